@@ -0,0 +1,469 @@
+#include "program_gen.h"
+#include "ast.h"
+#include "global.h"
+#include "ir_cfg.h"
+#include "ir_gen.h"
+#include "ir_optimize.h"
+#include "lex.h"
+#include "semantic.h"
+#include "str_hash.h"
+#include "syntax.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_DIR "/tmp/squirrel_bench"
+#define BENCH_TOLERANCE 25 // percent a metric could be worse than the baseline
+#define BENCH_MAX_INPUTS 16
+#define BENCH_MIN_TIME 1.0     // seconds an input is compiled again & again for, at least once
+#define BENCH_MIN_LEX_TIME 0.1 // lexing is much faster than the rest, it is repeated in a round
+#define BENCH_MAX_ROUNDS 10
+#define BENCH_RETRIES 2      // runs again of an input regressed, so one slow run on a busy machine is not a regression
+#define BENCH_UPDATE_RUNS 3 // the baseline is the median of runs, not a lucky fast one
+
+// generated inputs of the default corpus
+struct BenchInput {
+    char             *name;
+    struct GenOptions options;
+};
+
+static struct BenchInput default_inputs[] = {
+    {"small",  {.depth = 3, .locals = 2, .loop_density = 40, .size = 100 * 1024, .seed = 1}      },
+    {"medium", {.depth = 3, .locals = 2, .loop_density = 40, .size = 1024 * 1024, .seed = 2}     },
+    {"large",  {.depth = 3, .locals = 2, .loop_density = 40, .size = 8 * 1024 * 1024, .seed = 3} },
+    {"deep",   {.depth = 8, .locals = 1, .loop_density = 50, .size = 1024 * 1024, .seed = 4}     },
+    {"wide",   {.depth = 1, .locals = 16, .loop_density = 20, .size = 1024 * 1024, .seed = 5}    },
+};
+
+enum Metric {
+    METRIC_LEX,      // tokens/s
+    METRIC_PARSE,    // nodes/s, lexing included
+    METRIC_SEMANTIC, // nodes/s
+    METRIC_IR_GEN,   // tacs/s
+    METRIC_CFG,      // tacs/s
+    METRIC_OPTIMIZE, // tacs/s of the unoptimized tac
+    METRIC_RSS,      // peak KB
+    METRIC_SIZE,
+};
+
+static char *metric_names[] = {
+    [METRIC_LEX] = "lex",
+    [METRIC_PARSE] = "parse",
+    [METRIC_SEMANTIC] = "semantic",
+    [METRIC_IR_GEN] = "ir_gen",
+    [METRIC_CFG] = "cfg",
+    [METRIC_OPTIMIZE] = "optimize",
+    [METRIC_RSS] = "rss_kb",
+};
+
+// measured in a child process, so the peak rss is of the input only
+struct BenchResult {
+    bool     ok;
+    long     bytes;
+    long     tokens;
+    long     nodes;
+    long     tacs;
+    double   metrics[METRIC_SIZE];
+    uint64_t hash;   // of the source, tells if the generator changed since the baseline
+    int      rounds; // compiles of the input, the best throughput of them is taken
+};
+
+struct Baseline {
+    char     name[64];
+    double   metrics[METRIC_SIZE];
+    uint64_t hash;
+};
+
+static double _wall_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// phases are timed by the cpu time of the child, time spent on other processes of a busy machine is not counted
+static double _cpu_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long _count_tac(struct TAC *tac) {
+    long size = 0;
+    for (; tac; tac = tac->next) size += tac->op != TAC_HEAD;
+    return size;
+}
+
+static double _per_second(long count, double time) {
+    return time > 0 ? count / time : 0;
+}
+
+static uint64_t _hash_file(char *path, long *bytes) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    fseek(f, 0, SEEK_END);
+    *bytes = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = malloc(*bytes + 1);
+    if (!buf) {
+        fprintf(stderr, "_hash_file(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    uint64_t hash = fread(buf, 1, *bytes, f) == *bytes ? str_hash64(buf, *bytes) : 0;
+    fclose(f);
+    free(buf);
+    return hash;
+}
+
+// each phase once, on the output of the one before
+static void _run_phases(char *path, struct BenchResult *result) {
+    result->hash = _hash_file(path, &result->bytes);
+
+    double lex_start = _cpu_time(), start;
+    do {
+        if (!lex_init(path, false)) return;
+        result->tokens = 0;
+        start = _cpu_time();
+        while (lex_next() != _eof) result->tokens++;
+        double throughput = _per_second(result->tokens, _cpu_time() - start);
+        if (throughput > result->metrics[METRIC_LEX]) result->metrics[METRIC_LEX] = throughput;
+    } while (_cpu_time() - lex_start < BENCH_MIN_LEX_TIME);
+
+    if (!lex_init(path, false)) return;
+    reset_ast_node_id();
+    reset_tac_var_id();
+    start = _cpu_time();
+    struct AstNode *root = parse();
+    result->nodes = ast_node_count();
+    result->metrics[METRIC_PARSE] = _per_second(result->nodes, _cpu_time() - start);
+
+    start = _cpu_time();
+    manage_scope(root, NULL, false);
+    check_node_type(root, NULL, NULL, false);
+    check_stmt(root, false, false);
+    result->metrics[METRIC_SEMANTIC] = _per_second(result->nodes, _cpu_time() - start);
+
+    struct TAC *tac = CREATE_STRUCT_P(TAC);
+    tac->op = TAC_HEAD;
+    struct TAC *root_tac = tac;
+    start = _cpu_time();
+    gen_tac_from_ast(root, &tac, NULL);
+    double ir_gen_time = _cpu_time() - start;
+    result->tacs = _count_tac(root_tac);
+    result->metrics[METRIC_IR_GEN] = _per_second(result->tacs, ir_gen_time);
+
+    start = _cpu_time();
+    struct CFG *cfg = create_cfg(root_tac);
+    result->metrics[METRIC_CFG] = _per_second(result->tacs, _cpu_time() - start);
+
+    start = _cpu_time();
+    optimize_tac(cfg, NULL);
+    result->metrics[METRIC_OPTIMIZE] = _per_second(result->tacs, _cpu_time() - start);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    result->metrics[METRIC_RSS] = usage.ru_maxrss;
+    result->ok = true;
+}
+
+// small inputs are compiled more than once, their times are too short to compare otherwise
+static void _run_rounds(char *path, struct BenchResult *result) {
+    struct BenchResult round;
+    double             start = _wall_time();
+    for (int i = 0; i < BENCH_MAX_ROUNDS && (!i || _wall_time() - start < BENCH_MIN_TIME); i++) {
+        memset(&round, 0, sizeof(struct BenchResult));
+        _run_phases(path, &round);
+        if (!round.ok) return;
+
+        // the rss of the first round, the trees of a round are not freed & add to the rss of the next one
+        if (!i) *result = round;
+        for (int m = 0; m < METRIC_RSS; m++)
+            if (round.metrics[m] > result->metrics[m]) result->metrics[m] = round.metrics[m];
+        result->rounds = i + 1;
+    }
+}
+
+static bool _bench_file(char *path, struct BenchResult *result) {
+    memset(result, 0, sizeof(struct BenchResult));
+    int fds[2];
+    if (pipe(fds)) return false;
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        close(fds[0]);
+        _run_rounds(path, result);
+        write(fds[1], result, sizeof(struct BenchResult));
+        _exit(0);
+    }
+    close(fds[1]);
+    bool ok = read(fds[0], result, sizeof(struct BenchResult)) == sizeof(struct BenchResult) && result->ok;
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+    return ok;
+}
+
+static bool _gen_file(char *path, struct GenOptions *options) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "can not open file: %s\n", path);
+        return false;
+    }
+    gen_program(out, options);
+    return !fclose(out);
+}
+
+static int _load_baseline(char *path, struct Baseline *baseline, int cap) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+
+    int  size = 0;
+    char line[256], name[64], metric[32], value[64];
+    while (fgets(line, sizeof(line), f)) {
+        if (*line == '#' || sscanf(line, "%63s %31s %63s", name, metric, value) != 3) continue;
+
+        int i = 0;
+        while (i < size && strcmp(baseline[i].name, name)) i++;
+        if (i == size) {
+            if (size == cap) break;
+            memset(&baseline[size], 0, sizeof(struct Baseline));
+            strcpy(baseline[size++].name, name);
+        }
+        if (!strcmp(metric, "hash")) baseline[i].hash = strtoull(value, NULL, 16);
+        for (int m = 0; m < METRIC_SIZE; m++)
+            if (!strcmp(metric, metric_names[m])) baseline[i].metrics[m] = atof(value);
+    }
+    fclose(f);
+    return size;
+}
+
+static bool _store_baseline(char *path, char **names, struct BenchResult *results, int size) {
+    FILE *f = fopen(path, "w");
+    if (!f) return false;
+
+    fprintf(f, "# squirrel_bench baseline: <input> <metric> <value>, throughput per second, rss in KB\n");
+    fprintf(f, "# written by squirrel_bench --update, only comparable on the machine it was written on\n");
+    for (int i = 0; i < size; i++) {
+        fprintf(f, "%s hash %016llx\n", names[i], (unsigned long long)results[i].hash);
+        for (int m = 0; m < METRIC_SIZE; m++) fprintf(f, "%s %s %.0f\n", names[i], metric_names[m], results[i].metrics[m]);
+    }
+    return !fclose(f);
+}
+
+static struct Baseline *_find_baseline(char *name, struct Baseline *baseline, int baseline_size) {
+    for (int i = 0; i < baseline_size; i++)
+        if (!strcmp(baseline[i].name, name)) return &baseline[i];
+    return NULL;
+}
+
+// regressions of result against the baseline of the input, throughput lower or rss higher than tolerance allows
+static int _check_baseline(char *name, struct BenchResult *result, struct Baseline *b, int tolerance, bool print) {
+    int regressions = 0;
+    for (int m = 0; m < METRIC_SIZE; m++) {
+        double base = b->metrics[m], value = result->metrics[m];
+        if (base <= 0) continue;
+
+        double change = (value - base) * 100 / base;
+        bool   worse = m == METRIC_RSS ? change > tolerance : change < -tolerance;
+        if (!worse) continue;
+
+        if (print) printf("%-8s %-9s regressed %+.1f%%: %.0f, baseline %.0f\n", name, metric_names[m], change, value, base);
+        regressions++;
+    }
+    return regressions;
+}
+
+static int _compare_double(const void *a, const void *b) {
+    double x = *(double *)a, y = *(double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// median of each metric over the runs of an input, counts are the same in every run
+static bool _bench_median(char *path, struct BenchResult *result) {
+    struct BenchResult runs[BENCH_UPDATE_RUNS];
+    for (int r = 0; r < BENCH_UPDATE_RUNS; r++)
+        if (!_bench_file(path, &runs[r])) return false;
+
+    *result = runs[0];
+    for (int m = 0; m < METRIC_SIZE; m++) {
+        double values[BENCH_UPDATE_RUNS];
+        for (int r = 0; r < BENCH_UPDATE_RUNS; r++) values[r] = runs[r].metrics[m];
+        qsort(values, BENCH_UPDATE_RUNS, sizeof(double), _compare_double);
+        result->metrics[m] = values[BENCH_UPDATE_RUNS / 2];
+    }
+    return true;
+}
+
+static void _print_header() {
+    printf("%-8s %6s %10s %9s %9s %9s %11s %11s %11s %11s %11s %11s %9s\n",
+           "input",
+           "rounds",
+           "bytes",
+           "tokens",
+           "nodes",
+           "tacs",
+           "lex tok/s",
+           "parse nd/s",
+           "sema nd/s",
+           "irgen tac/s",
+           "cfg tac/s",
+           "opt tac/s",
+           "rss MB");
+}
+
+static void _print_result(char *name, struct BenchResult *r) {
+    printf("%-8s %6d %10ld %9ld %9ld %9ld %11.0f %11.0f %11.0f %11.0f %11.0f %11.0f %9.1f\n",
+           name,
+           r->rounds,
+           r->bytes,
+           r->tokens,
+           r->nodes,
+           r->tacs,
+           r->metrics[METRIC_LEX],
+           r->metrics[METRIC_PARSE],
+           r->metrics[METRIC_SEMANTIC],
+           r->metrics[METRIC_IR_GEN],
+           r->metrics[METRIC_CFG],
+           r->metrics[METRIC_OPTIMIZE],
+           r->metrics[METRIC_RSS] / 1024);
+}
+
+static void _usage() {
+    printf("usage: squirrel_bench gen [<knobs>] [-o <file.sl>]\n");
+    printf("       squirrel_bench [--baseline=<file>] [--update] [--tolerance=<percent>] [--dir=<dir>] [<knobs> | <file.sl>...]\n");
+    printf("  gen          write a generated program to the file or stdout\n");
+    printf("  --funcs=N    functions generated, 100 by default, ignored if --size is set\n");
+    printf("  --depth=N    nesting of if & for blocks, 3 by default, no more than %d\n", GEN_MAX_DEPTH);
+    printf("  --locals=N   ints declared in each block, 2 by default, no more than %d\n", GEN_MAX_LOCALS);
+    printf("  --loops=P    percent of nested blocks which are loops, 40 by default\n");
+    printf("  --size=S     generate till the file reaches S bytes, K & M suffixes, no more than 100M\n");
+    printf("  --seed=N     programs of the same knobs & seed are the same, 1 by default\n");
+    printf("  --baseline   compare with the baseline, exit with 1 if any metric regressed\n");
+    printf("  --update     write the results as the baseline instead, the median of %d runs of each input\n", BENCH_UPDATE_RUNS);
+    printf("  --tolerance  percent a metric could be worse than the baseline, %d by default\n", BENCH_TOLERANCE);
+    printf("  --dir        dir of the generated corpus, " BENCH_DIR " by default\n");
+    printf("  runs each phase on the default corpus, or on one program of the knobs given, or on the files\n");
+}
+
+static int _gen(int argc, char **argv) {
+    struct GenOptions options = default_gen_options();
+    char             *path = NULL;
+    for (int i = 0; i < argc; i++) {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc) path = argv[++i];
+        else if (!parse_gen_option(argv[i], &options)) {
+            _usage();
+            return 1;
+        }
+    }
+    if (!path) {
+        gen_program(stdout, &options);
+        return 0;
+    }
+    return _gen_file(path, &options) ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 2 && !strcmp(argv[1], "gen")) return _gen(argc - 2, argv + 2);
+
+    char             *baseline_path = NULL, *dir = BENCH_DIR;
+    char             *files[BENCH_MAX_INPUTS];
+    int               file_size = 0, tolerance = BENCH_TOLERANCE;
+    bool              update = false, knobs = false;
+    struct GenOptions options = default_gen_options();
+    for (int i = 1; i < argc; i++) {
+        char *arg = argv[i];
+        if (!strncmp(arg, "--baseline=", 11)) baseline_path = arg + 11;
+        else if (!strcmp(arg, "--update")) update = true;
+        else if (!strncmp(arg, "--tolerance=", 12)) tolerance = atoi(arg + 12);
+        else if (!strncmp(arg, "--dir=", 6)) dir = arg + 6;
+        else if (parse_gen_option(arg, &options)) knobs = true;
+        else if (*arg != '-' && file_size < BENCH_MAX_INPUTS) files[file_size++] = arg;
+        else {
+            _usage();
+            return 1;
+        }
+    }
+    if (update && !baseline_path) {
+        _usage();
+        return 1;
+    }
+
+    // inputs are the files given, or generated into dir
+    char *names[BENCH_MAX_INPUTS], paths[BENCH_MAX_INPUTS][1024];
+    int   size = 0;
+    if (file_size) {
+        for (; size < file_size; size++) {
+            char *name = strrchr(files[size], '/');
+            names[size] = name ? name + 1 : files[size];
+            snprintf(paths[size], sizeof(paths[size]), "%s", files[size]);
+        }
+    } else {
+        mkdir(dir, 0755);
+        struct BenchInput  custom = {"custom", options};
+        struct BenchInput *inputs = knobs ? &custom : default_inputs;
+        int                input_size = knobs ? 1 : sizeof(default_inputs) / sizeof(default_inputs[0]);
+        for (; size < input_size; size++) {
+            names[size] = inputs[size].name;
+            snprintf(paths[size], sizeof(paths[size]), "%s/%s.sl", dir, names[size]);
+            if (!_gen_file(paths[size], &inputs[size].options)) return 1;
+        }
+    }
+
+    struct BenchResult results[BENCH_MAX_INPUTS];
+    _print_header();
+    for (int i = 0; i < size; i++) {
+        if (!(update ? _bench_median(paths[i], &results[i]) : _bench_file(paths[i], &results[i]))) {
+            fprintf(stderr, "can not compile: %s\n", paths[i]);
+            return 1;
+        }
+        _print_result(names[i], &results[i]);
+    }
+
+    if (!baseline_path) return 0;
+    if (update) {
+        if (!_store_baseline(baseline_path, names, results, size)) {
+            fprintf(stderr, "can not write baseline: %s\n", baseline_path);
+            return 1;
+        }
+        printf("baseline written: %s\n", baseline_path);
+        return 0;
+    }
+
+    struct Baseline baseline[BENCH_MAX_INPUTS];
+    int             baseline_size = _load_baseline(baseline_path, baseline, BENCH_MAX_INPUTS);
+    if (baseline_size < 0) {
+        fprintf(stderr, "can not read baseline: %s\n", baseline_path);
+        return 1;
+    }
+    int regressions = 0;
+    for (int i = 0; i < size; i++) {
+        struct Baseline *b = _find_baseline(names[i], baseline, baseline_size);
+        if (!b) {
+            printf("%-8s not in the baseline\n", names[i]);
+            continue;
+        }
+        if (b->hash != results[i].hash) {
+            printf("%-8s generated differently from the baseline, not compared\n", names[i]);
+            continue;
+        }
+
+        // the best of the runs is compared
+        struct BenchResult retry;
+        for (int r = 0; r < BENCH_RETRIES && _check_baseline(names[i], &results[i], b, tolerance, false); r++) {
+            if (!_bench_file(paths[i], &retry)) break;
+            for (int m = 0; m < METRIC_RSS; m++)
+                if (retry.metrics[m] > results[i].metrics[m]) results[i].metrics[m] = retry.metrics[m];
+            if (retry.metrics[METRIC_RSS] < results[i].metrics[METRIC_RSS]) results[i].metrics[METRIC_RSS] = retry.metrics[METRIC_RSS];
+            printf("%-8s run again\n", names[i]);
+        }
+        regressions += _check_baseline(names[i], &results[i], b, tolerance, true);
+    }
+    printf("%d regressions against %s, tolerance %d%%\n", regressions, baseline_path, tolerance);
+    return regressions ? 1 : 0;
+}
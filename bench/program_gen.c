@@ -0,0 +1,256 @@
+#include "program_gen.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GEN_MAX_VARS 1024
+#define GEN_VAR_NAME_LEN 16
+
+struct ProgramGen {
+    FILE              *out;
+    struct GenOptions *options;
+    uint64_t           rng;
+    size_t             size;
+    int                indent;
+    int                func; // index of the function generated
+
+    // vars visible in the current block, outer ones first
+    char vars[GEN_MAX_VARS][GEN_VAR_NAME_LEN];
+    bool assignable[GEN_MAX_VARS]; // loop counters are only read, so loops keep their trip counts
+    int  var_size;
+};
+
+struct GenOptions default_gen_options() {
+    return (struct GenOptions){.funcs = 100, .depth = 3, .locals = 2, .loop_density = 40, .seed = 1};
+}
+
+// xorshift64*, programs do not depend on rand() of the libc
+static uint32_t _rand(struct ProgramGen *g) {
+    g->rng ^= g->rng >> 12;
+    g->rng ^= g->rng << 25;
+    g->rng ^= g->rng >> 27;
+    return (g->rng * 0x2545F4914F6CDD1DULL) >> 32;
+}
+
+static int _rand_below(struct ProgramGen *g, int n) {
+    return n > 0 ? _rand(g) % n : 0;
+}
+
+static void _emit(struct ProgramGen *g, char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int len = vfprintf(g->out, fmt, args);
+    va_end(args);
+    if (len > 0) g->size += len;
+}
+
+static void _line(struct ProgramGen *g) {
+    _emit(g, "%*s", g->indent * 4, "");
+}
+
+static void _add_var(struct ProgramGen *g, bool assignable, char *fmt, ...) {
+    if (g->var_size == GEN_MAX_VARS) {
+        fprintf(stderr, "_add_var(), too many vars in scope\n");
+        exit(EXIT_FAILURE);
+    }
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(g->vars[g->var_size], GEN_VAR_NAME_LEN, fmt, args);
+    va_end(args);
+    g->assignable[g->var_size++] = assignable;
+}
+
+static char *_any_var(struct ProgramGen *g) {
+    return g->vars[_rand_below(g, g->var_size)];
+}
+
+// the params are always assignable, so there is one
+static char *_assignable_var(struct ProgramGen *g) {
+    for (;;) {
+        int i = _rand_below(g, g->var_size);
+        if (g->assignable[i]) return g->vars[i];
+    }
+}
+
+static void _gen_expr(struct ProgramGen *g, int depth) {
+    int kind = _rand_below(g, 10);
+    if (depth == 0 || kind < 3) {
+        if (kind % 3 == 0) _emit(g, "%d", _rand_below(g, 100));
+        else _emit(g, "%s", _any_var(g));
+        return;
+    }
+    if (kind == 3 && g->func > 0) {
+        _emit(g, "f%d(", _rand_below(g, g->func));
+        _gen_expr(g, depth - 1);
+        _emit(g, ", ");
+        _gen_expr(g, depth - 1);
+        _emit(g, ")");
+        return;
+    }
+    // divisors are non zero literals
+    if (kind == 4) {
+        _emit(g, "(");
+        _gen_expr(g, depth - 1);
+        _emit(g, " %% %d)", 1 + _rand_below(g, 13));
+        return;
+    }
+
+    static char *ops[] = {"+", "-", "*", "&", "|", "^"};
+    _emit(g, "(");
+    _gen_expr(g, depth - 1);
+    _emit(g, " %s ", ops[_rand_below(g, sizeof(ops) / sizeof(ops[0]))]);
+    _gen_expr(g, depth - 1);
+    _emit(g, ")");
+}
+
+static void _gen_cond(struct ProgramGen *g) {
+    static char *cmps[] = {"<", "<=", ">", ">=", "==", "!="};
+    _gen_expr(g, 1);
+    _emit(g, " %s ", cmps[_rand_below(g, sizeof(cmps) / sizeof(cmps[0]))]);
+    _gen_expr(g, 1);
+}
+
+static void _gen_block(struct ProgramGen *g, int depth);
+
+static void _gen_nested(struct ProgramGen *g, int depth) {
+    if (_rand_below(g, 100) < g->options->loop_density) {
+        _line(g);
+        _emit(g, "for (int i%d = 0; i%d < %d; i%d++) {\n", depth, depth, 2 + _rand_below(g, 8), depth);
+        int var_size = g->var_size;
+        _add_var(g, false, "i%d", depth);
+        _gen_block(g, depth + 1);
+        g->var_size = var_size;
+        _line(g);
+        _emit(g, "};\n");
+        return;
+    }
+
+    _line(g);
+    _emit(g, "if (");
+    _gen_cond(g);
+    _emit(g, ") {\n");
+    _gen_block(g, depth + 1);
+    if (_rand_below(g, 4) == 0) {
+        _line(g);
+        _emit(g, "} elseif (");
+        _gen_cond(g);
+        _emit(g, ") {\n");
+        _gen_block(g, depth + 1);
+    }
+    if (_rand_below(g, 2) == 0) {
+        _line(g);
+        _emit(g, "} else {\n");
+        _gen_block(g, depth + 1);
+    }
+    _line(g);
+    _emit(g, "};\n");
+}
+
+// locals, then assignments & nested blocks, locals are named by depth, so they never shadow outer ones
+static void _gen_block(struct ProgramGen *g, int depth) {
+    int var_size = g->var_size;
+    g->indent++;
+    for (int i = 0; i < g->options->locals; i++) {
+        _line(g);
+        _emit(g, "int v%d_%d = ", depth, i);
+        _gen_expr(g, 2);
+        _emit(g, ";\n");
+        _add_var(g, true, "v%d_%d", depth, i);
+    }
+
+    int stmts = 1 + _rand_below(g, 3);
+    for (int i = 0; i < stmts; i++) {
+        if (depth < g->options->depth && _rand_below(g, 100) < 60) {
+            _gen_nested(g, depth);
+            continue;
+        }
+        _line(g);
+        _emit(g, "%s = ", _assignable_var(g));
+        _gen_expr(g, 2);
+        _emit(g, ";\n");
+    }
+    g->indent--;
+    g->var_size = var_size;
+}
+
+static void _gen_func(struct ProgramGen *g) {
+    _line(g);
+    _emit(g, "func f%d(int a, int b) int {\n", g->func);
+    g->var_size = 0;
+    _add_var(g, true, "a");
+    _add_var(g, true, "b");
+    _gen_block(g, 0);
+
+    g->indent++;
+    _line(g);
+    _emit(g, "return ");
+    _gen_expr(g, 2);
+    _emit(g, ";\n");
+    g->indent--;
+    _line(g);
+    _emit(g, "};\n");
+
+    _line(g);
+    _emit(g, "total = total + f%d(%d, %d);\n", g->func, _rand_below(g, 100), _rand_below(g, 100));
+    g->func++;
+}
+
+size_t gen_program(FILE *out, struct GenOptions *options) {
+    struct ProgramGen *g = calloc(1, sizeof(struct ProgramGen));
+    if (!g) {
+        fprintf(stderr, "gen_program(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    g->out = out;
+    g->options = options;
+    // xorshift never leaves 0
+    g->rng = options->seed * 0x9E3779B97F4A7C15ULL + 1;
+    if (!g->rng) g->rng = 1;
+
+    size_t size = options->size < GEN_MAX_SIZE ? options->size : GEN_MAX_SIZE;
+    _emit(g, "{\n");
+    g->indent = 1;
+    _line(g);
+    _emit(g, "int total = 0;\n");
+    while (size ? g->size < size : g->func < options->funcs) _gen_func(g);
+    _emit(g, "}\n");
+
+    size = g->size;
+    free(g);
+    return size;
+}
+
+static bool _parse_int_knob(char *arg, char *name, int min, int max, int *value) {
+    int len = strlen(name);
+    if (strncmp(arg, name, len) || arg[len] != '=') return false;
+
+    char *end;
+    long  v = strtol(arg + len + 1, &end, 10);
+    if (*end || end == arg + len + 1 || v < min || v > max) return false;
+    *value = v;
+    return true;
+}
+
+// size takes a K or M suffix
+static bool _parse_size(char *s, size_t *size) {
+    char  *end;
+    double v = strtod(s, &end);
+    if (end == s || v < 0) return false;
+    if (*end == 'K' || *end == 'k') v *= 1024, end++;
+    else if (*end == 'M' || *end == 'm') v *= 1024 * 1024, end++;
+    if (*end || v > GEN_MAX_SIZE) return false;
+    *size = v;
+    return true;
+}
+
+bool parse_gen_option(char *arg, struct GenOptions *options) {
+    if (!strncmp(arg, "--size=", 7)) return _parse_size(arg + 7, &options->size);
+    if (!strncmp(arg, "--seed=", 7)) {
+        char *end;
+        options->seed = strtoull(arg + 7, &end, 10);
+        return *end == '\0' && end != arg + 7;
+    }
+    return _parse_int_knob(arg, "--funcs", 1, 1 << 24, &options->funcs) || _parse_int_knob(arg, "--depth", 0, GEN_MAX_DEPTH, &options->depth) ||
+           _parse_int_knob(arg, "--locals", 0, GEN_MAX_LOCALS, &options->locals) || _parse_int_knob(arg, "--loops", 0, 100, &options->loop_density);
+}
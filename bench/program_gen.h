@@ -0,0 +1,35 @@
+#ifndef PROGRAM_GEN_H
+#define PROGRAM_GEN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define GEN_MAX_SIZE (100 * 1024 * 1024)
+#define GEN_MAX_DEPTH 16
+#define GEN_MAX_LOCALS 32
+
+struct GenOptions {
+    int      funcs;        // functions generated, ignored if size is set
+    int      depth;        // nesting of if & for blocks in a function, 0 means straight line code
+    int      locals;       // int vars declared in each block
+    int      loop_density; // percent of nested blocks which are for loops, the others are if/else
+    size_t   size;         // if not 0, functions are generated till the file reaches size bytes, no more than GEN_MAX_SIZE
+    uint64_t seed;
+};
+
+/*
+ * Deterministic .sl program, the same options always give the same bytes.
+ * Functions are declared in the top level block, each one reads its params & locals, calls functions declared before it,
+ * & is called once from the top level code, so every function is reachable.
+ * Programs only use ints, loops have constant trip counts & no function is recursive, so they terminate,
+ * but calls nest deeply in big programs, they are meant to be compiled rather than run.
+ */
+struct GenOptions default_gen_options();
+// bytes written
+size_t            gen_program(FILE *out, struct GenOptions *options);
+// parse the knob of "--funcs=N" like args, false if arg is not a knob or illegal
+bool              parse_gen_option(char *arg, struct GenOptions *options);
+
+#endif
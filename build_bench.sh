@@ -0,0 +1,6 @@
+rm -rf build
+cmake -B build -DNEED_BENCH=ON
+cmake --build build
+
+# --update writes the baseline of this machine, compared by later runs
+bin/squirrel_bench --baseline=bench/baseline.txt "$@"
@@ -3,6 +3,9 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+
+#include "str_hash.h"
 
 typedef unsigned int uint;
 
@@ -176,22 +179,23 @@ static uint round_up_power_of_2(uint n) {
     return n;
 }
 
+// xor-multiply-xor, the high bits of a hash reach the low bits picking the bucket
 static int int_hash(int i) {
-    return (i == 0) ? 0 : i ^ (i >> 16);
+    uint h = (uint)i;
+    h ^= h >> 16;
+    h *= 0x45d9f3bu;
+    h ^= h >> 16;
+    return (int)h;
 }
 
 static int hash(hash_func hash_f, void *k) {
     return int_hash(hash_f(k));
 }
 
+// entries cache the hash, so it is computed once per key put
 static int str_hash_func(void *k) {
-    int         h = 0;
-    const char *c = (char *)k;
-    while (*c != '\0') {
-        h += h * 7 + *c;
-        c++;
-    }
-    return h;
+    uint64_t h = str_hash64((char *)k, strlen((char *)k));
+    return (int)(uint)(h ^ h >> 32);
 }
 
 static int ptr_hash_func(void *k) {
@@ -1,6 +1,180 @@
+#include "vm.h"
+#include "jit.h"
+#include "x86_64.h"
+#include "c_source.h"
+#include "driver.h"
+#include "ir_cache.h"
+#include "ir_file.h"
+#include "ir_optimize.h"
+#include "server.h"
+#include "time_report.h"
+#include "trace.h"
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void _usage() {
+    printf("usage: squirrel run [--interp | --jit] <file.sl>\n");
+    printf("       squirrel build [--ra-stats | --c] <file.sl> [-o <exe>]\n");
+    printf("       squirrel [-O0 | -O1 | -O2 | --passes=<list>] [--disable-pass=<name>]... [--list-passes] [--pass-stats] [--emit=ast|tac|cfg|asm|ir] [-j <jobs>] [-o <dir>] [--cache=<dir>] [--time-report[=table|json]] [--trace=<file>] [-v] <file.sl>...\n");
+    printf("       squirrel dump <file.sqir>\n");
+    printf("       squirrel --server <socket>\n");
+    printf("       squirrel --connect <socket> [--stop | <options> <file.sl>...]\n");
+    printf("  --interp    run the TAC interpreter instead of the bytecode vm\n");
+    printf("  --jit       run the TAC interpreter, hot funcs are compiled to machine code\n");
+    printf("  --ra-stats  print intervals, splits & spills of the register allocation of each func\n");
+    printf("  --c         emit C instead of assembly, compiled by cc -O2, the source is kept in <exe>.c\n");
+    printf("  -o          native executable, a.out by default, the assembly is kept in <exe>.s\n");
+    printf("  -O          optimization level of the files compiled, -O2 by default\n");
+    printf("  --passes    comma separated passes run in place of the -O level, like simplifycfg,constprop,dce, from:\n");
+    printf("              simplifycfg, constprop, coalesce, copyprop, dce & peephole\n");
+    printf("  --disable-pass\n");
+    printf("              skip the pass wherever it is in the pipeline, could be given more than once\n");
+    printf("  --list-passes\n");
+    printf("              print the passes registered & whether each runs forward, backward or on a whole func\n");
+    printf("  --pass-stats\n");
+    printf("              print runs, time & tac removed of each pass over all files at the end\n");
+    printf("  --emit      output of each file, <name>.ast, .tac, .cfg, .s (asm, by default) or .sqir (binary ir)\n");
+    printf("              .sqir files are taken by run, build & the driver in place of sources, dump prints one\n");
+    printf("  -j          files compiled in parallel, one per cpu by default, jobs left over by fewer files optimize funcs of each file\n");
+    printf("  -o <dir>    dir of the outputs, next to each file by default\n");
+    printf("  --cache     dir caching the optimized tac of each source, $" IR_CACHE_ENV " by default, also used by run & build\n");
+    printf("  --time-report\n");
+    printf("              print time & allocations of each phase of the compile to stderr, as a table by default or json,\n");
+    printf("              $" TIME_REPORT_ENV "=table|json by default, also used by run & build\n");
+    printf("  --trace     write a chrome trace of phases, funcs & passes of the compile, loaded by Perfetto,\n");
+    printf("              $" TRACE_ENV "=<file> by default, run & build also trace calls of the program\n");
+    printf("  -v          print time & output of each file\n");
+    printf("  --server    stay resident & compile files sent to the socket, unchanged files are not compiled again\n");
+    printf("  --connect   send the options & files to the server instead of compiling them, --stop stops the server\n");
+}
+
+// optimized tac of the file resolved for execution, NULL if the file can not be opened
+static struct Interp *_compile(char *filepath, struct CFG **cfg_out) {
+    enum TimeReportFormat format = TIME_REPORT_NONE;
+    char                 *time_report = getenv(TIME_REPORT_ENV);
+    if (time_report && !parse_time_report_format(time_report, &format)) fprintf(stderr, "unknown $" TIME_REPORT_ENV ": %s\n", time_report);
+    if (format) time_report_start();
+
+    struct PassPipeline *pipeline = create_opt_level_pipeline(2);
+    struct CFG          *cfg = compile_to_cfg(filepath, pipeline, getenv(IR_CACHE_ENV), NULL, NULL);
+    free_pass_pipeline(pipeline);
+    if (format) {
+        struct TimeReport report = {0};
+        time_report_stop(&report);
+        fprint_time_report(stderr, &report, format);
+    }
+    if (!cfg) return NULL;
+
+    if (cfg_out) *cfg_out = cfg;
+    return create_interp(cfg->tac);
+}
+
+// written at exit, the trace of a failed compile or run is kept
+static void _start_trace() {
+    char *trace_file = getenv(TRACE_ENV);
+    if (trace_file && !trace_start(trace_file)) fprintf(stderr, "can not write trace: %s\n", trace_file);
+}
+
+static int _run(char *filepath, bool use_interp, bool use_jit) {
+    _start_trace();
+    struct Interp *interp = _compile(filepath, NULL);
+    if (!interp) return 1;
+
+    if (use_interp || use_jit) {
+        if (use_jit) interp->jit = create_jit(interp, JIT_HOT_CALLS);
+        interp_run(interp);
+        print_interp_globals(interp);
+        free_jit(interp->jit);
+    } else {
+        struct Bytecode *bc = create_bytecode(interp);
+        struct VM       *vm = create_vm(bc);
+        vm_run(vm);
+        print_vm_globals(vm);
+        free_vm(vm);
+        free_bytecode(bc);
+    }
+    free_interp(interp);
+    return 0;
+}
+
+static int _build(char *filepath, char *exe_path, bool ra_stats, bool emit_source) {
+    _start_trace();
+    struct CFG    *cfg;
+    struct Interp *interp = _compile(filepath, &cfg);
+    if (!interp) return 1;
+
+    char out_path[1024];
+    snprintf(out_path, sizeof(out_path), "%s.%s", exe_path, emit_source ? "c" : "s");
+    FILE *out = fopen(out_path, "w");
+    if (!out) {
+        fprintf(stderr, "can not open file: %s\n", out_path);
+        return 1;
+    }
+    if (emit_source) emit_c(interp, out);
+    else {
+        struct RegAlloc *ra = emit_x86_64(interp, cfg, out);
+        if (ra_stats) print_reg_alloc_stats(ra);
+        free_reg_alloc(ra);
+    }
+    fclose(out);
+    free_interp(interp);
+    free_cfg(cfg);
+    if (emit_source) return compile_c(out_path, exe_path) ? 0 : 1;
+    return link_native(out_path, exe_path) ? 0 : 1;
+}
+
+// squirrel [options] <file.sl>..., returns -1 if the arguments are illegal
+static int _compile_files(int argc, char **argv) {
+    struct DriverOptions options;
+    char               **files = calloc(argc, sizeof(char *));
+    int                  size;
+    bool                 legal = parse_driver_args(argc - 1, argv + 1, &options, files, &size);
+    if (legal && options.list_passes) {
+        print_opt_passes();
+        free(files);
+        return 0;
+    }
 
-int main() {
-    printf("squirrel !\n");
+    int failed = legal && size ? compile_files(files, size, &options) : -1;
+    free(files);
+    return failed;
+}
+
+static int _dump(char *filepath) {
+    struct IrFile *file = open_ir_file(filepath);
+    if (!file) {
+        fprintf(stderr, "can not open ir file: %s\n", filepath);
+        return 1;
+    }
+    fprint_ir_file(stdout, file);
+    close_ir_file(file);
     return 0;
 }
+
+int main(int argc, char **argv) {
+    if (argc == 3 && !strcmp(argv[1], "run")) return _run(argv[2], false, false);
+    if (argc == 4 && !strcmp(argv[1], "run") && !strcmp(argv[2], "--interp")) return _run(argv[3], true, false);
+    if (argc == 4 && !strcmp(argv[1], "run") && !strcmp(argv[2], "--jit")) return _run(argv[3], false, true);
+    if (argc >= 3 && !strcmp(argv[1], "build")) {
+        bool ra_stats = !strcmp(argv[2], "--ra-stats");
+        bool emit_source = !strcmp(argv[2], "--c");
+        int  k = ra_stats || emit_source ? 3 : 2;
+        if (argc == k + 1) return _build(argv[k], "a.out", ra_stats, emit_source);
+        if (argc == k + 3 && !strcmp(argv[k + 1], "-o")) return _build(argv[k], argv[k + 2], ra_stats, emit_source);
+    }
+    if (argc == 3 && !strcmp(argv[1], "dump")) return _dump(argv[2]);
+    if (argc == 3 && !strcmp(argv[1], "--server")) return run_compile_server(argv[2]);
+    if (argc >= 4 && !strcmp(argv[1], "--connect")) {
+        int failed = send_compile_request(argv[2], argc - 3, argv + 3);
+        return failed ? 1 : 0;
+    }
+    if (argc >= 2 && strcmp(argv[1], "run") && strcmp(argv[1], "build") && strcmp(argv[1], "dump")) {
+        int failed = _compile_files(argc, argv);
+        if (failed >= 0) return failed ? 1 : 0;
+    }
+
+    _usage();
+    return 1;
+}
@@ -4,6 +4,7 @@
 #include "position.h"
 #include "token.h"
 #include <stdbool.h>
+#include <stdio.h>
 
 enum NodeClass {
     CODE_FILE,
@@ -71,6 +72,7 @@ struct AstNode {
     struct Position *pos;
     bool             reachable;
     struct Scope    *scope;
+    struct Type     *type; // type of expr, set by the semantic pass
 
     enum NodeClass class;
     union {
@@ -95,6 +97,10 @@ struct AstNode {
 };
 
 struct AstNode *create_ast_node();
+// ids restart from 0, so labels named by ids do not depend on files parsed before on the thread
+void            reset_ast_node_id();
+// nodes created on the thread since the ids restart
+int             ast_node_count();
 
 // stmt
 struct CodeBlock {
@@ -193,5 +199,6 @@ struct ForCtrl {
 };
 
 void print_node(struct AstNode *node, int level, char *hint);
+void fprint_node(FILE *out, struct AstNode *node, int level, char *hint);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,440 @@
+#include "c_source.h"
+#include "native.h"
+#include "ir_gen.h"
+#include "ir_fold.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// declarators follow directly
+static char *c_types[] = {"int ", "int ", "float ", "bool ", "int ", "char *"};
+static char *c_fields[] = {"i", "i", "f", "b", "i", "s"};
+static char *c_cmps[] = {"==", "!=", "<", "<=", ">", ">="};
+
+struct CCtx {
+    struct Interp     *interp;
+    FILE              *out;
+    struct NativeInfo *info;
+
+    int func;  // func emitted
+    int depth; // params stored, not passed yet
+};
+
+static char *_c_type(enum TacType type) {
+    return c_types[type <= TAC_TYPE_STRING ? type : TAC_TYPE_INT];
+}
+
+static char *_c_field(enum TacType type) {
+    return c_fields[type <= TAC_TYPE_STRING ? type : TAC_TYPE_INT];
+}
+
+static void _emit_string(FILE *out, char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\') fprintf(out, "\\%c", c);
+        else if (c < 32 || c >= 127) fprintf(out, "\\%03o", c);
+        else fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+// ---------------------Expressions---------------------
+
+static void _emit_ref(struct CCtx *ctx, struct Operand *o) {
+    FILE *out = ctx->out;
+    switch (o->kind) {
+        case OPERAND_LOCAL:
+        case OPERAND_OUTER: {
+            if (!o->func) fprintf(out, "g%d", o->index);
+            else if (o->func != ctx->func) fprintf(out, "sl_d%d->s%d", o->func, o->index);
+            else if (ctx->info->funcs[o->func].display) fprintf(out, "fr.s%d", o->index);
+            else fprintf(out, "s%d", o->index);
+            break;
+        }
+        case OPERAND_ARG: fprintf(out, "p%d", o->index); break;
+        default: {
+            fprintf(stderr, "emit_c(), operand without address\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// strings are never converted, the interpreter fails on them
+static bool _convertible(enum TacType src, enum TacType dst) {
+    return (src == TAC_TYPE_STRING) == (dst == TAC_TYPE_STRING);
+}
+
+static enum TacType _type_of(struct CCtx *ctx, struct Operand *o) {
+    enum TacType type = native_operand_type(ctx->info, ctx->func, o);
+    return type ? type : TAC_TYPE_INT;
+}
+
+static void _convert_open(FILE *out, enum TacType src, enum TacType dst) {
+    if (src == dst || (src != TAC_TYPE_FLOAT && dst != TAC_TYPE_FLOAT && dst != TAC_TYPE_BOOL)) return;
+    if (dst == TAC_TYPE_FLOAT) fprintf(out, "(float)(");
+    else if (dst == TAC_TYPE_BOOL) fprintf(out, "(");
+    else fprintf(out, "(int)(");
+}
+
+static void _convert_close(FILE *out, enum TacType src, enum TacType dst) {
+    if (src == dst || (src != TAC_TYPE_FLOAT && dst != TAC_TYPE_FLOAT && dst != TAC_TYPE_BOOL)) return;
+    fprintf(out, dst == TAC_TYPE_BOOL ? " != 0)" : ")");
+}
+
+static void _emit_lit(struct CCtx *ctx, struct Value *lit, enum TacType type) {
+    FILE *out = ctx->out;
+    if (type == TAC_TYPE_STRING) {
+        _emit_string(out, lit->s);
+        return;
+    }
+
+    struct Value v = value_convert(lit, type);
+    switch (type) {
+        case TAC_TYPE_FLOAT: {
+            if (isnan(v.f)) fprintf(out, "NAN");
+            else if (isinf(v.f)) fprintf(out, v.f > 0 ? "INFINITY" : "(-INFINITY)");
+            else fprintf(out, "%af", v.f);
+            break;
+        }
+        case TAC_TYPE_BOOL: fprintf(out, v.b ? "true" : "false"); break;
+        default: {
+            if (v.i == -2147483647 - 1) fprintf(out, "(-2147483647 - 1)");
+            else fprintf(out, v.i < 0 ? "(%d)" : "%d", v.i);
+        }
+    }
+}
+
+// value of o converted to type, the caller checks it is convertible
+static void _emit_value(struct CCtx *ctx, struct Operand *o, enum TacType type) {
+    if (o->kind == OPERAND_LIT) {
+        _emit_lit(ctx, &o->lit, type);
+        return;
+    }
+
+    enum TacType src = _type_of(ctx, o);
+    _convert_open(ctx->out, src, type);
+    _emit_ref(ctx, o);
+    _convert_close(ctx->out, src, type);
+}
+
+static enum TacType _value_type(struct CCtx *ctx, struct Operand *o) {
+    return o->kind == OPERAND_LIT ? o->lit.type : _type_of(ctx, o);
+}
+
+// error of x op y in type, NULL if the operation is legal
+static char *_illegal_op(struct CCtx *ctx, enum TacOpCode op, enum TacType type, struct Operand *x, struct Operand *y) {
+    bool cmp = op <= TAC_GE;
+    if (!_convertible(_value_type(ctx, x), type) || (y->kind != OPERAND_NONE && !_convertible(_value_type(ctx, y), type))) {
+        if (type == TAC_TYPE_STRING) return cmp ? "string compared with non-string" : "can not convert to string";
+        return "string used as number";
+    }
+
+    switch (type) {
+        case TAC_TYPE_STRING: return cmp ? NULL : "illegal operation on string";
+        case TAC_TYPE_FLOAT: return cmp || op <= TAC_QUO ? NULL : "illegal operation on float";
+        case TAC_TYPE_BOOL: return cmp || (op >= TAC_AND && op <= TAC_XOR) || op == TAC_NOT ? NULL : "illegal operation on bool";
+        default: return op <= TAC_NOT ? NULL : "illegal operation";
+    }
+}
+
+// x op y of type tac_res_type(op, type), ints wrap around like the interpreter
+static void _emit_binary(struct CCtx *ctx, enum TacOpCode op, enum TacType type, struct Operand *x, struct Operand *y) {
+    FILE *out = ctx->out;
+    if (op <= TAC_GE) {
+        fprintf(out, type == TAC_TYPE_STRING ? "strcmp(" : "(");
+        _emit_value(ctx, x, type);
+        fprintf(out, type == TAC_TYPE_STRING ? ", " : " %s ", c_cmps[op - TAC_EQ]);
+        _emit_value(ctx, y, type);
+        if (type == TAC_TYPE_STRING) fprintf(out, ") %s 0", c_cmps[op - TAC_EQ]);
+        else fprintf(out, ")");
+        return;
+    }
+    if (op == TAC_NOT) {
+        fprintf(out, type == TAC_TYPE_BOOL ? "!" : "~");
+        _emit_value(ctx, x, type);
+        return;
+    }
+
+    char *prefix = "(", *infix = NULL, *suffix = ")";
+    if (type == TAC_TYPE_FLOAT) infix = op == TAC_ADD ? " + " : op == TAC_SUB ? " - " : op == TAC_MUL ? " * " : " / ";
+    else if (type == TAC_TYPE_BOOL) infix = op == TAC_AND ? " && " : op == TAC_OR ? " || " : " != ";
+    else {
+        switch (op) {
+            case TAC_ADD: prefix = "(int)((unsigned)", infix = " + (unsigned)"; break;
+            case TAC_SUB: prefix = "(int)((unsigned)", infix = " - (unsigned)"; break;
+            case TAC_MUL: prefix = "(int)((unsigned)", infix = " * (unsigned)"; break;
+            case TAC_QUO: prefix = "sl_runtime_quo(", infix = ", "; break;
+            case TAC_REM: prefix = "sl_runtime_rem(", infix = ", "; break;
+            case TAC_AND: infix = " & "; break;
+            case TAC_OR: infix = " | "; break;
+            case TAC_XOR: infix = " ^ "; break;
+            case TAC_SHL: prefix = "(int)((unsigned)", infix = " << (", suffix = " & 31))"; break;
+            case TAC_SHR: infix = " >> (", suffix = " & 31))"; break;
+            default: break;
+        }
+    }
+    fprintf(out, "%s", prefix);
+    _emit_value(ctx, x, type);
+    fprintf(out, "%s", infix);
+    _emit_value(ctx, y, type);
+    fprintf(out, "%s", suffix);
+}
+
+// ---------------------Statements---------------------
+
+static void _emit_error(struct CCtx *ctx, char *msg) {
+    fprintf(ctx->out, "\tsl_runtime_error(\"%s\");\n", msg);
+}
+
+static enum TacType _op_type(struct CCtx *ctx, struct Instr *instr) {
+    return instr->type ? instr->type : _type_of(ctx, &instr->x);
+}
+
+// sl_func, a nested func h.<scope id> is sn_h_<scope id>, which no top level func could be named
+static void _emit_func_name(struct CCtx *ctx, int func) {
+    char *name = ctx->interp->funcs[func].name;
+    fprintf(ctx->out, strchr(name, SCOPE_SEP) ? "sn_" : "sl_");
+    for (; *name; name++) fputc(*name == SCOPE_SEP ? '_' : *name, ctx->out);
+}
+
+static void _emit_call(struct CCtx *ctx, struct Instr *instr) {
+    FILE              *out = ctx->out;
+    struct NativeFunc *callee = &ctx->info->funcs[instr->target];
+    int                argc = instr->y.lit.i;
+    int                first = ctx->depth - argc;
+    ctx->depth = first;
+
+    enum TacType res = instr->res.kind != OPERAND_NONE ? _type_of(ctx, &instr->res) : TAC_TYPE_NONE;
+    if (res && !_convertible(callee->ret_type, res)) {
+        _emit_error(ctx, callee->ret_type == TAC_TYPE_STRING ? "string used as number" : "can not convert to string");
+        return;
+    }
+
+    fprintf(out, "\t");
+    if (res) {
+        _emit_ref(ctx, &instr->res);
+        fprintf(out, " = ");
+        _convert_open(out, callee->ret_type, res);
+    }
+    _emit_func_name(ctx, instr->target);
+    fprintf(out, "(");
+    for (int k = 0; k < argc; k++) fprintf(out, "%sa[%d].%s", k ? ", " : "", first + k, _c_field(callee->param_types[k]));
+    // params read but not passed are zero, like empty slots
+    for (int k = argc; k < callee->param_size; k++) fprintf(out, "%s0", k ? ", " : "");
+    fprintf(out, ")");
+    if (res) _convert_close(out, callee->ret_type, res);
+    fprintf(out, ";\n");
+}
+
+static void _emit_instr(struct CCtx *ctx, int i) {
+    FILE         *out = ctx->out;
+    struct Instr *instr = &ctx->interp->instrs[i];
+    switch (instr->op) {
+        case TAC_MOV: {
+            enum TacType type = _type_of(ctx, &instr->x);
+            if (!_convertible(_value_type(ctx, &instr->y), type)) {
+                _emit_error(ctx, type == TAC_TYPE_STRING ? "can not convert to string" : "string used as number");
+                break;
+            }
+            fprintf(out, "\t");
+            _emit_ref(ctx, &instr->x);
+            fprintf(out, " = ");
+            _emit_value(ctx, &instr->y, type);
+            fprintf(out, ";\n");
+            break;
+        }
+        case TAC_JMP: fprintf(out, "\tgoto L%d;\n", instr->target); break;
+        case TAC_JE:
+        case TAC_JNE:
+        case TAC_JLT:
+        case TAC_JLE:
+        case TAC_JGT:
+        case TAC_JGE: {
+            enum TacType   type = _op_type(ctx, instr);
+            enum TacOpCode cmp = instr->op - TAC_JE + TAC_EQ;
+            char          *err = _illegal_op(ctx, cmp, type, &instr->x, &instr->y);
+            if (err) {
+                _emit_error(ctx, err);
+                break;
+            }
+            fprintf(out, "\tif (");
+            _emit_binary(ctx, cmp, type, &instr->x, &instr->y);
+            fprintf(out, ") goto L%d;\n", instr->target);
+            break;
+        }
+        case TAC_PARAM: {
+            struct NativeFunc *callee = &ctx->info->funcs[ctx->interp->instrs[ctx->info->param_call[i]].target];
+            enum TacType       type = callee->param_types[ctx->info->param_index[i]];
+            ctx->depth++;
+            if (!_convertible(_value_type(ctx, &instr->x), type)) {
+                _emit_error(ctx, type == TAC_TYPE_STRING ? "can not convert to string" : "string used as number");
+                break;
+            }
+            fprintf(out, "\ta[%d].%s = ", ctx->info->param_depth[i], _c_field(type));
+            _emit_value(ctx, &instr->x, type);
+            fprintf(out, ";\n");
+            break;
+        }
+        case TAC_CALL: _emit_call(ctx, instr); break;
+        case TAC_RET: {
+            if (!ctx->func) {
+                fprintf(out, "\tgoto L%d;\n", ctx->interp->instr_size);
+                break;
+            }
+            enum TacType type = ctx->info->funcs[ctx->func].ret_type;
+            if (instr->x.kind == OPERAND_NONE) {
+                fprintf(out, "\tgoto ret;\n");
+                break;
+            }
+            if (!_convertible(_value_type(ctx, &instr->x), type)) {
+                _emit_error(ctx, type == TAC_TYPE_STRING ? "can not convert to string" : "string used as number");
+                break;
+            }
+            fprintf(out, "\tr = ");
+            _emit_value(ctx, &instr->x, type);
+            fprintf(out, ";\n\tgoto ret;\n");
+            break;
+        }
+        default: {
+            enum TacType type = _op_type(ctx, instr);
+            enum TacType res = tac_res_type(instr->op, type);
+            enum TacType dst = _type_of(ctx, &instr->res);
+            char        *err = _illegal_op(ctx, instr->op, type, &instr->x, &instr->y);
+            if (!err && !_convertible(res, dst)) err = dst == TAC_TYPE_STRING ? "can not convert to string" : "string used as number";
+            if (err) {
+                _emit_error(ctx, err);
+                break;
+            }
+            fprintf(out, "\t");
+            _emit_ref(ctx, &instr->res);
+            fprintf(out, " = ");
+            _convert_open(out, res, dst);
+            _emit_binary(ctx, instr->op, type, &instr->x, &instr->y);
+            _convert_close(out, res, dst);
+            fprintf(out, ";\n");
+        }
+    }
+}
+
+// ---------------------Funcs---------------------
+
+static void _emit_signature(struct CCtx *ctx, int func) {
+    struct NativeFunc *f = &ctx->info->funcs[func];
+    fprintf(ctx->out, "static %s", _c_type(f->ret_type));
+    _emit_func_name(ctx, func);
+    fprintf(ctx->out, "(");
+    for (int k = 0; k < f->param_size; k++) fprintf(ctx->out, "%s%sp%d", k ? ", " : "", _c_type(f->param_types[k]), k);
+    if (!f->param_size) fprintf(ctx->out, "void");
+    fprintf(ctx->out, ")");
+}
+
+static void _emit_slots(struct CCtx *ctx, int func, char *indent) {
+    struct InterpFunc *f = &ctx->interp->funcs[func];
+    for (int s = 0; s < f->slot_size; s++) {
+        fprintf(ctx->out, "%s%s%s%c%d", indent, func ? "" : "static ", _c_type(ctx->info->funcs[func].slot_types[s]), func ? 's' : 'g', s);
+        fprintf(ctx->out, func ? " = 0; // %s\n" : "; // %s\n", unpack_name(f->slots[s]));
+    }
+}
+
+// frames of funcs whose vars are accessed by nested funcs, prototypes & top level vars
+static void _emit_decls(struct CCtx *ctx) {
+    FILE *out = ctx->out;
+    for (int f = 1; f < ctx->interp->func_size; f++) {
+        if (!ctx->info->funcs[f].display) continue;
+        fprintf(out, "struct sl_frame%d {\n", f);
+        for (int s = 0; s < ctx->interp->funcs[f].slot_size; s++)
+            fprintf(out, "\t%ss%d; // %s\n", _c_type(ctx->info->funcs[f].slot_types[s]), s, unpack_name(ctx->interp->funcs[f].slots[s]));
+        if (!ctx->interp->funcs[f].slot_size) fprintf(out, "\tint unused;\n");
+        fprintf(out, "};\nstatic struct sl_frame%d *sl_d%d;\n\n", f, f);
+    }
+
+    for (int f = 1; f < ctx->interp->func_size; f++) {
+        _emit_signature(ctx, f);
+        fprintf(out, ";\n");
+    }
+    fprintf(out, "\n");
+    _emit_slots(ctx, 0, "");
+}
+
+// vars of the top level code, the same format as the interpreter
+static void _emit_print_globals(struct CCtx *ctx) {
+    struct InterpFunc *top = &ctx->interp->funcs[0];
+    for (int s = 0; s < top->slot_size; s++) {
+        if (is_temp_var(top->slots[s])) continue;
+
+        char *name = unpack_name(top->slots[s]);
+        switch (ctx->info->funcs[0].slot_types[s]) {
+            case TAC_TYPE_FLOAT: fprintf(ctx->out, "\tprintf(\"%s = %%g\\n\", g%d);\n", name, s); break;
+            case TAC_TYPE_BOOL: fprintf(ctx->out, "\tprintf(\"%s = %%s\\n\", g%d ? \"true\" : \"false\");\n", name, s); break;
+            case TAC_TYPE_CHAR: fprintf(ctx->out, "\tprintf(\"%s = '%%c'\\n\", g%d);\n", name, s); break;
+            case TAC_TYPE_STRING: fprintf(ctx->out, "\tprintf(\"%s = \\\"%%s\\\"\\n\", g%d);\n", name, s); break;
+            default: fprintf(ctx->out, "\tprintf(\"%s = %%d\\n\", g%d);\n", name, s);
+        }
+    }
+}
+
+static void _emit_func(struct CCtx *ctx, int func) {
+    struct Interp     *interp = ctx->interp;
+    struct NativeFunc *f = &ctx->info->funcs[func];
+    FILE              *out = ctx->out;
+    ctx->func = func;
+    ctx->depth = 0;
+
+    if (func) {
+        _emit_signature(ctx, func);
+        fprintf(out, " {\n\t%sr = 0;\n", _c_type(f->ret_type));
+    } else fprintf(out, "int main(void) {\n");
+    if (f->display) fprintf(out, "\tstruct sl_frame%d fr = {0};\n\tstruct sl_frame%d *saved = sl_d%d;\n\tsl_d%d = &fr;\n", func, func, func, func);
+    else if (func) _emit_slots(ctx, func, "\t");
+    if (f->max_pending) fprintf(out, "\tunion SlValue a[%d];\n", f->max_pending);
+    fprintf(out, "\n");
+
+    int start = func ? interp->funcs[func].entry : 0;
+    int end = func ? interp->funcs[func].end : interp->instr_size;
+    for (int i = start; i < end; i++) {
+        if (ctx->info->owner[i] != func) continue;
+        // a jump over a nested func body emits nothing, its label belongs to the next instr
+        if (ctx->info->target[i]) fprintf(out, "L%d:;\n", i);
+        if (!ctx->info->skip[i]) _emit_instr(ctx, i);
+    }
+
+    if (!func) {
+        if (ctx->info->target[interp->instr_size]) fprintf(out, "L%d:;\n", interp->instr_size);
+        _emit_print_globals(ctx);
+        fprintf(out, "\treturn 0;\n}\n");
+        return;
+    }
+    fprintf(out, "ret:\n");
+    if (f->display) fprintf(out, "\tsl_d%d = saved;\n", func);
+    fprintf(out, "\treturn r;\n}\n\n");
+}
+
+static void _emit_runtime(FILE *out) {
+    fprintf(out, "#include <math.h>\n#include <stdbool.h>\n#include <stdio.h>\n#include <stdlib.h>\n#include <string.h>\n\n");
+    fprintf(out, "union SlValue {\n\tint i;\n\tfloat f;\n\tbool b;\n\tchar *s;\n};\n\n");
+    fprintf(out, "static void sl_runtime_error(const char *msg) {\n\tfprintf(stderr, \"runtime error: %%s\\n\", msg);\n\texit(EXIT_FAILURE);\n}\n\n");
+    // INT_MIN / -1 overflows in C, it wraps around like the interpreter instead
+    fprintf(out, "static inline int sl_runtime_quo(int x, int y) {\n\tif (!y) sl_runtime_error(\"division by zero\");\n\treturn y == -1 ? (int)(0u - (unsigned)x) : x / y;\n}\n\n");
+    fprintf(out, "static inline int sl_runtime_rem(int x, int y) {\n\tif (!y) sl_runtime_error(\"division by zero\");\n\treturn y == -1 ? 0 : x %% y;\n}\n\n");
+}
+
+void emit_c(struct Interp *interp, FILE *out) {
+    struct CCtx ctx = {.interp = interp, .out = out, .info = create_native_info(interp)};
+
+    fprintf(out, "// generated by squirrel\n");
+    _emit_runtime(out);
+    _emit_decls(&ctx);
+    fprintf(out, "\n");
+    for (int f = 1; f < interp->func_size; f++) _emit_func(&ctx, f);
+    _emit_func(&ctx, 0);
+
+    free_native_info(ctx.info);
+}
+
+bool compile_c(char *c_path, char *exe_path) {
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd), "cc -O2 -o '%s' '%s'", exe_path, c_path);
+    return system(cmd) == 0;
+}
@@ -0,0 +1,19 @@
+#ifndef C_SOURCE_H
+#define C_SOURCE_H
+
+#include "interp.h"
+
+#include <stdio.h>
+
+/*
+ * Emit portable C of the resolved TAC, to be compiled by the system C compiler:
+ * each S#..E# func becomes a static function sl_<name>, the top level code becomes main and prints its vars at the end, like the interpreter.
+ * Labels become gotos, slots become typed locals, top level slots file scope vars.
+ * Vars of a func accessed by nested funcs live in a frame struct, the latest one is published in sl_d<func>.
+ */
+void emit_c(struct Interp *interp, FILE *out);
+
+// compile c_path into exe_path with the system cc -O2, returns false if it fails
+bool compile_c(char *c_path, char *exe_path);
+
+#endif
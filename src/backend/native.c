@@ -0,0 +1,178 @@
+#include "native.h"
+#include "ir_gen.h"
+#include "ir_fold.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static void *_native_alloc(size_t size) {
+    void *p = calloc(1, size ? size : 1);
+    if (!p) {
+        fprintf(stderr, "create_native_info(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+// ---------------------Types---------------------
+
+enum TacType native_operand_type(struct NativeInfo *info, int func, struct Operand *o) {
+    switch (o->kind) {
+        case OPERAND_LIT: return o->lit.type;
+        case OPERAND_LOCAL:
+        case OPERAND_OUTER: return info->funcs[o->func].slot_types[o->index];
+        case OPERAND_ARG: return o->index < info->funcs[func].param_size ? info->funcs[func].param_types[o->index] : TAC_TYPE_NONE;
+        default: return TAC_TYPE_NONE;
+    }
+}
+
+static bool _set_slot_type(struct NativeInfo *info, struct Operand *o, enum TacType type) {
+    if (type == TAC_TYPE_NONE || (o->kind != OPERAND_LOCAL && o->kind != OPERAND_OUTER)) return false;
+
+    enum TacType *t = &info->funcs[o->func].slot_types[o->index];
+    if (*t != TAC_TYPE_NONE) return false;
+    *t = type;
+    return true;
+}
+
+// static type of each slot, param & return value, by the typed tac writing them
+static void _infer_types(struct NativeInfo *info) {
+    struct Interp *interp = info->interp;
+    for (int i = 0; i < interp->instr_size; i++) {
+        struct Instr      *instr = &interp->instrs[i];
+        struct NativeFunc *f = &info->funcs[info->owner[i]];
+        if (instr->op == TAC_CALL && instr->y.lit.i > info->funcs[instr->target].param_size)
+            info->funcs[instr->target].param_size = instr->y.lit.i;
+        if (instr->op == TAC_MOV && instr->y.kind == OPERAND_ARG && instr->y.index >= f->param_size) f->param_size = instr->y.index + 1;
+    }
+    for (int k = 0; k < interp->func_size; k++) {
+        info->funcs[k].slot_types = _native_alloc(interp->funcs[k].slot_size * sizeof(enum TacType));
+        info->funcs[k].param_types = _native_alloc(info->funcs[k].param_size * sizeof(enum TacType));
+    }
+
+    for (int i = 0; i < interp->instr_size; i++) {
+        struct Instr      *instr = &interp->instrs[i];
+        struct NativeFunc *f = &info->funcs[info->owner[i]];
+        if (instr->op == TAC_CALL && !info->funcs[instr->target].ret_type) info->funcs[instr->target].ret_type = instr->type;
+        if (instr->op == TAC_MOV && instr->y.kind == OPERAND_ARG) f->param_types[instr->y.index] = instr->type;
+    }
+    for (int i = 0; i < interp->instr_size; i++) {
+        struct Instr      *instr = &interp->instrs[i];
+        struct NativeFunc *f = &info->funcs[info->owner[i]];
+        if (instr->op == TAC_RET && instr->x.kind != OPERAND_NONE && !f->ret_type) f->ret_type = instr->type;
+    }
+
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int i = 0; i < interp->instr_size; i++) {
+            struct Instr *instr = &interp->instrs[i];
+            int           func = info->owner[i];
+            switch (instr->op) {
+                case TAC_MOV: {
+                    enum TacType type = instr->type ? instr->type : native_operand_type(info, func, &instr->y);
+                    changed |= _set_slot_type(info, &instr->x, type);
+                    break;
+                }
+                case TAC_CALL: changed |= _set_slot_type(info, &instr->res, info->funcs[instr->target].ret_type); break;
+                default: {
+                    if (instr->op > TAC_NOT) break;
+                    enum TacType type = instr->type ? instr->type : native_operand_type(info, func, &instr->x);
+                    changed |= _set_slot_type(info, &instr->res, type ? tac_res_type(instr->op, type) : TAC_TYPE_NONE);
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < interp->instr_size; i++) {
+        if (interp->instrs[i].op != TAC_PARAM) continue;
+
+        struct NativeFunc *callee = &info->funcs[interp->instrs[info->param_call[i]].target];
+        enum TacType      *t = &callee->param_types[info->param_index[i]];
+        if (!*t) *t = native_operand_type(info, info->owner[i], &interp->instrs[i].x);
+    }
+
+    // int by default
+    for (int k = 0; k < interp->func_size; k++) {
+        struct NativeFunc *f = &info->funcs[k];
+        if (!f->ret_type) f->ret_type = TAC_TYPE_INT;
+        for (int s = 0; s < interp->funcs[k].slot_size; s++)
+            if (!f->slot_types[s]) f->slot_types[s] = TAC_TYPE_INT;
+        for (int p = 0; p < f->param_size; p++)
+            if (!f->param_types[p]) f->param_types[p] = TAC_TYPE_INT;
+    }
+}
+
+// ---------------------Layout---------------------
+
+static void _mark(struct NativeInfo *info) {
+    struct Interp *interp = info->interp;
+    // nested funcs come after their enclosing funcs
+    for (int f = 1; f < interp->func_size; f++) {
+        for (int i = interp->funcs[f].entry; i < interp->funcs[f].end; i++) info->owner[i] = f;
+        info->skip[interp->funcs[f].entry - 1] = true;
+    }
+
+    // params are stored in pending slots, till their call
+    int *stack = _native_alloc((interp->instr_size + 1) * sizeof(int));
+    int  size = 0;
+    for (int i = 0; i < interp->instr_size; i++) {
+        struct Instr *instr = &interp->instrs[i];
+        if ((instr->op == TAC_JMP || is_cond_jump(instr->op)) && !info->skip[i]) info->target[instr->target] = true;
+        for (int k = 0; k < 3; k++) {
+            struct Operand *o = k == 0 ? &instr->x : k == 1 ? &instr->y : &instr->res;
+            if (o->kind == OPERAND_OUTER && o->func) info->funcs[o->func].display = true;
+        }
+
+        if (instr->op == TAC_PARAM) {
+            struct NativeFunc *f = &info->funcs[info->owner[i]];
+            info->param_depth[i] = size;
+            if (size + 1 > f->max_pending) f->max_pending = size + 1;
+            stack[size++] = i;
+        } else if (instr->op == TAC_CALL) {
+            int argc = instr->y.lit.i;
+            if (argc > size) {
+                fprintf(stderr, "create_native_info(), CALL without enough PARAM\n");
+                exit(EXIT_FAILURE);
+            }
+            size -= argc;
+            for (int k = 0; k < argc; k++) {
+                info->param_call[stack[size + k]] = i;
+                info->param_index[stack[size + k]] = k;
+            }
+        }
+    }
+    free(stack);
+}
+
+struct NativeInfo *create_native_info(struct Interp *interp) {
+    struct NativeInfo *info = _native_alloc(sizeof(struct NativeInfo));
+    int                size = interp->instr_size + 1;
+    info->interp = interp;
+    info->funcs = _native_alloc(interp->func_size * sizeof(struct NativeFunc));
+    info->owner = _native_alloc(size * sizeof(int));
+    info->skip = _native_alloc(size * sizeof(bool));
+    info->target = _native_alloc(size * sizeof(bool));
+    info->param_call = _native_alloc(size * sizeof(int));
+    info->param_index = _native_alloc(size * sizeof(int));
+    info->param_depth = _native_alloc(size * sizeof(int));
+
+    _mark(info);
+    _infer_types(info);
+    return info;
+}
+
+void free_native_info(struct NativeInfo *info) {
+    if (!info) return;
+    for (int f = 0; f < info->interp->func_size; f++) {
+        free(info->funcs[f].slot_types);
+        free(info->funcs[f].param_types);
+    }
+    free(info->funcs);
+    free(info->owner);
+    free(info->skip);
+    free(info->target);
+    free(info->param_call);
+    free(info->param_index);
+    free(info->param_depth);
+    free(info);
+}
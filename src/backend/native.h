@@ -0,0 +1,35 @@
+#ifndef NATIVE_H
+#define NATIVE_H
+
+#include "interp.h"
+
+// static facts of a func, shared by the native backends
+struct NativeFunc {
+    enum TacType *slot_types;
+    enum TacType *param_types;
+    int           param_size;
+    enum TacType  ret_type;
+    bool          display;     // vars accessed by nested funcs, the latest frame is published for them
+    int           max_pending; // params stored before their call
+};
+
+/*
+ * Static types & layout of the resolved TAC, which the interpreter finds at runtime.
+ * Types come from the typed tac writing each slot, param & return value, int by default.
+ */
+struct NativeInfo {
+    struct Interp     *interp;
+    struct NativeFunc *funcs;       // the same order as interp->funcs
+    int               *owner;       // func of each instr
+    bool              *skip;        // JMP over a nested func body
+    bool              *target;      // jumped to
+    int               *param_call;  // CALL of each PARAM
+    int               *param_index; // arg index of each PARAM
+    int               *param_depth; // pending slot of each PARAM
+};
+
+struct NativeInfo *create_native_info(struct Interp *interp);
+void               free_native_info(struct NativeInfo *info);
+enum TacType       native_operand_type(struct NativeInfo *info, int func, struct Operand *o);
+
+#endif
@@ -0,0 +1,488 @@
+#include "regalloc.h"
+#include "global.h"
+#include "ir.h"
+#include "ir_gen.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BITS_PER_WORD (8 * sizeof(unsigned long))
+
+// var seen in the tac list, before it is allocated
+struct VarInfo {
+    char           *name;
+    struct CFGFunc *func;   // func referring it
+    bool            pinned; // referred by several funcs
+    int             id;     // index in vars of its func, -1 if not allocated
+};
+
+// liveness of a block, bitsets over vars of the func
+struct BlockLive {
+    int            from; // position of head
+    int            to;   // position of tail
+    unsigned long *use;
+    unsigned long *def;
+    unsigned long *in;
+    unsigned long *out;
+};
+
+static void *_get_var_name(void *ele) {
+    return ((struct RegAllocVar *)ele)->name;
+}
+
+static void *_get_var_value(void *ele) {
+    return ele;
+}
+
+static void _update_var(void *ele1, void *ele2) {
+    ((struct RegAllocVar *)ele1)->first = ((struct RegAllocVar *)ele2)->first;
+}
+
+static void *_get_info_name(void *ele) {
+    return ((struct VarInfo *)ele)->name;
+}
+
+static void _update_info(void *ele1, void *ele2) {
+    ((struct VarInfo *)ele1)->func = ((struct VarInfo *)ele2)->func;
+}
+
+int tac_position(int tac_index) {
+    return tac_index << 1;
+}
+
+// ---------------------Operands---------------------
+
+static char *_var_of(char *s) {
+    return s[0] == VAR_PREFIX ? s : NULL;
+}
+
+static char *_def_of(struct TAC *tac) {
+    switch (tac->op) {
+        case TAC_MOV: return _var_of(tac->x);
+        case TAC_CALL: return _var_of(tac->res);
+        default: return tac->op <= TAC_NOT && tac->op != TAC_HEAD ? _var_of(tac->res) : NULL;
+    }
+}
+
+// vars read by the tac, returns the count
+static int _uses_of(struct TAC *tac, char *uses[2]) {
+    int size = 0;
+    switch (tac->op) {
+        case TAC_MOV: {
+            if (_var_of(tac->y)) uses[size++] = tac->y;
+            break;
+        }
+        case TAC_PARAM:
+        case TAC_RET: {
+            if (_var_of(tac->x)) uses[size++] = tac->x;
+            break;
+        }
+        case TAC_HEAD:
+        case TAC_JMP:
+        case TAC_LABEL:
+        case TAC_CALL: break;
+        default: {
+            // ops & cond jumps
+            if (_var_of(tac->x)) uses[size++] = tac->x;
+            if (_var_of(tac->y)) uses[size++] = tac->y;
+        }
+    }
+    return size;
+}
+
+// ---------------------Intervals---------------------
+
+static struct LiveInterval *_create_interval(struct RegAlloc *ra, struct RegAllocVar *var, int start, int end) {
+    struct LiveInterval *it = arena_alloc(ra->arena, sizeof(struct LiveInterval));
+    it->var = var;
+    it->start = start;
+    it->end = end;
+    it->reg = REG_NONE;
+    return it;
+}
+
+// it keeps [start, at - 1], returns the rest [at + 1, end] linked after it, NULL if nothing is left
+static struct LiveInterval *_split_interval(struct RegAlloc *ra, struct RegAllocFunc *rf, struct LiveInterval *it, int at) {
+    int end = it->end;
+    it->end = at - 1 < it->start ? it->start : at - 1;
+    if (at + 1 > end) return NULL;
+
+    struct LiveInterval *rest = _create_interval(ra, it->var, at + 1, end);
+    rest->next = it->next;
+    it->next = rest;
+    if (!it->var->split) rf->split_size++;
+    it->var->split = true;
+    rf->interval_size++;
+    return rest;
+}
+
+static int _cmp_interval(const void *a, const void *b) {
+    struct LiveInterval *x = *(struct LiveInterval **)a, *y = *(struct LiveInterval **)b;
+    return x->start != y->start ? (x->start < y->start ? -1 : 1) : (x->end > y->end) - (x->end < y->end);
+}
+
+// queue of unhandled intervals, sorted by start
+struct IntervalQueue {
+    struct LiveInterval **items;
+    int                   head;
+    int                   size;
+    int                   cap;
+};
+
+static void _queue_insert(struct IntervalQueue *q, struct LiveInterval *it) {
+    if (q->size == q->cap) {
+        q->cap = q->cap ? q->cap << 1 : 16;
+        q->items = realloc(q->items, q->cap * sizeof(struct LiveInterval *));
+        if (!q->items) {
+            fprintf(stderr, "_queue_insert(), no enough memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    int k = q->size++;
+    for (; k > q->head && _cmp_interval(&q->items[k - 1], &it) > 0; k--) q->items[k] = q->items[k - 1];
+    q->items[k] = it;
+}
+
+// first CALL after pos, INT_MAX if none
+static int _next_call(int *calls, int call_size, int pos) {
+    int lo = 0, hi = call_size;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (calls[mid] <= pos) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < call_size ? calls[lo] : INT_MAX;
+}
+
+/*
+ * Linear scan of Poletto & Sarkar, with splitting in the way of Wimmer:
+ * a caller saved register is free only till the next CALL, the interval is split there;
+ * without a free register, the interval ending furthest is spilled, an active one is split at the current position.
+ */
+static void _scan(struct RegAlloc *ra, struct RegAllocFunc *rf, struct IntervalQueue *q, int *calls, int call_size) {
+    struct RegTarget     *target = &ra->target;
+    struct LiveInterval **active = calloc(target->reg_size + 1, sizeof(struct LiveInterval *));
+    if (!active) {
+        fprintf(stderr, "linear_scan(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (; q->head < q->size; q->head++) {
+        struct LiveInterval *cur = q->items[q->head];
+        int                  next_call = _next_call(calls, call_size, cur->start);
+
+        // expire intervals ended, active[r] is the interval in register r
+        for (int r = 0; r < target->reg_size; r++)
+            if (active[r] && active[r]->end < cur->start) active[r] = NULL;
+
+        int reg = REG_NONE, partial = REG_NONE;
+        for (int r = 0; r < target->reg_size; r++) {
+            if (active[r]) continue;
+            bool clobbered = target->caller_saved >> r & 1;
+            if (!clobbered || next_call >= cur->end) {
+                // caller saved registers cost nothing to save
+                if (reg == REG_NONE || (clobbered && !(target->caller_saved >> reg & 1))) reg = r;
+            } else if (next_call > cur->start && partial == REG_NONE) partial = r;
+        }
+        if (reg == REG_NONE) reg = partial;
+
+        if (reg == REG_NONE) {
+            int victim = REG_NONE;
+            for (int r = 0; r < target->reg_size; r++)
+                if (active[r] && (victim == REG_NONE || active[r]->end > active[victim]->end)) victim = r;
+            if (victim == REG_NONE || active[victim]->end <= cur->end) continue;
+
+            struct LiveInterval *rest = _split_interval(ra, rf, active[victim], cur->start);
+            if (active[victim]->start == cur->start) active[victim]->reg = REG_NONE;
+            if (rest) _queue_insert(q, rest);
+            active[victim] = NULL;
+            reg = victim;
+        }
+
+        cur->reg = reg;
+        active[reg] = cur;
+        rf->used_regs |= 1u << reg;
+        if (target->caller_saved >> reg & 1 && next_call < cur->end) {
+            struct LiveInterval *rest = _split_interval(ra, rf, cur, next_call);
+            if (rest) _queue_insert(q, rest);
+        }
+    }
+    free(active);
+}
+
+// ---------------------Liveness---------------------
+
+static unsigned long *_bitset(struct Arena *arena, int words) {
+    return arena_alloc(arena, (words ? words : 1) * sizeof(unsigned long));
+}
+
+static void _set_bit(unsigned long *set, int k) {
+    set[k / BITS_PER_WORD] |= 1ul << k % BITS_PER_WORD;
+}
+
+static bool _has_bit(unsigned long *set, int k) {
+    return set[k / BITS_PER_WORD] >> k % BITS_PER_WORD & 1;
+}
+
+static int _var_id(hashmap info_map, char *name) {
+    struct VarInfo *info = hashmap_get(info_map, &(struct VarInfo){.name = name});
+    return info ? info->id : -1;
+}
+
+static void _extend(int *start, int *end, int id, int from, int to) {
+    if (from < start[id]) start[id] = from;
+    if (to > end[id]) end[id] = to;
+}
+
+static void _alloc_func(struct RegAlloc *ra, struct RegAllocFunc *rf, hashmap info_map, struct Arena *tmp) {
+    struct CFGFunc *func = rf->func;
+    int             n = rf->var_size;
+    int             words = (n + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    if (!n) return;
+
+    int  block_size = 0;
+    int *calls = NULL, call_size = 0, call_cap = 0;
+    for (struct BasicBlock *block = func->entry; block; block = block->next, block_size++) {
+        struct BlockLive *live = block->data;
+        live->use = _bitset(tmp, words);
+        live->def = _bitset(tmp, words);
+        live->in = _bitset(tmp, words);
+        live->out = _bitset(tmp, words);
+
+        int pos = live->from;
+        for (struct TAC *tac = block->head;; tac = tac->next, pos += 2) {
+            char *uses[2];
+            int   use_size = _uses_of(tac, uses);
+            for (int k = 0; k < use_size; k++) {
+                int id = _var_id(info_map, uses[k]);
+                if (id >= 0 && !_has_bit(live->def, id)) _set_bit(live->use, id);
+            }
+            char *def = _def_of(tac);
+            int   id = def ? _var_id(info_map, def) : -1;
+            if (id >= 0) _set_bit(live->def, id);
+
+            if (tac->op == TAC_CALL) {
+                if (call_size == call_cap) {
+                    call_cap = call_cap ? call_cap << 1 : 16;
+                    calls = realloc(calls, call_cap * sizeof(int));
+                    if (!calls) {
+                        fprintf(stderr, "linear_scan(), no enough memory\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                calls[call_size++] = pos;
+            }
+            if (tac == block->tail) break;
+        }
+    }
+
+    // backward dataflow, blocks in reverse layout order converge fast
+    struct BasicBlock **blocks = arena_alloc(tmp, block_size * sizeof(struct BasicBlock *));
+    int                 k = 0;
+    for (struct BasicBlock *block = func->entry; block; block = block->next) blocks[k++] = block;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int b = block_size - 1; b >= 0; b--) {
+            struct BlockLive *live = blocks[b]->data;
+            for (int s = 0; s < blocks[b]->successors_size; s++) {
+                struct BlockLive *succ = blocks[b]->successors[s]->data;
+                for (int w = 0; w < words; w++) live->out[w] |= succ->in[w];
+            }
+            for (int w = 0; w < words; w++) {
+                unsigned long in = live->use[w] | (live->out[w] & ~live->def[w]);
+                if (in != live->in[w]) {
+                    live->in[w] = in;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // one interval per var, the hull of its live ranges
+    int *start = arena_alloc(tmp, n * sizeof(int));
+    int *end = arena_alloc(tmp, n * sizeof(int));
+    for (int id = 0; id < n; id++) {
+        start[id] = INT_MAX;
+        end[id] = -1;
+    }
+    for (int b = 0; b < block_size; b++) {
+        struct BlockLive *live = blocks[b]->data;
+        for (int id = 0; id < n; id++) {
+            if (_has_bit(live->in, id)) _extend(start, end, id, live->from, live->from);
+            if (_has_bit(live->out, id)) _extend(start, end, id, live->to, live->to + 1);
+        }
+
+        int pos = live->from;
+        for (struct TAC *tac = blocks[b]->head;; tac = tac->next, pos += 2) {
+            char *uses[2];
+            int   use_size = _uses_of(tac, uses);
+            for (int u = 0; u < use_size; u++) {
+                int id = _var_id(info_map, uses[u]);
+                if (id >= 0) _extend(start, end, id, pos, pos);
+            }
+            char *def = _def_of(tac);
+            int   id = def ? _var_id(info_map, def) : -1;
+            if (id >= 0) _extend(start, end, id, pos, pos);
+            if (tac == blocks[b]->tail) break;
+        }
+    }
+
+    struct IntervalQueue q = {0};
+    for (int id = 0; id < n; id++) {
+        if (end[id] < 0) continue;
+        struct LiveInterval *it = _create_interval(ra, rf->vars[id], start[id], end[id]);
+        rf->vars[id]->first = it;
+        rf->interval_size++;
+        _queue_insert(&q, it);
+    }
+    _scan(ra, rf, &q, calls, call_size);
+
+    for (int id = 0; id < n; id++) {
+        bool in_memory = true;
+        for (struct LiveInterval *it = rf->vars[id]->first; it; it = it->next)
+            if (it->reg != REG_NONE) in_memory = false;
+        if (in_memory) rf->spill_size++;
+    }
+    free(q.items);
+    free(calls);
+}
+
+// ---------------------Allocation---------------------
+
+struct RegAlloc *linear_scan(struct CFG *cfg, struct RegTarget *target) {
+    struct RegAlloc *ra = CREATE_STRUCT_P(RegAlloc);
+    if (!ra) {
+        fprintf(stderr, "linear_scan(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    ra->arena = create_arena();
+    ra->target = *target;
+    ra->func_size = cfg->func_size;
+    ra->funcs = arena_alloc(ra->arena, cfg->func_size * sizeof(struct RegAllocFunc));
+    ra->var_map = hashmap_new_default(_get_var_name, _get_var_value, _update_var, str_hash_func, str_eq_func, ptr_eq_func);
+    for (int f = 0; f < cfg->func_size; f++) ra->funcs[f].func = cfg->funcs[f];
+
+    struct Arena *tmp = create_arena();
+    hashmap info_map = hashmap_new_default(_get_info_name, _get_var_value, _update_info, str_hash_func, str_eq_func, ptr_eq_func);
+    struct VarInfo **infos = NULL;
+    int              info_size = 0, info_cap = 0;
+
+    // facts of earlier passes may be left in blocks
+    for (int f = 0; f < cfg->func_size; f++)
+        for (struct BasicBlock *block = cfg->funcs[f]->entry; block; block = block->next) block->data = arena_alloc(tmp, sizeof(struct BlockLive));
+
+    // positions of blocks & the func referring each var
+    int index = 0;
+    for (struct TAC *tac = cfg->tac; tac; tac = tac->next, index++) {
+        struct BasicBlock *block = tac->block;
+        if (!block) continue;
+        struct BlockLive *live = block->data;
+        if (tac == block->head) live->from = tac_position(index);
+        if (tac == block->tail) live->to = tac_position(index);
+
+        char *names[3];
+        int   size = _uses_of(tac, names);
+        if (_def_of(tac)) names[size++] = _def_of(tac);
+        for (int k = 0; k < size; k++) {
+            struct VarInfo *info = hashmap_get(info_map, &(struct VarInfo){.name = names[k]});
+            if (info) {
+                if (info->func != block->func) info->pinned = true;
+                continue;
+            }
+
+            info = arena_alloc(tmp, sizeof(struct VarInfo));
+            info->name = names[k];
+            info->func = block->func;
+            info->id = -1;
+            hashmap_put(info_map, info);
+            if (info_size == info_cap) {
+                info_cap = info_cap ? info_cap << 1 : 64;
+                infos = realloc(infos, info_cap * sizeof(struct VarInfo *));
+                if (!infos) {
+                    fprintf(stderr, "linear_scan(), no enough memory\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            infos[info_size++] = info;
+        }
+    }
+
+    int *caps = calloc(cfg->func_size, sizeof(int));
+    if (!caps) {
+        fprintf(stderr, "linear_scan(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < info_size; i++) {
+        struct VarInfo *info = infos[i];
+        int             f = 0;
+        while (cfg->funcs[f] != info->func) f++;
+        struct RegAllocFunc *rf = &ra->funcs[f];
+        if (info->pinned || !target->allocatable(info->name, target->arg)) {
+            rf->pinned_size++;
+            continue;
+        }
+
+        if (rf->var_size == caps[f]) {
+            int new_cap = caps[f] ? caps[f] << 1 : 16;
+            rf->vars = arena_realloc(ra->arena, rf->vars, caps[f] * sizeof(struct RegAllocVar *), new_cap * sizeof(struct RegAllocVar *));
+            caps[f] = new_cap;
+        }
+        struct RegAllocVar *var = arena_alloc(ra->arena, sizeof(struct RegAllocVar));
+        var->name = arena_alloc(ra->arena, strlen(info->name) + 1);
+        strcpy(var->name, info->name);
+        info->id = rf->var_size;
+        rf->vars[rf->var_size++] = var;
+        hashmap_put(ra->var_map, var);
+    }
+
+    for (int f = 0; f < cfg->func_size; f++) _alloc_func(ra, &ra->funcs[f], info_map, tmp);
+
+    // block data is only valid during the pass
+    for (int f = 0; f < cfg->func_size; f++)
+        for (struct BasicBlock *block = cfg->funcs[f]->entry; block; block = block->next) block->data = NULL;
+    free(caps);
+    free(infos);
+    hashmap_free(info_map);
+    free_arena(tmp);
+    return ra;
+}
+
+void free_reg_alloc(struct RegAlloc *ra) {
+    if (!ra) return;
+    hashmap_free(ra->var_map);
+    free_arena(ra->arena);
+    free(ra);
+}
+
+struct RegAllocVar *reg_alloc_var(struct RegAlloc *ra, char *name) {
+    return ra ? hashmap_get(ra->var_map, &(struct RegAllocVar){.name = name}) : NULL;
+}
+
+int reg_alloc_location(struct RegAllocVar *var, int pos) {
+    if (!var) return REG_NONE;
+    for (struct LiveInterval *it = var->first; it && it->start <= pos; it = it->next)
+        if (pos <= it->end) return it->reg;
+    return REG_NONE;
+}
+
+void print_reg_alloc_stats(struct RegAlloc *ra) {
+    printf("%-16s %5s %9s %6s %6s %6s %6s  %s\n", "func", "vars", "intervals", "split", "spill", "pinned", "regs", "used");
+    for (int f = 0; f < ra->func_size; f++) {
+        struct RegAllocFunc *rf = &ra->funcs[f];
+        int                  regs = 0;
+        for (unsigned m = rf->used_regs; m; m &= m - 1) regs++;
+        printf("%-16s %5d %9d %6d %6d %6d %6d ",
+               rf->func->name ? unpack_name(rf->func->name) : "<top>",
+               rf->var_size,
+               rf->interval_size,
+               rf->split_size,
+               rf->spill_size,
+               rf->pinned_size,
+               regs);
+        for (int r = 0; r < ra->target.reg_size; r++)
+            if (rf->used_regs >> r & 1) printf(" %s", ra->target.names[r]);
+        printf("\n");
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include "ir_cfg.h"
+#include "arena.h"
+#include "c_hashmap.h"
+
+#define REG_NONE -1 // in the memory home of the var
+
+// registers of a backend, vars are allocated only if allocatable() returns true
+struct RegTarget {
+    char   **names;
+    int      reg_size;
+    unsigned caller_saved; // bit k is set if register k is clobbered by calls
+    bool (*allocatable)(char *var, void *arg);
+    void *arg;
+};
+
+// part of the lifetime of a var in one location, positions are inclusive
+struct LiveInterval {
+    struct RegAllocVar  *var;
+    int                  start;
+    int                  end;
+    int                  reg;  // REG_NONE if spilled
+    struct LiveInterval *next; // next part of the same var, by start
+};
+
+struct RegAllocVar {
+    char                *name;
+    struct LiveInterval *first;
+    bool                 split; // more than one interval, the memory home is written on every def
+};
+
+/*
+ * Allocation of one CFGFunc.
+ * Position of a tac is twice its index in the tac list, so a split point never falls on a tac.
+ */
+struct RegAllocFunc {
+    struct CFGFunc *func;
+
+    struct RegAllocVar **vars;
+    int                  var_size;
+
+    int      interval_size;
+    int      split_size;   // vars split into several intervals
+    int      spill_size;   // vars living only in memory
+    int      pinned_size;  // vars not allocatable, shared with nested funcs or rejected by the target
+    unsigned used_regs;
+};
+
+struct RegAlloc {
+    struct Arena    *arena;
+    struct RegTarget target; // arg is only used during linear_scan()
+
+    struct RegAllocFunc *funcs; // the same order as cfg->funcs
+    int                  func_size;
+
+    hashmap var_map; // var name -> RegAllocVar
+};
+
+// linear scan over live intervals of each func, vars live across a CALL are never in caller saved registers
+struct RegAlloc    *linear_scan(struct CFG *cfg, struct RegTarget *target);
+void                free_reg_alloc(struct RegAlloc *ra);
+// NULL if the var is not allocated
+struct RegAllocVar *reg_alloc_var(struct RegAlloc *ra, char *name);
+// register of the var at pos, REG_NONE if it is in memory
+int                 reg_alloc_location(struct RegAllocVar *var, int pos);
+int                 tac_position(int tac_index);
+void                print_reg_alloc_stats(struct RegAlloc *ra);
+
+#endif
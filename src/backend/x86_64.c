@@ -0,0 +1,657 @@
+#include "x86_64.h"
+#include "regalloc.h"
+#include "native.h"
+#include "global.h"
+#include "ir_gen.h"
+#include "ir_fold.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static char *int_arg_regs32[] = {"%edi", "%esi", "%edx", "%ecx", "%r8d", "%r9d"};
+static char *int_arg_regs64[] = {"%rdi", "%rsi", "%rdx", "%rcx", "%r8", "%r9"};
+static char *int_jumps[] = {"je", "jne", "jl", "jle", "jg", "jge"};
+static char *int_sets[] = {"sete", "setne", "setl", "setle", "setg", "setge"};
+
+// allocatable registers, callee saved ones first, r11 & the argument registers of libc calls are kept for scratch
+static char *alloc_regs32[] = {"%ebx", "%r12d", "%r13d", "%r14d", "%r15d", "%r8d", "%r9d", "%r10d"};
+static char *alloc_regs64[] = {"%rbx", "%r12", "%r13", "%r14", "%r15", "%r8", "%r9", "%r10"};
+#define X64_ALLOC_REGS 8
+#define X64_CALLER_SAVED 0xE0u
+
+enum ArgClass { ARG_INT_REG, ARG_FLOAT_REG, ARG_STACK };
+
+// display of a func is published in sl_d<func>
+struct X64Func {
+    struct RegAllocVar **slot_vars; // allocation of each slot, NULL if it stays in memory
+    unsigned             used_regs;
+};
+
+struct X64Ctx {
+    struct Interp     *interp;
+    FILE              *out;
+    struct NativeInfo *info;
+    struct X64Func    *funcs;
+
+    char **strings; // literals & names in .rodata, .Ls<index>
+    int    string_size;
+    int    string_cap;
+
+    struct RegAlloc *ra;
+
+    int func;  // func emitted
+    int pos;   // position of the instr emitted, for register allocation
+    int depth; // params stored, not passed yet
+    int label_id;
+};
+
+static void *_x64_alloc(size_t size) {
+    void *p = calloc(1, size ? size : 1);
+    if (!p) {
+        fprintf(stderr, "emit_x86_64(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static int _string_label(struct X64Ctx *ctx, char *s) {
+    for (int i = 0; i < ctx->string_size; i++)
+        if (!strcmp(ctx->strings[i], s)) return i;
+
+    if (ctx->string_size == ctx->string_cap) {
+        ctx->string_cap = ctx->string_cap ? ctx->string_cap << 1 : 16;
+        ctx->strings = realloc(ctx->strings, ctx->string_cap * sizeof(char *));
+        if (!ctx->strings) {
+            fprintf(stderr, "_string_label(), no enough memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    ctx->strings[ctx->string_size] = s;
+    return ctx->string_size++;
+}
+
+// ---------------------Layout---------------------
+
+// register or stack slot of param k, by the classes of params before it
+static enum ArgClass _classify(struct NativeFunc *f, int k, int *index) {
+    int ints = 0, floats = 0, stacks = 0;
+    for (int p = 0; p <= k; p++) {
+        enum ArgClass c = f->param_types[p] == TAC_TYPE_FLOAT ? (floats < X64_FLOAT_ARG_REGS ? ARG_FLOAT_REG : ARG_STACK)
+                                                             : (ints < X64_INT_ARG_REGS ? ARG_INT_REG : ARG_STACK);
+        int *n = c == ARG_INT_REG ? &ints : c == ARG_FLOAT_REG ? &floats : &stacks;
+        if (p == k) {
+            *index = *n;
+            return c;
+        }
+        (*n)++;
+    }
+    return ARG_STACK;
+}
+
+// rbp offsets: display at -8, then slots, saved params & pending params
+static int _slot_offset(int slot) {
+    return 16 + 8 * slot;
+}
+
+static int _param_offset(struct X64Ctx *ctx, int func, int k) {
+    return _slot_offset(func ? ctx->interp->funcs[func].slot_size + k : k);
+}
+
+static int _pending_offset(struct X64Ctx *ctx, int func, int p) {
+    return _param_offset(ctx, func, ctx->info->funcs[func].param_size + p);
+}
+
+static int _saved_reg_size(struct X64Func *f) {
+    int size = 0;
+    for (unsigned m = f->used_regs & ~X64_CALLER_SAVED; m; m &= m - 1) size++;
+    return size;
+}
+
+// callee saved registers used by the func, after pending params
+static int _saved_reg_offset(struct X64Ctx *ctx, int func, int k) {
+    return _pending_offset(ctx, func, ctx->info->funcs[func].max_pending + k);
+}
+
+static int _frame_size(struct X64Ctx *ctx, int func) {
+    int size = _saved_reg_offset(ctx, func, _saved_reg_size(&ctx->funcs[func])) - 8;
+    return (size + 15) & ~15;
+}
+
+// ---------------------Registers---------------------
+
+// int, char & bool vars of the func, top level vars are kept in memory to be printed
+static bool _allocatable(char *var, void *arg) {
+    struct X64Ctx *ctx = arg;
+    int            func, slot;
+    if (!interp_lookup_var(ctx->interp, var, &func, &slot) || (!func && !is_temp_var(var))) return false;
+
+    enum TacType type = ctx->info->funcs[func].slot_types[slot];
+    return type == TAC_TYPE_INT || type == TAC_TYPE_BOOL || type == TAC_TYPE_CHAR;
+}
+
+static void _alloc_regs(struct X64Ctx *ctx, struct CFG *cfg) {
+    struct Interp   *interp = ctx->interp;
+    struct RegTarget target = {
+        .names = alloc_regs64, .reg_size = X64_ALLOC_REGS, .caller_saved = X64_CALLER_SAVED, .allocatable = _allocatable, .arg = ctx};
+    ctx->ra = linear_scan(cfg, &target);
+
+    for (int f = 0; f < interp->func_size; f++) {
+        struct X64Func *xf = &ctx->funcs[f];
+        xf->slot_vars = _x64_alloc(interp->funcs[f].slot_size * sizeof(struct RegAllocVar *));
+        for (int s = 0; s < interp->funcs[f].slot_size; s++) {
+            struct RegAllocVar *var = reg_alloc_var(ctx->ra, interp->funcs[f].slots[s]);
+            xf->slot_vars[s] = var;
+            for (struct LiveInterval *it = var ? var->first : NULL; it; it = it->next)
+                if (it->reg != REG_NONE) xf->used_regs |= 1u << it->reg;
+        }
+    }
+}
+
+static struct RegAllocVar *_operand_var(struct X64Ctx *ctx, struct Operand *o) {
+    if (o->kind != OPERAND_LOCAL || o->func != ctx->func) return NULL;
+    return ctx->funcs[ctx->func].slot_vars[o->index];
+}
+
+// ---------------------Emitting---------------------
+
+static void _mem_addr(struct X64Ctx *ctx, struct Operand *o, char *buf) {
+    switch (o->kind) {
+        case OPERAND_LOCAL:
+        case OPERAND_OUTER: {
+            if (!o->func) sprintf(buf, "sl_g%d(%%rip)", o->index);
+            else if (o->func == ctx->func) sprintf(buf, "-%d(%%rbp)", _slot_offset(o->index));
+            else {
+                fprintf(ctx->out, "\tmovq sl_d%d(%%rip), %%r11\n", o->func);
+                sprintf(buf, "-%d(%%r11)", _slot_offset(o->index));
+            }
+            break;
+        }
+        case OPERAND_ARG: {
+            int index;
+            if (_classify(&ctx->info->funcs[ctx->func], o->index, &index) == ARG_STACK) sprintf(buf, "%d(%%rbp)", 16 + 8 * index);
+            else sprintf(buf, "-%d(%%rbp)", _param_offset(ctx, ctx->func, o->index));
+            break;
+        }
+        default: {
+            fprintf(stderr, "emit_x86_64(), operand without address\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// register of the operand at the instr emitted, or its memory home
+static void _addr(struct X64Ctx *ctx, struct Operand *o, char *buf) {
+    int reg = reg_alloc_location(_operand_var(ctx, o), ctx->pos);
+    if (reg != REG_NONE) strcpy(buf, alloc_regs32[reg]);
+    else _mem_addr(ctx, o, buf);
+}
+
+static void _emit_error(struct X64Ctx *ctx, char *msg) {
+    fprintf(ctx->out, "\tleaq .Ls%d(%%rip), %%rdi\n\tcall sl_runtime_error\n", _string_label(ctx, msg));
+}
+
+// value of o converted to type, in %eax, %rax for string or %xmm0 for float
+static void _load_as(struct X64Ctx *ctx, struct Operand *o, enum TacType type) {
+    FILE *out = ctx->out;
+    if (o->kind == OPERAND_LIT) {
+        if (type == TAC_TYPE_STRING) {
+            if (o->lit.type != TAC_TYPE_STRING) _emit_error(ctx, "can not convert to string");
+            else fprintf(out, "\tleaq .Ls%d(%%rip), %%rax\n", _string_label(ctx, o->lit.s));
+            return;
+        }
+        if (o->lit.type == TAC_TYPE_STRING) {
+            _emit_error(ctx, "string used as number");
+            return;
+        }
+
+        struct Value v = value_convert(&o->lit, type);
+        if (type == TAC_TYPE_FLOAT) {
+            int bits;
+            memcpy(&bits, &v.f, sizeof(int));
+            fprintf(out, "\tmovl $%d, %%eax\n\tmovd %%eax, %%xmm0\n", bits);
+        } else fprintf(out, "\tmovl $%d, %%eax\n", type == TAC_TYPE_BOOL ? v.b : v.i);
+        return;
+    }
+
+    char         addr[64];
+    enum TacType src = native_operand_type(ctx->info, ctx->func, o);
+    _addr(ctx, o, addr);
+    switch (type) {
+        case TAC_TYPE_FLOAT: {
+            if (src == TAC_TYPE_FLOAT) fprintf(out, "\tmovss %s, %%xmm0\n", addr);
+            else fprintf(out, "\tcvtsi2ssl %s, %%xmm0\n", addr);
+            break;
+        }
+        case TAC_TYPE_STRING: fprintf(out, "\tmovq %s, %%rax\n", addr); break;
+        case TAC_TYPE_BOOL: {
+            if (src == TAC_TYPE_FLOAT)
+                fprintf(out, "\tmovss %s, %%xmm0\n\txorps %%xmm2, %%xmm2\n\tucomiss %%xmm2, %%xmm0\n\tsetne %%al\n\tsetp %%dl\n\torb %%dl, %%al\n\tmovzbl %%al, %%eax\n", addr);
+            else if (src == TAC_TYPE_BOOL) fprintf(out, "\tmovl %s, %%eax\n", addr);
+            else fprintf(out, "\tmovl %s, %%eax\n\ttestl %%eax, %%eax\n\tsetne %%al\n\tmovzbl %%al, %%eax\n", addr);
+            break;
+        }
+        default: {
+            if (src == TAC_TYPE_FLOAT) fprintf(out, "\tcvttss2si %s, %%eax\n", addr);
+            else fprintf(out, "\tmovl %s, %%eax\n", addr);
+        }
+    }
+}
+
+static void _store_as(struct X64Ctx *ctx, struct Operand *o, enum TacType type) {
+    char addr[64];
+    _addr(ctx, o, addr);
+    if (type == TAC_TYPE_FLOAT) fprintf(ctx->out, "\tmovss %%xmm0, %s\n", addr);
+    else if (type == TAC_TYPE_STRING) fprintf(ctx->out, "\tmovq %%rax, %s\n", addr);
+    else fprintf(ctx->out, "\tmovl %%eax, %s\n", addr);
+
+    // the memory home of a split var is always up to date, so any of its intervals may reload from it
+    struct RegAllocVar *var = _operand_var(ctx, o);
+    if (var && var->split && addr[0] == '%') {
+        _mem_addr(ctx, o, addr);
+        fprintf(ctx->out, "\tmovl %%eax, %s\n", addr);
+    }
+}
+
+// allocated caller saved registers, kept around libc calls which are not CALL tac
+static void _save_caller_regs(struct X64Ctx *ctx, bool save) {
+    unsigned regs = ctx->funcs[ctx->func].used_regs & X64_CALLER_SAVED;
+    if (!regs) return;
+
+    if (save) fprintf(ctx->out, "\tsubq $32, %%rsp\n");
+    for (int r = 0, k = 0; r < X64_ALLOC_REGS; r++) {
+        if (!(regs >> r & 1)) continue;
+        if (save) fprintf(ctx->out, "\tmovq %s, %d(%%rsp)\n", alloc_regs64[r], 8 * k++);
+        else fprintf(ctx->out, "\tmovq %d(%%rsp), %s\n", 8 * k++, alloc_regs64[r]);
+    }
+    if (!save) fprintf(ctx->out, "\taddq $32, %%rsp\n");
+}
+
+static void _emit_int_op(struct X64Ctx *ctx, enum TacOpCode op, enum TacType type) {
+    FILE *out = ctx->out;
+    if (op <= TAC_GE) {
+        fprintf(out, "\tcmpl %%ecx, %%eax\n\t%s %%al\n\tmovzbl %%al, %%eax\n", int_sets[op - TAC_EQ]);
+        return;
+    }
+
+    switch (op) {
+        case TAC_ADD: fprintf(out, "\taddl %%ecx, %%eax\n"); break;
+        case TAC_SUB: fprintf(out, "\tsubl %%ecx, %%eax\n"); break;
+        case TAC_MUL: fprintf(out, "\timull %%ecx, %%eax\n"); break;
+        case TAC_QUO:
+        case TAC_REM: {
+            // INT_MIN / -1 traps on idiv, it wraps around like the interpreter instead
+            int id = ctx->label_id++;
+            fprintf(out, "\ttestl %%ecx, %%ecx\n\tjz .Ldiv_zero\n\tcmpl $-1, %%ecx\n\tjne .Ldiv%d\n", id);
+            fprintf(out, op == TAC_QUO ? "\tnegl %%eax\n" : "\txorl %%eax, %%eax\n");
+            fprintf(out, "\tjmp .Ldiv_end%d\n.Ldiv%d:\n\tcltd\n\tidivl %%ecx\n", id, id);
+            if (op == TAC_REM) fprintf(out, "\tmovl %%edx, %%eax\n");
+            fprintf(out, ".Ldiv_end%d:\n", id);
+            break;
+        }
+        case TAC_AND: fprintf(out, "\tandl %%ecx, %%eax\n"); break;
+        case TAC_OR: fprintf(out, "\torl %%ecx, %%eax\n"); break;
+        case TAC_XOR: fprintf(out, "\txorl %%ecx, %%eax\n"); break;
+        case TAC_SHL: fprintf(out, "\tshll %%cl, %%eax\n"); break;
+        case TAC_SHR: fprintf(out, "\tsarl %%cl, %%eax\n"); break;
+        case TAC_NOT: fprintf(out, type == TAC_TYPE_BOOL ? "\txorl $1, %%eax\n" : "\tnotl %%eax\n"); break;
+        default: _emit_error(ctx, "illegal operation");
+    }
+}
+
+static void _emit_float_op(struct X64Ctx *ctx, enum TacOpCode op) {
+    FILE *out = ctx->out;
+    switch (op) {
+        // any comparison with nan is false but NE
+        case TAC_EQ: fprintf(out, "\tucomiss %%xmm1, %%xmm0\n\tsete %%al\n\tsetnp %%dl\n\tandb %%dl, %%al\n"); break;
+        case TAC_NE: fprintf(out, "\tucomiss %%xmm1, %%xmm0\n\tsetne %%al\n\tsetp %%dl\n\torb %%dl, %%al\n"); break;
+        case TAC_LT: fprintf(out, "\tucomiss %%xmm0, %%xmm1\n\tseta %%al\n"); break;
+        case TAC_LE: fprintf(out, "\tucomiss %%xmm0, %%xmm1\n\tsetae %%al\n"); break;
+        case TAC_GT: fprintf(out, "\tucomiss %%xmm1, %%xmm0\n\tseta %%al\n"); break;
+        case TAC_GE: fprintf(out, "\tucomiss %%xmm1, %%xmm0\n\tsetae %%al\n"); break;
+        case TAC_ADD: fprintf(out, "\taddss %%xmm1, %%xmm0\n"); return;
+        case TAC_SUB: fprintf(out, "\tsubss %%xmm1, %%xmm0\n"); return;
+        case TAC_MUL: fprintf(out, "\tmulss %%xmm1, %%xmm0\n"); return;
+        case TAC_QUO: fprintf(out, "\tdivss %%xmm1, %%xmm0\n"); return;
+        default: _emit_error(ctx, "illegal operation on float"); return;
+    }
+    fprintf(out, "\tmovzbl %%al, %%eax\n");
+}
+
+// x op y in %eax or %xmm0
+static void _emit_binary(struct X64Ctx *ctx, enum TacOpCode op, enum TacType type, struct Operand *x, struct Operand *y) {
+    FILE *out = ctx->out;
+    if (type == TAC_TYPE_STRING) {
+        if (op != TAC_EQ && op != TAC_NE) {
+            _emit_error(ctx, "illegal operation on string");
+            return;
+        }
+        _load_as(ctx, y, type);
+        fprintf(out, "\tmovq %%rax, %%rsi\n");
+        _load_as(ctx, x, type);
+        fprintf(out, "\tmovq %%rax, %%rdi\n");
+        _save_caller_regs(ctx, true);
+        fprintf(out, "\tcall strcmp@PLT\n");
+        _save_caller_regs(ctx, false);
+        fprintf(out, "\ttestl %%eax, %%eax\n\t%s %%al\n\tmovzbl %%al, %%eax\n", op == TAC_EQ ? "sete" : "setne");
+        return;
+    }
+
+    if (y->kind != OPERAND_NONE) {
+        _load_as(ctx, y, type);
+        fprintf(out, type == TAC_TYPE_FLOAT ? "\tmovaps %%xmm0, %%xmm1\n" : "\tmovl %%eax, %%ecx\n");
+    }
+    _load_as(ctx, x, type);
+    if (type == TAC_TYPE_FLOAT) _emit_float_op(ctx, op);
+    else _emit_int_op(ctx, op, type);
+}
+
+static enum TacType _op_type(struct X64Ctx *ctx, struct Instr *instr) {
+    enum TacType type = instr->type ? instr->type : native_operand_type(ctx->info, ctx->func, &instr->x);
+    return type ? type : TAC_TYPE_INT;
+}
+
+static void _store_pending(struct X64Ctx *ctx, int p, enum TacType type) {
+    int off = _pending_offset(ctx, ctx->func, p);
+    if (type == TAC_TYPE_FLOAT) fprintf(ctx->out, "\tmovss %%xmm0, -%d(%%rbp)\n", off);
+    else if (type == TAC_TYPE_STRING) fprintf(ctx->out, "\tmovq %%rax, -%d(%%rbp)\n", off);
+    else fprintf(ctx->out, "\tmovl %%eax, -%d(%%rbp)\n", off);
+}
+
+static void _emit_call(struct X64Ctx *ctx, struct Instr *instr) {
+    FILE           *out = ctx->out;
+    struct NativeFunc *callee = &ctx->info->funcs[instr->target];
+    int             argc = instr->y.lit.i;
+    int             first = ctx->depth - argc;
+
+    int stacks = 0, index;
+    for (int k = 0; k < argc; k++)
+        if (_classify(callee, k, &index) == ARG_STACK) stacks++;
+    // rsp must be 16-byte aligned at the call
+    if (stacks & 1) fprintf(out, "\tsubq $8, %%rsp\n");
+    for (int k = argc - 1; k >= 0; k--)
+        if (_classify(callee, k, &index) == ARG_STACK) fprintf(out, "\tpushq -%d(%%rbp)\n", _pending_offset(ctx, ctx->func, first + k));
+
+    for (int k = 0; k < argc; k++) {
+        int off = _pending_offset(ctx, ctx->func, first + k);
+        switch (_classify(callee, k, &index)) {
+            case ARG_INT_REG: {
+                if (callee->param_types[k] == TAC_TYPE_STRING) fprintf(out, "\tmovq -%d(%%rbp), %s\n", off, int_arg_regs64[index]);
+                else fprintf(out, "\tmovl -%d(%%rbp), %s\n", off, int_arg_regs32[index]);
+                break;
+            }
+            case ARG_FLOAT_REG: fprintf(out, "\tmovss -%d(%%rbp), %%xmm%d\n", off, index); break;
+            default: break;
+        }
+    }
+    fprintf(out, "\tcall sl_%s\n", ctx->interp->funcs[instr->target].name);
+    if (stacks) fprintf(out, "\taddq $%d, %%rsp\n", 8 * (stacks + (stacks & 1)));
+    ctx->depth = first;
+
+    if (instr->res.kind != OPERAND_NONE) _store_as(ctx, &instr->res, callee->ret_type);
+}
+
+static void _emit_instr(struct X64Ctx *ctx, int i) {
+    FILE         *out = ctx->out;
+    struct Instr *instr = &ctx->interp->instrs[i];
+    switch (instr->op) {
+        case TAC_MOV: {
+            enum TacType type = native_operand_type(ctx->info, ctx->func, &instr->x);
+            _load_as(ctx, &instr->y, type);
+            _store_as(ctx, &instr->x, type);
+            break;
+        }
+        case TAC_JMP: fprintf(out, "\tjmp .Lt%d\n", instr->target); break;
+        case TAC_JE:
+        case TAC_JNE:
+        case TAC_JLT:
+        case TAC_JLE:
+        case TAC_JGT:
+        case TAC_JGE: {
+            enum TacType   type = _op_type(ctx, instr);
+            enum TacOpCode cmp = instr->op - TAC_JE + TAC_EQ;
+            if (type == TAC_TYPE_FLOAT || type == TAC_TYPE_STRING) {
+                _emit_binary(ctx, cmp, type, &instr->x, &instr->y);
+                fprintf(out, "\ttestl %%eax, %%eax\n\tjnz .Lt%d\n", instr->target);
+                break;
+            }
+            _load_as(ctx, &instr->y, type);
+            fprintf(out, "\tmovl %%eax, %%ecx\n");
+            _load_as(ctx, &instr->x, type);
+            fprintf(out, "\tcmpl %%ecx, %%eax\n\t%s .Lt%d\n", int_jumps[cmp - TAC_EQ], instr->target);
+            break;
+        }
+        case TAC_PARAM: {
+            struct NativeFunc *callee = &ctx->info->funcs[ctx->interp->instrs[ctx->info->param_call[i]].target];
+            enum TacType    type = callee->param_types[ctx->info->param_index[i]];
+            _load_as(ctx, &instr->x, type);
+            _store_pending(ctx, ctx->info->param_depth[i], type);
+            ctx->depth++;
+            break;
+        }
+        case TAC_CALL: _emit_call(ctx, instr); break;
+        case TAC_RET: {
+            if (!ctx->func) {
+                fprintf(out, "\tjmp .Lt%d\n", ctx->interp->instr_size);
+                break;
+            }
+            enum TacType type = ctx->info->funcs[ctx->func].ret_type;
+            if (instr->x.kind == OPERAND_NONE) fprintf(out, "\txorl %%eax, %%eax\n\txorps %%xmm0, %%xmm0\n");
+            else _load_as(ctx, &instr->x, type);
+            fprintf(out, "\tjmp .Lret%d\n", ctx->func);
+            break;
+        }
+        default: {
+            enum TacType type = _op_type(ctx, instr);
+            _emit_binary(ctx, instr->op, type, &instr->x, &instr->y);
+            _store_as(ctx, &instr->res, tac_res_type(instr->op, type));
+        }
+    }
+}
+
+static void _save_callee_regs(struct X64Ctx *ctx, int func, bool save) {
+    unsigned regs = ctx->funcs[func].used_regs & ~X64_CALLER_SAVED;
+    for (int r = 0, k = 0; r < X64_ALLOC_REGS; r++) {
+        if (!(regs >> r & 1)) continue;
+        int off = _saved_reg_offset(ctx, func, k++);
+        if (save) fprintf(ctx->out, "\tmovq %s, -%d(%%rbp)\n", alloc_regs64[r], off);
+        else fprintf(ctx->out, "\tmovq -%d(%%rbp), %s\n", off, alloc_regs64[r]);
+    }
+}
+
+// vars are zero before their first def, the same as slots
+static void _clear_regs(struct X64Ctx *ctx, int func) {
+    for (int r = 0; r < X64_ALLOC_REGS; r++)
+        if (ctx->funcs[func].used_regs >> r & 1) fprintf(ctx->out, "\txorl %s, %s\n", alloc_regs32[r], alloc_regs32[r]);
+}
+
+// reload split vars whose interval starts in a register, or which are in a register at a jump target
+static void _reload_regs(struct X64Ctx *ctx, int *prev, bool target) {
+    struct X64Func *f = &ctx->funcs[ctx->func];
+    for (int s = 0; s < ctx->interp->funcs[ctx->func].slot_size; s++) {
+        struct RegAllocVar *var = f->slot_vars[s];
+        if (!var || !var->split) continue;
+
+        int reg = reg_alloc_location(var, ctx->pos);
+        if (reg != REG_NONE && (target || reg != prev[s])) {
+            char addr[64];
+            _mem_addr(ctx, &(struct Operand){.kind = OPERAND_LOCAL, .func = ctx->func, .index = s}, addr);
+            fprintf(ctx->out, "\tmovl %s, %s\n", addr, alloc_regs32[reg]);
+        }
+        prev[s] = reg;
+    }
+}
+
+static void _emit_prologue(struct X64Ctx *ctx, int func) {
+    FILE           *out = ctx->out;
+    struct NativeFunc *f = &ctx->info->funcs[func];
+    char              *name = func ? ctx->interp->funcs[func].name : "main";
+
+    fprintf(out, "\n\t.text\n");
+    if (!func) fprintf(out, "\t.globl main\n");
+    fprintf(out, "\t.type %s%s, @function\n%s%s:\n", func ? "sl_" : "", name, func ? "sl_" : "", name);
+    fprintf(out, "\tpushq %%rbp\n\tmovq %%rsp, %%rbp\n\tsubq $%d, %%rsp\n", _frame_size(ctx, func));
+    _save_callee_regs(ctx, func, true);
+    if (!func) {
+        _clear_regs(ctx, func);
+        return;
+    }
+
+    if (f->display) fprintf(out, "\tmovq sl_d%d(%%rip), %%rax\n\tmovq %%rax, -8(%%rbp)\n\tmovq %%rbp, sl_d%d(%%rip)\n", func, func);
+    for (int s = 0; s < ctx->interp->funcs[func].slot_size; s++) fprintf(out, "\tmovq $0, -%d(%%rbp)\n", _slot_offset(s));
+    for (int k = 0; k < f->param_size; k++) {
+        int index;
+        int off = _param_offset(ctx, func, k);
+        switch (_classify(f, k, &index)) {
+            case ARG_INT_REG: fprintf(out, "\tmovq %s, -%d(%%rbp)\n", int_arg_regs64[index], off); break;
+            case ARG_FLOAT_REG: fprintf(out, "\tmovss %%xmm%d, -%d(%%rbp)\n", index, off); break;
+            default: break;
+        }
+    }
+    // after params are saved, r8 & r9 may be allocated
+    _clear_regs(ctx, func);
+}
+
+// vars of the top level code, the same format as the interpreter
+static void _emit_print_globals(struct X64Ctx *ctx) {
+    FILE              *out = ctx->out;
+    struct InterpFunc *top = &ctx->interp->funcs[0];
+    for (int s = 0; s < top->slot_size; s++) {
+        if (is_temp_var(top->slots[s])) continue;
+
+        char *fmt;
+        switch (ctx->info->funcs[0].slot_types[s]) {
+            case TAC_TYPE_FLOAT: {
+                fmt = "%s = %g\n";
+                fprintf(out, "\tcvtss2sd sl_g%d(%%rip), %%xmm0\n\tmovl $1, %%eax\n", s);
+                break;
+            }
+            case TAC_TYPE_BOOL: {
+                fmt = "%s = %s\n";
+                fprintf(out,
+                        "\tleaq .Ls%d(%%rip), %%rdx\n\tleaq .Ls%d(%%rip), %%rcx\n\tcmpl $0, sl_g%d(%%rip)\n\tcmove %%rcx, %%rdx\n\txorl %%eax, %%eax\n",
+                        _string_label(ctx, "true"),
+                        _string_label(ctx, "false"),
+                        s);
+                break;
+            }
+            case TAC_TYPE_CHAR: {
+                fmt = "%s = '%c'\n";
+                fprintf(out, "\tmovl sl_g%d(%%rip), %%edx\n\txorl %%eax, %%eax\n", s);
+                break;
+            }
+            case TAC_TYPE_STRING: {
+                fmt = "%s = \"%s\"\n";
+                fprintf(out, "\tmovq sl_g%d(%%rip), %%rdx\n\txorl %%eax, %%eax\n", s);
+                break;
+            }
+            default: {
+                fmt = "%s = %d\n";
+                fprintf(out, "\tmovl sl_g%d(%%rip), %%edx\n\txorl %%eax, %%eax\n", s);
+            }
+        }
+        fprintf(out, "\tleaq .Ls%d(%%rip), %%rsi\n\tleaq .Ls%d(%%rip), %%rdi\n\tcall printf@PLT\n", _string_label(ctx, unpack_name(top->slots[s])), _string_label(ctx, fmt));
+    }
+}
+
+static void _emit_func(struct X64Ctx *ctx, int func) {
+    struct Interp *interp = ctx->interp;
+    FILE          *out = ctx->out;
+    ctx->func = func;
+    ctx->depth = 0;
+    _emit_prologue(ctx, func);
+
+    // location of split vars at the last instr emitted
+    int *prev = _x64_alloc(interp->funcs[func].slot_size * sizeof(int));
+    for (int s = 0; s < interp->funcs[func].slot_size; s++) prev[s] = REG_NONE;
+
+    int  start = func ? interp->funcs[func].entry : 0;
+    int  end = func ? interp->funcs[func].end : interp->instr_size;
+    bool target = false;
+    for (int i = start; i < end; i++) {
+        if (ctx->info->owner[i] != func) continue;
+        if (ctx->info->target[i]) fprintf(out, ".Lt%d:\n", i);
+        // a jump over a nested func body emits nothing, its label belongs to the next instr
+        target |= ctx->info->target[i];
+        if (ctx->info->skip[i]) continue;
+
+        ctx->pos = tac_position(interp->instrs[i].tac_index);
+        _reload_regs(ctx, prev, target);
+        target = false;
+        _emit_instr(ctx, i);
+    }
+    free(prev);
+
+    if (!func) {
+        fprintf(out, ".Lt%d:\n", interp->instr_size);
+        _emit_print_globals(ctx);
+        _save_callee_regs(ctx, func, false);
+        fprintf(out, "\txorl %%eax, %%eax\n\tleave\n\tret\n");
+        return;
+    }
+    fprintf(out, ".Lret%d:\n", func);
+    if (ctx->info->funcs[func].display) fprintf(out, "\tmovq -8(%%rbp), %%rdx\n\tmovq %%rdx, sl_d%d(%%rip)\n", func);
+    _save_callee_regs(ctx, func, false);
+    fprintf(out, "\tleave\n\tret\n");
+}
+
+static void _emit_string(FILE *out, char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\') fprintf(out, "\\%c", c);
+        else if (c < 32 || c >= 127) fprintf(out, "\\%03o", c);
+        else fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+static void _emit_data(struct X64Ctx *ctx) {
+    FILE *out = ctx->out;
+    fprintf(out, "\n\t.bss\n\t.p2align 3\n");
+    for (int s = 0; s < ctx->interp->funcs[0].slot_size; s++) fprintf(out, "sl_g%d:\n\t.zero 8\n", s);
+    for (int f = 1; f < ctx->interp->func_size; f++)
+        if (ctx->info->funcs[f].display) fprintf(out, "sl_d%d:\n\t.zero 8\n", f);
+
+    fprintf(out, "\n\t.section .rodata\n");
+    for (int i = 0; i < ctx->string_size; i++) {
+        fprintf(out, ".Ls%d:\n\t.string ", i);
+        _emit_string(out, ctx->strings[i]);
+        fprintf(out, "\n");
+    }
+    fprintf(out, "\n\t.section .note.GNU-stack,\"\",@progbits\n");
+}
+
+static void _emit_runtime(struct X64Ctx *ctx) {
+    FILE *out = ctx->out;
+    fprintf(out, "\n\t.text\nsl_runtime_error:\n\tpushq %%rbp\n\tmovq %%rsp, %%rbp\n\tmovq %%rdi, %%rdx\n");
+    fprintf(out, "\tleaq .Ls%d(%%rip), %%rsi\n\tmovl $2, %%edi\n\txorl %%eax, %%eax\n\tcall dprintf@PLT\n", _string_label(ctx, "runtime error: %s\n"));
+    fprintf(out, "\tmovl $1, %%edi\n\tcall exit@PLT\n");
+    fprintf(out, ".Ldiv_zero:\n");
+    _emit_error(ctx, "division by zero");
+}
+
+struct RegAlloc *emit_x86_64(struct Interp *interp, struct CFG *cfg, FILE *out) {
+    struct X64Ctx ctx = {.interp = interp, .out = out, .info = create_native_info(interp)};
+    ctx.funcs = _x64_alloc(interp->func_size * sizeof(struct X64Func));
+    if (cfg) _alloc_regs(&ctx, cfg);
+    else
+        for (int f = 0; f < interp->func_size; f++) ctx.funcs[f].slot_vars = _x64_alloc(interp->funcs[f].slot_size * sizeof(struct RegAllocVar *));
+
+    fprintf(out, "\t.file \"squirrel\"\n");
+    for (int f = 1; f < interp->func_size; f++) _emit_func(&ctx, f);
+    _emit_func(&ctx, 0);
+    _emit_runtime(&ctx);
+    _emit_data(&ctx);
+
+    for (int f = 0; f < interp->func_size; f++) free(ctx.funcs[f].slot_vars);
+    free(ctx.funcs);
+    free_native_info(ctx.info);
+    free(ctx.strings);
+    return ctx.ra;
+}
+
+bool link_native(char *asm_path, char *exe_path) {
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd), "cc -o '%s' '%s'", exe_path, asm_path);
+    return system(cmd) == 0;
+}
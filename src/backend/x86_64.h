@@ -0,0 +1,25 @@
+#ifndef X86_64_H
+#define X86_64_H
+
+#include "interp.h"
+#include "regalloc.h"
+
+#include <stdio.h>
+
+#define X64_INT_ARG_REGS 6
+#define X64_FLOAT_ARG_REGS 8
+
+/*
+ * Emit GNU assembly of the resolved TAC for x86-64 System V:
+ * each func becomes a function sl_<name>, the top level code becomes main and prints its vars at the end, like the interpreter.
+ * Top level vars live in .bss, vars of other funcs in the frame, reached from nested funcs through a display of frame pointers.
+ * int, char & bool are 32-bit in general registers, float in xmm registers, string is a pointer.
+ * With the cfg the interp is created from, int, char & bool vars of funcs are allocated to registers by linear scan,
+ * returns the allocation to be freed by the caller, NULL without cfg.
+ */
+struct RegAlloc *emit_x86_64(struct Interp *interp, struct CFG *cfg, FILE *out);
+
+// assemble & link asm_path into exe_path with the system cc, returns false if it fails
+bool link_native(char *asm_path, char *exe_path);
+
+#endif
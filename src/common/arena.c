@@ -0,0 +1,73 @@
+#include "arena.h"
+#include "global.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGN 16
+
+static struct ArenaChunk *_create_arena_chunk(size_t size, struct ArenaChunk *next) {
+    struct ArenaChunk *chunk = malloc(sizeof(struct ArenaChunk) + size);
+    if (!chunk) {
+        fprintf(stderr, "_create_arena_chunk(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    chunk->next = next;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+struct Arena *create_arena() {
+    struct Arena *arena = CREATE_STRUCT_P(Arena);
+    if (!arena) {
+        fprintf(stderr, "create_arena(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return arena;
+}
+
+void free_arena(struct Arena *arena) {
+    if (!arena) return;
+
+    struct ArenaChunk *chunk = arena->chunk;
+    while (chunk) {
+        struct ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(arena);
+}
+
+void *arena_alloc(struct Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (!size) size = ARENA_ALIGN;
+
+    struct ArenaChunk *chunk = arena->chunk;
+    if (!chunk || chunk->used + size > chunk->size) {
+        // big allocations get their own chunk, keep the current one for small ones
+        if (size > ARENA_CHUNK_SIZE / 4 && chunk) {
+            struct ArenaChunk *big = _create_arena_chunk(size, chunk->next);
+            chunk->next = big;
+            big->used = size;
+            arena->allocated += size;
+            memset(big->data, 0, size);
+            return big->data;
+        }
+        chunk = _create_arena_chunk(size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE, chunk);
+        arena->chunk = chunk;
+    }
+
+    void *p = chunk->data + chunk->used;
+    chunk->used += size;
+    arena->allocated += size;
+    memset(p, 0, size);
+    return p;
+}
+
+void *arena_realloc(struct Arena *arena, void *ptr, size_t old_size, size_t new_size) {
+    void *p = arena_alloc(arena, new_size);
+    if (ptr && old_size) memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+    return p;
+}
@@ -0,0 +1,32 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+struct ArenaChunk {
+    struct ArenaChunk *next; // previous allocated chunk
+    size_t             size; // usable bytes of data
+    size_t             used; // used bytes of data
+    _Alignas(16) char  data[];
+};
+
+/*
+ * Bump allocator, all memory is released at once by free_arena().
+ * Careful that Arena is not thread safe, use one arena per thread.
+ */
+struct Arena {
+    struct ArenaChunk *chunk; // current chunk, linked to older chunks
+    size_t             allocated;
+};
+
+struct Arena *create_arena();
+void          free_arena(struct Arena *arena);
+
+// returns zeroed memory aligned to 16 bytes
+void *arena_alloc(struct Arena *arena, size_t size);
+// returns zeroed memory of new_size, with the first old_size bytes copied from ptr
+void *arena_realloc(struct Arena *arena, void *ptr, size_t old_size, size_t new_size);
+
+#endif
@@ -1,3 +1,3 @@
 #include "global.h"
 
-bool debug;
\ No newline at end of file
+_Thread_local bool debug;
\ No newline at end of file
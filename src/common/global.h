@@ -3,8 +3,10 @@
 
 #include <stdbool.h>
 
+#define SQUIRREL_VERSION "0.1.0"
+
 #define CREATE_STRUCT_P(T) calloc(1, sizeof(struct T))
 
-extern bool debug;
+extern _Thread_local bool debug;
 
 #endif
\ No newline at end of file
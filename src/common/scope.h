@@ -7,6 +7,7 @@
 struct Scope {
     char          *name;         // name of scope
     bool           is_func;      // is scope a func scope
+    char          *func_name;    // name of the func, for func scope only
     struct Symbol *first_symbol; // first symbol in symbol list
     struct Symbol *last_symbol;  // last symbol in symbol list
 
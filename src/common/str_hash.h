@@ -0,0 +1,57 @@
+#ifndef STR_HASH_H
+#define STR_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * String hash in the style of wyhash, reading 8 bytes at a time.
+ * Each word is folded by a 64x64->128 bit multiply, so names sharing long prefixes & differing
+ * in the last digits (V#$t1, V#$t2, IF_TRUE#51) still spread over all bits of the hash.
+ */
+
+#define STR_HASH_P0 0xa0761d6478bd642fULL
+#define STR_HASH_P1 0xe7037ed1a0b428dbULL
+#define STR_HASH_P2 0x8ebc6af09c88c6e3ULL
+
+static inline uint64_t str_hash_mix(uint64_t a, uint64_t b) {
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+static inline uint64_t str_hash_read8(const char *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t str_hash_read4(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t str_hash64(const char *s, size_t len) {
+    uint64_t seed = str_hash_mix(STR_HASH_P0, STR_HASH_P1);
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            // two overlapping reads cover 4..16 bytes
+            size_t k = (len >> 3) << 2;
+            a = str_hash_read4(s) << 32 | str_hash_read4(s + k);
+            b = str_hash_read4(s + len - 4) << 32 | str_hash_read4(s + len - 4 - k);
+        } else if (len) {
+            a = (uint64_t)(unsigned char)s[0] << 16 | (uint64_t)(unsigned char)s[len >> 1] << 8 | (unsigned char)s[len - 1];
+            b = 0;
+        } else a = b = 0;
+    } else {
+        size_t i = len;
+        for (; i > 16; i -= 16, s += 16) seed = str_hash_mix(str_hash_read8(s) ^ STR_HASH_P1, str_hash_read8(s + 8) ^ seed);
+        a = str_hash_read8(s + i - 16);
+        b = str_hash_read8(s + i - 8);
+    }
+    return str_hash_mix(STR_HASH_P1 ^ len, str_hash_mix(a ^ STR_HASH_P1, b ^ seed) ^ STR_HASH_P2);
+}
+
+#endif
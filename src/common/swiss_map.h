@@ -0,0 +1,246 @@
+#ifndef SWISS_MAP_H
+#define SWISS_MAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "str_hash.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Open addressing hashmap in the style of Swiss tables, header only & specialized by macros.
+ *
+ * Slots are split into groups of SWISS_GROUP_SIZE, each slot has one control byte:
+ * SWISS_EMPTY, SWISS_DELETED or the low 7 bits of the hash (h2) if it is full.
+ * A lookup starts at the group picked by the high bits of the hash (h1), matches h2 against all
+ * control bytes of the group at once, with SSE2 if it is available, and probes the next groups
+ * triangularly till a group with an empty slot.
+ * Keys & values are stored inline with the full hash, so rehashing & mismatches never touch the keys.
+ *
+ * Keys are not copied, the caller keeps them alive while they are in the map.
+ * Careful that the map is not thread safe.
+ */
+
+#define SWISS_GROUP_SIZE 16
+#define SWISS_EMPTY ((uint8_t)0x80)
+#define SWISS_DELETED ((uint8_t)0xFE)
+
+static inline uint8_t swiss_h2(uint64_t hash) {
+    return hash & 0x7F;
+}
+
+static inline size_t swiss_h1(uint64_t hash) {
+    return hash >> 7;
+}
+
+// bit k is set if control byte k of the group equals b
+static inline unsigned swiss_match(const uint8_t *ctrl, uint8_t b) {
+#if defined(__SSE2__)
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)b)));
+#else
+    unsigned mask = 0;
+    for (int k = 0; k < SWISS_GROUP_SIZE; k++) mask |= (unsigned)(ctrl[k] == b) << k;
+    return mask;
+#endif
+}
+
+// bit k is set if slot k of the group is empty or deleted, full control bytes never have the high bit
+static inline unsigned swiss_match_free(const uint8_t *ctrl) {
+#if defined(__SSE2__)
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+#else
+    unsigned mask = 0;
+    for (int k = 0; k < SWISS_GROUP_SIZE; k++) mask |= (unsigned)(ctrl[k] >> 7) << k;
+    return mask;
+#endif
+}
+
+static inline int swiss_first_bit(unsigned mask) {
+    return __builtin_ctz(mask);
+}
+
+// murmur3 finalizer, every input bit affects h1 & h2
+static inline uint64_t swiss_int_hash(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+static inline uint64_t swiss_str_hash(const char *s) {
+    return str_hash64(s, strlen(s));
+}
+
+static inline bool swiss_str_eq(const char *s1, const char *s2) {
+    return !strcmp(s1, s2);
+}
+
+static inline bool swiss_int_eq(long k1, long k2) {
+    return k1 == k2;
+}
+
+/*
+ * Declare struct T & its functions named prefix_xxx, for keys of type K & values of type V:
+ *   void prefix_init(struct T *m)       empty map, no memory allocated
+ *   void prefix_free(struct T *m)
+ *   void prefix_clear(struct T *m)      remove all keys, keep the capacity
+ *   V   *prefix_get(struct T *m, K key) NULL if absent
+ *   V   *prefix_put(struct T *m, K key) slot of the value, zeroed if the key is new
+ *   bool prefix_remove(struct T *m, K key)
+ *   prefix_get/put/remove_hashed take the hash of prefix_hash(key), to hash a key once for several calls
+ *   struct T##Slot *prefix_next(struct T *m, size_t *pos) next full slot from *pos, NULL at the end
+ * Pointers returned are invalid after the next put.
+ */
+#define SWISS_MAP(T, prefix, K, V, hash_f, eq_f)                                                                     \
+    struct T##Slot {                                                                                                 \
+        uint64_t hash;                                                                                               \
+        K        key;                                                                                                \
+        V        val;                                                                                                \
+    };                                                                                                               \
+                                                                                                                     \
+    struct T {                                                                                                       \
+        uint8_t        *ctrl;                                                                                        \
+        struct T##Slot *slots;                                                                                       \
+        size_t          cap; /* 0 or a power of 2, at least SWISS_GROUP_SIZE */                                      \
+        size_t          size;                                                                                        \
+        size_t          deleted;                                                                                     \
+    };                                                                                                               \
+                                                                                                                     \
+    static inline void prefix##_init(struct T *m) {                                                                  \
+        memset(m, 0, sizeof(struct T));                                                                              \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline void prefix##_free(struct T *m) {                                                                  \
+        free(m->ctrl);                                                                                               \
+        free(m->slots);                                                                                              \
+        prefix##_init(m);                                                                                            \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline void prefix##_clear(struct T *m) {                                                                 \
+        if (m->ctrl && m->size + m->deleted) memset(m->ctrl, SWISS_EMPTY, m->cap);                                   \
+        m->size = m->deleted = 0;                                                                                    \
+    }                                                                                                                \
+                                                                                                                     \
+    /* index of the slot holding key, or -1 */                                                                       \
+    static inline long prefix##_find(struct T *m, K key, uint64_t hash) {                                            \
+        if (!m->cap) return -1;                                                                                      \
+        size_t  groups = m->cap / SWISS_GROUP_SIZE;                                                                  \
+        size_t  g = swiss_h1(hash) & (groups - 1);                                                                   \
+        uint8_t h2 = swiss_h2(hash);                                                                                 \
+        for (size_t step = 1;; step++) {                                                                             \
+            uint8_t *ctrl = m->ctrl + g * SWISS_GROUP_SIZE;                                                          \
+            for (unsigned mask = swiss_match(ctrl, h2); mask; mask &= mask - 1) {                                    \
+                size_t i = g * SWISS_GROUP_SIZE + swiss_first_bit(mask);                                             \
+                if (m->slots[i].hash == hash && eq_f(m->slots[i].key, key)) return i;                                \
+            }                                                                                                        \
+            if (swiss_match(ctrl, SWISS_EMPTY) || step > groups) return -1;                                          \
+            g = (g + step) & (groups - 1);                                                                           \
+        }                                                                                                            \
+    }                                                                                                                \
+                                                                                                                     \
+    /* first empty or deleted slot on the probe sequence of hash, there is always one */                             \
+    static inline size_t prefix##_find_free(struct T *m, uint64_t hash) {                                            \
+        size_t groups = m->cap / SWISS_GROUP_SIZE;                                                                   \
+        size_t g = swiss_h1(hash) & (groups - 1);                                                                    \
+        for (size_t step = 1;; step++) {                                                                             \
+            unsigned mask = swiss_match_free(m->ctrl + g * SWISS_GROUP_SIZE);                                        \
+            if (mask) return g * SWISS_GROUP_SIZE + swiss_first_bit(mask);                                           \
+            g = (g + step) & (groups - 1);                                                                           \
+        }                                                                                                            \
+    }                                                                                                                \
+                                                                                                                     \
+    /* rehash into cap slots, deleted slots are dropped */                                                           \
+    static inline void prefix##_rehash(struct T *m, size_t cap) {                                                    \
+        struct T old = *m;                                                                                           \
+        m->ctrl = malloc(cap);                                                                                       \
+        m->slots = malloc(cap * sizeof(struct T##Slot));                                                             \
+        if (!m->ctrl || !m->slots) {                                                                                 \
+            fprintf(stderr, #prefix "_rehash(), no enough memory\n");                                                \
+            exit(EXIT_FAILURE);                                                                                      \
+        }                                                                                                            \
+        memset(m->ctrl, SWISS_EMPTY, cap);                                                                           \
+        m->cap = cap;                                                                                                \
+        m->deleted = 0;                                                                                              \
+        for (size_t i = 0; i < old.cap; i++) {                                                                       \
+            if (old.ctrl[i] & 0x80) continue;                                                                        \
+            size_t j = prefix##_find_free(m, old.slots[i].hash);                                                     \
+            m->ctrl[j] = old.ctrl[i];                                                                                \
+            m->slots[j] = old.slots[i];                                                                              \
+        }                                                                                                            \
+        free(old.ctrl);                                                                                              \
+        free(old.slots);                                                                                             \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline uint64_t prefix##_hash(K key) {                                                                    \
+        return hash_f(key);                                                                                          \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline V *prefix##_get_hashed(struct T *m, K key, uint64_t hash) {                                        \
+        long i = prefix##_find(m, key, hash);                                                                        \
+        return i < 0 ? NULL : &m->slots[i].val;                                                                      \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline V *prefix##_get(struct T *m, K key) {                                                              \
+        return prefix##_get_hashed(m, key, hash_f(key));                                                             \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline V *prefix##_put_hashed(struct T *m, K key, uint64_t hash) {                                        \
+        long i = prefix##_find(m, key, hash);                                                                        \
+        if (i >= 0) return &m->slots[i].val;                                                                         \
+                                                                                                                     \
+        /* at most 7/8 full, counting deleted slots, which are dropped if they are the most part */                  \
+        if ((m->size + m->deleted + 1) * 8 > m->cap * 7) {                                                           \
+            size_t cap = m->cap ? m->cap : SWISS_GROUP_SIZE;                                                         \
+            if ((m->size + 1) * 16 > cap * 7) cap <<= 1;                                                             \
+            prefix##_rehash(m, cap);                                                                                 \
+        }                                                                                                            \
+        size_t j = prefix##_find_free(m, hash);                                                                      \
+        if (m->ctrl[j] == SWISS_DELETED) m->deleted--;                                                               \
+        m->ctrl[j] = swiss_h2(hash);                                                                                 \
+        m->slots[j].hash = hash;                                                                                     \
+        m->slots[j].key = key;                                                                                       \
+        memset(&m->slots[j].val, 0, sizeof(V));                                                                      \
+        m->size++;                                                                                                   \
+        return &m->slots[j].val;                                                                                     \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline V *prefix##_put(struct T *m, K key) {                                                              \
+        return prefix##_put_hashed(m, key, hash_f(key));                                                             \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline bool prefix##_remove_hashed(struct T *m, K key, uint64_t hash) {                                   \
+        long i = prefix##_find(m, key, hash);                                                                        \
+        if (i < 0) return false;                                                                                     \
+        /* a group with an empty slot ends every probe through it, so the slot may become empty again */             \
+        bool empty = swiss_match(m->ctrl + (i & ~(long)(SWISS_GROUP_SIZE - 1)), SWISS_EMPTY);                        \
+        m->ctrl[i] = empty ? SWISS_EMPTY : SWISS_DELETED;                                                            \
+        if (!empty) m->deleted++;                                                                                    \
+        m->size--;                                                                                                   \
+        return true;                                                                                                 \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline bool prefix##_remove(struct T *m, K key) {                                                         \
+        return prefix##_remove_hashed(m, key, hash_f(key));                                                          \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline struct T##Slot *prefix##_next(struct T *m, size_t *pos) {                                          \
+        for (; *pos < m->cap; (*pos)++)                                                                              \
+            if (!(m->ctrl[*pos] & 0x80)) return &m->slots[(*pos)++];                                                 \
+        return NULL;                                                                                                 \
+    }
+
+// string keys, compared by content
+#define SWISS_STR_MAP(T, prefix, V) SWISS_MAP(T, prefix, const char *, V, swiss_str_hash, swiss_str_eq)
+// integer & pointer keys, stored as long
+#define SWISS_INT_MAP(T, prefix, V) SWISS_MAP(T, prefix, long, V, swiss_int_hash, swiss_int_eq)
+
+#endif
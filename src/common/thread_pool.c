@@ -0,0 +1,190 @@
+#include "thread_pool.h"
+#include "global.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+struct WorkerArg {
+    struct ThreadPool *pool;
+    int                id;
+};
+
+// the pool & deque index the current thread works for
+static _Thread_local struct ThreadPool *cur_pool;
+static _Thread_local int                cur_worker = -1;
+
+int thread_pool_cpu_count() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+static void _deque_push(struct TaskDeque *d, struct Task task) {
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom == d->cap) {
+        // compact before growing
+        if (d->top) {
+            for (int i = d->top; i < d->bottom; i++) d->tasks[i - d->top] = d->tasks[i];
+            d->bottom -= d->top;
+            d->top = 0;
+        }
+        if (d->bottom == d->cap) {
+            int          new_cap = d->cap ? d->cap << 1 : 64;
+            struct Task *tasks = realloc(d->tasks, new_cap * sizeof(struct Task));
+            if (!tasks) {
+                fprintf(stderr, "_deque_push(), no enough memory\n");
+                exit(EXIT_FAILURE);
+            }
+            d->tasks = tasks;
+            d->cap = new_cap;
+        }
+    }
+    d->tasks[d->bottom++] = task;
+    pthread_mutex_unlock(&d->lock);
+}
+
+static bool _deque_pop(struct TaskDeque *d, struct Task *task) {
+    bool ok = false;
+    pthread_mutex_lock(&d->lock);
+    if (d->top < d->bottom) {
+        *task = d->tasks[--d->bottom];
+        ok = true;
+        if (d->top == d->bottom) d->top = d->bottom = 0;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+static bool _deque_steal(struct TaskDeque *d, struct Task *task) {
+    bool ok = false;
+    pthread_mutex_lock(&d->lock);
+    if (d->top < d->bottom) {
+        *task = d->tasks[d->top++];
+        ok = true;
+        if (d->top == d->bottom) d->top = d->bottom = 0;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+// own deque first, then steal from others starting at the next worker
+static bool _find_task(struct ThreadPool *pool, int id, struct Task *task) {
+    if (_deque_pop(&pool->deques[id], task)) return true;
+    for (int i = 1; i < pool->size; i++)
+        if (_deque_steal(&pool->deques[(id + i) % pool->size], task)) return true;
+    return false;
+}
+
+static void *_worker(void *p) {
+    struct WorkerArg  *arg = p;
+    struct ThreadPool *pool = arg->pool;
+    int                id = arg->id;
+    free(arg);
+
+    cur_pool = pool;
+    cur_worker = id;
+    for (;;) {
+        struct Task task;
+        if (_find_task(pool, id, &task)) {
+            pthread_mutex_lock(&pool->lock);
+            pool->queued--;
+            pthread_mutex_unlock(&pool->lock);
+
+            time_task_begin(&task.time);
+            task.func(task.arg);
+            time_task_end(&task.time);
+
+            pthread_mutex_lock(&pool->lock);
+            if (!--pool->pending) pthread_cond_broadcast(&pool->done_cond);
+            pthread_mutex_unlock(&pool->lock);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->shutdown && !pool->queued) pthread_cond_wait(&pool->task_cond, &pool->lock);
+        bool shutdown = pool->shutdown && !pool->queued;
+        pthread_mutex_unlock(&pool->lock);
+        if (shutdown) break;
+    }
+    return NULL;
+}
+
+struct ThreadPool *create_thread_pool(int size) {
+    if (size <= 0) size = thread_pool_cpu_count();
+
+    struct ThreadPool *pool = CREATE_STRUCT_P(ThreadPool);
+    if (!pool) {
+        fprintf(stderr, "create_thread_pool(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    pool->size = size;
+    pool->threads = calloc(size, sizeof(pthread_t));
+    pool->deques = calloc(size, sizeof(struct TaskDeque));
+    if (!pool->threads || !pool->deques) {
+        fprintf(stderr, "create_thread_pool(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->task_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+    for (int i = 0; i < size; i++) pthread_mutex_init(&pool->deques[i].lock, NULL);
+
+    for (int i = 0; i < size; i++) {
+        struct WorkerArg *arg = CREATE_STRUCT_P(WorkerArg);
+        if (!arg) {
+            fprintf(stderr, "create_thread_pool(), no enough memory\n");
+            exit(EXIT_FAILURE);
+        }
+        arg->pool = pool;
+        arg->id = i;
+        if (pthread_create(&pool->threads[i], NULL, _worker, arg)) {
+            fprintf(stderr, "create_thread_pool(), can not create thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return pool;
+}
+
+void free_thread_pool(struct ThreadPool *pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->task_cond);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->size; i++) pthread_join(pool->threads[i], NULL);
+
+    for (int i = 0; i < pool->size; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->task_cond);
+    pthread_cond_destroy(&pool->done_cond);
+    free(pool->threads);
+    free(pool->deques);
+    free(pool);
+}
+
+void thread_pool_submit(struct ThreadPool *pool, task_func func, void *arg) {
+    // push under the pool lock, so queued never falls behind tasks in deques
+    pthread_mutex_lock(&pool->lock);
+    pool->pending++;
+    pool->queued++;
+    int id = cur_worker;
+    if (cur_pool != pool) {
+        id = pool->next;
+        pool->next = (pool->next + 1) % pool->size;
+    }
+    struct Task task = {.func = func, .arg = arg};
+    time_task_init(&task.time);
+    _deque_push(&pool->deques[id], task);
+    pthread_cond_signal(&pool->task_cond);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void thread_pool_wait(struct ThreadPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending) pthread_cond_wait(&pool->done_cond, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,52 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "time_report.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+
+typedef void (*task_func)(void *arg);
+
+struct Task {
+    task_func       func;
+    void           *arg;
+    struct TimeTask time; // counted in the phase of the submitting thread
+};
+
+// tasks of a worker, the owner pops from the bottom, thieves steal from the top
+struct TaskDeque {
+    pthread_mutex_t lock;
+    struct Task    *tasks;
+    int             top;
+    int             bottom;
+    int             cap;
+};
+
+/*
+ * Work-stealing thread pool, each worker runs tasks of its own deque and steals from others when it's empty.
+ * Tasks submitted from a worker go to the deque of the worker, others are spread over all deques.
+ */
+struct ThreadPool {
+    pthread_t        *threads;
+    struct TaskDeque *deques;
+    int               size;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  task_cond; // signaled when tasks are submitted
+    pthread_cond_t  done_cond; // signaled when all tasks are done
+    int             pending;   // submitted but not finished tasks
+    int             queued;    // tasks in deques, not taken by any worker yet
+    int             next;      // deque for the next task submitted from outside
+    bool            shutdown;
+};
+
+// size <= 0 means one worker per online cpu
+struct ThreadPool *create_thread_pool(int size);
+void               free_thread_pool(struct ThreadPool *pool);
+void               thread_pool_submit(struct ThreadPool *pool, task_func func, void *arg);
+// wait until all submitted tasks are done, should not be called from a worker
+void               thread_pool_wait(struct ThreadPool *pool);
+int                thread_pool_cpu_count();
+
+#endif
@@ -0,0 +1,288 @@
+#include "time_report.h"
+#include "trace.h"
+
+#include <malloc.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static char *phase_names[] = {
+    [PHASE_LEX] = "lex_next",
+    [PHASE_PARSE] = "parse",
+    [PHASE_SCOPE] = "manage_scope",
+    [PHASE_TYPE] = "check_node_type",
+    [PHASE_STMT] = "check_stmt",
+    [PHASE_IR_GEN] = "gen_tac_from_ast",
+    [PHASE_CFG] = "create_cfg",
+    [PHASE_OPTIMIZE] = "optimize_tac",
+    [PHASE_EMIT] = "emit",
+};
+
+static char *format_names[] = {
+    [TIME_REPORT_TABLE] = "table",
+    [TIME_REPORT_JSON] = "json",
+};
+
+// allocations of the thread, always counted, phases take the differences
+static _Thread_local uint64_t allocs;
+static _Thread_local uint64_t alloc_bytes;
+
+/*
+ * Wrappers of allocation functions, calls of them are redirected here by -Wl,--wrap=malloc,...
+ * __real_* are weak, so it still links without --wrap, the wrappers are not called then.
+ */
+extern void *__real_malloc(size_t size) __attribute__((weak));
+extern void *__real_calloc(size_t n, size_t size) __attribute__((weak));
+extern void *__real_realloc(void *ptr, size_t size) __attribute__((weak));
+extern char *__real_strdup(const char *s) __attribute__((weak));
+
+void *__wrap_malloc(size_t size) {
+    allocs++;
+    alloc_bytes += size;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    allocs++;
+    alloc_bytes += n * size;
+    return __real_calloc(n, size);
+}
+
+// only the growth is counted, a buffer grown line by line is not counted again & again
+void *__wrap_realloc(void *ptr, size_t size) {
+    size_t old_size = ptr ? malloc_usable_size(ptr) : 0;
+    allocs++;
+    alloc_bytes += size > old_size ? size - old_size : 0;
+    return __real_realloc(ptr, size);
+}
+
+char *__wrap_strdup(const char *s) {
+    allocs++;
+    alloc_bytes += strlen(s) + 1;
+    return __real_strdup(s);
+}
+
+// cpu & allocations of pool tasks, added by the workers
+struct SharedStats {
+    uint64_t cpu_ns;
+    uint64_t allocs;
+    uint64_t alloc_bytes;
+};
+
+struct Recorder {
+    bool              recording;
+    int               depth;
+    enum Phase        stack[TIME_REPORT_MAX_DEPTH];
+    // since the last phase begins or ends
+    double            wall;
+    double            cpu;
+    uint64_t          allocs;
+    uint64_t          alloc_bytes;
+    // when started
+    double            start_wall;
+    double            start_cpu;
+    uint64_t          start_allocs;
+    uint64_t          start_alloc_bytes;
+    struct PhaseStats phases[PHASE_SIZE];
+    // of tasks submitted in each phase, the last is out of any phase
+    struct SharedStats shared[PHASE_SIZE + 1];
+};
+
+static _Thread_local struct Recorder recorder;
+
+static double _clock(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// add what happened since the last mark to stats, & mark now
+static void _charge(struct PhaseStats *stats) {
+    double wall = _clock(CLOCK_MONOTONIC), cpu = _clock(CLOCK_THREAD_CPUTIME_ID);
+    if (stats) {
+        stats->wall += wall - recorder.wall;
+        stats->cpu += cpu - recorder.cpu;
+        stats->allocs += allocs - recorder.allocs;
+        stats->alloc_bytes += alloc_bytes - recorder.alloc_bytes;
+    }
+    recorder.wall = wall;
+    recorder.cpu = cpu;
+    recorder.allocs = allocs;
+    recorder.alloc_bytes = alloc_bytes;
+}
+
+static void _add_stats(struct PhaseStats *stats, struct PhaseStats *other) {
+    stats->calls += other->calls;
+    stats->wall += other->wall;
+    stats->cpu += other->cpu;
+    stats->allocs += other->allocs;
+    stats->alloc_bytes += other->alloc_bytes;
+}
+
+bool parse_time_report_format(char *name, enum TimeReportFormat *format) {
+    for (int i = TIME_REPORT_TABLE; i < (int)(sizeof(format_names) / sizeof(format_names[0])); i++) {
+        if (strcmp(name, format_names[i])) continue;
+
+        *format = i;
+        return true;
+    }
+    return false;
+}
+
+void time_report_start() {
+    memset(&recorder, 0, sizeof(struct Recorder));
+    recorder.recording = true;
+    _charge(NULL);
+    recorder.start_wall = recorder.wall;
+    recorder.start_cpu = recorder.cpu;
+    recorder.start_allocs = recorder.allocs;
+    recorder.start_alloc_bytes = recorder.alloc_bytes;
+}
+
+void time_report_stop(struct TimeReport *report) {
+    if (!recorder.recording) return;
+
+    // phases left by exits are closed here
+    while (recorder.depth) time_phase_end();
+    _charge(NULL);
+    recorder.recording = false;
+
+    struct PhaseStats total = {
+        .calls = 1,
+        .wall = recorder.wall - recorder.start_wall,
+        .cpu = recorder.cpu - recorder.start_cpu,
+        .allocs = recorder.allocs - recorder.start_allocs,
+        .alloc_bytes = recorder.alloc_bytes - recorder.start_alloc_bytes,
+    };
+    // tasks are all done, the pool is waited for in their phases
+    for (int i = 0; i <= PHASE_SIZE; i++) {
+        struct SharedStats *s = &recorder.shared[i];
+        struct PhaseStats   tasks = {.cpu = s->cpu_ns / 1e9, .allocs = s->allocs, .alloc_bytes = s->alloc_bytes};
+        _add_stats(&total, &tasks);
+        if (i < PHASE_SIZE) _add_stats(&recorder.phases[i], &tasks);
+    }
+    _add_stats(&report->total, &total);
+    for (int i = 0; i < PHASE_SIZE; i++) _add_stats(&report->phases[i], &recorder.phases[i]);
+    report->compiles++;
+}
+
+void time_report_merge(struct TimeReport *report, struct TimeReport *other) {
+    _add_stats(&report->total, &other->total);
+    for (int i = 0; i < PHASE_SIZE; i++) _add_stats(&report->phases[i], &other->phases[i]);
+    report->compiles += other->compiles;
+}
+
+// phases are spans of the trace too, except lex_next, a span per token would be most of the trace
+void time_phase_begin(enum Phase phase) {
+    if (!recorder.recording && !trace_enabled) return;
+    if (recorder.depth == TIME_REPORT_MAX_DEPTH) {
+        fprintf(stderr, "time_phase_begin(), phases nested too deep\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (recorder.recording) {
+        // time out of any phase goes to other
+        _charge(recorder.depth ? &recorder.phases[recorder.stack[recorder.depth - 1]] : NULL);
+        recorder.phases[phase].calls++;
+    }
+    recorder.stack[recorder.depth++] = phase;
+    if (phase != PHASE_LEX) trace_begin(phase_names[phase], "phase");
+}
+
+void time_phase_end() {
+    if (!recorder.depth) return;
+
+    enum Phase phase = recorder.stack[--recorder.depth];
+    if (recorder.recording) _charge(&recorder.phases[phase]);
+    if (phase != PHASE_LEX) trace_end();
+}
+
+void time_task_init(struct TimeTask *task) {
+    task->shared = NULL;
+    if (recorder.recording) task->shared = &recorder.shared[recorder.depth ? recorder.stack[recorder.depth - 1] : PHASE_SIZE];
+}
+
+void time_task_begin(struct TimeTask *task) {
+    if (recorder.recording) task->shared = NULL;
+    if (!task->shared) return;
+
+    task->cpu = _clock(CLOCK_THREAD_CPUTIME_ID);
+    task->allocs = allocs;
+    task->alloc_bytes = alloc_bytes;
+}
+
+void time_task_end(struct TimeTask *task) {
+    if (!task->shared) return;
+
+    uint64_t cpu_ns = (_clock(CLOCK_THREAD_CPUTIME_ID) - task->cpu) * 1e9;
+    __atomic_add_fetch(&task->shared->cpu_ns, cpu_ns, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&task->shared->allocs, allocs - task->allocs, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&task->shared->alloc_bytes, alloc_bytes - task->alloc_bytes, __ATOMIC_RELAXED);
+}
+
+static void _print_table(FILE *out, struct TimeReport *report) {
+    struct PhaseStats other = report->total;
+    fprintf(out, "%-18s %10s %12s %7s %12s %10s %14s\n", "phase", "calls", "wall ms", "wall%", "cpu ms", "allocs", "alloc bytes");
+    for (int i = 0; i < PHASE_SIZE; i++) {
+        struct PhaseStats *s = &report->phases[i];
+        fprintf(out,
+                "%-18s %10lu %12.3f %6.1f%% %12.3f %10lu %14lu\n",
+                phase_names[i],
+                s->calls,
+                s->wall * 1e3,
+                report->total.wall > 0 ? s->wall * 100 / report->total.wall : 0,
+                s->cpu * 1e3,
+                s->allocs,
+                s->alloc_bytes);
+        other.wall -= s->wall;
+        other.cpu -= s->cpu;
+        other.allocs -= s->allocs;
+        other.alloc_bytes -= s->alloc_bytes;
+    }
+    fprintf(out,
+            "%-18s %10s %12.3f %6.1f%% %12.3f %10lu %14lu\n",
+            "other",
+            "",
+            other.wall * 1e3,
+            report->total.wall > 0 ? other.wall * 100 / report->total.wall : 0,
+            other.cpu * 1e3,
+            other.allocs,
+            other.alloc_bytes);
+    fprintf(out,
+            "%-18s %10d %12.3f %6.1f%% %12.3f %10lu %14lu\n",
+            "total",
+            report->compiles,
+            report->total.wall * 1e3,
+            100.0,
+            report->total.cpu * 1e3,
+            report->total.allocs,
+            report->total.alloc_bytes);
+}
+
+static void _print_json_stats(FILE *out, struct PhaseStats *s) {
+    fprintf(out,
+            "\"calls\": %lu, \"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"allocs\": %lu, \"alloc_bytes\": %lu",
+            s->calls,
+            s->wall * 1e3,
+            s->cpu * 1e3,
+            s->allocs,
+            s->alloc_bytes);
+}
+
+static void _print_json(FILE *out, struct TimeReport *report) {
+    fprintf(out, "{\n  \"compiles\": %d,\n  \"total\": {", report->compiles);
+    _print_json_stats(out, &report->total);
+    fprintf(out, "},\n  \"phases\": [\n");
+    for (int i = 0; i < PHASE_SIZE; i++) {
+        fprintf(out, "    {\"name\": \"%s\", ", phase_names[i]);
+        _print_json_stats(out, &report->phases[i]);
+        fprintf(out, "}%s\n", i + 1 < PHASE_SIZE ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+void fprint_time_report(FILE *out, struct TimeReport *report, enum TimeReportFormat format) {
+    if (format == TIME_REPORT_TABLE) _print_table(out, report);
+    else if (format == TIME_REPORT_JSON) _print_json(out, report);
+}
@@ -0,0 +1,85 @@
+#ifndef TIME_REPORT_H
+#define TIME_REPORT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define TIME_REPORT_ENV "SQUIRREL_TIME_REPORT"
+#define TIME_REPORT_MAX_DEPTH 16
+
+enum Phase {
+    PHASE_LEX, // lex_next, called by parse
+    PHASE_PARSE,
+    PHASE_SCOPE,
+    PHASE_TYPE,
+    PHASE_STMT,
+    PHASE_IR_GEN,
+    PHASE_CFG,
+    PHASE_OPTIMIZE,
+    PHASE_EMIT, // output of the driver, asm, tac, cfg or ir file
+    PHASE_SIZE,
+};
+
+enum TimeReportFormat {
+    TIME_REPORT_NONE,
+    TIME_REPORT_TABLE,
+    TIME_REPORT_JSON,
+};
+
+struct PhaseStats {
+    uint64_t calls;
+    double   wall; // seconds
+    double   cpu;  // seconds of the thread
+    uint64_t allocs;
+    uint64_t alloc_bytes;
+};
+
+/*
+ * Time & allocations of each phase of compiles, phases are recorded on the thread compiling.
+ * A phase entered in another one is not counted in the outer one, so lex_next is not in parse,
+ * the phases & other add up to the total.
+ * Allocations are malloc, calloc, realloc & strdup called by squirrel, counted only if linked with
+ * -Wl,--wrap of them, libc_hashmap & libc itself are not counted.
+ */
+struct TimeReport {
+    struct PhaseStats phases[PHASE_SIZE];
+    struct PhaseStats total; // from time_report_start() to time_report_stop()
+    int               compiles;
+};
+
+/*
+ * A task run by a pool worker for a recording thread, the worker does not record,
+ * its cpu & allocations are added to the phase the task is submitted in when the task ends.
+ * Wall time is not added, the recording thread waits for the task in that phase.
+ */
+struct TimeTask {
+    struct SharedStats *shared; // of the phase, NULL if not recorded
+    // when begun
+    double              cpu;
+    uint64_t            allocs;
+    uint64_t            alloc_bytes;
+};
+
+// parse "table" or "json", false if unknown
+bool parse_time_report_format(char *name, enum TimeReportFormat *format);
+
+// record phases of the current thread from now on, until stopped
+void time_report_start();
+// stop recording of the current thread & add what is recorded to report
+void time_report_stop(struct TimeReport *report);
+void time_report_merge(struct TimeReport *report, struct TimeReport *other);
+
+// no-op if the current thread is not recording
+void time_phase_begin(enum Phase phase);
+void time_phase_end();
+
+// by the submitting thread, in the phase of the task
+void time_task_init(struct TimeTask *task);
+// by the worker around the task, no-op if the worker is recording, its own phases count the task then
+void time_task_begin(struct TimeTask *task);
+void time_task_end(struct TimeTask *task);
+
+void fprint_time_report(FILE *out, struct TimeReport *report, enum TimeReportFormat format);
+
+#endif
@@ -0,0 +1,154 @@
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+bool trace_enabled = false;
+
+// events of a thread not written yet, kept after the thread exits till the trace stops
+struct TraceBuffer {
+    char               *data;
+    size_t              size;
+    size_t              cap;
+    int                 tid;
+    struct TraceBuffer *next;
+};
+
+static pthread_mutex_t     trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE               *trace_file;
+static double              trace_start_time;
+static struct TraceBuffer *buffers; // of all threads traced
+static int                 buffer_size;
+static bool                at_exit_registered;
+
+static _Thread_local struct TraceBuffer *buffer;
+
+static double _now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// caller holds trace_lock
+static void _flush(struct TraceBuffer *b) {
+    if (trace_file && b->size) fwrite(b->data, 1, b->size, trace_file);
+    b->size = 0;
+}
+
+// caller holds trace_lock, tids are numbered in the order threads are traced, the main thread is 1 usually
+static void _write_thread_name(struct TraceBuffer *b) {
+    fprintf(trace_file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"thread %d\"}},\n", (int)getpid(), b->tid, b->tid);
+}
+
+static struct TraceBuffer *_buffer() {
+    if (buffer) return buffer;
+
+    buffer = calloc(1, sizeof(struct TraceBuffer));
+    if (!buffer) {
+        fprintf(stderr, "_buffer(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_lock(&trace_lock);
+    buffer->tid = ++buffer_size;
+    buffer->next = buffers;
+    buffers = buffer;
+    if (trace_file) _write_thread_name(buffer);
+    pthread_mutex_unlock(&trace_lock);
+    return buffer;
+}
+
+static void _reserve(struct TraceBuffer *b, size_t size) {
+    if (b->size + size <= b->cap) return;
+
+    size_t new_cap = b->cap ? b->cap * 2 : TRACE_FLUSH_SIZE * 2;
+    while (new_cap < b->size + size) new_cap *= 2;
+    char *data = realloc(b->data, new_cap);
+    if (!data) {
+        fprintf(stderr, "_reserve(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    b->data = data;
+    b->cap = new_cap;
+}
+
+// json string chars of s, names are idents & labels, only quotes, backslashes & controls need escapes
+static void _append_escaped(struct TraceBuffer *b, char *s) {
+    _reserve(b, strlen(s) * 6);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            b->data[b->size++] = '\\';
+            b->data[b->size++] = *s;
+        } else if ((unsigned char)*s < 0x20) b->size += sprintf(b->data + b->size, "\\u%04x", *s);
+        else b->data[b->size++] = *s;
+    }
+}
+
+static void _append_event(char phase, char *name, char *category) {
+    struct TraceBuffer *b = _buffer();
+    _reserve(b, 256);
+    b->size += sprintf(b->data + b->size, "{\"ph\": \"%c\", \"ts\": %.3f, \"pid\": %d, \"tid\": %d", phase, _now_us() - trace_start_time, (int)getpid(), b->tid);
+    if (name) {
+        b->size += sprintf(b->data + b->size, ", \"name\": \"");
+        _append_escaped(b, name);
+        _reserve(b, 64);
+        b->size += sprintf(b->data + b->size, "\", \"cat\": \"");
+        _append_escaped(b, category);
+        _reserve(b, 64);
+        b->data[b->size++] = '"';
+    }
+    b->size += sprintf(b->data + b->size, "},\n");
+
+    if (b->size < TRACE_FLUSH_SIZE) return;
+    pthread_mutex_lock(&trace_lock);
+    _flush(b);
+    pthread_mutex_unlock(&trace_lock);
+}
+
+bool trace_start(char *path) {
+    pthread_mutex_lock(&trace_lock);
+    if (trace_file) {
+        pthread_mutex_unlock(&trace_lock);
+        return false;
+    }
+    trace_file = fopen(path, "w");
+    if (!trace_file) {
+        pthread_mutex_unlock(&trace_lock);
+        return false;
+    }
+    fprintf(trace_file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    // threads traced before keep their buffers & tids
+    for (struct TraceBuffer *b = buffers; b; b = b->next) _write_thread_name(b);
+    trace_start_time = _now_us();
+    trace_enabled = true;
+    if (!at_exit_registered) atexit(trace_stop);
+    at_exit_registered = true;
+    pthread_mutex_unlock(&trace_lock);
+    return true;
+}
+
+void trace_stop() {
+    pthread_mutex_lock(&trace_lock);
+    if (!trace_file) {
+        pthread_mutex_unlock(&trace_lock);
+        return;
+    }
+    trace_enabled = false;
+    for (struct TraceBuffer *b = buffers; b; b = b->next) _flush(b);
+    // the last event has no comma after it
+    fprintf(trace_file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"squirrel\"}}\n]}\n", (int)getpid());
+    fclose(trace_file);
+    trace_file = NULL;
+    pthread_mutex_unlock(&trace_lock);
+}
+
+void trace_begin(char *name, char *category) {
+    if (trace_enabled) _append_event('B', name, category);
+}
+
+void trace_end() {
+    if (trace_enabled) _append_event('E', NULL, NULL);
+}
@@ -0,0 +1,27 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+
+#define TRACE_ENV "SQUIRREL_TRACE"
+#define TRACE_FLUSH_SIZE (64 * 1024)
+
+/*
+ * Chrome trace_event json of spans, loaded by chrome://tracing or Perfetto.
+ * Spans are begin & end events of the thread calling, so they nest per thread & need no stack here.
+ * Events are buffered per thread & appended to the file in chunks, the file is complete once trace_stop() is called,
+ * which is also done at exit, so a trace of a compile or run that fails is still written.
+ */
+
+// read by callers before building span names, false unless tracing
+extern bool trace_enabled;
+
+// false if the file can not be opened, or a trace is written already
+bool trace_start(char *path);
+void trace_stop();
+
+// category groups spans, like "phase" or "pass", both strings are copied
+void trace_begin(char *name, char *category);
+void trace_end();
+
+#endif
@@ -0,0 +1,320 @@
+#include "driver.h"
+#include "ir_cache.h"
+#include "ir_file.h"
+#include "ir_gen.h"
+#include "ir_optimize.h"
+#include "ir_pass.h"
+#include "ir_peephole.h"
+#include "lex.h"
+#include "semantic.h"
+#include "syntax.h"
+#include "thread_pool.h"
+#include "time_report.h"
+#include "trace.h"
+#include "x86_64.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static char *emit_suffixes[] = {
+    [EMIT_AST] = "ast",
+    [EMIT_TAC] = "tac",
+    [EMIT_CFG] = "cfg",
+    [EMIT_ASM] = "s",
+    [EMIT_IR] = "sqir",
+};
+
+static char *emit_names[] = {
+    [EMIT_AST] = "ast",
+    [EMIT_TAC] = "tac",
+    [EMIT_CFG] = "cfg",
+    [EMIT_ASM] = "asm",
+    [EMIT_IR] = "ir",
+};
+
+bool parse_emit_kind(char *name, enum EmitKind *emit) {
+    for (int i = 0; i < sizeof(emit_names) / sizeof(emit_names[0]); i++) {
+        if (strcmp(name, emit_names[i])) continue;
+
+        *emit = i;
+        return true;
+    }
+    return false;
+}
+
+struct CompileTask {
+    struct CompileUnit   *unit;
+    struct DriverOptions *options;
+};
+
+static double _wall_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+bool parse_driver_args(int argc, char **argv, struct DriverOptions *options, char **files, int *size) {
+    *options = (struct DriverOptions){.opt_level = 2, .emit = EMIT_ASM, .cache_dir = getenv(IR_CACHE_ENV), .trace_file = getenv(TRACE_ENV)};
+    *size = 0;
+    char *time_report = getenv(TIME_REPORT_ENV);
+    if (time_report && !parse_time_report_format(time_report, &options->time_report)) return false;
+    // passes disabled by an earlier request to the server are run again
+    enable_all_opt_passes();
+    for (int i = 0; i < argc; i++) {
+        char *arg = argv[i];
+        if (!strcmp(arg, "-O0") || !strcmp(arg, "-O1") || !strcmp(arg, "-O2")) options->opt_level = arg[2] - '0';
+        else if (!strncmp(arg, "--passes=", 9)) {
+            // unknown passes are reported here, not by each file
+            struct PassPipeline *pipeline = create_pass_pipeline(arg + 9);
+            if (!pipeline) return false;
+            free_pass_pipeline(pipeline);
+            options->passes = arg + 9;
+        } else if (!strncmp(arg, "--disable-pass=", 15)) {
+            if (!set_opt_pass_enabled(arg + 15, false)) {
+                fprintf(stderr, "unknown pass: %s\n", arg + 15);
+                return false;
+            }
+        } else if (!strcmp(arg, "--list-passes")) options->list_passes = true;
+        else if (!strcmp(arg, "--pass-stats")) options->pass_stats = true;
+        else if (!strncmp(arg, "--emit=", 7)) {
+            if (!parse_emit_kind(arg + 7, &options->emit)) return false;
+        } else if (!strcmp(arg, "-j") && i + 1 < argc) options->jobs = atoi(argv[++i]);
+        else if (!strcmp(arg, "-o") && i + 1 < argc) options->out_dir = argv[++i];
+        else if (!strncmp(arg, "--cache=", 8)) options->cache_dir = *(arg + 8) ? arg + 8 : NULL;
+        else if (!strcmp(arg, "--time-report")) options->time_report = TIME_REPORT_TABLE;
+        else if (!strncmp(arg, "--time-report=", 14)) {
+            if (!parse_time_report_format(arg + 14, &options->time_report)) return false;
+        } else if (!strncmp(arg, "--trace=", 8)) options->trace_file = *(arg + 8) ? arg + 8 : NULL;
+        else if (!strcmp(arg, "-v")) options->verbose = true;
+        else if (*arg != '-') files[(*size)++] = arg;
+        else return false;
+    }
+    return true;
+}
+
+// <out_dir>/<file name without .sl or .sqir>.<suffix>, out_dir defaults to the dir of input
+void init_compile_unit(struct CompileUnit *unit, char *input, struct DriverOptions *options) {
+    memset(unit, 0, sizeof(struct CompileUnit));
+    unit->input = input;
+    char *name = strrchr(unit->input, '/');
+    name = name ? name + 1 : unit->input;
+    int name_len = strlen(name);
+    if (name_len > 3 && !strcmp(name + name_len - 3, ".sl")) name_len -= 3;
+    else if (name_len > 5 && !strcmp(name + name_len - 5, IR_FILE_SUFFIX)) name_len -= 5;
+
+    char *suffix = emit_suffixes[options->emit];
+    if (options->out_dir) snprintf(unit->output, sizeof(unit->output), "%s/%.*s.%s", options->out_dir, name_len, name, suffix);
+    else snprintf(unit->output, sizeof(unit->output), "%.*s%.*s.%s", (int)(name - unit->input), unit->input, name_len, name, suffix);
+}
+
+struct PassPipeline *create_driver_pipeline(struct DriverOptions *options) {
+    struct PassPipeline *pipeline = options->passes ? create_pass_pipeline(options->passes) : create_opt_level_pipeline(options->opt_level);
+    if (pipeline) pipeline->count_tac = options->pass_stats;
+    return pipeline;
+}
+
+static bool _runs_pass(struct PassPipeline *pipeline, char *name) {
+    for (int i = 0; pipeline && i < pipeline->size; i++)
+        if (pipeline->passes[i].pass->enabled && !strcmp(pipeline->passes[i].pass->name, name)) return true;
+    return false;
+}
+
+static void _optimize(struct CFG *cfg, struct PassPipeline *pipeline, struct ThreadPool *pool) {
+    if (!pipeline) return;
+
+    time_phase_begin(PHASE_OPTIMIZE);
+    run_pass_pipeline(pipeline, cfg, pool);
+    time_phase_end();
+}
+
+// checked ast of the file, NULL if it can not be opened
+static struct AstNode *_parse_file(char *filepath) {
+    if (!lex_init(filepath, false)) {
+        fprintf(stderr, "can not open file: %s\n", filepath);
+        return NULL;
+    }
+    reset_ast_node_id();
+    reset_tac_var_id();
+    time_phase_begin(PHASE_PARSE);
+    struct AstNode *root = parse();
+    time_phase_end();
+    time_phase_begin(PHASE_SCOPE);
+    manage_scope(root, NULL, false);
+    time_phase_end();
+    time_phase_begin(PHASE_TYPE);
+    check_node_type(root, NULL, NULL, false);
+    time_phase_end();
+    time_phase_begin(PHASE_STMT);
+    check_stmt(root, false, false);
+    time_phase_end();
+    return root;
+}
+
+// cfg of an ir file written before, it is optimized already
+static struct CFG *_load_ir_file(char *filepath) {
+    struct IrFile *file = open_ir_file(filepath);
+    if (!file) {
+        fprintf(stderr, "can not open ir file: %s\n", filepath);
+        return NULL;
+    }
+    struct TAC *tac = ir_file_to_tac(file);
+    close_ir_file(file);
+    return create_cfg(tac);
+}
+
+struct CFG *compile_to_cfg(char *filepath, struct PassPipeline *pipeline, char *cache_dir, struct ThreadPool *pool, bool *cache_hit) {
+    if (cache_hit) *cache_hit = false;
+    if (is_ir_file(filepath)) return _load_ir_file(filepath);
+
+    char passes[1024];
+    char key[IR_CACHE_KEY_LEN + 1];
+    // -O0 is keyed by no passes, the same as an empty --passes=, both leave the tac as it is
+    sprint_pass_pipeline(passes, sizeof(passes), pipeline);
+    bool keyed = cache_dir && ir_cache_key(filepath, passes, key);
+    // the optimized tac is complete, the cfg is only rebuilt on it
+    struct TAC *cached = keyed ? ir_cache_load(cache_dir, key) : NULL;
+    if (cache_hit) *cache_hit = cached != NULL;
+    if (cached) return create_cfg(cached);
+
+    struct AstNode *root = _parse_file(filepath);
+    if (!root) return NULL;
+
+    struct TAC *tac = CREATE_STRUCT_P(TAC);
+    tac->op = TAC_HEAD;
+    struct TAC *root_tac = tac;
+    time_phase_begin(PHASE_IR_GEN);
+    gen_tac_from_ast(root, &tac, NULL);
+    time_phase_end();
+
+    time_phase_begin(PHASE_CFG);
+    struct CFG *cfg = create_cfg(root_tac);
+    time_phase_end();
+    _optimize(cfg, pipeline, pool);
+    if (keyed && !ir_cache_store(cache_dir, key, cfg)) fprintf(stderr, "can not write cache in: %s\n", cache_dir);
+    return cfg;
+}
+
+static bool _compile_unit(struct CompileUnit *unit, struct DriverOptions *options) {
+    if (options->emit == EMIT_AST) {
+        if (is_ir_file(unit->input)) {
+            fprintf(stderr, "no ast in ir file: %s\n", unit->input);
+            return false;
+        }
+        struct AstNode *root = _parse_file(unit->input);
+        FILE           *out = root ? fopen(unit->output, "w") : NULL;
+        if (!out) {
+            if (root) fprintf(stderr, "can not open file: %s\n", unit->output);
+            return false;
+        }
+        time_phase_begin(PHASE_EMIT);
+        fprint_node(out, root, 0, NULL);
+        fclose(out);
+        time_phase_end();
+        return true;
+    }
+
+    struct PassPipeline *pipeline = unit->pipeline ? unit->pipeline : create_driver_pipeline(options);
+    // workers of the driver left over by a few files optimize the funcs of each one
+    struct ThreadPool   *pool = unit->func_jobs > 1 && pipeline ? create_thread_pool(unit->func_jobs) : NULL;
+    struct CFG          *cfg = compile_to_cfg(unit->input, pipeline, options->cache_dir, pool, &unit->cache_hit);
+    bool                 optimized = pipeline != NULL;
+    if (pool) free_thread_pool(pool);
+    if (pipeline != unit->pipeline) free_pass_pipeline(pipeline);
+    if (!cfg) return false;
+
+    FILE *out = fopen(unit->output, "wb");
+    if (!out) {
+        fprintf(stderr, "can not open file: %s\n", unit->output);
+        free_cfg(cfg);
+        return false;
+    }
+    time_phase_begin(PHASE_EMIT);
+    switch (options->emit) {
+        case EMIT_TAC: fprint_tac_list(out, cfg->tac, NULL); break;
+        case EMIT_CFG: fprint_cfg(out, cfg, false, true); break;
+        case EMIT_IR: write_ir_file(out, cfg); break;
+        default: {
+            // registers are allocated only if optimized, -O0 keeps every var in memory
+            struct Interp   *interp = create_interp(cfg->tac);
+            struct RegAlloc *ra = emit_x86_64(interp, optimized ? cfg : NULL, out);
+            free_reg_alloc(ra);
+            free_interp(interp);
+        }
+    }
+    fclose(out);
+    time_phase_end();
+    free_cfg(cfg);
+    return true;
+}
+
+bool compile_unit(struct CompileUnit *unit, struct DriverOptions *options) {
+    if (!options->time_report) return _compile_unit(unit, options);
+
+    time_report_start();
+    bool ok = _compile_unit(unit, options);
+    time_report_stop(&unit->report);
+    return ok;
+}
+
+static void _compile_task(void *arg) {
+    struct CompileTask *task = arg;
+    double              start = _wall_time();
+    trace_begin(task->unit->input, "file");
+    task->unit->ok = compile_unit(task->unit, task->options);
+    trace_end();
+    task->unit->time = _wall_time() - start;
+}
+
+int compile_files(char **files, int size, struct DriverOptions *options) {
+    struct CompileUnit *units = calloc(size, sizeof(struct CompileUnit));
+    struct CompileTask *tasks = calloc(size, sizeof(struct CompileTask));
+    if (!units || !tasks) {
+        fprintf(stderr, "compile_files(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options->trace_file && !trace_start(options->trace_file)) fprintf(stderr, "can not write trace: %s\n", options->trace_file);
+
+    int jobs = options->jobs > 0 ? options->jobs : thread_pool_cpu_count();
+    int func_jobs = jobs / size;
+    if (jobs > size) jobs = size;
+    struct ThreadPool   *pool = create_thread_pool(jobs);
+    // stats of the passes are merged from all files
+    struct PassPipeline *pipeline = create_driver_pipeline(options);
+    double               start = _wall_time();
+    for (int i = 0; i < size; i++) {
+        init_compile_unit(&units[i], files[i], options);
+        units[i].func_jobs = func_jobs;
+        units[i].pipeline = pipeline;
+        tasks[i] = (struct CompileTask){&units[i], options};
+        thread_pool_submit(pool, _compile_task, &tasks[i]);
+    }
+    thread_pool_wait(pool);
+    double time = _wall_time() - start;
+    free_thread_pool(pool);
+    if (options->trace_file) trace_stop();
+
+    int failed = 0;
+    for (int i = 0; i < size; i++) {
+        failed += !units[i].ok;
+        if (options->verbose) printf("%-4s %10.3fms  %s -> %s\n", units[i].ok ? units[i].cache_hit ? "hit" : "ok" : "fail", units[i].time * 1e3, units[i].input, units[i].output);
+    }
+    if (options->verbose) printf("%d files, %d failed, %.3fms on %d workers\n", size, failed, time * 1e3, jobs);
+    if (options->time_report) {
+        struct TimeReport report = {0};
+        for (int i = 0; i < size; i++) time_report_merge(&report, &units[i].report);
+        fprint_time_report(stderr, &report, options->time_report);
+    }
+    if (options->pass_stats) {
+        print_pass_stats(pipeline);
+        // fire counts of the patterns are kept by the peephole pass itself
+        if (_runs_pass(pipeline, "peephole")) print_peephole_stats();
+    }
+    free_pass_pipeline(pipeline);
+
+    free(tasks);
+    free(units);
+    return failed;
+}
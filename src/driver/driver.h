@@ -0,0 +1,75 @@
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include "ir_cfg.h"
+#include "ir_pass.h"
+#include "thread_pool.h"
+#include "time_report.h"
+
+#include <stdbool.h>
+
+enum EmitKind {
+    EMIT_AST,
+    EMIT_TAC,
+    EMIT_CFG,
+    EMIT_ASM,
+    EMIT_IR, // binary ir file of the optimized cfg, could be compiled again or run
+};
+
+struct DriverOptions {
+    int                   opt_level;  // 0: no optimization, 1: simplifycfg,constprop,dce, 2: the default pipeline
+    char                 *passes;     // pass list run in place of the pipeline of opt_level if not NULL, like "constprop,dce"
+    bool                  pass_stats;  // stats of each pass over all files are printed at the end
+    bool                  list_passes; // registered passes are printed instead of compiling
+    enum EmitKind         emit;
+    char                 *out_dir;     // outputs are written next to the inputs if NULL
+    int                   jobs;        // files compiled at once, <= 0 means one per online cpu
+    bool                  verbose;     // print time & output of each file
+    char                 *cache_dir;   // optimized tac is cached in it if not NULL, $SQUIRREL_CACHE_DIR by default
+    enum TimeReportFormat time_report; // phases of all files are printed to stderr at the end, $SQUIRREL_TIME_REPORT by default
+    char                 *trace_file;  // chrome trace of the compile is written to it if not NULL, $SQUIRREL_TRACE by default
+};
+
+// one input file & what came out of it
+struct CompileUnit {
+    char                *input;
+    char                 output[1024];
+    bool                 ok;
+    bool                 cache_hit; // tac is read from the cache, the front end & optimizer are skipped
+    double               time;      // wall time in seconds
+    int                  func_jobs; // funcs of the file optimized at once, <= 1 means serially
+    struct PassPipeline *pipeline;  // shared by units compiled together & collects their stats, created per unit if NULL
+    struct TimeReport    report;    // phases of the unit, recorded only if options->time_report
+};
+
+/*
+ * Optimized cfg of the source file, NULL if it can not be opened, an ir file is loaded as it is.
+ * Funcs are optimized by pipeline, not at all if it is NULL, concurrently on pool, or serially if pool is NULL.
+ * With cache_dir, the optimized tac is read from the cache if the source was compiled before with the same passes,
+ * or written to it after optimized, cache_hit tells which if not NULL.
+ */
+struct CFG *compile_to_cfg(char *filepath, struct PassPipeline *pipeline, char *cache_dir, struct ThreadPool *pool, bool *cache_hit);
+/*
+ * parse [-O0|-O1|-O2] [--passes=list] [--disable-pass=name]... [--list-passes] [--pass-stats] [--emit=...] [-j N] [-o dir] [--cache=dir] [--time-report[=table|json]] [--trace=file] [-v] <file.sl>...
+ * into options & files, false if illegal or a pass is unknown, passes disabled are skipped by every pipeline till parsed again
+ */
+bool                 parse_driver_args(int argc, char **argv, struct DriverOptions *options, char **files, int *size);
+// pipeline run on files compiled with options, NULL if they are not optimized
+struct PassPipeline *create_driver_pipeline(struct DriverOptions *options);
+// input & output path of the unit
+void                 init_compile_unit(struct CompileUnit *unit, char *input, struct DriverOptions *options);
+// compile one file & write its output, could be called concurrently on different threads
+bool                 compile_unit(struct CompileUnit *unit, struct DriverOptions *options);
+
+/*
+ * Compile each file on its own worker of a thread pool, through the front end, tac generation & the optimizer,
+ * output of the last stage is written to <out_dir>/<name>.<ast|tac|cfg|s>.
+ * Files are independent, the front end keeps its state per thread.
+ * With more jobs than files, each file gets jobs / files workers optimizing its functions concurrently.
+ * Returns the number of files failed.
+ */
+int  compile_files(char **files, int size, struct DriverOptions *options);
+// parse "ast", "tac", "cfg" or "asm", false if unknown
+bool parse_emit_kind(char *name, enum EmitKind *emit);
+
+#endif
@@ -0,0 +1,65 @@
+#include "ir_cache.h"
+#include "global.h"
+#include "ir_file.h"
+#include "str_hash.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool ir_cache_key(char *source_path, char *passes, char key[IR_CACHE_KEY_LEN + 1]) {
+    FILE *f = fopen(source_path, "rb");
+    if (!f) return false;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = malloc(size + 1);
+    if (!buf) {
+        fprintf(stderr, "ir_cache_key(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    bool ok = fread(buf, 1, size, f) == size;
+    fclose(f);
+
+    char     compiler[64];
+    int      compiler_len = snprintf(compiler, sizeof(compiler), "squirrel %s ir %d", SQUIRREL_VERSION, IR_FILE_VERSION);
+    uint64_t options = str_hash_mix(str_hash64(compiler, compiler_len) ^ STR_HASH_P0, str_hash64(passes, strlen(passes)));
+    if (ok) sprintf(key, "%016llx%016llx", (unsigned long long)str_hash64(buf, size), (unsigned long long)str_hash_mix(options, size ^ STR_HASH_P1));
+    free(buf);
+    return ok;
+}
+
+static void _entry_path(char *path, size_t len, char *dir, char *key) {
+    snprintf(path, len, "%s/%s.sqir", dir, key);
+}
+
+struct TAC *ir_cache_load(char *dir, char *key) {
+    char path[1024];
+    _entry_path(path, sizeof(path), dir, key);
+    struct IrFile *file = open_ir_file(path);
+    if (!file) return NULL;
+
+    struct TAC *head = ir_file_to_tac(file);
+    close_ir_file(file);
+    return head;
+}
+
+bool ir_cache_store(char *dir, char *key, struct CFG *cfg) {
+    mkdir(dir, 0755);
+
+    // unique per process & thread, renamed over the entry once it is complete
+    char path[1024], tmp_path[1100];
+    _entry_path(path, sizeof(path), dir, key);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.%lx.tmp", path, (int)getpid(), (unsigned long)pthread_self());
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) return false;
+
+    bool ok = write_ir_file(f, cfg);
+    ok = !fclose(f) && ok && !rename(tmp_path, path);
+    if (!ok) unlink(tmp_path);
+    return ok;
+}
@@ -0,0 +1,25 @@
+#ifndef IR_CACHE_H
+#define IR_CACHE_H
+
+#include "ir_cfg.h"
+
+#include <stdbool.h>
+
+#define IR_CACHE_KEY_LEN 32
+#define IR_CACHE_ENV "SQUIRREL_CACHE_DIR"
+
+/*
+ * Content addressed cache of optimized tac, an ir file <dir>/<key>.sqir per source.
+ * The key hashes the source bytes & size, the compiler version, the ir file version & the passes run,
+ * so a changed source or compiler never hits an old entry & entries are never invalidated.
+ * Entries are written to a temp file & renamed, concurrent compilers never see a partial one.
+ */
+
+// key of the source file optimized by passes, like "constprop,dce", false if it can not be read
+bool        ir_cache_key(char *source_path, char *passes, char key[IR_CACHE_KEY_LEN + 1]);
+// tac list cached for key, NULL on a miss
+struct TAC *ir_cache_load(char *dir, char *key);
+// dir is created if it does not exist, returns false if the entry can not be written
+bool        ir_cache_store(char *dir, char *key, struct CFG *cfg);
+
+#endif
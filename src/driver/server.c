@@ -0,0 +1,318 @@
+#include "server.h"
+#include "driver.h"
+#include "global.h"
+#include "str_hash.h"
+#include "swiss_map.h"
+#include "thread_pool.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SERVER_MAX_LINE_LEN 4096
+
+// output of a file compiled before, keyed by the output path, which tells the emit kind & the out dir
+struct ServerEntry {
+    uint64_t hash;   // of the source
+    uint64_t passes; // hash of the names of the passes run
+    char    *result;
+    size_t   size;
+};
+
+SWISS_STR_MAP(ServerCache, server_cache, struct ServerEntry *)
+
+static double _wall_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// whole content of the file, NULL if it can not be read
+static char *_read_file(char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = malloc(len + 1);
+    if (!buf) {
+        fprintf(stderr, "_read_file(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    *size = fread(buf, 1, len, f);
+    buf[*size] = '\0';
+    fclose(f);
+    return buf;
+}
+
+static bool _write_file(char *path, char *buf, size_t size) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+
+    bool ok = fwrite(buf, 1, size, f) == size;
+    return !fclose(f) && ok;
+}
+
+// cached output is the same as the file on disk, the file is left untouched to keep its mtime
+static bool _same_output(char *path, struct ServerEntry *entry) {
+    struct stat st;
+    if (stat(path, &st) || st.st_size != entry->size) return false;
+
+    size_t size;
+    char  *buf = _read_file(path, &size);
+    bool   same = buf && size == entry->size && !memcmp(buf, entry->result, size);
+    free(buf);
+    return same;
+}
+
+// compile the unit in a child & write its output, returns the pid of the child, -1 if it can not fork
+static pid_t _fork_compile(struct CompileUnit *unit, struct DriverOptions *options, int client) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid) return pid;
+
+    dup2(client, STDOUT_FILENO);
+    dup2(client, STDERR_FILENO);
+    bool ok = compile_unit(unit, options);
+    fflush(stdout);
+    _exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/*
+ * Compile units of indexes, each in its own child, at most jobs children at once.
+ * The front end exits on an error of the source, so a child taken down by its file never fails the others.
+ * Units compiled are marked ok, a unit which can not be forked or whose child is killed is reported to the client.
+ */
+static void _compile_in_children(struct CompileUnit *units, int *indexes, int size, struct DriverOptions *options, int client) {
+    int jobs = options->jobs > 0 ? options->jobs : thread_pool_cpu_count();
+    int func_jobs = jobs / size;
+    if (jobs > size) jobs = size;
+    pid_t *pids = calloc(size, sizeof(pid_t));
+    if (!pids) {
+        fprintf(stderr, "_compile_in_children(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int next = 0, running = 0;
+    while (next < size || running) {
+        if (next < size && running < jobs) {
+            struct CompileUnit *unit = &units[indexes[next]];
+            // jobs left over by a few files optimize the funcs of each one, as compile_files does
+            unit->func_jobs = func_jobs;
+            pids[next] = _fork_compile(unit, options, client);
+            if (pids[next] < 0) dprintf(client, "can not fork to compile: %s\n", unit->input);
+            else running++;
+            next++;
+            continue;
+        }
+
+        int   status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) break;
+        for (int i = 0; i < next; i++) {
+            if (pids[i] != pid) continue;
+
+            struct CompileUnit *unit = &units[indexes[i]];
+            unit->ok = WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+            if (WIFSIGNALED(status)) dprintf(client, "compiler of %s killed by signal %d\n", unit->input, WTERMSIG(status));
+            running--;
+            break;
+        }
+    }
+    free(pids);
+}
+
+// relative paths of the client are resolved against its cwd
+static char *_absolute_path(char *cwd, char *path) {
+    if (*path == '/') return strdup(path);
+
+    char *abs = malloc(strlen(cwd) + strlen(path) + 2);
+    sprintf(abs, "%s/%s", cwd, path);
+    return abs;
+}
+
+// compile files of the request & reply, returns the number of files failed, -1 if the args are illegal
+static int _serve_request(struct ServerCache *cache, char *cwd, int argc, char **argv, int client) {
+    struct DriverOptions options;
+    char               **files = calloc(argc, sizeof(char *));
+    int                  size;
+    if (!parse_driver_args(argc, argv, &options, files, &size) || !size) {
+        dprintf(client, "illegal arguments\ndone -1\n");
+        free(files);
+        return -1;
+    }
+
+    // -O levels & --passes running the same passes share entries
+    char                 names[1024];
+    struct PassPipeline *pipeline = create_driver_pipeline(&options);
+    uint64_t             passes = str_hash64(names, sprint_pass_pipeline(names, sizeof(names), pipeline));
+    free_pass_pipeline(pipeline);
+
+    double              start = _wall_time();
+    struct CompileUnit *units = calloc(size, sizeof(struct CompileUnit));
+    uint64_t           *hashes = calloc(size, sizeof(uint64_t));
+    bool               *cached = calloc(size, sizeof(bool));
+    int                *misses = calloc(size, sizeof(int));
+    int                 miss_size = 0;
+    for (int i = 0; i < size; i++) {
+        init_compile_unit(&units[i], files[i], &options);
+
+        size_t len;
+        char  *source = _read_file(files[i], &len);
+        if (!source) {
+            misses[miss_size++] = i;
+            continue;
+        }
+        hashes[i] = str_hash64(source, len);
+        free(source);
+
+        struct ServerEntry **entry = server_cache_get(cache, units[i].output);
+        cached[i] = entry && (*entry)->hash == hashes[i] && (*entry)->passes == passes &&
+                    (_same_output(units[i].output, *entry) || _write_file(units[i].output, (*entry)->result, (*entry)->size));
+        if (cached[i]) units[i].ok = true;
+        else misses[miss_size++] = i;
+    }
+    if (miss_size) _compile_in_children(units, misses, miss_size, &options, client);
+
+    int failed = 0;
+    for (int i = 0; i < size; i++) {
+        if (!cached[i]) {
+            uint64_t             hash = server_cache_hash(units[i].output);
+            struct ServerEntry **entry = server_cache_get_hashed(cache, units[i].output, hash);
+            if (!entry) {
+                entry = server_cache_put_hashed(cache, strdup(units[i].output), hash);
+                *entry = CREATE_STRUCT_P(ServerEntry);
+            }
+            free((*entry)->result);
+            (*entry)->result = units[i].ok ? _read_file(units[i].output, &(*entry)->size) : NULL;
+            // a failed file is compiled again next time, even if unchanged
+            (*entry)->hash = (*entry)->result ? hashes[i] : 0;
+            (*entry)->passes = passes;
+            units[i].ok = (*entry)->result != NULL;
+        }
+        failed += !units[i].ok;
+        dprintf(client, "%-6s %s -> %s\n", units[i].ok ? cached[i] ? "cached" : "ok" : "fail", units[i].input, units[i].output);
+    }
+    dprintf(client, "done %d\n", failed);
+    printf("server: %s, %d files, %d compiled, %d failed, %.3fms\n", cwd, size, miss_size, failed, (_wall_time() - start) * 1e3);
+    fflush(stdout);
+
+    free(misses);
+    free(cached);
+    free(hashes);
+    free(units);
+    free(files);
+    return failed;
+}
+
+// read the request of a client & serve it, returns false if the client asked the server to stop
+static bool _serve_client(struct ServerCache *cache, int client) {
+    FILE *in = fdopen(dup(client), "r");
+    if (!in) return true;
+
+    char  line[SERVER_MAX_LINE_LEN];
+    char *cwd = NULL;
+    char *args[SERVER_MAX_ARGS];
+    int   argc = 0;
+    while (argc < SERVER_MAX_ARGS && fgets(line, sizeof(line), in)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (!*line) break;
+        if (!cwd) {
+            cwd = strdup(line);
+            continue;
+        }
+
+        // files & the arg of -o are paths, the arg of -j is not
+        char *prev = argc ? args[argc - 1] : "";
+        bool  is_path = !strcmp(prev, "-o") || (*line != '-' && strcmp(prev, "-j"));
+        args[argc] = is_path ? _absolute_path(cwd, line) : strdup(line);
+        argc++;
+    }
+    fclose(in);
+
+    bool stop = argc == 1 && !strcmp(args[0], "--stop");
+    if (stop) dprintf(client, "stopped\ndone 0\n");
+    else if (cwd) _serve_request(cache, cwd, argc, args, client);
+
+    for (int i = 0; i < argc; i++) free(args[i]);
+    free(cwd);
+    return !stop;
+}
+
+int run_compile_server(char *socket_path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "server: socket path too long: %s\n", socket_path);
+        return 1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(fd, 16)) {
+        perror("server: can not listen on the socket");
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+    // a client gone before its reply should not kill the server
+    signal(SIGPIPE, SIG_IGN);
+    printf("server: listening on %s\n", socket_path);
+    fflush(stdout);
+
+    struct ServerCache cache;
+    server_cache_init(&cache);
+    for (bool running = true; running;) {
+        int client = accept(fd, NULL, NULL);
+        if (client < 0) continue;
+
+        running = _serve_client(&cache, client);
+        close(client);
+    }
+    close(fd);
+    unlink(socket_path);
+
+    size_t pos = 0;
+    for (struct ServerCacheSlot *slot; (slot = server_cache_next(&cache, &pos));) {
+        free((char *)slot->key);
+        free(slot->val->result);
+        free(slot->val);
+    }
+    server_cache_free(&cache);
+    return 0;
+}
+
+int send_compile_request(char *socket_path, int argc, char **argv) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+        fprintf(stderr, "can not connect to the server: %s\n", socket_path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    char cwd[SERVER_MAX_LINE_LEN];
+    if (!getcwd(cwd, sizeof(cwd))) strcpy(cwd, "/");
+    dprintf(fd, "%s\n", cwd);
+    for (int i = 0; i < argc; i++) dprintf(fd, "%s\n", argv[i]);
+    dprintf(fd, "\n");
+
+    FILE *in = fdopen(fd, "r");
+    char  line[SERVER_MAX_LINE_LEN];
+    int   failed = -1;
+    while (fgets(line, sizeof(line), in)) {
+        if (!strncmp(line, "done ", 5)) failed = atoi(line + 5);
+        else fputs(line, stdout);
+    }
+    fclose(in);
+    return failed;
+}
@@ -0,0 +1,21 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#define SERVER_MAX_ARGS 4096
+
+/*
+ * Compile server on a unix socket, for editors & CI compiling the same files again & again.
+ * A request is the cwd of the client then the driver args, one per line, ended by an empty line.
+ * The reply is a line per file, "ok", "cached" or "fail" with its input & output, then "done <failed>".
+ * Outputs are kept in memory by their path, with the hash of the source & the options compiled with,
+ * files unchanged since their last compile are not compiled again, their outputs are rewritten from memory if needed.
+ * The front end exits on errors, so each changed file is compiled in a child forked for it,
+ * an error of one file never fails the others, messages of the compilation go to the client.
+ */
+
+// squirrel --server <socket>, returns only if the socket can not be listened or a client sent --stop
+int run_compile_server(char *socket_path);
+// squirrel --connect <socket> <args>..., prints the reply, returns the number of files failed, -1 if it fails to connect
+int send_compile_request(char *socket_path, int argc, char **argv);
+
+#endif
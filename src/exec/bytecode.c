@@ -0,0 +1,544 @@
+#include "bytecode.h"
+#include "global.h"
+#include "ir_gen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+char *bc_op_code_symbols[] = {"HALT",       "MOV",        "MOVT",       "GETO",       "SETO",       "GETW",       "SETW",       "LOADK",
+                              "EQI",        "NEI",        "LTI",        "LEI",        "GTI",        "GEI",        "ADDI",       "SUBI",
+                              "MULI",       "QUOI",       "REMI",       "ANDI",       "ORI",        "XORI",       "SHLI",       "SHRI",
+                              "NOTI",       "ADDF",       "SUBF",       "MULF",       "QUOF",       "EQIK",       "NEIK",       "LTIK",
+                              "LEIK",       "GTIK",       "GEIK",       "ADDIK",      "SUBIK",      "MULIK",      "QUOIK",      "REMIK",
+                              "ANDIK",      "ORIK",       "XORIK",      "SHLIK",      "SHRIK",      "ARITH",      "JMP",        "JEI",
+                              "JNEI",       "JLTI",       "JLEI",       "JGTI",       "JGEI",       "JEIK",       "JNEIK",      "JLTIK",
+                              "JLEIK",      "JGTIK",      "JGEIK",      "JCC",        "PARAM",      "CALL",       "RET",        "EXTRA",
+                              "ADDI_JMP",   "INC_LOOP",   "PARAM2",     "PARAM_CALL", "MOVT2"};
+
+// right after params, for operands of an instr not in a register below BC_NO_REG, x, y & res
+#define SCRATCH_SIZE 3
+
+struct Lowering {
+    struct Bytecode *bc;
+    struct Interp   *interp;
+    int             *owner;   // func of each instr
+    int             *word_pc; // first word of each instr, word_pc[instr_size] is the end
+    int             *patches; // words of jumps, with the instr jumped to
+    int              patch_size;
+    int              patch_cap;
+};
+
+static void _emit(struct Bytecode *bc, uint32_t word) {
+    if (bc->size == bc->cap) {
+        int       new_cap = bc->cap ? bc->cap << 1 : 1024;
+        uint32_t *code = realloc(bc->code, new_cap * sizeof(uint32_t));
+        if (!code) {
+            fprintf(stderr, "_emit(), no enough memory\n");
+            exit(EXIT_FAILURE);
+        }
+        bc->code = code;
+        bc->cap = new_cap;
+    }
+    bc->code[bc->size++] = word;
+}
+
+// jump word to patch with the offset of target later
+static void _emit_jump(struct Lowering *l, int target) {
+    if (l->patch_size == l->patch_cap) {
+        int  new_cap = l->patch_cap ? l->patch_cap << 1 : 256;
+        int *patches = realloc(l->patches, new_cap * 2 * sizeof(int));
+        if (!patches) {
+            fprintf(stderr, "_emit_jump(), no enough memory\n");
+            exit(EXIT_FAILURE);
+        }
+        l->patches = patches;
+        l->patch_cap = new_cap;
+    }
+    l->patches[l->patch_size * 2] = l->bc->size;
+    l->patches[l->patch_size * 2 + 1] = target;
+    l->patch_size++;
+    _emit(l->bc, BC_SX(BC_JMP, 0));
+}
+
+// ---------------------Frame Layout---------------------
+
+static bool _same_value(struct Value *x, struct Value *y) {
+    if (x->type != y->type) return false;
+    switch (x->type) {
+        case TAC_TYPE_FLOAT: return !memcmp(&x->f, &y->f, sizeof(float));
+        case TAC_TYPE_BOOL: return x->b == y->b;
+        case TAC_TYPE_STRING: return !strcmp(x->s, y->s);
+        default: return x->i == y->i;
+    }
+}
+
+static int _const_index(struct Bytecode *bc, struct BcFunc *f, struct Value *v) {
+    for (int i = 0; i < f->const_size; i++)
+        if (_same_value(&f->consts[i], v)) return i;
+
+    if (f->const_size == f->const_cap) {
+        int new_cap = f->const_cap ? f->const_cap << 1 : 16;
+        f->consts = arena_realloc(bc->arena, f->consts, f->const_cap * sizeof(struct Value), new_cap * sizeof(struct Value));
+        f->const_cap = new_cap;
+    }
+    f->consts[f->const_size] = *v;
+    return f->const_size++;
+}
+
+static int _outer_ref(struct Bytecode *bc, int func, int reg) {
+    for (int i = 0; i < bc->outer_size; i++)
+        if (bc->outers[i].func == func && bc->outers[i].reg == reg) return i;
+
+    if (bc->outer_size == bc->outer_cap) {
+        int new_cap = bc->outer_cap ? bc->outer_cap << 1 : 16;
+        bc->outers = arena_realloc(bc->arena, bc->outers, bc->outer_cap * sizeof(struct BcOuter), new_cap * sizeof(struct BcOuter));
+        bc->outer_cap = new_cap;
+    }
+    bc->outers[bc->outer_size] = (struct BcOuter){func, reg};
+    return bc->outer_size++;
+}
+
+static void _mark_owners(struct Lowering *l) {
+    struct Interp *interp = l->interp;
+    for (int i = 0; i < interp->instr_size; i++) l->owner[i] = 0;
+    // nested funcs come after their enclosing funcs
+    for (int f = 1; f < interp->func_size; f++)
+        for (int i = interp->funcs[f].entry; i < interp->funcs[f].end; i++) l->owner[i] = f;
+}
+
+static void _count_params(struct Lowering *l) {
+    struct Interp *interp = l->interp;
+    for (int i = 0; i < interp->instr_size; i++) {
+        struct Instr  *instr = &interp->instrs[i];
+        struct BcFunc *f = &l->bc->funcs[l->owner[i]];
+        if (instr->op == TAC_CALL && instr->y.lit.i > l->bc->funcs[instr->target].param_size)
+            l->bc->funcs[instr->target].param_size = instr->y.lit.i;
+        if (instr->op == TAC_MOV && instr->y.kind == OPERAND_ARG && instr->y.index >= f->param_size) f->param_size = instr->y.index + 1;
+    }
+}
+
+struct Interval {
+    int slot;
+    int start;
+    int end;
+};
+
+static void _touch(struct Interval *intervals, int *slot_interval, struct Operand *o, int i) {
+    if (o->kind != OPERAND_LOCAL || slot_interval[o->index] < 0) return;
+
+    struct Interval *it = &intervals[slot_interval[o->index]];
+    if (it->start < 0) it->start = i;
+    it->end = i;
+}
+
+static int _cmp_interval(const void *a, const void *b) {
+    return ((struct Interval *)a)->start - ((struct Interval *)b)->start;
+}
+
+/*
+ * Temps get registers by linear scan over their live ranges in instr order,
+ * a range crossed by a backward jump is widened to the whole loop, as the temp may live around it.
+ * Named vars keep their own registers after the temps, they may be accessed by nested funcs.
+ */
+static void _layout_frame(struct Lowering *l, int func) {
+    struct Interp     *interp = l->interp;
+    struct InterpFunc *src = &interp->funcs[func];
+    struct BcFunc     *f = &l->bc->funcs[func];
+
+    int *slot_interval = arena_alloc(l->bc->arena, (src->slot_size + 1) * sizeof(int));
+    f->var_regs = arena_alloc(l->bc->arena, (src->slot_size + 1) * sizeof(int));
+    f->var_base = f->param_size + SCRATCH_SIZE;
+
+    struct Interval *intervals = malloc((src->slot_size + 1) * sizeof(struct Interval));
+    if (!intervals) {
+        fprintf(stderr, "_layout_frame(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int s = 0; s < src->slot_size; s++) {
+        if (is_temp_var(src->slots[s])) {
+            slot_interval[s] = f->temp_size;
+            intervals[f->temp_size++] = (struct Interval){s, -1, -1};
+        } else slot_interval[s] = -1;
+    }
+
+    int start = func ? src->entry : 0;
+    int end = func ? src->end : interp->instr_size;
+    for (int i = start; i < end; i++) {
+        if (l->owner[i] != func) continue;
+        _touch(intervals, slot_interval, &interp->instrs[i].x, i);
+        _touch(intervals, slot_interval, &interp->instrs[i].y, i);
+        _touch(intervals, slot_interval, &interp->instrs[i].res, i);
+    }
+
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int i = start; i < end; i++) {
+            struct Instr *instr = &interp->instrs[i];
+            bool          is_jump = instr->op == TAC_JMP || is_cond_jump(instr->op);
+            if (l->owner[i] != func || !is_jump || instr->target > i) continue;
+
+            for (int t = 0; t < f->temp_size; t++) {
+                struct Interval *it = &intervals[t];
+                if (it->start < 0 || it->end < instr->target || it->start > i) continue;
+                if (it->start > instr->target) it->start = instr->target, changed = true;
+                if (it->end < i) it->end = i, changed = true;
+            }
+        }
+    }
+
+    qsort(intervals, f->temp_size, sizeof(struct Interval), _cmp_interval);
+    // end of the range held by each temp register
+    int *reg_end = malloc((f->temp_size + 1) * sizeof(int));
+    if (!reg_end) {
+        fprintf(stderr, "_layout_frame(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int t = 0; t < f->temp_size; t++) {
+        int r = 0;
+        while (r < f->temp_regs && reg_end[r] >= intervals[t].start) r++;
+        if (r == f->temp_regs) f->temp_regs++;
+        reg_end[r] = intervals[t].end;
+        f->var_regs[intervals[t].slot] = f->var_base + r;
+    }
+    free(reg_end);
+    free(intervals);
+
+    // temps are used the most, they are kept below BC_NO_REG first
+    f->frame_size = f->var_base + f->temp_regs;
+    for (int s = 0; s < src->slot_size; s++)
+        if (slot_interval[s] < 0) f->var_regs[s] = f->frame_size++;
+}
+
+// ---------------------Lowering---------------------
+
+static int _scratch_reg(struct BcFunc *f, int scratch) {
+    return f->param_size + scratch;
+}
+
+// register the operand is read from, constants, outer vars & registers from BC_NO_REG on are loaded to the scratch register first
+static int _read_reg(struct Lowering *l, struct BcFunc *f, struct Operand *o, int scratch) {
+    int reg = _scratch_reg(f, scratch);
+    switch (o->kind) {
+        case OPERAND_LIT: _emit(l->bc, BC_ABX(BC_LOADK, reg, _const_index(l->bc, f, &o->lit))); return reg;
+        case OPERAND_LOCAL: {
+            if (f->var_regs[o->index] < BC_NO_REG) return f->var_regs[o->index];
+            _emit(l->bc, BC_ABX(BC_GETW, reg, f->var_regs[o->index]));
+            return reg;
+        }
+        case OPERAND_ARG: return o->index;
+        case OPERAND_OUTER: {
+            _emit(l->bc, BC_ABX(BC_GETO, reg, _outer_ref(l->bc, o->func, l->bc->funcs[o->func].var_regs[o->index])));
+            return reg;
+        }
+        default: return BC_NO_REG;
+    }
+}
+
+// register the operand is written to, the last scratch register is stored by _write_back
+static int _write_reg(struct Lowering *l, struct BcFunc *f, struct Operand *o) {
+    switch (o->kind) {
+        case OPERAND_LOCAL: return f->var_regs[o->index] < BC_NO_REG ? f->var_regs[o->index] : _scratch_reg(f, SCRATCH_SIZE - 1);
+        case OPERAND_OUTER: return _scratch_reg(f, SCRATCH_SIZE - 1);
+        case OPERAND_NONE: return BC_NO_REG;
+        default: {
+            fprintf(stderr, "create_bytecode(), illegal operand written\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void _write_back(struct Lowering *l, struct BcFunc *f, struct Operand *o) {
+    int reg = _scratch_reg(f, SCRATCH_SIZE - 1);
+    if (o->kind == OPERAND_LOCAL && f->var_regs[o->index] >= BC_NO_REG) _emit(l->bc, BC_ABX(BC_SETW, reg, f->var_regs[o->index]));
+    else if (o->kind == OPERAND_OUTER) _emit(l->bc, BC_ABX(BC_SETO, reg, _outer_ref(l->bc, o->func, l->bc->funcs[o->func].var_regs[o->index])));
+}
+
+static bool _is_int_type(enum TacType type) {
+    return type == TAC_TYPE_INT;
+}
+
+// constant read by the K form of an int op or cond jump, -1 if it has none
+static int _k_operand(struct Bytecode *bc, struct BcFunc *f, struct Instr *instr) {
+    if (!_is_int_type(instr->type) || instr->op == TAC_NOT || instr->y.kind != OPERAND_LIT) return -1;
+
+    int k = _const_index(bc, f, &instr->y.lit);
+    return k <= 0xFF ? k : -1;
+}
+
+static void _lower_instr(struct Lowering *l, struct Instr *instr, struct BcFunc *f) {
+    struct Bytecode *bc = l->bc;
+    switch (instr->op) {
+        case TAC_MOV: {
+            // a constant is loaded right to the var, unless converted
+            if (instr->y.kind == OPERAND_LIT && (instr->type == TAC_TYPE_NONE || instr->type == instr->y.lit.type)) {
+                int a = _write_reg(l, f, &instr->x);
+                _emit(bc, BC_ABX(BC_LOADK, a, _const_index(bc, f, &instr->y.lit)));
+                _write_back(l, f, &instr->x);
+                break;
+            }
+            int b = _read_reg(l, f, &instr->y, 0);
+            int a = _write_reg(l, f, &instr->x);
+            if (instr->type == TAC_TYPE_NONE) _emit(bc, BC_ABC(BC_MOV, a, b, 0));
+            else _emit(bc, BC_ABC(BC_MOVT, a, b, instr->type));
+            _write_back(l, f, &instr->x);
+            break;
+        }
+        case TAC_JMP: _emit_jump(l, instr->target); break;
+        case TAC_JE:
+        case TAC_JNE:
+        case TAC_JLT:
+        case TAC_JLE:
+        case TAC_JGT:
+        case TAC_JGE: {
+            int a = _read_reg(l, f, &instr->x, 0);
+            int k = _k_operand(bc, f, instr);
+            if (k >= 0) {
+                _emit(bc, BC_ABC(BC_JEIK + instr->op - TAC_JE, a, k, 0));
+                _emit_jump(l, instr->target);
+                break;
+            }
+            int b = _read_reg(l, f, &instr->y, 1);
+            if (_is_int_type(instr->type)) _emit(bc, BC_ABC(BC_JEI + instr->op - TAC_JE, a, b, 0));
+            else _emit(bc, BC_ABC(BC_JCC, a, b, (instr->op - TAC_JE) << 4 | instr->type));
+            _emit_jump(l, instr->target);
+            break;
+        }
+        case TAC_PARAM: _emit(bc, BC_ABC(BC_PARAM, _read_reg(l, f, &instr->x, 0), 0, 0)); break;
+        case TAC_CALL: {
+            int a = _write_reg(l, f, &instr->res);
+            _emit(bc, BC_ABC(BC_CALL, a, instr->y.lit.i, instr->type));
+            _emit(bc, BC_SX(BC_EXTRA, instr->target));
+            _write_back(l, f, &instr->res);
+            break;
+        }
+        case TAC_RET: _emit(bc, BC_ABC(BC_RET, _read_reg(l, f, &instr->x, 0), 0, 0)); break;
+        default: {
+            int b = _read_reg(l, f, &instr->x, 0);
+            int k = _k_operand(bc, f, instr);
+            int c = instr->op == TAC_NOT ? b : k >= 0 ? k : _read_reg(l, f, &instr->y, 1);
+            int a = _write_reg(l, f, &instr->res);
+            if (k >= 0) _emit(bc, BC_ABC(BC_EQIK + instr->op - TAC_EQ, a, b, c));
+            else if (_is_int_type(instr->type)) _emit(bc, BC_ABC(BC_EQI + instr->op - TAC_EQ, a, b, c));
+            else if (instr->type == TAC_TYPE_FLOAT && instr->op >= TAC_ADD && instr->op <= TAC_QUO)
+                _emit(bc, BC_ABC(BC_ADDF + instr->op - TAC_ADD, a, b, c));
+            else {
+                _emit(bc, BC_ABC(BC_ARITH, a, b, c));
+                _emit(bc, BC_SX(BC_EXTRA, instr->op | instr->type << 8));
+            }
+            _write_back(l, f, &instr->res);
+        }
+    }
+}
+
+// params & scratch registers are read by ABC operands, the rest by bx
+static void _check_frame(struct Bytecode *bc, int func) {
+    struct BcFunc *f = &bc->funcs[func];
+    if (f->var_base > BC_NO_REG || f->frame_size > BC_MAX_REGS || f->const_size > BC_MAX_CONSTS) {
+        fprintf(stderr,
+                "create_bytecode(), func %s needs %d params, %d registers & %d constants, more than %d, %d & %d\n",
+                f->name ? f->name : "<top>",
+                f->param_size,
+                f->frame_size,
+                f->const_size,
+                BC_NO_REG - SCRATCH_SIZE,
+                BC_MAX_REGS,
+                BC_MAX_CONSTS);
+        exit(EXIT_FAILURE);
+    }
+}
+
+struct Bytecode *create_bytecode(struct Interp *interp) {
+    struct Bytecode *bc = CREATE_STRUCT_P(Bytecode);
+    if (!bc) {
+        fprintf(stderr, "create_bytecode(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    bc->interp = interp;
+    bc->arena = create_arena();
+    bc->func_size = interp->func_size;
+    bc->funcs = arena_alloc(bc->arena, interp->func_size * sizeof(struct BcFunc));
+    memset(bc->funcs, 0, interp->func_size * sizeof(struct BcFunc));
+    for (int i = 0; i < interp->func_size; i++) bc->funcs[i].name = interp->funcs[i].name;
+
+    struct Lowering l = {.bc = bc, .interp = interp};
+    l.owner = malloc((interp->instr_size + 1) * sizeof(int));
+    l.word_pc = malloc((interp->instr_size + 1) * sizeof(int));
+    if (!l.owner || !l.word_pc) {
+        fprintf(stderr, "create_bytecode(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    _mark_owners(&l);
+    _count_params(&l);
+    for (int i = 0; i < interp->func_size; i++) _layout_frame(&l, i);
+
+    for (int i = 0; i < interp->instr_size; i++) {
+        l.word_pc[i] = bc->size;
+        _lower_instr(&l, &interp->instrs[i], &bc->funcs[l.owner[i]]);
+    }
+    l.word_pc[interp->instr_size] = bc->size;
+    _emit(bc, BC_SX(BC_HALT, 0));
+
+    for (int i = 0; i < l.patch_size; i++) {
+        int pos = l.patches[i * 2];
+        int offset = l.word_pc[l.patches[i * 2 + 1]] - (pos + 1);
+        if (offset > BC_MAX_SBX || offset < -BC_MAX_SBX) {
+            fprintf(stderr, "create_bytecode(), jump out of range\n");
+            exit(EXIT_FAILURE);
+        }
+        bc->code[pos] = BC_SX(BC_JMP, offset);
+    }
+    for (int i = 0; i < interp->func_size; i++) {
+        bc->funcs[i].entry = i ? l.word_pc[interp->funcs[i].entry] : 0;
+        _check_frame(bc, i);
+    }
+
+    free(l.owner);
+    free(l.word_pc);
+    free(l.patches);
+    return bc;
+}
+
+void free_bytecode(struct Bytecode *bc) {
+    if (!bc) return;
+
+    free(bc->code);
+    free_arena(bc->arena);
+    free(bc);
+}
+
+void print_bytecode(struct Bytecode *bc) {
+    for (int i = 0; i < bc->func_size; i++) {
+        struct BcFunc *f = &bc->funcs[i];
+        printf("func %-16s entry %5d, params %2d, vars %3d, temps %3d in %3d regs, consts %3d, frame %3d\n",
+               f->name ? f->name : "<top>",
+               f->entry,
+               f->param_size,
+               f->frame_size - f->temp_regs - f->var_base,
+               f->temp_size,
+               f->temp_regs,
+               f->const_size,
+               f->frame_size);
+    }
+    for (int pc = 0; pc < bc->size; pc++) {
+        uint32_t i = bc->code[pc];
+        int      op = BC_OP(i);
+        printf("%5d  %-6s", pc, bc_op_code_symbols[op]);
+        switch (op) {
+            case BC_JMP: printf(" %+d -> %d\n", BC_SBX(i), pc + 1 + BC_SBX(i)); break;
+            case BC_EXTRA: printf(" %d\n", BC_SBX(i)); break;
+            case BC_GETO:
+            case BC_SETO: printf(" r%d, outer %d\n", BC_A(i), BC_BX(i)); break;
+            case BC_GETW:
+            case BC_SETW: printf(" r%d, r%d\n", BC_A(i), BC_BX(i)); break;
+            case BC_LOADK: printf(" r%d, const %d\n", BC_A(i), BC_BX(i)); break;
+            case BC_JEIK:
+            case BC_JNEIK:
+            case BC_JLTIK:
+            case BC_JLEIK:
+            case BC_JGTIK:
+            case BC_JGEIK: printf(" r%d, const %d\n", BC_A(i), BC_B(i)); break;
+            default:
+                if (op >= BC_EQIK && op <= BC_SHRIK) printf(" r%d, r%d, const %d\n", BC_A(i), BC_B(i), BC_C(i));
+                else printf(" r%d, r%d, r%d\n", BC_A(i), BC_B(i), BC_C(i));
+        }
+    }
+}
+
+// ---------------------Superinstructions---------------------
+
+// BC_INC_LOOP is chosen over BC_ADDI_JMP where the jump lands on a JxxI or JxxIK
+static struct BcSuper supers[] = {
+    {"addi_jmp",   BC_ADDIK, BC_JMP,   BC_ADDI_JMP  },
+    {"param2",     BC_PARAM, BC_PARAM, BC_PARAM2    },
+    {"param_call", BC_PARAM, BC_CALL,  BC_PARAM_CALL},
+    {"movt2",      BC_MOVT,  BC_MOVT,  BC_MOVT2     },
+};
+
+#define SUPER_SIZE (int)(sizeof(supers) / sizeof(supers[0]))
+
+// inc_loop is counted apart from addi_jmp
+static int inc_loop_fused;
+
+enum BcOpCode bc_base_op(enum BcOpCode op) {
+    switch (op) {
+        case BC_ADDI_JMP:
+        case BC_INC_LOOP: return BC_ADDIK;
+        case BC_PARAM2:
+        case BC_PARAM_CALL: return BC_PARAM;
+        case BC_MOVT2: return BC_MOVT;
+        default: return op;
+    }
+}
+
+int bc_op_width(enum BcOpCode op) {
+    switch (op) {
+        case BC_ARITH:
+        case BC_CALL:
+        case BC_JEI:
+        case BC_JNEI:
+        case BC_JLTI:
+        case BC_JLEI:
+        case BC_JGTI:
+        case BC_JGEI:
+        case BC_JEIK:
+        case BC_JNEIK:
+        case BC_JLTIK:
+        case BC_JLEIK:
+        case BC_JGTIK:
+        case BC_JGEIK:
+        case BC_JCC: return 2;
+        default: return 1;
+    }
+}
+
+static long _pair_count(long (*pair_counts)[BC_OP_SIZE], struct BcSuper *s) {
+    return pair_counts[s->first][s->second];
+}
+
+int fuse_superinstructions(struct Bytecode *bc, long (*pair_counts)[BC_OP_SIZE], int max_supers) {
+    // by count, most frequent first
+    struct BcSuper *chosen[SUPER_SIZE];
+    for (int i = 0; i < SUPER_SIZE; i++) {
+        int k = i;
+        for (; k > 0 && _pair_count(pair_counts, chosen[k - 1]) < _pair_count(pair_counts, &supers[i]); k--) chosen[k] = chosen[k - 1];
+        chosen[k] = &supers[i];
+    }
+
+    int chosen_size = 0;
+    while (chosen_size < max_supers && chosen_size < SUPER_SIZE && _pair_count(pair_counts, chosen[chosen_size]))
+        chosen_size++;
+
+    int fused = 0;
+    for (int pc = 0; pc + 1 < bc->size; pc += bc_op_width(bc_base_op(BC_OP(bc->code[pc])))) {
+        enum BcOpCode first = BC_OP(bc->code[pc]);
+        enum BcOpCode second = bc_base_op(BC_OP(bc->code[pc + 1]));
+        for (int i = 0; i < chosen_size; i++) {
+            struct BcSuper *s = chosen[i];
+            if (s->first != first || s->second != second) continue;
+
+            enum BcOpCode super = s->super;
+            if (super == BC_ADDI_JMP) {
+                int target = pc + 2 + BC_SBX(bc->code[pc + 1]);
+                int op = BC_OP(bc->code[target]);
+                if ((op >= BC_JEI && op <= BC_JGEI) || (op >= BC_JEIK && op <= BC_JGEIK)) super = BC_INC_LOOP;
+            }
+            bc->code[pc] = (bc->code[pc] & ~0xFFu) | super;
+            __atomic_add_fetch(super == BC_INC_LOOP ? &inc_loop_fused : &s->fused, 1, __ATOMIC_RELAXED);
+            fused++;
+            break;
+        }
+    }
+    return fused;
+}
+
+void print_superinstructions() {
+    printf("%-12s %-6s %-6s %8s\n", "super", "first", "second", "fused");
+    for (int i = 0; i < SUPER_SIZE; i++)
+        printf("%-12s %-6s %-6s %8d\n",
+               supers[i].name,
+               bc_op_code_symbols[supers[i].first],
+               bc_op_code_symbols[supers[i].second],
+               __atomic_load_n(&supers[i].fused, __ATOMIC_RELAXED));
+    printf("%-12s %-6s %-6s %8d\n", "inc_loop", "ADDI", "JMP", __atomic_load_n(&inc_loop_fused, __ATOMIC_RELAXED));
+}
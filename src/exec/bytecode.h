@@ -0,0 +1,181 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "interp.h"
+
+#include <stdint.h>
+
+/*
+ * 32-bit register bytecode, lowered from the resolved TAC of an interp.
+ * ABC: op:8 | a:8 | b:8 | c:8, registers of the frame in a, b, c
+ * ABx: op:8 | a:8 | bx:16
+ * sBx: op:8 | sbx:24, jump offset relative to the next word
+ *
+ * Cond jumps are followed by a BC_JMP word taken if the condition holds,
+ * BC_CALL & BC_ARITH are followed by a BC_EXTRA word with the func index or the TAC op & type.
+ * Registers from BC_NO_REG on are only reached by bx, through BC_GETW & BC_SETW on a scratch register.
+ * Constants take no register, int ops & cond jumps read the first 256 constants of the func by their K forms,
+ * other constants are loaded from the pool by BC_LOADK.
+ */
+#define BC_OP(i) ((i) & 0xFF)
+#define BC_A(i) (((i) >> 8) & 0xFF)
+#define BC_B(i) (((i) >> 16) & 0xFF)
+#define BC_C(i) ((i) >> 24)
+#define BC_BX(i) ((i) >> 16)
+#define BC_SBX(i) ((int32_t)(i) >> 8)
+
+#define BC_ABC(op, a, b, c) ((uint32_t)(op) | (uint32_t)(a) << 8 | (uint32_t)(b) << 16 | (uint32_t)(c) << 24)
+#define BC_ABX(op, a, bx) ((uint32_t)(op) | (uint32_t)(a) << 8 | (uint32_t)(bx) << 16)
+#define BC_SX(op, sbx) ((uint32_t)(op) | (uint32_t)(sbx) << 8)
+
+#define BC_MAX_REGS 0x10000   // per frame
+#define BC_MAX_CONSTS 0x10000 // per func
+#define BC_NO_REG 0xFF        // CALL result discarded, RET without value
+#define BC_MAX_SBX 0x7FFFFF
+
+/*
+ * Int ops keep the order of TAC_EQ..TAC_NOT & TAC_JE..TAC_JGE, so they are mapped by offset.
+ * Ops on other types go through BC_ARITH & BC_JCC, with the typed value ops of the interpreter.
+ */
+enum BcOpCode {
+    BC_HALT,
+    BC_MOV,   // R[a] = R[b]
+    BC_MOVT,  // R[a] = R[b] converted to type c
+    BC_GETO,  // R[a] = slot of an enclosing func frame, bx indexes outer refs
+    BC_SETO,  // slot of an enclosing func frame = R[a]
+    BC_GETW,  // R[a] = R[bx]
+    BC_SETW,  // R[bx] = R[a]
+    BC_LOADK, // R[a] = constant bx of the func
+    BC_EQI,
+    BC_NEI,
+    BC_LTI,
+    BC_LEI,
+    BC_GTI,
+    BC_GEI,
+    BC_ADDI,
+    BC_SUBI,
+    BC_MULI,
+    BC_QUOI,
+    BC_REMI,
+    BC_ANDI,
+    BC_ORI,
+    BC_XORI,
+    BC_SHLI,
+    BC_SHRI,
+    BC_NOTI,
+    BC_ADDF,
+    BC_SUBF,
+    BC_MULF,
+    BC_QUOF,
+    // R[a] = R[b] op K[c], K is the constant pool of the func
+    BC_EQIK,
+    BC_NEIK,
+    BC_LTIK,
+    BC_LEIK,
+    BC_GTIK,
+    BC_GEIK,
+    BC_ADDIK,
+    BC_SUBIK,
+    BC_MULIK,
+    BC_QUOIK,
+    BC_REMIK,
+    BC_ANDIK,
+    BC_ORIK,
+    BC_XORIK,
+    BC_SHLIK,
+    BC_SHRIK,
+    BC_ARITH, // R[a] = R[b] op R[c], op & type in the extra word
+    BC_JMP,
+    BC_JEI,
+    BC_JNEI,
+    BC_JLTI,
+    BC_JLEI,
+    BC_JGTI,
+    BC_JGEI,
+    // R[a] cmp K[b]
+    BC_JEIK,
+    BC_JNEIK,
+    BC_JLTIK,
+    BC_JLEIK,
+    BC_JGTIK,
+    BC_JGEIK,
+    BC_JCC,   // R[a] cmp R[b], c = cmp << 4 | type
+    BC_PARAM, // push R[a] as an argument of the next call
+    BC_CALL,  // R[a] = func(b args), c = result type, func index in the extra word
+    BC_RET,   // return R[a]
+    BC_EXTRA, // operand word, never dispatched
+
+    // superinstructions, the first word of a pair is rewritten, the second word is kept as jumps may land on it
+    BC_ADDI_JMP,   // ADDIK; JMP
+    BC_INC_LOOP,   // ADDIK; JMP to a JxxI or JxxIK loop header, the header is run too
+    BC_PARAM2,     // PARAM; PARAM
+    BC_PARAM_CALL, // PARAM; CALL
+    BC_MOVT2,      // MOVT; MOVT
+    BC_OP_SIZE
+};
+
+extern char *bc_op_code_symbols[];
+
+// op of a word before fused
+enum BcOpCode bc_base_op(enum BcOpCode op);
+// words taken by an instr, 2 for the ones followed by a jump or extra word
+int           bc_op_width(enum BcOpCode op);
+
+#define BC_MAX_SUPERS 4 // pairs fused by default
+
+struct BcSuper {
+    char         *name;
+    enum BcOpCode first;
+    enum BcOpCode second;
+    enum BcOpCode super;
+    int           fused; // pairs rewritten since start
+};
+
+struct BcFunc {
+    char         *name;       // NULL for the top level code
+    int           entry;      // first word of the body
+    int           param_size; // args are R[0..param_size)
+    int           var_base;   // first register of temps & named vars, after the scratch registers
+    int           frame_size;
+    struct Value *consts; // constant pool, read by the K ops & BC_LOADK
+    int           const_size;
+    int           const_cap;
+    int          *var_regs;  // register of each interp slot
+    int           temp_size; // temps of the func
+    int           temp_regs; // registers shared by temps with disjoint live ranges
+};
+
+// slot of a func frame accessed by nested funcs
+struct BcOuter {
+    int func;
+    int reg;
+};
+
+struct Bytecode {
+    struct Interp *interp; // names of funcs & slots
+    struct Arena  *arena;  // owns funcs, consts & outer refs
+
+    uint32_t       *code;
+    int             size;
+    int             cap;
+    struct BcFunc  *funcs;
+    int             func_size;
+    struct BcOuter *outers;
+    int             outer_size;
+    int             outer_cap;
+};
+
+// lower the resolved instrs of interp, interp must outlive the bytecode
+struct Bytecode *create_bytecode(struct Interp *interp);
+void             free_bytecode(struct Bytecode *bc);
+void             print_bytecode(struct Bytecode *bc);
+
+/*
+ * Rewrite pairs of adjacent instrs to superinstructions,
+ * pair_counts[x][y] is how many times y is dispatched right after x in a profiling run,
+ * the max_supers most frequent pairs with a superinstruction are fused, returns the number of pairs rewritten.
+ */
+int  fuse_superinstructions(struct Bytecode *bc, long (*pair_counts)[BC_OP_SIZE], int max_supers);
+void print_superinstructions();
+
+#endif
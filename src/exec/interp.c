@@ -0,0 +1,595 @@
+#include "interp.h"
+#include "jit.h"
+#include "global.h"
+#include "ir_gen.h"
+#include "ir_fold.h"
+#include "ir_cfg.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// entry of label, func & var maps
+struct IndexEntry {
+    char *name;
+    int   func;
+    int   index;
+};
+
+static void *_get_index_entry_name(void *ele) {
+    return ((struct IndexEntry *)ele)->name;
+}
+
+static void *_get_index_entry_value(void *ele) {
+    return ele;
+}
+
+static void _update_index_entry(void *ele1, void *ele2) {
+    ((struct IndexEntry *)ele1)->func = ((struct IndexEntry *)ele2)->func;
+    ((struct IndexEntry *)ele1)->index = ((struct IndexEntry *)ele2)->index;
+}
+
+static hashmap _create_index_map() {
+    return hashmap_new_default(_get_index_entry_name, _get_index_entry_value, _update_index_entry, str_hash_func, str_eq_func, ptr_eq_func);
+}
+
+static struct IndexEntry *_index_get(hashmap map, char *name) {
+    return hashmap_get(map, &(struct IndexEntry){.name = name});
+}
+
+static char *_interp_strdup(struct Interp *interp, char *s) {
+    char *d = arena_alloc(interp->arena, strlen(s) + 1);
+    strcpy(d, s);
+    return d;
+}
+
+static void _index_put(struct Interp *interp, hashmap map, char *name, int func, int index) {
+    struct IndexEntry *e = arena_alloc(interp->arena, sizeof(struct IndexEntry));
+    e->name = _interp_strdup(interp, name);
+    e->func = func;
+    e->index = index;
+    hashmap_put(map, e);
+}
+
+void runtime_error(char *msg) {
+    fprintf(stderr, "runtime error: %s\n", msg);
+    exit(EXIT_FAILURE);
+}
+
+// ---------------------Resolving---------------------
+
+static int _add_func(struct Interp *interp, char *name) {
+    if (interp->func_size == interp->func_cap) {
+        int                new_cap = interp->func_cap ? interp->func_cap << 1 : 16;
+        struct InterpFunc *funcs = realloc(interp->funcs, new_cap * sizeof(struct InterpFunc));
+        if (!funcs) {
+            fprintf(stderr, "_add_func(), no enough memory\n");
+            exit(EXIT_FAILURE);
+        }
+        interp->funcs = funcs;
+        interp->func_cap = new_cap;
+    }
+    interp->funcs[interp->func_size] = (struct InterpFunc){.name = name ? _interp_strdup(interp, name) : NULL};
+    if (name) _index_put(interp, interp->func_map, name, interp->func_size, 0);
+    return interp->func_size++;
+}
+
+static struct Instr *_add_instr(struct Interp *interp) {
+    if (interp->instr_size == interp->instr_cap) {
+        int           new_cap = interp->instr_cap ? interp->instr_cap << 1 : 256;
+        struct Instr *instrs = realloc(interp->instrs, new_cap * sizeof(struct Instr));
+        if (!instrs) {
+            fprintf(stderr, "_add_instr(), no enough memory\n");
+            exit(EXIT_FAILURE);
+        }
+        interp->instrs = instrs;
+        interp->instr_cap = new_cap;
+    }
+    struct Instr *instr = &interp->instrs[interp->instr_size++];
+    memset(instr, 0, sizeof(struct Instr));
+    return instr;
+}
+
+static int _add_slot(struct Interp *interp, int func, char *name) {
+    struct InterpFunc *f = &interp->funcs[func];
+    if (f->slot_size == f->slot_cap) {
+        int new_cap = f->slot_cap ? f->slot_cap << 1 : 16;
+        f->slots = arena_realloc(interp->arena, f->slots, f->slot_cap * sizeof(char *), new_cap * sizeof(char *));
+        f->slot_cap = new_cap;
+    }
+    f->slots[f->slot_size] = _interp_strdup(interp, name);
+    _index_put(interp, interp->var_map, name, func, f->slot_size);
+    return f->slot_size++;
+}
+
+// V#name@func is owned by func, temp vars by the func using them, other vars by the top level code
+static struct IndexEntry *_resolve_var(struct Interp *interp, char *name, int cur_func) {
+    struct IndexEntry *e = _index_get(interp->var_map, name);
+    if (e) return e;
+
+    int   owner = is_temp_var(name) ? cur_func : 0;
+    char *sep = strrchr(name, LOCAL_VAR_SEP);
+    if (sep) {
+        struct IndexEntry *f = _index_get(interp->func_map, sep + 1);
+        if (!f) {
+            fprintf(stderr, "create_interp(), unknown func of var: %s\n", name);
+            exit(EXIT_FAILURE);
+        }
+        owner = f->func;
+    }
+    _add_slot(interp, owner, name);
+    return _index_get(interp->var_map, name);
+}
+
+static struct Value _parse_value(struct Interp *interp, char *lit, enum TacType type) {
+    struct Value v = {0};
+    if (type == TAC_TYPE_NONE) type = lit_type(lit);
+    char *s = unpack_name(lit);
+    v.type = type;
+    switch (type) {
+        case TAC_TYPE_INT: v.i = (int)strtol(s, NULL, 10); break;
+        case TAC_TYPE_FLOAT: v.f = strtof(s, NULL); break;
+        case TAC_TYPE_BOOL: v.b = !strcmp(s, "true") || !strcmp(s, "1"); break;
+        case TAC_TYPE_CHAR: v.i = (unsigned char)s[0]; break;
+        default: {
+            v.type = TAC_TYPE_STRING;
+            v.s = _interp_strdup(interp, s);
+        }
+    }
+    return v;
+}
+
+static struct Operand _resolve_operand(struct Interp *interp, char *s, enum TacType type, int cur_func) {
+    struct Operand o = {0};
+    if (!*s) return o;
+
+    switch (s[0]) {
+        case LIT_PREFIX: {
+            o.kind = OPERAND_LIT;
+            o.lit = _parse_value(interp, s, type);
+            return o;
+        }
+        case ARG_PREFIX: {
+            o.kind = OPERAND_ARG;
+            o.index = atoi(unpack_name(s));
+            return o;
+        }
+        case VAR_PREFIX: {
+            struct IndexEntry *e = _resolve_var(interp, s, cur_func);
+            o.kind = e->func == cur_func ? OPERAND_LOCAL : OPERAND_OUTER;
+            o.func = e->func;
+            o.index = e->index;
+            return o;
+        }
+        default: {
+            fprintf(stderr, "create_interp(), unknown operand: %s\n", s);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static int _resolve_label(struct Interp *interp, char *label) {
+    struct IndexEntry *e = _index_get(interp->label_map, label);
+    if (!e) {
+        fprintf(stderr, "create_interp(), unknown label: %s\n", label);
+        exit(EXIT_FAILURE);
+    }
+    return e->index;
+}
+
+// first walk, numbers instrs of labels & funcs
+static void _resolve_labels(struct Interp *interp, struct TAC *tac) {
+    int stack[MAX_LOOP_DEPTH];
+    int depth = 0;
+    int index = 0;
+    for (; tac; tac = tac->next) {
+        if (tac->op == TAC_HEAD) continue;
+        if (tac->op != TAC_LABEL) {
+            index++;
+            continue;
+        }
+
+        if (is_func_label(tac, FUNC_S_PREFIX)) {
+            if (depth == MAX_LOOP_DEPTH) {
+                fprintf(stderr, "create_interp(), funcs nested too deep\n");
+                exit(EXIT_FAILURE);
+            }
+            int func = _add_func(interp, unpack_name(tac->x));
+            interp->funcs[func].entry = ++index;
+            stack[depth++] = func;
+        } else if (is_func_label(tac, FUNC_E_PREFIX)) {
+            interp->funcs[stack[--depth]].end = ++index;
+        } else _index_put(interp, interp->label_map, tac->x, 0, index);
+    }
+    interp->funcs[0].end = index;
+}
+
+// second walk, emits instrs with operands resolved
+static void _resolve_instrs(struct Interp *interp, struct TAC *tac) {
+    int stack[MAX_LOOP_DEPTH];
+    int depth = 0;
+    int cur_func = 0;
+    int index = -1;
+    for (; tac; tac = tac->next) {
+        index++;
+        if (tac->op == TAC_HEAD || (tac->op == TAC_LABEL && !is_func_label(tac, FUNC_S_PREFIX) && !is_func_label(tac, FUNC_E_PREFIX))) continue;
+
+        struct Instr *instr = _add_instr(interp);
+        instr->op = tac->op;
+        instr->type = tac->type;
+        instr->tac_index = index;
+        switch (tac->op) {
+            case TAC_LABEL: {
+                if (is_func_label(tac, FUNC_S_PREFIX)) {
+                    stack[depth++] = cur_func;
+                    cur_func = _index_get(interp->func_map, unpack_name(tac->x))->func;
+                    // jump over the body
+                    instr->op = TAC_JMP;
+                    instr->target = interp->funcs[cur_func].end;
+                } else {
+                    // falls to the end of body
+                    instr->op = TAC_RET;
+                    cur_func = stack[--depth];
+                }
+                break;
+            }
+            case TAC_MOV: {
+                instr->x = _resolve_operand(interp, tac->x, tac->type, cur_func);
+                instr->y = _resolve_operand(interp, tac->y, tac->type, cur_func);
+                break;
+            }
+            case TAC_JMP: instr->target = _resolve_label(interp, tac->x); break;
+            case TAC_JE:
+            case TAC_JNE:
+            case TAC_JLT:
+            case TAC_JLE:
+            case TAC_JGT:
+            case TAC_JGE: {
+                instr->x = _resolve_operand(interp, tac->x, tac->type, cur_func);
+                instr->y = _resolve_operand(interp, tac->y, tac->type, cur_func);
+                instr->target = _resolve_label(interp, tac->res);
+                break;
+            }
+            case TAC_PARAM:
+            case TAC_RET: instr->x = _resolve_operand(interp, tac->x, tac->type, cur_func); break;
+            case TAC_CALL: {
+                struct IndexEntry *f = _index_get(interp->func_map, unpack_name(tac->x));
+                if (!f) {
+                    fprintf(stderr, "create_interp(), unknown func: %s\n", tac->x);
+                    exit(EXIT_FAILURE);
+                }
+                instr->target = f->func;
+                instr->y = _resolve_operand(interp, tac->y, TAC_TYPE_INT, cur_func);
+                instr->res = _resolve_operand(interp, tac->res, tac->type, cur_func);
+                break;
+            }
+            default: {
+                instr->x = _resolve_operand(interp, tac->x, tac->type, cur_func);
+                instr->y = _resolve_operand(interp, tac->y, tac->type, cur_func);
+                instr->res = _resolve_operand(interp, tac->res, tac_res_type(tac->op, tac->type), cur_func);
+            }
+        }
+    }
+}
+
+struct Interp *create_interp(struct TAC *tac) {
+    struct Interp *interp = CREATE_STRUCT_P(Interp);
+    if (!interp) {
+        fprintf(stderr, "create_interp(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    interp->arena = create_arena();
+    interp->label_map = _create_index_map();
+    interp->func_map = _create_index_map();
+    interp->var_map = _create_index_map();
+
+    _add_func(interp, NULL);
+    _resolve_labels(interp, tac);
+    _resolve_instrs(interp, tac);
+    return interp;
+}
+
+bool interp_lookup_var(struct Interp *interp, char *name, int *func, int *slot) {
+    struct IndexEntry *e = _index_get(interp->var_map, name);
+    if (!e) return false;
+    *func = e->func;
+    *slot = e->index;
+    return true;
+}
+
+void free_interp(struct Interp *interp) {
+    if (!interp) return;
+
+    hashmap_free(interp->label_map);
+    hashmap_free(interp->func_map);
+    hashmap_free(interp->var_map);
+    free(interp->instrs);
+    free(interp->funcs);
+    free(interp->stack);
+    free(interp->frames);
+    free(interp->cur_frames);
+    free_arena(interp->arena);
+    free(interp);
+}
+
+// ---------------------Execution---------------------
+
+static int _as_int(struct Value *v) {
+    switch (v->type) {
+        case TAC_TYPE_FLOAT: return (int)v->f;
+        case TAC_TYPE_BOOL: return v->b;
+        case TAC_TYPE_STRING: runtime_error("string used as number");
+        default: return v->i;
+    }
+}
+
+static float _as_float(struct Value *v) {
+    return v->type == TAC_TYPE_FLOAT ? v->f : (float)_as_int(v);
+}
+
+static bool _as_bool(struct Value *v) {
+    switch (v->type) {
+        case TAC_TYPE_BOOL: return v->b;
+        case TAC_TYPE_FLOAT: return v->f != 0;
+        default: return _as_int(v) != 0;
+    }
+}
+
+struct Value value_convert(struct Value *v, enum TacType type) {
+    struct Value r = {.type = type};
+    if (type == TAC_TYPE_NONE || type == v->type) return *v;
+    switch (type) {
+        case TAC_TYPE_INT:
+        case TAC_TYPE_CHAR: r.i = _as_int(v); break;
+        case TAC_TYPE_FLOAT: r.f = _as_float(v); break;
+        case TAC_TYPE_BOOL: r.b = _as_bool(v); break;
+        default: runtime_error("can not convert to string");
+    }
+    return r;
+}
+
+bool value_compare(enum TacOpCode op, enum TacType type, struct Value *x, struct Value *y) {
+    int cmp;
+    switch (type) {
+        case TAC_TYPE_FLOAT: {
+            float fx = _as_float(x), fy = _as_float(y);
+            // any comparison with nan is false but NE
+            if (fx != fx || fy != fy) return op == TAC_NE;
+            cmp = (fx > fy) - (fx < fy);
+            break;
+        }
+        case TAC_TYPE_STRING: {
+            if (x->type != TAC_TYPE_STRING || y->type != TAC_TYPE_STRING) runtime_error("string compared with non-string");
+            cmp = strcmp(x->s, y->s);
+            break;
+        }
+        default: {
+            int ix = _as_int(x), iy = _as_int(y);
+            cmp = (ix > iy) - (ix < iy);
+        }
+    }
+
+    switch (op) {
+        case TAC_EQ: return !cmp;
+        case TAC_NE: return cmp;
+        case TAC_LT: return cmp < 0;
+        case TAC_LE: return cmp <= 0;
+        case TAC_GT: return cmp > 0;
+        default: return cmp >= 0;
+    }
+}
+
+struct Value value_compute(enum TacOpCode op, enum TacType type, struct Value *x, struct Value *y) {
+    struct Value r = {.type = type};
+    if (op <= TAC_GE) {
+        r.type = TAC_TYPE_BOOL;
+        r.b = value_compare(op, type, x, y);
+        return r;
+    }
+
+    switch (type) {
+        case TAC_TYPE_FLOAT: {
+            float fx = _as_float(x), fy = op == TAC_NOT ? 0 : _as_float(y);
+            switch (op) {
+                case TAC_ADD: r.f = fx + fy; break;
+                case TAC_SUB: r.f = fx - fy; break;
+                case TAC_MUL: r.f = fx * fy; break;
+                case TAC_QUO: r.f = fx / fy; break;
+                default: runtime_error("illegal operation on float");
+            }
+            return r;
+        }
+        case TAC_TYPE_BOOL: {
+            bool bx = _as_bool(x), by = op == TAC_NOT ? false : _as_bool(y);
+            switch (op) {
+                case TAC_AND: r.b = bx && by; break;
+                case TAC_OR: r.b = bx || by; break;
+                case TAC_XOR: r.b = bx != by; break;
+                case TAC_NOT: r.b = !bx; break;
+                default: runtime_error("illegal operation on bool");
+            }
+            return r;
+        }
+        case TAC_TYPE_STRING: runtime_error("illegal operation on string");
+        default: break;
+    }
+
+    // int & char, wrap around instead of overflowing
+    int      ix = _as_int(x), iy = op == TAC_NOT ? 0 : _as_int(y);
+    unsigned ux = ix, uy = iy;
+    switch (op) {
+        case TAC_ADD: r.i = (int)(ux + uy); break;
+        case TAC_SUB: r.i = (int)(ux - uy); break;
+        case TAC_MUL: r.i = (int)(ux * uy); break;
+        case TAC_QUO:
+        case TAC_REM: {
+            if (!iy) runtime_error("division by zero");
+            if (ix == -2147483647 - 1 && iy == -1) r.i = op == TAC_QUO ? ix : 0;
+            else r.i = op == TAC_QUO ? ix / iy : ix % iy;
+            break;
+        }
+        case TAC_AND: r.i = ix & iy; break;
+        case TAC_OR: r.i = ix | iy; break;
+        case TAC_XOR: r.i = ix ^ iy; break;
+        case TAC_SHL: r.i = (int)(ux << (iy & 31)); break;
+        case TAC_SHR: r.i = ix >> (iy & 31); break;
+        case TAC_NOT: r.i = ~ix; break;
+        default: runtime_error("illegal operation");
+    }
+    return r;
+}
+
+static struct Value *_operand(struct Interp *interp, struct Frame *frame, struct Operand *o) {
+    switch (o->kind) {
+        case OPERAND_LIT: return &o->lit;
+        case OPERAND_LOCAL: return &frame->slots[o->index];
+        case OPERAND_OUTER: {
+            struct Frame *outer = interp->cur_frames[o->func];
+            if (!outer) runtime_error("var of a func not running");
+            return &outer->slots[o->index];
+        }
+        case OPERAND_ARG: {
+            if (o->index >= frame->argc) runtime_error("missing argument");
+            return &frame->args[o->index];
+        }
+        default: runtime_error("missing operand");
+    }
+    return NULL;
+}
+
+static struct Frame *_push_frame(struct Interp *interp, int func, int argc) {
+    struct InterpFunc *f = &interp->funcs[func];
+    if (interp->depth == INTERP_MAX_CALL_DEPTH) runtime_error("call stack overflow");
+    if (interp->sp + f->slot_size > INTERP_STACK_SIZE) runtime_error("value stack overflow");
+
+    struct Frame *frame = &interp->frames[interp->depth++];
+    frame->func = func;
+    frame->argc = argc;
+    frame->args = interp->stack + interp->sp - argc;
+    frame->slots = interp->stack + interp->sp;
+    memset(frame->slots, 0, f->slot_size * sizeof(struct Value));
+    interp->sp += f->slot_size;
+    frame->outer = interp->cur_frames[func];
+    interp->cur_frames[func] = frame;
+    if (trace_enabled) trace_begin(f->name ? f->name : "top level", "call");
+    return frame;
+}
+
+void interp_run(struct Interp *interp) {
+    if (!interp->stack) {
+        interp->stack = malloc(INTERP_STACK_SIZE * sizeof(struct Value));
+        interp->frames = malloc(INTERP_MAX_CALL_DEPTH * sizeof(struct Frame));
+        interp->cur_frames = malloc(interp->func_size * sizeof(struct Frame *));
+        if (!interp->stack || !interp->frames || !interp->cur_frames) {
+            fprintf(stderr, "interp_run(), no enough memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memset(interp->cur_frames, 0, interp->func_size * sizeof(struct Frame *));
+    interp->sp = 0;
+    interp->depth = 0;
+    interp->executed = 0;
+
+    struct Frame *frame = _push_frame(interp, 0, 0);
+    struct Instr *instrs = interp->instrs;
+    int           ip = 0;
+    long          executed = 0;
+    while (ip < interp->instr_size) {
+        struct Instr *instr = &instrs[ip++];
+        executed++;
+        switch (instr->op) {
+            case TAC_MOV: {
+                struct Value *y = _operand(interp, frame, &instr->y);
+                *_operand(interp, frame, &instr->x) = value_convert(y, instr->type);
+                break;
+            }
+            case TAC_JMP: ip = instr->target; break;
+            case TAC_JE:
+            case TAC_JNE:
+            case TAC_JLT:
+            case TAC_JLE:
+            case TAC_JGT:
+            case TAC_JGE: {
+                struct Value *x = _operand(interp, frame, &instr->x);
+                struct Value *y = _operand(interp, frame, &instr->y);
+                enum TacType  type = instr->type ? instr->type : x->type;
+                if (value_compare(instr->op - TAC_JE + TAC_EQ, type, x, y)) ip = instr->target;
+                break;
+            }
+            case TAC_PARAM: {
+                if (interp->sp == INTERP_STACK_SIZE) runtime_error("value stack overflow");
+                interp->stack[interp->sp++] = *_operand(interp, frame, &instr->x);
+                break;
+            }
+            case TAC_CALL: {
+                struct Value ret;
+                int          argc = instr->y.lit.i;
+                // spans of native calls are written by jit_call
+                if (interp->jit && jit_call(interp->jit, instr->target, interp->stack + interp->sp - argc, argc, &ret)) {
+                    interp->sp -= argc;
+                    if (instr->res.kind != OPERAND_NONE) *_operand(interp, frame, &instr->res) = value_convert(&ret, instr->type);
+                    break;
+                }
+
+                frame = _push_frame(interp, instr->target, argc);
+                frame->ret_ip = ip;
+                frame->call = instr;
+                ip = interp->funcs[instr->target].entry;
+                break;
+            }
+            case TAC_RET: {
+                // the top level code never returns
+                if (interp->depth == 1) {
+                    ip = interp->instr_size;
+                    break;
+                }
+
+                struct Value ret = {0};
+                if (instr->x.kind != OPERAND_NONE) ret = *_operand(interp, frame, &instr->x);
+
+                // pop slots & params of the frame
+                struct Frame *callee = frame;
+                if (trace_enabled) trace_end();
+                interp->cur_frames[callee->func] = callee->outer;
+                interp->sp = callee->args - interp->stack;
+                frame = &interp->frames[--interp->depth - 1];
+                ip = callee->ret_ip;
+                if (callee->call->res.kind != OPERAND_NONE) *_operand(interp, frame, &callee->call->res) = value_convert(&ret, callee->call->type);
+                break;
+            }
+            default: {
+                struct Value *x = _operand(interp, frame, &instr->x);
+                struct Value *y = instr->y.kind == OPERAND_NONE ? x : _operand(interp, frame, &instr->y);
+                enum TacType  type = instr->type ? instr->type : x->type;
+                *_operand(interp, frame, &instr->res) = value_compute(instr->op, type, x, y);
+            }
+        }
+    }
+    // the top level code
+    if (trace_enabled) trace_end();
+    interp->executed = executed;
+}
+
+void print_value(struct Value *v) {
+    switch (v->type) {
+        case TAC_TYPE_FLOAT: printf("%g", v->f); break;
+        case TAC_TYPE_BOOL: printf("%s", v->b ? "true" : "false"); break;
+        case TAC_TYPE_CHAR: printf("'%c'", v->i); break;
+        case TAC_TYPE_STRING: printf("\"%s\"", v->s); break;
+        default: printf("%d", v->i);
+    }
+}
+
+void print_interp_globals(struct Interp *interp) {
+    if (!interp->stack) return;
+
+    struct InterpFunc *top = &interp->funcs[0];
+    for (int i = 0; i < top->slot_size; i++) {
+        if (is_temp_var(top->slots[i])) continue;
+
+        printf("%s = ", unpack_name(top->slots[i]));
+        print_value(&interp->stack[i]);
+        printf("\n");
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef INTERP_H
+#define INTERP_H
+
+#include "ir.h"
+#include "arena.h"
+#include "c_hashmap.h"
+
+#define INTERP_MAX_CALL_DEPTH 10000
+#define INTERP_STACK_SIZE (1 << 20) // value slots shared by frames & pending params
+
+// typed value slot, char is kept in i
+struct Value {
+    enum TacType type;
+    union {
+        int   i;
+        float f;
+        bool  b;
+        char *s;
+    };
+};
+
+enum OperandKind {
+    OPERAND_NONE,
+    OPERAND_LIT,
+    OPERAND_LOCAL, // slot of the running frame
+    OPERAND_OUTER, // slot of the latest frame of an enclosing func
+    OPERAND_ARG,   // argument of the running frame
+};
+
+struct Operand {
+    enum OperandKind kind;
+    int              func;  // owner func of OPERAND_OUTER
+    int              index; // slot or argument index
+    struct Value     lit;
+};
+
+/*
+ * TAC resolved for execution, labels are dropped and jumps hold the index of their target.
+ * LABEL S#f becomes a JMP over the func body, LABEL E#f becomes a RET without value.
+ */
+struct Instr {
+    enum TacOpCode op;
+    enum TacType   type;
+    struct Operand x;
+    struct Operand y;
+    struct Operand res;
+    int            target;    // instr index for jumps, func index for CALL
+    int            tac_index; // index of the tac in the tac list, the head is 0
+};
+
+struct InterpFunc {
+    char  *name;      // NULL for the top level code
+    int    entry;     // first instr of the body
+    int    end;       // instr right after the body
+    char **slots;     // var names of slots
+    int    slot_size;
+    int    slot_cap;
+};
+
+struct Frame {
+    int           func;
+    struct Value *slots;
+    struct Value *args;
+    int           argc;
+    int           ret_ip;
+    struct Instr *call;  // CALL instr which creates the frame
+    struct Frame *outer; // previous frame of the same func, restored on return
+};
+
+struct Interp {
+    struct Arena *arena; // owns names & string literals
+
+    struct Instr      *instrs;
+    int                instr_size;
+    int                instr_cap;
+    struct InterpFunc *funcs; // funcs[0] is the top level code
+    int                func_size;
+    int                func_cap;
+
+    hashmap label_map; // label name -> instr index
+    hashmap func_map;  // func name -> func index
+    hashmap var_map;   // var name -> owner func & slot
+
+    // runtime
+    struct Value  *stack;
+    int            sp;
+    struct Frame  *frames;
+    int            depth;
+    struct Frame **cur_frames; // latest frame of each func, NULL if not running
+    long           executed;   // instrs executed by the last run
+
+    struct Jit *jit; // tiered mode, hot funcs are run as machine code, NULL to only interpret
+};
+
+// resolve labels, funcs & vars of the tac list, tac is not referred after that
+struct Interp *create_interp(struct TAC *tac);
+void           free_interp(struct Interp *interp);
+// owner func & slot of a var, false if the var is unknown
+bool           interp_lookup_var(struct Interp *interp, char *name, int *func, int *slot);
+// run the top level code till its end
+void           interp_run(struct Interp *interp);
+// print vars of the top level code after running
+void           print_interp_globals(struct Interp *interp);
+
+// typed operations on values, shared by the interpreter & the bytecode vm
+struct Value value_convert(struct Value *v, enum TacType type);
+bool         value_compare(enum TacOpCode op, enum TacType type, struct Value *x, struct Value *y);
+struct Value value_compute(enum TacOpCode op, enum TacType type, struct Value *x, struct Value *y);
+void         print_value(struct Value *v);
+// print msg & exit
+void         runtime_error(char *msg);
+
+#endif
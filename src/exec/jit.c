@@ -0,0 +1,589 @@
+#include "jit.h"
+#include "global.h"
+#include "trace.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+enum JitReg { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+// condition codes of jcc & setcc
+enum JitCond { CC_E = 0x4, CC_NE = 0x5, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF };
+
+static enum JitCond int_conds[] = {CC_E, CC_NE, CC_L, CC_LE, CC_G, CC_GE};
+
+// jump targets besides instrs
+#define JIT_TARGET_RET -1
+#define JIT_TARGET_DIV_ZERO -2
+#define JIT_TARGET_OVERFLOW -3
+#define JIT_TARGET_ILLEGAL -4
+
+// rbx, r12 & r13 are pushed under rbp
+#define JIT_SAVED_SIZE 24
+
+struct JitFixup {
+    int at;     // offset of the rel32
+    int target; // instr index or JIT_TARGET_*
+};
+
+struct JitBuf {
+    uint8_t *code;
+    int      size;
+    int      cap;
+
+    struct JitFixup *fixups;
+    int              fixup_size;
+    int              fixup_cap;
+};
+
+// state of the func being compiled
+struct JitCtx {
+    struct Jit    *jit;
+    struct JitBuf *buf;
+    int            func;
+    int           *offsets; // code offset of each instr of the func, by instr - entry
+    int            depth;   // params stored, not passed yet
+    int            stubs[4];
+};
+
+static void *_jit_alloc(size_t size) {
+    void *p = calloc(1, size ? size : 1);
+    if (!p) {
+        fprintf(stderr, "create_jit(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+// ---------------------Encoding---------------------
+
+static void _byte(struct JitBuf *b, uint8_t x) {
+    if (b->size == b->cap) {
+        b->cap = b->cap ? b->cap << 1 : 4096;
+        b->code = realloc(b->code, b->cap);
+        if (!b->code) {
+            fprintf(stderr, "_byte(), no enough memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    b->code[b->size++] = x;
+}
+
+static void _int32(struct JitBuf *b, int32_t x) {
+    for (int k = 0; k < 4; k++) _byte(b, (uint32_t)x >> 8 * k);
+}
+
+static void _int64(struct JitBuf *b, int64_t x) {
+    for (int k = 0; k < 8; k++) _byte(b, (uint64_t)x >> 8 * k);
+}
+
+static void _rex(struct JitBuf *b, bool w, int reg, int rm) {
+    uint8_t rex = 0x40 | (w ? 8 : 0) | (reg & 8 ? 4 : 0) | (rm & 8 ? 1 : 0);
+    if (rex != 0x40) _byte(b, rex);
+}
+
+// op reg, [base + disp32]
+static void _op_mem(struct JitBuf *b, bool w, uint8_t op, int reg, int base, int disp) {
+    _rex(b, w, reg, base);
+    _byte(b, op);
+    _byte(b, 0x80 | (reg & 7) << 3 | (base & 7));
+    // rsp & r12 as base need a sib byte
+    if ((base & 7) == RSP) _byte(b, 0x24);
+    _int32(b, disp);
+}
+
+// op reg, rm of registers
+static void _op_reg(struct JitBuf *b, bool w, uint8_t op, int reg, int rm) {
+    _rex(b, w, reg, rm);
+    _byte(b, op);
+    _byte(b, 0xC0 | (reg & 7) << 3 | (rm & 7));
+}
+
+// two bytes opcode 0F op
+static void _op2_reg(struct JitBuf *b, uint8_t op, int reg, int rm) {
+    _rex(b, false, reg, rm);
+    _byte(b, 0x0F);
+    _byte(b, op);
+    _byte(b, 0xC0 | (reg & 7) << 3 | (rm & 7));
+}
+
+static void _push(struct JitBuf *b, int reg) {
+    _rex(b, false, 0, reg);
+    _byte(b, 0x50 | (reg & 7));
+}
+
+static void _pop(struct JitBuf *b, int reg) {
+    _rex(b, false, 0, reg);
+    _byte(b, 0x58 | (reg & 7));
+}
+
+static void _mov_imm32(struct JitBuf *b, int reg, int32_t imm) {
+    _rex(b, false, 0, reg);
+    _byte(b, 0xB8 | (reg & 7));
+    _int32(b, imm);
+}
+
+static void _mov_imm64(struct JitBuf *b, int reg, int64_t imm) {
+    _rex(b, true, 0, reg);
+    _byte(b, 0xB8 | (reg & 7));
+    _int64(b, imm);
+}
+
+static void _jump(struct JitBuf *b, int target) {
+    if (b->fixup_size == b->fixup_cap) {
+        b->fixup_cap = b->fixup_cap ? b->fixup_cap << 1 : 64;
+        b->fixups = realloc(b->fixups, b->fixup_cap * sizeof(struct JitFixup));
+        if (!b->fixups) {
+            fprintf(stderr, "_jump(), no enough memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    b->fixups[b->fixup_size++] = (struct JitFixup){.at = b->size, .target = target};
+    _int32(b, 0);
+}
+
+static void _jmp(struct JitBuf *b, int target) {
+    _byte(b, 0xE9);
+    _jump(b, target);
+}
+
+static void _jcc(struct JitBuf *b, enum JitCond cc, int target) {
+    _byte(b, 0x0F);
+    _byte(b, 0x80 | cc);
+    _jump(b, target);
+}
+
+// eax = cc ? 1 : 0
+static void _setcc(struct JitBuf *b, enum JitCond cc) {
+    _op2_reg(b, 0x90 | cc, 0, RAX);
+    _op2_reg(b, 0xB6, RAX, RAX);
+}
+
+// eax = eax != 0, bool of an int
+static void _normalize(struct JitBuf *b) {
+    _op_reg(b, false, 0x85, RAX, RAX);
+    _setcc(b, CC_NE);
+}
+
+// ---------------------Checking---------------------
+
+static bool _int_like(enum TacType type) {
+    return type == TAC_TYPE_INT || type == TAC_TYPE_BOOL || type == TAC_TYPE_CHAR;
+}
+
+static bool _operand_ok(struct Operand *o) {
+    switch (o->kind) {
+        case OPERAND_NONE:
+        case OPERAND_LOCAL:
+        case OPERAND_ARG: return true;
+        case OPERAND_LIT: return _int_like(o->lit.type);
+        default: return false;
+    }
+}
+
+// the body uses only int-like values of its own frame, params & return type are found on the way
+static bool _check_func(struct Jit *jit, int func) {
+    struct Interp     *interp = jit->interp;
+    struct InterpFunc *f = &interp->funcs[func];
+    struct JitFunc    *jf = &jit->funcs[func];
+
+    // enclosing funcs publish their frames for nested funcs, the interpreter does it
+    for (int g = 1; g < interp->func_size; g++)
+        if (interp->funcs[g].entry > f->entry && interp->funcs[g].entry < f->end) return false;
+
+    for (int i = f->entry; i < f->end; i++) {
+        struct Instr *instr = &interp->instrs[i];
+        if (!_operand_ok(&instr->x) || !_operand_ok(&instr->y) || !_operand_ok(&instr->res)) return false;
+        for (int k = 0; k < 3; k++) {
+            struct Operand *o = k == 0 ? &instr->x : k == 1 ? &instr->y : &instr->res;
+            if (o->kind == OPERAND_ARG && o->index >= jf->param_size) jf->param_size = o->index + 1;
+        }
+
+        switch (instr->op) {
+            case TAC_JMP: break;
+            case TAC_CALL: {
+                if (instr->res.kind != OPERAND_NONE && !_int_like(instr->type)) return false;
+                break;
+            }
+            case TAC_RET: {
+                if (instr->x.kind == OPERAND_NONE) break;
+                if (!_int_like(instr->type) || (jf->ret_type && jf->ret_type != instr->type)) return false;
+                jf->ret_type = instr->type;
+                break;
+            }
+            default: {
+                if (!_int_like(instr->type)) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// func & the cold funcs it calls, transitively, in order
+static int _collect(struct Jit *jit, int func, int *list) {
+    struct Interp *interp = jit->interp;
+    bool          *seen = _jit_alloc(interp->func_size * sizeof(bool));
+    int            size = 0;
+    list[size++] = func;
+    seen[func] = true;
+    for (int k = 0; k < size; k++) {
+        struct InterpFunc *f = &interp->funcs[list[k]];
+        for (int i = f->entry; i < f->end; i++) {
+            struct Instr *instr = &interp->instrs[i];
+            if (instr->op != TAC_CALL || seen[instr->target] || jit->funcs[instr->target].state == JIT_NATIVE) continue;
+            seen[instr->target] = true;
+            list[size++] = instr->target;
+        }
+    }
+    free(seen);
+    return size;
+}
+
+// ---------------------Emitting---------------------
+
+static int _slot_disp(int slot) {
+    return -(JIT_SAVED_SIZE + 8 * (slot + 1));
+}
+
+static void _load(struct JitCtx *ctx, int reg, struct Operand *o) {
+    switch (o->kind) {
+        case OPERAND_LIT: {
+            struct Value v = value_convert(&o->lit, TAC_TYPE_INT);
+            _mov_imm32(ctx->buf, reg, v.i);
+            break;
+        }
+        case OPERAND_LOCAL: _op_mem(ctx->buf, false, 0x8B, reg, RBP, _slot_disp(o->index)); break;
+        case OPERAND_ARG: _op_mem(ctx->buf, false, 0x8B, reg, RBX, 4 * o->index); break;
+        default: _mov_imm32(ctx->buf, reg, 0);
+    }
+}
+
+static void _store(struct JitCtx *ctx, struct Operand *o) {
+    if (o->kind == OPERAND_LOCAL) _op_mem(ctx->buf, false, 0x89, RAX, RBP, _slot_disp(o->index));
+}
+
+// eax = eax op ecx, wraps around like the interpreter
+static void _emit_int_op(struct JitCtx *ctx, enum TacOpCode op) {
+    struct JitBuf *b = ctx->buf;
+    switch (op) {
+        case TAC_ADD: _op_reg(b, false, 0x01, RCX, RAX); break;
+        case TAC_SUB: _op_reg(b, false, 0x29, RCX, RAX); break;
+        case TAC_MUL: _op2_reg(b, 0xAF, RAX, RCX); break;
+        case TAC_QUO:
+        case TAC_REM: {
+            // INT_MIN / -1 traps on idiv, the quotient is INT_MIN & the remainder 0
+            _op_reg(b, false, 0x85, RCX, RCX);
+            _jcc(b, CC_E, JIT_TARGET_DIV_ZERO);
+            _op_reg(b, false, 0x83, 7, RCX);
+            _byte(b, 0xFF);
+            _byte(b, 0x75); // jne rel8 to idiv
+            _byte(b, 4);
+            if (op == TAC_QUO) _op_reg(b, false, 0xF7, 3, RAX); // neg eax
+            else _op_reg(b, false, 0x31, RAX, RAX);
+            _byte(b, 0xEB); // jmp rel8 over idiv
+            _byte(b, op == TAC_QUO ? 3 : 5);
+            _byte(b, 0x99); // cltd
+            _op_reg(b, false, 0xF7, 7, RCX);
+            if (op == TAC_REM) _op_reg(b, false, 0x89, RDX, RAX);
+            break;
+        }
+        case TAC_AND: _op_reg(b, false, 0x21, RCX, RAX); break;
+        case TAC_OR: _op_reg(b, false, 0x09, RCX, RAX); break;
+        case TAC_XOR: _op_reg(b, false, 0x31, RCX, RAX); break;
+        case TAC_SHL: _op_reg(b, false, 0xD3, 4, RAX); break;
+        case TAC_SHR: _op_reg(b, false, 0xD3, 7, RAX); break;
+        case TAC_NOT: _op_reg(b, false, 0xF7, 2, RAX); break;
+        default: _jmp(b, JIT_TARGET_ILLEGAL);
+    }
+}
+
+static void _emit_bool_op(struct JitCtx *ctx, enum TacOpCode op) {
+    struct JitBuf *b = ctx->buf;
+    switch (op) {
+        case TAC_AND: _op_reg(b, false, 0x21, RCX, RAX); break;
+        case TAC_OR: _op_reg(b, false, 0x09, RCX, RAX); break;
+        case TAC_XOR: _op_reg(b, false, 0x31, RCX, RAX); break;
+        case TAC_NOT: {
+            _op_reg(b, false, 0x83, 6, RAX);
+            _byte(b, 1);
+            break;
+        }
+        default: _jmp(b, JIT_TARGET_ILLEGAL);
+    }
+}
+
+static void _emit_call(struct JitCtx *ctx, struct Instr *instr) {
+    struct JitBuf *b = ctx->buf;
+    int            first = ctx->depth - instr->y.lit.i;
+    _op_mem(b, true, 0x8D, RDI, RSP, 4 * first);
+    _op_reg(b, true, 0x89, R12, RSI);
+    _op_reg(b, true, 0x89, R13, RDX);
+    // call *entries[func]
+    _op_mem(b, false, 0xFF, 2, R13, 8 * instr->target);
+    ctx->depth = first;
+
+    if (instr->res.kind == OPERAND_NONE) return;
+    if (instr->type == TAC_TYPE_BOOL) _normalize(b);
+    _store(ctx, &instr->res);
+}
+
+static void _emit_instr(struct JitCtx *ctx, struct Instr *instr) {
+    struct JitBuf *b = ctx->buf;
+    switch (instr->op) {
+        case TAC_MOV: {
+            _load(ctx, RAX, &instr->y);
+            if (instr->type == TAC_TYPE_BOOL) _normalize(b);
+            _store(ctx, &instr->x);
+            break;
+        }
+        case TAC_JMP: _jmp(b, instr->target); break;
+        case TAC_JE:
+        case TAC_JNE:
+        case TAC_JLT:
+        case TAC_JLE:
+        case TAC_JGT:
+        case TAC_JGE: {
+            _load(ctx, RCX, &instr->y);
+            _load(ctx, RAX, &instr->x);
+            _op_reg(b, false, 0x39, RCX, RAX);
+            _jcc(b, int_conds[instr->op - TAC_JE], instr->target);
+            break;
+        }
+        case TAC_PARAM: {
+            _load(ctx, RAX, &instr->x);
+            _op_mem(b, false, 0x89, RAX, RSP, 4 * ctx->depth++);
+            break;
+        }
+        case TAC_CALL: _emit_call(ctx, instr); break;
+        case TAC_RET: {
+            _load(ctx, RAX, &instr->x);
+            _jmp(b, JIT_TARGET_RET);
+            break;
+        }
+        default: {
+            _load(ctx, RCX, instr->y.kind == OPERAND_NONE ? &instr->x : &instr->y);
+            _load(ctx, RAX, &instr->x);
+            if (instr->op <= TAC_GE) {
+                _op_reg(b, false, 0x39, RCX, RAX);
+                _setcc(b, int_conds[instr->op]);
+            } else if (instr->type == TAC_TYPE_BOOL) _emit_bool_op(ctx, instr->op);
+            else _emit_int_op(ctx, instr->op);
+            _store(ctx, &instr->res);
+        }
+    }
+}
+
+// runtime error of a stub, the stack is aligned at every jump to it
+static void _emit_error(struct JitBuf *b, char *msg) {
+    _mov_imm64(b, RDI, (int64_t)(intptr_t)msg);
+    _mov_imm64(b, RAX, (int64_t)(intptr_t)runtime_error);
+    _op_reg(b, false, 0xFF, 2, RAX);
+}
+
+static void _emit_func(struct JitCtx *ctx) {
+    struct Interp     *interp = ctx->jit->interp;
+    struct InterpFunc *f = &interp->funcs[ctx->func];
+    struct JitBuf     *b = ctx->buf;
+
+    // pending params are an int array at rsp, passed to the callee
+    int max_pending = 0;
+    for (int i = f->entry, depth = 0; i < f->end; i++) {
+        if (interp->instrs[i].op == TAC_PARAM && ++depth > max_pending) max_pending = depth;
+        if (interp->instrs[i].op == TAC_CALL) depth -= interp->instrs[i].y.lit.i;
+    }
+    int frame = (JIT_SAVED_SIZE + 8 * f->slot_size + 8 * ((max_pending + 1) / 2) + 15) & ~15;
+    int depth_disp = offsetof(struct Interp, depth);
+
+    _push(b, RBP);
+    _op_reg(b, true, 0x89, RSP, RBP);
+    _push(b, RBX);
+    _push(b, R12);
+    _push(b, R13);
+    _op_reg(b, true, 0x81, 5, RSP);
+    _int32(b, frame - JIT_SAVED_SIZE);
+    _op_reg(b, true, 0x89, RDI, RBX);
+    _op_reg(b, true, 0x89, RSI, R12);
+    _op_reg(b, true, 0x89, RDX, R13);
+
+    // machine code frames are counted in the call depth of the interpreter
+    _op_mem(b, false, 0x81, 7, R12, depth_disp);
+    _int32(b, INTERP_MAX_CALL_DEPTH);
+    _jcc(b, CC_GE, JIT_TARGET_OVERFLOW);
+    _op_mem(b, false, 0xFF, 0, R12, depth_disp);
+    for (int s = 0; s < f->slot_size; s++) {
+        _op_mem(b, true, 0xC7, 0, RBP, _slot_disp(s));
+        _int32(b, 0);
+    }
+
+    ctx->depth = 0;
+    for (int i = f->entry; i < f->end; i++) {
+        ctx->offsets[i - f->entry] = b->size;
+        _emit_instr(ctx, &interp->instrs[i]);
+    }
+
+    ctx->stubs[-JIT_TARGET_RET - 1] = b->size;
+    _op_mem(b, false, 0xFF, 1, R12, depth_disp);
+    _op_mem(b, true, 0x8D, RSP, RBP, -JIT_SAVED_SIZE);
+    _pop(b, R13);
+    _pop(b, R12);
+    _pop(b, RBX);
+    _pop(b, RBP);
+    _byte(b, 0xC3);
+
+    ctx->stubs[-JIT_TARGET_DIV_ZERO - 1] = b->size;
+    _emit_error(b, "division by zero");
+    ctx->stubs[-JIT_TARGET_OVERFLOW - 1] = b->size;
+    _emit_error(b, "call stack overflow");
+    ctx->stubs[-JIT_TARGET_ILLEGAL - 1] = b->size;
+    _emit_error(b, "illegal operation on bool");
+
+    // jumps of the func
+    for (int k = 0; k < b->fixup_size; k++) {
+        struct JitFixup *fix = &b->fixups[k];
+        int              to = fix->target < 0 ? ctx->stubs[-fix->target - 1] : ctx->offsets[fix->target - f->entry];
+        int32_t          rel = to - (fix->at + 4);
+        memcpy(b->code + fix->at, &rel, sizeof(rel));
+    }
+    b->fixup_size = 0;
+}
+
+// compile func & the cold funcs it calls into one region, false if any of them can not be compiled
+static bool _compile(struct Jit *jit, int func) {
+    struct Interp *interp = jit->interp;
+    int           *list = _jit_alloc(interp->func_size * sizeof(int));
+    int            size = _collect(jit, func, list);
+
+    bool ok = true;
+    for (int k = 0; k < size && ok; k++) {
+        struct JitFunc *jf = &jit->funcs[list[k]];
+        if (jf->state == JIT_REJECTED || !_check_func(jit, list[k])) {
+            jf->state = JIT_REJECTED;
+            ok = false;
+        }
+    }
+    // calls must pass the args the callee reads
+    for (int k = 0; k < size && ok; k++) {
+        struct InterpFunc *f = &interp->funcs[list[k]];
+        for (int i = f->entry; i < f->end; i++) {
+            struct Instr *instr = &interp->instrs[i];
+            if (instr->op == TAC_CALL && instr->y.lit.i < jit->funcs[instr->target].param_size) ok = false;
+        }
+    }
+    if (!ok) {
+        jit->funcs[func].state = JIT_REJECTED;
+        free(list);
+        return false;
+    }
+
+    struct JitBuf buf = {0};
+    int          *starts = _jit_alloc(size * sizeof(int));
+    for (int k = 0; k < size; k++) {
+        struct InterpFunc *f = &interp->funcs[list[k]];
+        struct JitCtx      ctx = {.jit = jit, .buf = &buf, .func = list[k]};
+        ctx.offsets = _jit_alloc((f->end - f->entry) * sizeof(int));
+
+        // 16-byte aligned entries
+        while (buf.size & 15) _byte(&buf, 0xCC);
+        starts[k] = buf.size;
+        _emit_func(&ctx);
+        jit->funcs[list[k]].code_size = buf.size - starts[k];
+        free(ctx.offsets);
+    }
+
+    void *addr = mmap(NULL, buf.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        fprintf(stderr, "jit_call(), can not map memory\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(addr, buf.code, buf.size);
+    // never writable & executable at once
+    if (mprotect(addr, buf.size, PROT_READ | PROT_EXEC)) {
+        fprintf(stderr, "jit_call(), can not make memory executable\n");
+        exit(EXIT_FAILURE);
+    }
+
+    struct JitRegion *region = _jit_alloc(sizeof(struct JitRegion));
+    region->addr = addr;
+    region->size = buf.size;
+    region->next = jit->regions;
+    jit->regions = region;
+    for (int k = 0; k < size; k++) {
+        jit->entries[list[k]] = (uint8_t *)addr + starts[k];
+        jit->funcs[list[k]].state = JIT_NATIVE;
+    }
+
+    free(buf.code);
+    free(buf.fixups);
+    free(starts);
+    free(list);
+    return true;
+}
+
+// ---------------------Running---------------------
+
+struct Jit *create_jit(struct Interp *interp, int threshold) {
+    struct Jit *jit = CREATE_STRUCT_P(Jit);
+    if (!jit) {
+        fprintf(stderr, "create_jit(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    jit->interp = interp;
+    jit->threshold = threshold;
+    jit->funcs = _jit_alloc(interp->func_size * sizeof(struct JitFunc));
+    jit->entries = _jit_alloc(interp->func_size * sizeof(void *));
+    // the top level code is run once
+    jit->funcs[0].state = JIT_REJECTED;
+    return jit;
+}
+
+void free_jit(struct Jit *jit) {
+    if (!jit) return;
+    for (struct JitRegion *region = jit->regions, *next; region; region = next) {
+        next = region->next;
+        munmap(region->addr, region->size);
+        free(region);
+    }
+    free(jit->funcs);
+    free(jit->entries);
+    free(jit);
+}
+
+bool jit_call(struct Jit *jit, int func, struct Value *args, int argc, struct Value *ret) {
+    struct JitFunc *jf = &jit->funcs[func];
+    if (jf->state == JIT_REJECTED) return false;
+    if (jf->state == JIT_COLD && (++jf->calls < jit->threshold || !_compile(jit, func))) return false;
+    if (argc < jf->param_size) return false;
+
+    // args of other types are left to the interpreter
+    int values[argc + 1];
+    for (int k = 0; k < argc; k++) {
+        switch (args[k].type) {
+            case TAC_TYPE_FLOAT:
+            case TAC_TYPE_STRING: return false;
+            case TAC_TYPE_BOOL: values[k] = args[k].b; break;
+            default: values[k] = args[k].i;
+        }
+    }
+
+    // native code calls native code directly, only the call entering it is traced
+    if (trace_enabled) trace_begin(jit->interp->funcs[func].name, "jit");
+    int r = ((JitCode)jit->entries[func])(values, jit->interp, jit->entries);
+    if (trace_enabled) trace_end();
+    jf->native_calls++;
+    *ret = (struct Value){.type = jf->ret_type};
+    if (jf->ret_type == TAC_TYPE_BOOL) ret->b = r;
+    else ret->i = r;
+    return true;
+}
+
+void print_jit_stats(struct Jit *jit) {
+    printf("%-16s %-8s %10s %12s %8s\n", "func", "state", "calls", "native calls", "bytes");
+    for (int f = 1; f < jit->interp->func_size; f++) {
+        struct JitFunc *jf = &jit->funcs[f];
+        char           *state = jf->state == JIT_NATIVE ? "native" : jf->state == JIT_REJECTED ? "rejected" : "cold";
+        printf("%-16s %-8s %10ld %12ld %8d\n", jit->interp->funcs[f].name, state, jf->calls, jf->native_calls, jf->code_size);
+    }
+}
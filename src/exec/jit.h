@@ -0,0 +1,54 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "interp.h"
+
+#include <stdint.h>
+
+#define JIT_HOT_CALLS 100 // calls from the interpreter before a func is compiled
+
+enum JitState {
+    JIT_COLD,     // interpreted, counting calls
+    JIT_NATIVE,   // compiled, calls run the machine code
+    JIT_REJECTED, // can not be compiled, always interpreted
+};
+
+// machine code of a func, args are the int values of the call
+typedef int (*JitCode)(int *args, struct Interp *interp, void **entries);
+
+struct JitFunc {
+    enum JitState state;
+    long          calls;        // calls from the interpreter
+    int           param_size;   // args read by the body
+    enum TacType  ret_type;     // type of returned values, TAC_TYPE_NONE if it returns nothing
+    int           code_size;
+    long          native_calls; // calls from the interpreter run as machine code
+};
+
+// executable memory mapped for one compilation
+struct JitRegion {
+    void             *addr;
+    size_t            size;
+    struct JitRegion *next;
+};
+
+/*
+ * Tiered execution: funcs start in the interpreter, a func called JIT_HOT_CALLS times is compiled
+ * with the funcs it calls into mmap'd memory, from the resolved TAC of its S#..E# body.
+ * Only funcs working on int, char & bool locals & args are compiled, vars of enclosing funcs are never accessed.
+ */
+struct Jit {
+    struct Interp    *interp;
+    int               threshold;
+    struct JitFunc   *funcs;   // the same order as interp->funcs
+    void            **entries; // machine code of each func, NULL if not compiled
+    struct JitRegion *regions;
+};
+
+struct Jit *create_jit(struct Interp *interp, int threshold);
+void        free_jit(struct Jit *jit);
+// called by the interpreter for each CALL, returns true if the func is run as machine code, with its return value in ret
+bool        jit_call(struct Jit *jit, int func, struct Value *args, int argc, struct Value *ret);
+void        print_jit_stats(struct Jit *jit);
+
+#endif
@@ -0,0 +1,110 @@
+#include "vm.h"
+#include "global.h"
+#include "ir_gen.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct VM *create_vm(struct Bytecode *bc) {
+    struct VM *vm = CREATE_STRUCT_P(VM);
+    if (!vm) {
+        fprintf(stderr, "create_vm(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    vm->bc = bc;
+    vm->dispatch = VM_COMPUTED_GOTO ? VM_DISPATCH_THREADED : VM_DISPATCH_SWITCH;
+    vm->stack = malloc(VM_STACK_SIZE * sizeof(struct Value));
+    vm->frames = malloc(VM_MAX_CALL_DEPTH * sizeof(struct VMFrame));
+    vm->cur_bases = malloc(bc->func_size * sizeof(struct Value *));
+    if (!vm->stack || !vm->frames || !vm->cur_bases) {
+        fprintf(stderr, "create_vm(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return vm;
+}
+
+void free_vm(struct VM *vm) {
+    if (!vm) return;
+
+    free(vm->stack);
+    free(vm->frames);
+    free(vm->cur_bases);
+    free(vm);
+}
+
+// args are already at base, the rest of the frame is cleared, constants stay in the pool
+static struct VMFrame *_push_frame(struct VM *vm, int func, struct Value *base, int argc) {
+    struct BcFunc *f = &vm->bc->funcs[func];
+    if (vm->depth == VM_MAX_CALL_DEPTH) runtime_error("call stack overflow");
+    if (base + f->frame_size > vm->stack + VM_STACK_SIZE) runtime_error("value stack overflow");
+
+    if (argc < f->frame_size) memset(base + argc, 0, (f->frame_size - argc) * sizeof(struct Value));
+
+    struct VMFrame *frame = &vm->frames[vm->depth++];
+    frame->func = func;
+    frame->base = base;
+    frame->outer = vm->cur_bases[func];
+    vm->cur_bases[func] = base;
+    if (trace_enabled) trace_begin(f->name ? f->name : "top level", "call");
+    return frame;
+}
+
+static struct Value *_outer(struct VM *vm, int ref) {
+    struct BcOuter *o = &vm->bc->outers[ref];
+    struct Value   *base = vm->cur_bases[o->func];
+    if (!base) runtime_error("var of a func not running");
+    return &base[o->reg];
+}
+
+#define VM_LOOP_NAME _run_switch
+#define VM_THREADED 0
+#define VM_PROFILE 0
+#include "vm_loop.h"
+#undef VM_LOOP_NAME
+#undef VM_PROFILE
+
+#define VM_LOOP_NAME _run_profile
+#define VM_PROFILE 1
+#include "vm_loop.h"
+#undef VM_LOOP_NAME
+#undef VM_THREADED
+#undef VM_PROFILE
+
+#if VM_COMPUTED_GOTO
+#define VM_LOOP_NAME _run_threaded
+#define VM_THREADED 1
+#define VM_PROFILE 0
+#include "vm_loop.h"
+#undef VM_LOOP_NAME
+#undef VM_THREADED
+#undef VM_PROFILE
+#endif
+
+void vm_run(struct VM *vm) {
+#if VM_COMPUTED_GOTO
+    if (vm->dispatch == VM_DISPATCH_THREADED) {
+        _run_threaded(vm);
+        return;
+    }
+#endif
+    _run_switch(vm);
+}
+
+void vm_profile(struct VM *vm) {
+    memset(vm->pair_counts, 0, sizeof(vm->pair_counts));
+    _run_profile(vm);
+}
+
+void print_vm_globals(struct VM *vm) {
+    struct InterpFunc *top = &vm->bc->interp->funcs[0];
+    struct BcFunc     *f = &vm->bc->funcs[0];
+    for (int i = 0; i < top->slot_size; i++) {
+        if (is_temp_var(top->slots[i])) continue;
+
+        printf("%s = ", unpack_name(top->slots[i]));
+        print_value(&vm->stack[f->var_regs[i]]);
+        printf("\n");
+    }
+}
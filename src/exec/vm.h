@@ -0,0 +1,52 @@
+#ifndef VM_H
+#define VM_H
+
+#include "bytecode.h"
+
+#define VM_MAX_CALL_DEPTH INTERP_MAX_CALL_DEPTH
+#define VM_STACK_SIZE INTERP_STACK_SIZE
+
+// direct threaded dispatch needs labels as values, a gcc extension
+#ifndef VM_COMPUTED_GOTO
+#ifdef __GNUC__
+#define VM_COMPUTED_GOTO 1
+#else
+#define VM_COMPUTED_GOTO 0
+#endif
+#endif
+
+enum VMDispatch {
+    VM_DISPATCH_SWITCH,
+    VM_DISPATCH_THREADED, // falls back to switch without VM_COMPUTED_GOTO
+};
+
+struct VMFrame {
+    int           func;
+    struct Value *base;   // R[0] of the frame
+    int           ret_pc; // word after the CALL of the caller
+    struct Value *outer;  // previous base of the same func, restored on return
+};
+
+struct VM {
+    struct Bytecode *bc;
+    enum VMDispatch  dispatch;
+
+    struct Value    *stack;
+    struct VMFrame  *frames;
+    int              depth;
+    struct Value   **cur_bases; // base of the latest frame of each func, NULL if not running
+    long             executed;  // words dispatched by the last run
+
+    long pair_counts[BC_OP_SIZE][BC_OP_SIZE]; // [x][y], times y is dispatched right after x, by vm_profile
+};
+
+struct VM *create_vm(struct Bytecode *bc);
+void       free_vm(struct VM *vm);
+// run the top level code till BC_HALT, by vm->dispatch
+void       vm_run(struct VM *vm);
+// run on the switch loop, counting pairs of instrs to select superinstructions
+void       vm_profile(struct VM *vm);
+// print vars of the top level code after running
+void       print_vm_globals(struct VM *vm);
+
+#endif
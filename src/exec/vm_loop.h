@@ -0,0 +1,360 @@
+/*
+ * Dispatch loop of the vm, included by vm.c once per variant with:
+ * VM_LOOP_NAME  name of the function
+ * VM_THREADED   1 for direct threaded dispatch by computed goto, 0 for switch
+ * VM_PROFILE    1 to count pairs of instrs dispatched one after another, switch only
+ */
+
+#define R(x) (base[x])
+#define K(x) (consts[x])
+#define A BC_A(i)
+#define B BC_B(i)
+#define C BC_C(i)
+
+#if VM_THREADED
+#define OP(name) op_##name:
+#define FUSED_OP(name) OP(name)
+// handler address of each word is resolved before running, so dispatching needs no decoding
+#define NEXT                                                                                                                               \
+    {                                                                                                                                      \
+        i = code[pc];                                                                                                                      \
+        executed++;                                                                                                                        \
+        goto *threaded[pc++];                                                                                                              \
+    }
+#else
+// only the handlers run by FUSED need a label, others would be unused
+#define OP(name) case BC_##name:
+#define FUSED_OP(name)                                                                                                                     \
+    case BC_##name:                                                                                                                        \
+        op_##name:
+#define NEXT continue
+#endif
+
+// int ops wrap around instead of overflowing
+#define INT_OP(y, expr)                                                                                                                    \
+    {                                                                                                                                      \
+        unsigned ub = R(B).i, uc = (y).i;                                                                                                  \
+        R(A).type = TAC_TYPE_INT;                                                                                                          \
+        R(A).i = (int)(expr);                                                                                                              \
+        NEXT;                                                                                                                              \
+    }
+#define INT_CMP(y, cmp)                                                                                                                    \
+    {                                                                                                                                      \
+        bool r = R(B).i cmp(y).i;                                                                                                          \
+        R(A).type = TAC_TYPE_BOOL;                                                                                                         \
+        R(A).b = r;                                                                                                                        \
+        NEXT;                                                                                                                              \
+    }
+#define FLOAT_OP(op)                                                                                                                       \
+    {                                                                                                                                      \
+        float r = R(B).f op R(C).f;                                                                                                        \
+        R(A).type = TAC_TYPE_FLOAT;                                                                                                        \
+        R(A).f = r;                                                                                                                        \
+        NEXT;                                                                                                                              \
+    }
+// skip the jump word after if the condition does not hold
+#define INT_JUMP(y, cmp)                                                                                                                   \
+    {                                                                                                                                      \
+        if (R(A).i cmp(y).i) pc += 1 + BC_SBX(code[pc]);                                                                                   \
+        else pc++;                                                                                                                         \
+        NEXT;                                                                                                                              \
+    }
+// run the second word of a superinstruction by its own handler, without dispatching
+#define FUSED(name)                                                                                                                        \
+    {                                                                                                                                      \
+        i = code[pc++];                                                                                                                    \
+        goto op_##name;                                                                                                                    \
+    }
+
+static void VM_LOOP_NAME(struct VM *vm) {
+    struct Bytecode *bc = vm->bc;
+    uint32_t        *code = bc->code;
+    memset(vm->cur_bases, 0, bc->func_size * sizeof(struct Value *));
+    vm->depth = 0;
+
+    struct VMFrame *frame = _push_frame(vm, 0, vm->stack, 0);
+    struct Value   *base = frame->base;
+    struct Value   *top = base + bc->funcs[0].frame_size; // pending args of the next call
+    struct Value   *consts = bc->funcs[0].consts;
+    int             pc = 0;
+    long            executed = 0;
+    uint32_t        i;
+
+#if VM_THREADED
+    static void *handlers[BC_OP_SIZE] = {
+        [BC_HALT] = &&op_HALT,              [BC_MOV] = &&op_MOV,                [BC_MOVT] = &&op_MOVT,              [BC_GETO] = &&op_GETO,
+        [BC_SETO] = &&op_SETO,              [BC_GETW] = &&op_GETW,              [BC_SETW] = &&op_SETW,              [BC_LOADK] = &&op_LOADK,
+        [BC_EQI] = &&op_EQI,                [BC_NEI] = &&op_NEI,                [BC_LTI] = &&op_LTI,                [BC_LEI] = &&op_LEI,
+        [BC_GTI] = &&op_GTI,                [BC_GEI] = &&op_GEI,                [BC_ADDI] = &&op_ADDI,              [BC_SUBI] = &&op_SUBI,
+        [BC_MULI] = &&op_MULI,              [BC_QUOI] = &&op_QUOI,              [BC_REMI] = &&op_REMI,              [BC_ANDI] = &&op_ANDI,
+        [BC_ORI] = &&op_ORI,                [BC_XORI] = &&op_XORI,              [BC_SHLI] = &&op_SHLI,              [BC_SHRI] = &&op_SHRI,
+        [BC_NOTI] = &&op_NOTI,              [BC_ADDF] = &&op_ADDF,              [BC_SUBF] = &&op_SUBF,              [BC_MULF] = &&op_MULF,
+        [BC_QUOF] = &&op_QUOF,              [BC_EQIK] = &&op_EQIK,              [BC_NEIK] = &&op_NEIK,              [BC_LTIK] = &&op_LTIK,
+        [BC_LEIK] = &&op_LEIK,              [BC_GTIK] = &&op_GTIK,              [BC_GEIK] = &&op_GEIK,              [BC_ADDIK] = &&op_ADDIK,
+        [BC_SUBIK] = &&op_SUBIK,            [BC_MULIK] = &&op_MULIK,            [BC_QUOIK] = &&op_QUOIK,            [BC_REMIK] = &&op_REMIK,
+        [BC_ANDIK] = &&op_ANDIK,            [BC_ORIK] = &&op_ORIK,              [BC_XORIK] = &&op_XORIK,            [BC_SHLIK] = &&op_SHLIK,
+        [BC_SHRIK] = &&op_SHRIK,            [BC_ARITH] = &&op_ARITH,            [BC_JMP] = &&op_JMP,                [BC_JEI] = &&op_JEI,
+        [BC_JNEI] = &&op_JNEI,              [BC_JLTI] = &&op_JLTI,              [BC_JLEI] = &&op_JLEI,              [BC_JGTI] = &&op_JGTI,
+        [BC_JGEI] = &&op_JGEI,              [BC_JEIK] = &&op_JEIK,              [BC_JNEIK] = &&op_JNEIK,            [BC_JLTIK] = &&op_JLTIK,
+        [BC_JLEIK] = &&op_JLEIK,            [BC_JGTIK] = &&op_JGTIK,            [BC_JGEIK] = &&op_JGEIK,            [BC_JCC] = &&op_JCC,
+        [BC_PARAM] = &&op_PARAM,            [BC_CALL] = &&op_CALL,              [BC_RET] = &&op_RET,                [BC_EXTRA] = &&op_EXTRA,
+        [BC_ADDI_JMP] = &&op_ADDI_JMP,      [BC_INC_LOOP] = &&op_INC_LOOP,      [BC_PARAM2] = &&op_PARAM2,          [BC_PARAM_CALL] = &&op_PARAM_CALL,
+        [BC_MOVT2] = &&op_MOVT2,
+    };
+    // rebuilt each run, superinstructions may be fused since the last one
+    void **threaded = malloc(bc->size * sizeof(void *));
+    if (!threaded) {
+        fprintf(stderr, "vm_run(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int k = 0; k < bc->size; k++) threaded[k] = handlers[BC_OP(code[k])];
+
+    NEXT;
+#else
+#if VM_PROFILE
+    int prev_op = BC_HALT, next_pc = -1;
+#endif
+    for (;;) {
+        i = code[pc];
+#if VM_PROFILE
+        if (pc == next_pc) vm->pair_counts[prev_op][BC_OP(i)]++;
+        prev_op = BC_OP(i);
+        next_pc = pc + bc_op_width(bc_base_op(prev_op));
+#endif
+        pc++;
+        executed++;
+        switch (BC_OP(i)) {
+#endif
+            OP(MOV) {
+                R(A) = R(B);
+                NEXT;
+            }
+            FUSED_OP(MOVT) {
+                struct Value v = R(B).type == C ? R(B) : value_convert(&R(B), C);
+                R(A) = v;
+                NEXT;
+            }
+            OP(GETO) {
+                R(A) = *_outer(vm, BC_BX(i));
+                NEXT;
+            }
+            OP(SETO) {
+                *_outer(vm, BC_BX(i)) = R(A);
+                NEXT;
+            }
+            OP(GETW) {
+                R(A) = R(BC_BX(i));
+                NEXT;
+            }
+            OP(SETW) {
+                R(BC_BX(i)) = R(A);
+                NEXT;
+            }
+            OP(LOADK) {
+                R(A) = consts[BC_BX(i)];
+                NEXT;
+            }
+            OP(EQI) INT_CMP(R(C), ==);
+            OP(NEI) INT_CMP(R(C), !=);
+            OP(LTI) INT_CMP(R(C), <);
+            OP(LEI) INT_CMP(R(C), <=);
+            OP(GTI) INT_CMP(R(C), >);
+            OP(GEI) INT_CMP(R(C), >=);
+            OP(ADDI) INT_OP(R(C), ub + uc);
+            OP(SUBI) INT_OP(R(C), ub - uc);
+            OP(MULI) INT_OP(R(C), ub * uc);
+            OP(QUOI) {
+                struct Value r = value_compute(TAC_QUO, TAC_TYPE_INT, &R(B), &R(C));
+                R(A) = r;
+                NEXT;
+            }
+            OP(REMI) {
+                struct Value r = value_compute(TAC_REM, TAC_TYPE_INT, &R(B), &R(C));
+                R(A) = r;
+                NEXT;
+            }
+            OP(ANDI) INT_OP(R(C), ub & uc);
+            OP(ORI) INT_OP(R(C), ub | uc);
+            OP(XORI) INT_OP(R(C), ub ^ uc);
+            OP(SHLI) INT_OP(R(C), ub << (uc & 31));
+            OP(SHRI) {
+                int r = R(B).i >> (R(C).i & 31);
+                R(A).type = TAC_TYPE_INT;
+                R(A).i = r;
+                NEXT;
+            }
+            OP(NOTI) {
+                int r = ~R(B).i;
+                R(A).type = TAC_TYPE_INT;
+                R(A).i = r;
+                NEXT;
+            }
+            OP(ADDF) FLOAT_OP(+);
+            OP(SUBF) FLOAT_OP(-);
+            OP(MULF) FLOAT_OP(*);
+            OP(QUOF) FLOAT_OP(/);
+            OP(EQIK) INT_CMP(K(C), ==);
+            OP(NEIK) INT_CMP(K(C), !=);
+            OP(LTIK) INT_CMP(K(C), <);
+            OP(LEIK) INT_CMP(K(C), <=);
+            OP(GTIK) INT_CMP(K(C), >);
+            OP(GEIK) INT_CMP(K(C), >=);
+            OP(ADDIK) INT_OP(K(C), ub + uc);
+            OP(SUBIK) INT_OP(K(C), ub - uc);
+            OP(MULIK) INT_OP(K(C), ub * uc);
+            OP(QUOIK) {
+                struct Value r = value_compute(TAC_QUO, TAC_TYPE_INT, &R(B), &K(C));
+                R(A) = r;
+                NEXT;
+            }
+            OP(REMIK) {
+                struct Value r = value_compute(TAC_REM, TAC_TYPE_INT, &R(B), &K(C));
+                R(A) = r;
+                NEXT;
+            }
+            OP(ANDIK) INT_OP(K(C), ub & uc);
+            OP(ORIK) INT_OP(K(C), ub | uc);
+            OP(XORIK) INT_OP(K(C), ub ^ uc);
+            OP(SHLIK) INT_OP(K(C), ub << (uc & 31));
+            OP(SHRIK) {
+                int r = R(B).i >> (K(C).i & 31);
+                R(A).type = TAC_TYPE_INT;
+                R(A).i = r;
+                NEXT;
+            }
+            OP(ARITH) {
+                int          extra = BC_SBX(code[pc++]);
+                enum TacType type = extra >> 8 ? (enum TacType)(extra >> 8) : R(B).type;
+                struct Value r = value_compute(extra & 0xFF, type, &R(B), &R(C));
+                R(A) = r;
+                NEXT;
+            }
+            FUSED_OP(JMP) {
+                pc += BC_SBX(i);
+                NEXT;
+            }
+            OP(JEI) INT_JUMP(R(B), ==);
+            OP(JNEI) INT_JUMP(R(B), !=);
+            OP(JLTI) INT_JUMP(R(B), <);
+            OP(JLEI) INT_JUMP(R(B), <=);
+            OP(JGTI) INT_JUMP(R(B), >);
+            OP(JGEI) INT_JUMP(R(B), >=);
+            OP(JEIK) INT_JUMP(K(B), ==);
+            OP(JNEIK) INT_JUMP(K(B), !=);
+            OP(JLTIK) INT_JUMP(K(B), <);
+            OP(JLEIK) INT_JUMP(K(B), <=);
+            OP(JGTIK) INT_JUMP(K(B), >);
+            OP(JGEIK) INT_JUMP(K(B), >=);
+            OP(JCC) {
+                enum TacType type = C & 0xF ? C & 0xF : R(A).type;
+                if (value_compare((C >> 4) + TAC_EQ, type, &R(A), &R(B))) pc += 1 + BC_SBX(code[pc]);
+                else pc++;
+                NEXT;
+            }
+            FUSED_OP(PARAM) {
+                if (top == vm->stack + VM_STACK_SIZE) runtime_error("value stack overflow");
+                *top++ = R(A);
+                NEXT;
+            }
+            FUSED_OP(CALL) {
+                int func = BC_SBX(code[pc++]);
+                frame = _push_frame(vm, func, top - B, B);
+                frame->ret_pc = pc;
+                base = frame->base;
+                consts = bc->funcs[func].consts;
+                top = base + bc->funcs[func].frame_size;
+                pc = bc->funcs[func].entry;
+                NEXT;
+            }
+            OP(RET) {
+                // the top level code never returns
+                if (vm->depth == 1) goto halt;
+
+                struct Value ret = {0};
+                if (A != BC_NO_REG) ret = R(A);
+
+                struct VMFrame *callee = frame;
+                if (trace_enabled) trace_end();
+                vm->cur_bases[callee->func] = callee->outer;
+                top = callee->base;
+                frame = &vm->frames[--vm->depth - 1];
+                base = frame->base;
+                consts = bc->funcs[frame->func].consts;
+                pc = callee->ret_pc;
+
+                // CALL a, b, c; EXTRA func
+                uint32_t call = code[pc - 2];
+                if (BC_A(call) != BC_NO_REG) R(BC_A(call)) = value_convert(&ret, BC_C(call));
+                NEXT;
+            }
+            OP(ADDI_JMP) {
+                R(A).type = TAC_TYPE_INT;
+                R(A).i = (int)((unsigned)R(B).i + (unsigned)K(C).i);
+                FUSED(JMP);
+            }
+            OP(INC_LOOP) {
+                R(A).type = TAC_TYPE_INT;
+                R(A).i = (int)((unsigned)R(B).i + (unsigned)K(C).i);
+                // jump to the loop header & run its JxxI or JxxIK
+                pc += 1 + BC_SBX(code[pc]);
+                i = code[pc++];
+                switch (BC_OP(i)) {
+                    case BC_JEI: INT_JUMP(R(B), ==);
+                    case BC_JNEI: INT_JUMP(R(B), !=);
+                    case BC_JLTI: INT_JUMP(R(B), <);
+                    case BC_JLEI: INT_JUMP(R(B), <=);
+                    case BC_JGTI: INT_JUMP(R(B), >);
+                    case BC_JGEI: INT_JUMP(R(B), >=);
+                    case BC_JEIK: INT_JUMP(K(B), ==);
+                    case BC_JNEIK: INT_JUMP(K(B), !=);
+                    case BC_JLTIK: INT_JUMP(K(B), <);
+                    case BC_JLEIK: INT_JUMP(K(B), <=);
+                    case BC_JGTIK: INT_JUMP(K(B), >);
+                    default: INT_JUMP(K(B), >=);
+                }
+            }
+            OP(PARAM2) {
+                if (top == vm->stack + VM_STACK_SIZE) runtime_error("value stack overflow");
+                *top++ = R(A);
+                FUSED(PARAM);
+            }
+            OP(PARAM_CALL) {
+                if (top == vm->stack + VM_STACK_SIZE) runtime_error("value stack overflow");
+                *top++ = R(A);
+                FUSED(CALL);
+            }
+            OP(MOVT2) {
+                struct Value v = R(B).type == C ? R(B) : value_convert(&R(B), C);
+                R(A) = v;
+                FUSED(MOVT);
+            }
+            OP(HALT) goto halt;
+            OP(EXTRA) runtime_error("illegal bytecode");
+#if !VM_THREADED
+            default: runtime_error("illegal bytecode");
+        }
+    }
+#endif
+
+halt:
+#if VM_THREADED
+    free(threaded);
+#endif
+    // the top level code
+    if (trace_enabled) trace_end();
+    vm->executed = executed;
+}
+
+#undef R
+#undef K
+#undef A
+#undef B
+#undef C
+#undef OP
+#undef FUSED_OP
+#undef NEXT
+#undef INT_OP
+#undef INT_CMP
+#undef FLOAT_OP
+#undef INT_JUMP
+#undef FUSED
@@ -4,8 +4,28 @@
 #include <stdio.h>
 #include <string.h>
 
-char *tac_op_code_symbols[] = {"EQ",  "NE",  "LT",  "LE",  "GT",  "GE", "ADD", "SUB",   "MUL",        "QUO",      "REM",   "AND",  "OR", "XOR",
-                               "SHL", "SHR", "NOT", "MOV", "JMP", "JE", "JNE", "LABEL", "PARAM", "CALL", "RET"};
+char *tac_op_code_symbols[] = {"EQ",  "NE",  "LT",  "LE",  "GT",  "GE",  "ADD", "SUB", "MUL",   "QUO",   "REM",  "AND", "OR", "XOR",
+                               "SHL", "SHR", "NOT", "MOV", "JMP", "JE",  "JNE", "JLT", "JLE",   "JGT",   "JGE",  "LABEL", "PARAM", "CALL", "RET"};
+
+bool is_cond_jump(enum TacOpCode op) {
+    return op >= TAC_JE && op <= TAC_JGE;
+}
+
+enum TacOpCode negate_cond_jump(enum TacOpCode op) {
+    switch (op) {
+        case TAC_JE: return TAC_JNE;
+        case TAC_JNE: return TAC_JE;
+        case TAC_JLT: return TAC_JGE;
+        case TAC_JLE: return TAC_JGT;
+        case TAC_JGT: return TAC_JLE;
+        case TAC_JGE: return TAC_JLT;
+        default: return op;
+    }
+}
+
+enum TacOpCode cond_jump_of_cmp(enum TacOpCode op) {
+    return op - TAC_EQ + TAC_JE;
+}
 
 struct TAC *create_tac(struct TAC *prev_tac, enum TacOpCode op, char *x, char *y, char *res) {
     struct TAC *t = CREATE_STRUCT_P(TAC);
@@ -36,10 +56,8 @@ struct TAC *create_tac(struct TAC *prev_tac, enum TacOpCode op, char *x, char *y
     return t;
 }
 
-void print_tac_list(struct TAC *tac_start, struct TAC *tac_end) {
-    if (!tac_start) return;
-
-    switch (tac_start->op) {
+void fprint_tac(FILE *out, enum TacOpCode op, char *x, char *y, char *res) {
+    switch (op) {
         case TAC_HEAD: break;
         case TAC_EQ:
         case TAC_NE:
@@ -58,38 +76,49 @@ void print_tac_list(struct TAC *tac_start, struct TAC *tac_end) {
         case TAC_SHL:
         case TAC_SHR:
         case TAC_NOT: {
-            printf("%s %s", tac_op_code_symbols[tac_start->op], tac_start->x);
-            if (*tac_start->y) printf(", %s", tac_start->y);
-            printf(", %s\n", tac_start->res);
+            fprintf(out, "%s %s", tac_op_code_symbols[op], x);
+            if (*y) fprintf(out, ", %s", y);
+            fprintf(out, ", %s\n", res);
             break;
         }
         case TAC_MOV: {
-            printf("MOV %s, %s\n", tac_start->x, tac_start->y);
+            fprintf(out, "MOV %s, %s\n", x, y);
             break;
         }
         case TAC_RET: {
-            printf("%s %s %s\n", tac_op_code_symbols[tac_start->op], tac_start->x, tac_start->res);
+            fprintf(out, "%s %s %s\n", tac_op_code_symbols[op], x, res);
             break;
         }
         case TAC_PARAM:
         case TAC_LABEL:
         case TAC_JMP: {
-            printf("%s %s\n", tac_op_code_symbols[tac_start->op], tac_start->x);
+            fprintf(out, "%s %s\n", tac_op_code_symbols[op], x);
             break;
         }
         case TAC_JE:
-        case TAC_JNE: {
-            printf("%s %s, %s, %s\n", tac_op_code_symbols[tac_start->op], tac_start->x, tac_start->y, tac_start->res);
+        case TAC_JNE:
+        case TAC_JLT:
+        case TAC_JLE:
+        case TAC_JGT:
+        case TAC_JGE: {
+            fprintf(out, "%s %s, %s, %s\n", tac_op_code_symbols[op], x, y, res);
             break;
         }
         case TAC_CALL: {
-            printf("%s %s, %s", tac_op_code_symbols[tac_start->op], tac_start->x, tac_start->y);
-            if (*tac_start->res) printf(", %s", tac_start->res);
-            printf("\n");
+            fprintf(out, "%s %s, %s", tac_op_code_symbols[op], x, y);
+            if (*res) fprintf(out, ", %s", res);
+            fprintf(out, "\n");
         }
     }
+}
 
-    if (tac_start == tac_end) return;
+void fprint_tac_list(FILE *out, struct TAC *tac_start, struct TAC *tac_end) {
+    for (; tac_start; tac_start = tac_start->next) {
+        fprint_tac(out, tac_start->op, tac_start->x, tac_start->y, tac_start->res);
+        if (tac_start == tac_end) return;
+    }
+}
 
-    print_tac_list(tac_start->next, tac_end);
+void print_tac_list(struct TAC *tac_start, struct TAC *tac_end) {
+    fprint_tac_list(stdout, tac_start, tac_end);
 }
\ No newline at end of file
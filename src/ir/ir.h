@@ -1,6 +1,9 @@
 #ifndef IR_H
 #define IR_H
 
+#include <stdbool.h>
+#include <stdio.h>
+
 enum TacOpCode {
     TAC_HEAD = -1,
     TAC_EQ,
@@ -24,6 +27,10 @@ enum TacOpCode {
     TAC_JMP,
     TAC_JE,
     TAC_JNE,
+    TAC_JLT,
+    TAC_JLE,
+    TAC_JGT,
+    TAC_JGE,
     TAC_LABEL,
     TAC_PARAM,
     TAC_CALL,
@@ -32,8 +39,12 @@ enum TacOpCode {
 
 extern char *tac_op_code_symbols[];
 
+// type of the operands, from the semantic pass, TAC_TYPE_NONE if unknown
+enum TacType { TAC_TYPE_NONE, TAC_TYPE_INT, TAC_TYPE_FLOAT, TAC_TYPE_BOOL, TAC_TYPE_CHAR, TAC_TYPE_STRING };
+
 struct TAC {
     enum TacOpCode op;
+    enum TacType   type;
     char           x[256];
     char           y[256];
     char           res[256];
@@ -46,6 +57,16 @@ struct TAC {
 
 struct TAC *create_tac(struct TAC *prev_tac, enum TacOpCode op, char *x, char *y, char *res);
 
+// JE/JNE/JLT/JLE/JGT/JGE x, y, label, jump to label if x op y
+bool           is_cond_jump(enum TacOpCode op);
+// jump if the condition does not hold, JLT <=> JGE, only for non float compares, JLT & JGE are both false on NaN
+enum TacOpCode negate_cond_jump(enum TacOpCode op);
+// the cond jump of a comparison, EQ => JE, LT => JLT
+enum TacOpCode cond_jump_of_cmp(enum TacOpCode op);
+
+// one tac, in the text form of print_tac_list
+void fprint_tac(FILE *out, enum TacOpCode op, char *x, char *y, char *res);
 void print_tac_list(struct TAC *tac_start, struct TAC *tac_end);
+void fprint_tac_list(FILE *out, struct TAC *tac_start, struct TAC *tac_end);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,322 @@
+#include "ir_cfg.h"
+#include "global.h"
+#include "ir.h"
+#include "ir_gen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct LabelEntry {
+    char           *name;
+    struct TAC     *tac;
+    struct CFGFunc *func; // available only for S# labels
+};
+
+bool is_func_label(struct TAC *tac, char prefix) {
+    return tac->op == TAC_LABEL && tac->x[0] == prefix && tac->x[1] == '#';
+}
+
+static struct LabelEntry *_lookup_label_entry(struct CFG *cfg, char *name) {
+    struct LabelEntry **e = label_map_get(&cfg->label_map, name);
+    return e ? *e : NULL;
+}
+
+struct TAC *cfg_lookup_label(struct CFG *cfg, char *name) {
+    struct LabelEntry *e = _lookup_label_entry(cfg, name);
+    return e ? e->tac : NULL;
+}
+
+struct CFGFunc *cfg_lookup_func(struct CFG *cfg, char *name) {
+    struct LabelEntry *e = _lookup_label_entry(cfg, name);
+    return e ? e->func : NULL;
+}
+
+bool is_block_terminator(struct TAC *tac) {
+    return tac->op == TAC_JMP || is_cond_jump(tac->op) || tac->op == TAC_RET || is_func_label(tac, FUNC_E_PREFIX);
+}
+
+struct TAC *cfg_func_next_tac(struct CFGFunc *func, struct TAC *tac) {
+    if (!tac || tac == func->end) return NULL;
+
+    struct TAC *next = tac->next;
+    // nested func body, jump over it
+    while (next && is_func_label(next, FUNC_S_PREFIX)) {
+        struct CFGFunc *nested = cfg_lookup_func(func->cfg, next->x);
+        next = nested->end->next;
+    }
+    return next;
+}
+
+static void _block_list_add(struct Arena *arena, struct BasicBlock ***list, int *size, int *cap, struct BasicBlock *block) {
+    if (*size == *cap) {
+        int new_cap = *cap ? *cap << 1 : 2;
+        *list = arena_realloc(arena, *list, *cap * sizeof(struct BasicBlock *), new_cap * sizeof(struct BasicBlock *));
+        *cap = new_cap;
+    }
+    (*list)[(*size)++] = block;
+}
+
+static void _connect_basic_block(struct CFGFunc *func, struct BasicBlock *from, struct BasicBlock *to) {
+    if (!to) return;
+
+    // successors are few, while a loop header may have lots of predecessors
+    for (int i = 0; i < from->successors_size; i++)
+        if (from->successors[i] == to) return;
+
+    _block_list_add(func->arena, &from->successors, &from->successors_size, &from->successors_cap, to);
+    _block_list_add(func->arena, &to->predecessors, &to->predecessors_size, &to->predecessors_cap, from);
+}
+
+static struct BasicBlock *_branch_target(struct CFGFunc *func, char *label) {
+    struct TAC *tac = cfg_lookup_label(func->cfg, label);
+    if (!tac) {
+        fprintf(stderr, "create_cfg(), can not find tac with name %s\n", label);
+        exit(EXIT_FAILURE);
+    }
+    if (!tac->block || tac->block->func != func) {
+        fprintf(stderr, "create_cfg(), jump to label %s out of function\n", label);
+        exit(EXIT_FAILURE);
+    }
+    return tac->block;
+}
+
+static struct BasicBlock *_create_basic_block(struct CFGFunc *func, struct TAC *tac) {
+    struct BasicBlock *block = arena_alloc(func->arena, sizeof(struct BasicBlock));
+    block->id = func->block_size++;
+    block->rpo = -1;
+    block->func = func;
+    block->head = tac;
+    block->tail = tac;
+    return block;
+}
+
+// iterative dfs, so deep graphs would not overflow the stack
+static void _compute_rpo(struct CFGFunc *func) {
+    int                 n = func->block_size;
+    struct BasicBlock **stack = malloc(n * sizeof(struct BasicBlock *));
+    int                *edge = malloc(n * sizeof(int));
+    struct BasicBlock **post = malloc(n * sizeof(struct BasicBlock *));
+    if (!stack || !edge || !post) {
+        fprintf(stderr, "_compute_rpo(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int sp = 0, post_size = 0;
+    if (func->entry) {
+        // -2 marks pushed blocks
+        func->entry->rpo = -2;
+        stack[sp] = func->entry;
+        edge[sp++] = 0;
+    }
+    while (sp) {
+        struct BasicBlock *block = stack[sp - 1];
+        if (edge[sp - 1] < block->successors_size) {
+            struct BasicBlock *successor = block->successors[edge[sp - 1]++];
+            if (successor->rpo != -1) continue;
+            successor->rpo = -2;
+            stack[sp] = successor;
+            edge[sp++] = 0;
+        } else post[post_size++] = stack[--sp];
+    }
+
+    func->rpo = arena_alloc(func->arena, (post_size ? post_size : 1) * sizeof(struct BasicBlock *));
+    func->rpo_size = post_size;
+    for (int i = 0; i < post_size; i++) {
+        func->rpo[i] = post[post_size - 1 - i];
+        func->rpo[i]->rpo = i;
+    }
+
+    free(stack);
+    free(edge);
+    free(post);
+}
+
+// split tac of the function into basic blocks, then connect them and number them in reverse post-order
+void rebuild_cfg_func(struct CFGFunc *func) {
+    if (func->arena) free_arena(func->arena);
+    func->arena = create_arena();
+    func->entry = NULL;
+    func->block_size = 0;
+
+    struct BasicBlock *cur_block = NULL;
+    struct BasicBlock *last_block = NULL;
+    for (struct TAC *tac = func->start, *next; tac; tac = next) {
+        // start of a basic block
+        if (!cur_block || (tac->op == TAC_LABEL && !is_func_label(tac, FUNC_E_PREFIX))) {
+            struct BasicBlock *block = _create_basic_block(func, tac);
+            if (!func->entry) func->entry = block;
+            else last_block->next = block;
+            last_block = cur_block = block;
+        }
+
+        tac->block = cur_block;
+        cur_block->tail = tac;
+
+        // end of basic block, also before a nested func body, so tac of a block is contiguous in the tac list
+        next = cfg_func_next_tac(func, tac);
+        if (is_block_terminator(tac) || next != tac->next) cur_block = NULL;
+    }
+
+    for (struct BasicBlock *block = func->entry; block; block = block->next) {
+        struct TAC *tail = block->tail;
+        switch (tail->op) {
+            case TAC_JMP: _connect_basic_block(func, block, _branch_target(func, tail->x)); break;
+            case TAC_JE:
+            case TAC_JNE:
+            case TAC_JLT:
+            case TAC_JLE:
+            case TAC_JGT:
+            case TAC_JGE: {
+                _connect_basic_block(func, block, _branch_target(func, tail->res));
+                _connect_basic_block(func, block, block->next);
+                break;
+            }
+            case TAC_RET: break;
+            default: _connect_basic_block(func, block, block->next);
+        }
+    }
+
+    _compute_rpo(func);
+}
+
+static struct CFGFunc *_create_cfg_func(struct CFG *cfg, struct TAC *start) {
+    struct CFGFunc *func = CREATE_STRUCT_P(CFGFunc);
+    if (!func) {
+        fprintf(stderr, "_create_cfg_func(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    func->cfg = cfg;
+    func->start = start;
+
+    if (cfg->func_size == cfg->func_cap) {
+        int              new_cap = cfg->func_cap ? cfg->func_cap << 1 : 8;
+        struct CFGFunc **funcs = realloc(cfg->funcs, new_cap * sizeof(struct CFGFunc *));
+        if (!funcs) {
+            fprintf(stderr, "_create_cfg_func(), no enough memory\n");
+            exit(EXIT_FAILURE);
+        }
+        cfg->funcs = funcs;
+        cfg->func_cap = new_cap;
+    }
+    cfg->funcs[cfg->func_size++] = func;
+    return func;
+}
+
+static void _init_label_map(struct CFG *cfg) {
+    label_map_init(&cfg->label_map);
+
+    for (struct TAC *tac = cfg->tac; tac; tac = tac->next) {
+        if (tac->op != TAC_LABEL) continue;
+
+        // a label defined twice would send jumps & calls of one of them into the other
+        struct LabelEntry **slot = label_map_put(&cfg->label_map, tac->x);
+        if (*slot) {
+            fprintf(stderr, "create_cfg(), duplicate label %s\n", tac->x);
+            exit(EXIT_FAILURE);
+        }
+        struct LabelEntry *e = CREATE_STRUCT_P(LabelEntry);
+        if (!e) {
+            fprintf(stderr, "_init_label_map(), no enough memory\n");
+            exit(EXIT_FAILURE);
+        }
+        e->name = tac->x;
+        e->tac = tac;
+        if (is_func_label(tac, FUNC_S_PREFIX)) e->func = _create_cfg_func(cfg, tac);
+        *slot = e;
+    }
+
+    for (int i = 1; i < cfg->func_size; i++) {
+        struct CFGFunc *func = cfg->funcs[i];
+        func->name = func->start->x;
+
+        char end_name[256];
+        strcpy(end_name, func->name);
+        end_name[0] = FUNC_E_PREFIX;
+        func->end = cfg_lookup_label(cfg, end_name);
+        if (!func->end) {
+            fprintf(stderr, "create_cfg(), can not find end of function %s\n", func->name);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// a function is reachable if it's called from reachable blocks
+static void _mark_reachable_funcs(struct CFG *cfg) {
+    struct CFGFunc **worklist = malloc(cfg->func_size * sizeof(struct CFGFunc *));
+    if (!worklist) {
+        fprintf(stderr, "_mark_reachable_funcs(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int size = 0;
+    cfg->funcs[0]->reachable = true;
+    worklist[size++] = cfg->funcs[0];
+    while (size) {
+        struct CFGFunc *func = worklist[--size];
+        for (int i = 0; i < func->rpo_size; i++) {
+            struct BasicBlock *block = func->rpo[i];
+            for (struct TAC *tac = block->head;; tac = tac->next) {
+                if (tac->op == TAC_CALL) {
+                    struct CFGFunc *callee = cfg_lookup_func(cfg, tac->x);
+                    if (callee && !callee->reachable) {
+                        callee->reachable = true;
+                        worklist[size++] = callee;
+                    }
+                }
+                if (tac == block->tail) break;
+            }
+        }
+    }
+
+    free(worklist);
+}
+
+struct CFG *create_cfg(struct TAC *tac) {
+    struct CFG *cfg = CREATE_STRUCT_P(CFG);
+    if (!cfg) {
+        fprintf(stderr, "create_cfg(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    cfg->tac = tac;
+
+    // top level code goes first
+    _create_cfg_func(cfg, tac);
+    _init_label_map(cfg);
+
+    for (int i = 0; i < cfg->func_size; i++) rebuild_cfg_func(cfg->funcs[i]);
+    cfg->entry = cfg->funcs[0]->entry;
+
+    _mark_reachable_funcs(cfg);
+    return cfg;
+}
+
+void free_cfg(struct CFG *cfg) {
+    if (!cfg) return;
+
+    for (int i = 0; i < cfg->func_size; i++) {
+        free_arena(cfg->funcs[i]->arena);
+        free(cfg->funcs[i]);
+    }
+    free(cfg->funcs);
+    size_t pos = 0;
+    for (struct LabelMapSlot *slot; (slot = label_map_next(&cfg->label_map, &pos));) free(slot->val);
+    label_map_free(&cfg->label_map);
+    free(cfg);
+}
+
+void fprint_cfg(FILE *out, struct CFG *cfg, bool only_reachable, bool split) {
+    if (!cfg) return;
+
+    for (struct TAC *tac = cfg->tac; tac; tac = tac->next) {
+        struct BasicBlock *block = tac->block;
+        if (only_reachable && (block->rpo < 0 || !block->func->reachable)) continue;
+
+        fprint_tac_list(out, tac, tac);
+        if (split && tac == block->tail) fprintf(out, "\n");
+    }
+}
+
+void print_cfg(struct CFG *cfg, bool only_reachable, bool split) {
+    fprint_cfg(stdout, cfg, only_reachable, split);
+}
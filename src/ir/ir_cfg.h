@@ -0,0 +1,74 @@
+#ifndef IR_CFG_H
+#define IR_CFG_H
+
+#include "arena.h"
+#include "swiss_map.h"
+#include <stdbool.h>
+
+struct BasicBlock {
+    int id;  // index in layout order of its function
+    int rpo; // index in reverse post-order of its function, -1 if unreachable
+
+    struct BasicBlock **successors;
+    int                 successors_size;
+    int                 successors_cap;
+    struct BasicBlock **predecessors;
+    int                 predecessors_size;
+    int                 predecessors_cap;
+
+    struct BasicBlock *next; // next block in layout order of the same function
+
+    struct CFGFunc *func;
+    struct TAC     *head; // tac from head to tail are linked by next, never cross a nested func body
+    struct TAC     *tail;
+
+    void *data;   // facts of the running pass
+    bool  queued; // in the worklist of the running pass
+};
+
+/*
+ * Code between LABEL S#name and LABEL E#name, or the top level code outside of any function.
+ * Functions are independent control flow graphs, CALL does not end a basic block.
+ */
+struct CFGFunc {
+    char       *name;  // S# label name, NULL for the top level code
+    struct TAC *start; // first tac of the function
+    struct TAC *end;   // LABEL E#name, NULL for the top level code
+
+    struct Arena      *arena; // owns blocks & edge lists of the function
+    struct BasicBlock *entry;
+    int                block_size;
+
+    struct BasicBlock **rpo; // reachable blocks in reverse post-order
+    int                 rpo_size;
+
+    bool        reachable; // top level code, or called from reachable code
+    bool        dirty;     // changed by the last optimization round
+    struct CFG *cfg;
+};
+
+SWISS_STR_MAP(LabelMap, label_map, struct LabelEntry *)
+
+struct CFG {
+    struct TAC        *tac;   // head of the tac list
+    struct BasicBlock *entry; // entry block of the top level code
+
+    struct CFGFunc **funcs; // funcs[0] is the top level code
+    int              func_size;
+    int              func_cap;
+
+    struct LabelMap label_map; // label name -> LABEL tac
+};
+
+struct CFG        *create_cfg(struct TAC *tac);
+void               free_cfg(struct CFG *cfg);
+void               rebuild_cfg_func(struct CFGFunc *func);
+struct TAC        *cfg_lookup_label(struct CFG *cfg, char *name);
+struct CFGFunc    *cfg_lookup_func(struct CFG *cfg, char *name);
+struct TAC        *cfg_func_next_tac(struct CFGFunc *func, struct TAC *tac);
+bool               is_block_terminator(struct TAC *tac);
+bool               is_func_label(struct TAC *tac, char prefix);
+void               print_cfg(struct CFG *cfg, bool only_reachable, bool split);
+void               fprint_cfg(FILE *out, struct CFG *cfg, bool only_reachable, bool split);
+
+#endif
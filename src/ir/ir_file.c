@@ -0,0 +1,332 @@
+#include "ir_file.h"
+#include "global.h"
+#include "ir_fold.h"
+#include "ir_gen.h"
+#include "swiss_map.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SWISS_STR_MAP(IrStringMap, ir_string_map, uint32_t)
+SWISS_INT_MAP(IrIndexMap, ir_index_map, uint32_t)
+
+// tables of the image being written
+struct IrFileWriter {
+    struct IrFileFunc  *funcs;
+    uint32_t            func_size;
+    struct IrFileBlock *blocks;
+    uint32_t            block_size;
+    uint32_t           *edges;
+    uint32_t            edge_size, edge_cap;
+    struct IrFileInstr *instrs;
+    uint32_t            instr_size, instr_cap;
+    struct IrFileConst *consts;
+    uint32_t            const_size, const_cap;
+    char               *strings;
+    uint32_t            string_size, string_cap;
+
+    struct IrStringMap string_map; // string -> offset
+    struct IrStringMap const_map;  // "<type>:<literal>" -> index
+    struct IrIndexMap  block_map;  // BasicBlock * -> index
+};
+
+static void *_grow(void *p, uint32_t *cap, uint32_t need, size_t elem_size) {
+    if (need <= *cap) return p;
+
+    uint32_t new_cap = *cap ? *cap : 64;
+    while (new_cap < need) new_cap <<= 1;
+    p = realloc(p, new_cap * elem_size);
+    if (!p) {
+        fprintf(stderr, "write_ir_file(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    *cap = new_cap;
+    return p;
+}
+
+static uint32_t _add_string(struct IrFileWriter *w, char *s) {
+    uint64_t  hash = ir_string_map_hash(s);
+    uint32_t *offset = ir_string_map_get_hashed(&w->string_map, s, hash);
+    if (offset) return *offset;
+
+    uint32_t len = strlen(s) + 1;
+    w->strings = _grow(w->strings, &w->string_cap, w->string_size + len, 1);
+    memcpy(w->strings + w->string_size, s, len);
+    // the key is owned by the writer, the string table moves when it grows
+    *ir_string_map_put_hashed(&w->string_map, strdup(s), hash) = w->string_size;
+    w->string_size += len;
+    return w->string_size - len;
+}
+
+static bool _is_lit_operand(char *s) {
+    return s[0] == LIT_PREFIX && s[1] == '#';
+}
+
+// the value the interpreter gives the literal used with type
+static uint32_t _add_const(struct IrFileWriter *w, char *lit, enum TacType type) {
+    if (type == TAC_TYPE_NONE) type = lit_type(lit);
+    if (type == TAC_TYPE_NONE) type = TAC_TYPE_STRING;
+
+    char key[300];
+    snprintf(key, sizeof(key), "%d:%s", type, lit);
+    uint32_t *index = ir_string_map_get(&w->const_map, key);
+    if (index) return *index;
+
+    struct IrFileConst c = {.type = type, .name = _add_string(w, lit)};
+    char              *s = unpack_name(lit);
+    switch (type) {
+        case TAC_TYPE_INT: c.i = (int)strtol(s, NULL, 10); break;
+        case TAC_TYPE_FLOAT: c.f = strtof(s, NULL); break;
+        case TAC_TYPE_BOOL: c.i = !strcmp(s, "true") || !strcmp(s, "1"); break;
+        case TAC_TYPE_CHAR: c.i = (unsigned char)s[0]; break;
+        default: c.s = _add_string(w, s);
+    }
+    w->consts = _grow(w->consts, &w->const_cap, w->const_size + 1, sizeof(struct IrFileConst));
+    w->consts[w->const_size] = c;
+    *ir_string_map_put(&w->const_map, strdup(key)) = w->const_size;
+    return w->const_size++;
+}
+
+static void _add_edges(struct IrFileWriter *w, struct BasicBlock **blocks, int size, uint32_t *first, uint32_t *edge_size) {
+    *first = w->edge_size;
+    *edge_size = size;
+    w->edges = _grow(w->edges, &w->edge_cap, w->edge_size + size, sizeof(uint32_t));
+    for (int i = 0; i < size; i++) w->edges[w->edge_size++] = *ir_index_map_get(&w->block_map, (long)blocks[i]);
+}
+
+static void _build_tables(struct IrFileWriter *w, struct CFG *cfg) {
+    w->funcs = calloc(cfg->func_size, sizeof(struct IrFileFunc));
+    for (int i = 0; i < cfg->func_size; i++) w->block_size += cfg->funcs[i]->block_size;
+    w->blocks = calloc(w->block_size ? w->block_size : 1, sizeof(struct IrFileBlock));
+    if (!w->funcs || !w->blocks) {
+        fprintf(stderr, "write_ir_file(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // blocks numbered first, edges refer to blocks of the whole file
+    uint32_t next_block = 0;
+    for (int i = 0; i < cfg->func_size; i++) {
+        struct CFGFunc *func = cfg->funcs[i];
+        w->funcs[i] = (struct IrFileFunc){func->name ? _add_string(w, func->name) : IR_FILE_NONE, next_block, func->block_size, func->reachable};
+        for (struct BasicBlock *block = func->entry; block; block = block->next) {
+            *ir_index_map_put(&w->block_map, (long)block) = next_block;
+            w->blocks[next_block++] = (struct IrFileBlock){.func = i, .rpo = block->rpo};
+        }
+    }
+    w->func_size = cfg->func_size;
+
+    for (int i = 0; i < cfg->func_size; i++) {
+        for (struct BasicBlock *block = cfg->funcs[i]->entry; block; block = block->next) {
+            struct IrFileBlock *b = &w->blocks[*ir_index_map_get(&w->block_map, (long)block)];
+            _add_edges(w, block->successors, block->successors_size, &b->first_succ, &b->succ_size);
+            _add_edges(w, block->predecessors, block->predecessors_size, &b->first_pred, &b->pred_size);
+        }
+    }
+
+    for (struct TAC *tac = cfg->tac; tac; tac = tac->next) {
+        uint32_t            block = *ir_index_map_get(&w->block_map, (long)tac->block);
+        struct IrFileBlock *b = &w->blocks[block];
+        if (!b->instr_size) b->first_instr = w->instr_size;
+        b->instr_size++;
+
+        bool values = tac->op != TAC_LABEL && tac->op != TAC_JMP;
+        w->instrs = _grow(w->instrs, &w->instr_cap, w->instr_size + 1, sizeof(struct IrFileInstr));
+        w->instrs[w->instr_size++] = (struct IrFileInstr){
+            .op = tac->op + 1,
+            .type = tac->type,
+            .block = block,
+            .x = _add_string(w, tac->x),
+            .y = _add_string(w, tac->y),
+            .res = _add_string(w, tac->res),
+            .x_const = values && _is_lit_operand(tac->x) ? _add_const(w, tac->x, tac->type) : IR_FILE_NONE,
+            .y_const = values && _is_lit_operand(tac->y) ? _add_const(w, tac->y, tac->type) : IR_FILE_NONE,
+        };
+    }
+}
+
+static void _free_writer(struct IrFileWriter *w) {
+    size_t pos = 0;
+    for (struct IrStringMapSlot *slot; (slot = ir_string_map_next(&w->string_map, &pos));) free((char *)slot->key);
+    pos = 0;
+    for (struct IrStringMapSlot *slot; (slot = ir_string_map_next(&w->const_map, &pos));) free((char *)slot->key);
+    ir_string_map_free(&w->string_map);
+    ir_string_map_free(&w->const_map);
+    ir_index_map_free(&w->block_map);
+    free(w->funcs);
+    free(w->blocks);
+    free(w->edges);
+    free(w->instrs);
+    free(w->consts);
+    free(w->strings);
+}
+
+static uint32_t _align(uint32_t offset) {
+    return (offset + IR_FILE_ALIGN - 1) & ~(uint32_t)(IR_FILE_ALIGN - 1);
+}
+
+// place a table after offset
+static void _place(struct IrFileSection *section, uint32_t *offset, uint32_t size, size_t elem_size) {
+    section->offset = _align(*offset);
+    section->size = size;
+    *offset = section->offset + size * elem_size;
+}
+
+static void _write_section(FILE *out, uint32_t *offset, struct IrFileSection *section, void *data, size_t elem_size) {
+    for (; *offset < section->offset; (*offset)++) fputc(0, out);
+    fwrite(data, elem_size, section->size, out);
+    *offset += section->size * elem_size;
+}
+
+bool write_ir_file(FILE *out, struct CFG *cfg) {
+    struct IrFileWriter w = {0};
+    _add_string(&w, "");
+    _build_tables(&w, cfg);
+
+    struct IrFileHeader h = {.magic = IR_FILE_MAGIC, .version = IR_FILE_VERSION, .byte_order = IR_FILE_BYTE_ORDER};
+    uint32_t            offset = sizeof(struct IrFileHeader);
+    _place(&h.funcs, &offset, w.func_size, sizeof(struct IrFileFunc));
+    _place(&h.blocks, &offset, w.block_size, sizeof(struct IrFileBlock));
+    _place(&h.edges, &offset, w.edge_size, sizeof(uint32_t));
+    _place(&h.instrs, &offset, w.instr_size, sizeof(struct IrFileInstr));
+    _place(&h.consts, &offset, w.const_size, sizeof(struct IrFileConst));
+    _place(&h.strings, &offset, w.string_size, 1);
+    h.size = offset;
+
+    fwrite(&h, sizeof(h), 1, out);
+    offset = sizeof(struct IrFileHeader);
+    _write_section(out, &offset, &h.funcs, w.funcs, sizeof(struct IrFileFunc));
+    _write_section(out, &offset, &h.blocks, w.blocks, sizeof(struct IrFileBlock));
+    _write_section(out, &offset, &h.edges, w.edges, sizeof(uint32_t));
+    _write_section(out, &offset, &h.instrs, w.instrs, sizeof(struct IrFileInstr));
+    _write_section(out, &offset, &h.consts, w.consts, sizeof(struct IrFileConst));
+    _write_section(out, &offset, &h.strings, w.strings, 1);
+
+    _free_writer(&w);
+    return !ferror(out);
+}
+
+// ---------------------Reading---------------------
+
+bool is_ir_file(char *path) {
+    size_t len = strlen(path), suffix_len = strlen(IR_FILE_SUFFIX);
+    return len > suffix_len && !strcmp(path + len - suffix_len, IR_FILE_SUFFIX);
+}
+
+static bool _check_section(struct IrFile *file, struct IrFileSection *section, size_t elem_size) {
+    return section->offset % IR_FILE_ALIGN == 0 && section->offset >= sizeof(struct IrFileHeader) &&
+           section->offset <= file->size && section->size <= (file->size - section->offset) / elem_size;
+}
+
+static bool _check_string(struct IrFile *file, uint32_t offset) {
+    return offset < ir_file_header(file)->strings.size;
+}
+
+static bool _check_slice(uint32_t first, uint32_t size, uint32_t total) {
+    return first <= total && size <= total - first;
+}
+
+// every index & offset of the image is in range, so it could be read in place
+static bool _check_ir_file(struct IrFile *file) {
+    struct IrFileHeader *h = ir_file_header(file);
+    if (file->size < sizeof(struct IrFileHeader) || memcmp(h->magic, IR_FILE_MAGIC, 4)) return false;
+    if (h->version != IR_FILE_VERSION || h->byte_order != IR_FILE_BYTE_ORDER || h->size != file->size) return false;
+    if (!_check_section(file, &h->funcs, sizeof(struct IrFileFunc)) || !_check_section(file, &h->blocks, sizeof(struct IrFileBlock)) ||
+        !_check_section(file, &h->edges, sizeof(uint32_t)) || !_check_section(file, &h->instrs, sizeof(struct IrFileInstr)) ||
+        !_check_section(file, &h->consts, sizeof(struct IrFileConst)) || !_check_section(file, &h->strings, 1))
+        return false;
+    // strings end with '\0', so none of them runs out of the table
+    if (!h->strings.size || ir_file_string(file, h->strings.size - 1)[0]) return false;
+
+    struct IrFileFunc *funcs = ir_file_funcs(file);
+    for (uint32_t i = 0; i < h->funcs.size; i++) {
+        if (funcs[i].name != IR_FILE_NONE && !_check_string(file, funcs[i].name)) return false;
+        if (!_check_slice(funcs[i].first_block, funcs[i].block_size, h->blocks.size)) return false;
+    }
+
+    struct IrFileBlock *blocks = ir_file_blocks(file);
+    for (uint32_t i = 0; i < h->blocks.size; i++) {
+        struct IrFileBlock *b = &blocks[i];
+        if (b->func >= h->funcs.size || !_check_slice(b->first_instr, b->instr_size, h->instrs.size)) return false;
+        if (!_check_slice(b->first_succ, b->succ_size, h->edges.size) || !_check_slice(b->first_pred, b->pred_size, h->edges.size)) return false;
+    }
+
+    uint32_t *edges = ir_file_edges(file);
+    for (uint32_t i = 0; i < h->edges.size; i++)
+        if (edges[i] >= h->blocks.size) return false;
+
+    struct IrFileInstr *instrs = ir_file_instrs(file);
+    for (uint32_t i = 0; i < h->instrs.size; i++) {
+        struct IrFileInstr *instr = &instrs[i];
+        if (instr->op > TAC_RET + 1 || instr->type > TAC_TYPE_STRING || instr->block >= h->blocks.size) return false;
+        if (!_check_string(file, instr->x) || !_check_string(file, instr->y) || !_check_string(file, instr->res)) return false;
+        if ((instr->x_const != IR_FILE_NONE && instr->x_const >= h->consts.size) || (instr->y_const != IR_FILE_NONE && instr->y_const >= h->consts.size))
+            return false;
+    }
+
+    struct IrFileConst *consts = ir_file_consts(file);
+    for (uint32_t i = 0; i < h->consts.size; i++) {
+        if (consts[i].type == TAC_TYPE_NONE || consts[i].type > TAC_TYPE_STRING || !_check_string(file, consts[i].name)) return false;
+        if (consts[i].type == TAC_TYPE_STRING && !_check_string(file, consts[i].s)) return false;
+    }
+    return true;
+}
+
+struct IrFile *open_ir_file(char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size < sizeof(struct IrFileHeader)) {
+        close(fd);
+        return NULL;
+    }
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+
+    struct IrFile *file = CREATE_STRUCT_P(IrFile);
+    if (!file) {
+        fprintf(stderr, "open_ir_file(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    *file = (struct IrFile){base, st.st_size};
+    if (_check_ir_file(file)) return file;
+
+    close_ir_file(file);
+    return NULL;
+}
+
+void close_ir_file(struct IrFile *file) {
+    if (!file) return;
+
+    munmap(file->base, file->size);
+    free(file);
+}
+
+struct TAC *ir_file_to_tac(struct IrFile *file) {
+    struct IrFileInstr *instrs = ir_file_instrs(file);
+    struct TAC         *head = NULL, *prev = NULL;
+    for (uint32_t i = 0; i < ir_file_header(file)->instrs.size; i++) {
+        struct IrFileInstr *instr = &instrs[i];
+        prev = create_tac(prev, (int)instr->op - 1, ir_file_string(file, instr->x), ir_file_string(file, instr->y), ir_file_string(file, instr->res));
+        prev->type = instr->type;
+        if (!head) head = prev;
+    }
+    return head;
+}
+
+void fprint_ir_file(FILE *out, struct IrFile *file) {
+    struct IrFileInstr *instrs = ir_file_instrs(file);
+    struct IrFileBlock *blocks = ir_file_blocks(file);
+    for (uint32_t i = 0; i < ir_file_header(file)->instrs.size; i++) {
+        struct IrFileInstr *instr = &instrs[i];
+        fprint_tac(out, (int)instr->op - 1, ir_file_string(file, instr->x), ir_file_string(file, instr->y), ir_file_string(file, instr->res));
+
+        struct IrFileBlock *block = &blocks[instr->block];
+        if (i == block->first_instr + block->instr_size - 1) fprintf(out, "\n");
+    }
+}
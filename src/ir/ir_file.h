@@ -0,0 +1,134 @@
+#ifndef IR_FILE_H
+#define IR_FILE_H
+
+#include "ir.h"
+#include "ir_cfg.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define IR_FILE_MAGIC "SQIR"
+#define IR_FILE_VERSION 3 // 3: temps are named V#$t<id>
+#define IR_FILE_BYTE_ORDER 0x01020304u
+#define IR_FILE_NONE 0xFFFFFFFFu // no string, no constant
+#define IR_FILE_ALIGN 8
+#define IR_FILE_SUFFIX ".sqir"
+
+/*
+ * Binary image of an optimized cfg, mapped & used in place, without deserialization.
+ * It holds no pointer, every reference is an index into a table or an offset into the string table,
+ * tables are found by their offset from the start of the file, so the image works at any address.
+ * Numbers are in the byte order of the writer, a file of the other byte order is rejected.
+ *
+ *   header | funcs | blocks | edges | instrs | consts | strings
+ *
+ * Blocks of a func are consecutive in layout order, the first one is its entry.
+ * Instrs are in the order of the tac list, tac of a block are consecutive.
+ * Edges are block indexes, successors & predecessors of a block are consecutive slices of them.
+ * Literal operands of instrs refer to the constant pool, which holds their values parsed for the type they are used with.
+ */
+
+struct IrFileSection {
+    uint32_t offset; // from the start of the file
+    uint32_t size;   // entries, bytes for strings
+};
+
+struct IrFileHeader {
+    char                 magic[4];
+    uint32_t             version;
+    uint32_t             byte_order;
+    uint32_t             size; // bytes of the whole file
+    struct IrFileSection funcs;
+    struct IrFileSection blocks;
+    struct IrFileSection edges;
+    struct IrFileSection instrs;
+    struct IrFileSection consts;
+    struct IrFileSection strings;
+};
+
+struct IrFileFunc {
+    uint32_t name; // S# label, IR_FILE_NONE for the top level code
+    uint32_t first_block;
+    uint32_t block_size;
+    uint32_t reachable;
+};
+
+struct IrFileBlock {
+    uint32_t func;
+    int32_t  rpo; // -1 if unreachable
+    uint32_t first_instr;
+    uint32_t instr_size;
+    uint32_t first_succ; // into edges
+    uint32_t succ_size;
+    uint32_t first_pred; // into edges
+    uint32_t pred_size;
+};
+
+struct IrFileInstr {
+    uint8_t  op; // enum TacOpCode + 1, TAC_HEAD is 0
+    uint8_t  type;
+    uint16_t reserved;
+    uint32_t block;
+    uint32_t x, y, res;      // strings, "" for no operand
+    uint32_t x_const, y_const; // constants of literal operands, IR_FILE_NONE for others
+};
+
+struct IrFileConst {
+    uint8_t  type; // enum TacType, never TAC_TYPE_NONE
+    uint8_t  reserved[3];
+    uint32_t name; // the literal operand, L#...
+    union {
+        int32_t  i; // int, char & bool
+        float    f;
+        uint32_t s; // string, offset of its chars
+    };
+};
+
+// a mapped image, checked once when opened, tables could be read in place without bounds checks
+struct IrFile {
+    uint8_t *base;
+    size_t   size;
+};
+
+bool           write_ir_file(FILE *out, struct CFG *cfg);
+// path ends with IR_FILE_SUFFIX
+bool           is_ir_file(char *path);
+// map the file & check its tables, NULL if it can not be read, is malformed or of another version
+struct IrFile *open_ir_file(char *path);
+void           close_ir_file(struct IrFile *file);
+// tac list of the image, for the consumers of tac
+struct TAC    *ir_file_to_tac(struct IrFile *file);
+// print the instrs in place, the same as fprint_cfg(out, cfg, false, true) of the cfg written
+void           fprint_ir_file(FILE *out, struct IrFile *file);
+
+static inline struct IrFileHeader *ir_file_header(struct IrFile *file) {
+    return (struct IrFileHeader *)file->base;
+}
+
+static inline struct IrFileFunc *ir_file_funcs(struct IrFile *file) {
+    return (struct IrFileFunc *)(file->base + ir_file_header(file)->funcs.offset);
+}
+
+static inline struct IrFileBlock *ir_file_blocks(struct IrFile *file) {
+    return (struct IrFileBlock *)(file->base + ir_file_header(file)->blocks.offset);
+}
+
+static inline uint32_t *ir_file_edges(struct IrFile *file) {
+    return (uint32_t *)(file->base + ir_file_header(file)->edges.offset);
+}
+
+static inline struct IrFileInstr *ir_file_instrs(struct IrFile *file) {
+    return (struct IrFileInstr *)(file->base + ir_file_header(file)->instrs.offset);
+}
+
+static inline struct IrFileConst *ir_file_consts(struct IrFile *file) {
+    return (struct IrFileConst *)(file->base + ir_file_header(file)->consts.offset);
+}
+
+static inline char *ir_file_string(struct IrFile *file, uint32_t offset) {
+    return (char *)file->base + ir_file_header(file)->strings.offset + offset;
+}
+
+#endif
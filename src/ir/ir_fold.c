@@ -0,0 +1,402 @@
+#include "ir_fold.h"
+#include "ir_gen.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// value of a literal, char is kept in i
+struct LitValue {
+    enum TacType type;
+    union {
+        int   i;
+        float f;
+        bool  b;
+    };
+};
+
+static bool _is_lit(char *name) {
+    return name[0] == LIT_PREFIX && name[1] == '#';
+}
+
+static bool _is_same_var(char *x, char *y) {
+    return x[0] == VAR_PREFIX && x[1] == '#' && !strcmp(x, y);
+}
+
+static bool _parse_int(char *s, int *v) {
+    char *end;
+    errno = 0;
+    long l = strtol(s, &end, 10);
+    if (!*s || *end || errno || l < INT_MIN || l > INT_MAX) return false;
+    *v = (int)l;
+    return true;
+}
+
+static bool _parse_float(char *s, float *v) {
+    char *end;
+    errno = 0;
+    *v = strtof(s, &end);
+    return *s && !*end && !errno;
+}
+
+enum TacType lit_type(char *lit) {
+    if (!_is_lit(lit)) return TAC_TYPE_NONE;
+
+    char *s = unpack_name(lit);
+    int   i;
+    float f;
+    if (!strcmp(s, "true") || !strcmp(s, "false")) return TAC_TYPE_BOOL;
+    if (_parse_int(s, &i)) return TAC_TYPE_INT;
+    if (_parse_float(s, &f)) return TAC_TYPE_FLOAT;
+    return TAC_TYPE_NONE;
+}
+
+enum TacType tac_res_type(enum TacOpCode op, enum TacType type) {
+    return op >= TAC_EQ && op <= TAC_GE ? TAC_TYPE_BOOL : type;
+}
+
+static bool _parse_lit(char *lit, enum TacType type, struct LitValue *v) {
+    if (!_is_lit(lit)) return false;
+
+    char *s = unpack_name(lit);
+    if (type == TAC_TYPE_NONE) type = lit_type(lit);
+    v->type = type;
+    switch (type) {
+        case TAC_TYPE_INT: return _parse_int(s, &v->i);
+        case TAC_TYPE_FLOAT: return _parse_float(s, &v->f);
+        case TAC_TYPE_BOOL: {
+            // conds of untyped tac are compared with L#1
+            if (!strcmp(s, "true") || !strcmp(s, "1")) v->b = true;
+            else if (!strcmp(s, "false") || !strcmp(s, "0")) v->b = false;
+            else return false;
+            return true;
+        }
+        case TAC_TYPE_CHAR: {
+            if (!s[0] || s[1]) return false;
+            v->i = (unsigned char)s[0];
+            return true;
+        }
+        default: return false;
+    }
+}
+
+static bool _print_lit(struct LitValue *v, char *lit) {
+    switch (v->type) {
+        case TAC_TYPE_INT: sprintf(lit, "%c#%d", LIT_PREFIX, v->i); return true;
+        case TAC_TYPE_BOOL: sprintf(lit, "%c#%s", LIT_PREFIX, v->b ? "true" : "false"); return true;
+        case TAC_TYPE_FLOAT: {
+            // inf & nan could not be spelled as literals
+            if (!isfinite(v->f)) return false;
+            sprintf(lit, "%c#%.9g", LIT_PREFIX, v->f);
+            // keep it a float literal
+            if (!strpbrk(lit + 2, ".e")) strcat(lit, ".0");
+            return true;
+        }
+        default: return false;
+    }
+}
+
+static bool _fold_int(enum TacOpCode op, int x, int y, struct LitValue *v) {
+    // wrap around instead of overflowing
+    unsigned ux = x, uy = y;
+    switch (op) {
+        case TAC_ADD: v->i = (int)(ux + uy); return true;
+        case TAC_SUB: v->i = (int)(ux - uy); return true;
+        case TAC_MUL: v->i = (int)(ux * uy); return true;
+        case TAC_QUO:
+        case TAC_REM: {
+            if (!y || (x == INT_MIN && y == -1)) return false;
+            v->i = op == TAC_QUO ? x / y : x % y;
+            return true;
+        }
+        case TAC_AND: v->i = x & y; return true;
+        case TAC_OR: v->i = x | y; return true;
+        case TAC_XOR: v->i = x ^ y; return true;
+        case TAC_SHL:
+        case TAC_SHR: {
+            if (y < 0 || y >= 32) return false;
+            v->i = op == TAC_SHL ? (int)(ux << y) : x >> y;
+            return true;
+        }
+        case TAC_NOT: v->i = ~x; return true;
+        default: return false;
+    }
+}
+
+static bool _fold_float(enum TacOpCode op, float x, float y, struct LitValue *v) {
+    switch (op) {
+        case TAC_ADD: v->f = x + y; return true;
+        case TAC_SUB: v->f = x - y; return true;
+        case TAC_MUL: v->f = x * y; return true;
+        case TAC_QUO: v->f = x / y; return true;
+        default: return false;
+    }
+}
+
+static bool _fold_bool(enum TacOpCode op, bool x, bool y, struct LitValue *v) {
+    switch (op) {
+        case TAC_AND: v->b = x && y; return true;
+        case TAC_OR: v->b = x || y; return true;
+        case TAC_XOR: v->b = x != y; return true;
+        case TAC_NOT: v->b = !x; return true;
+        default: return false;
+    }
+}
+
+static bool _fold_cmp(enum TacOpCode op, struct LitValue *x, struct LitValue *y, struct LitValue *v) {
+    int cmp;
+    switch (x->type) {
+        case TAC_TYPE_INT:
+        case TAC_TYPE_CHAR: cmp = (x->i > y->i) - (x->i < y->i); break;
+        case TAC_TYPE_BOOL: cmp = x->b - y->b; break;
+        case TAC_TYPE_FLOAT: {
+            // any comparison with nan is false but NE
+            if (isnan(x->f) || isnan(y->f)) {
+                v->b = op == TAC_NE;
+                return true;
+            }
+            cmp = (x->f > y->f) - (x->f < y->f);
+            break;
+        }
+        default: return false;
+    }
+
+    switch (op) {
+        case TAC_EQ: v->b = !cmp; break;
+        case TAC_NE: v->b = cmp; break;
+        case TAC_LT: v->b = cmp < 0; break;
+        case TAC_LE: v->b = cmp <= 0; break;
+        case TAC_GT: v->b = cmp > 0; break;
+        case TAC_GE: v->b = cmp >= 0; break;
+        default: return false;
+    }
+    return true;
+}
+
+// MOV res, val, val could be an operand of tac
+static bool _to_mov(struct TAC *tac, char *val) {
+    char v[256];
+    strcpy(v, val);
+    tac->type = tac_res_type(tac->op, tac->type);
+    tac->op = TAC_MOV;
+    strcpy(tac->x, tac->res);
+    strcpy(tac->y, v);
+    tac->res[0] = '\0';
+    return true;
+}
+
+bool fold_tac(struct TAC *tac) {
+    if (tac->op < TAC_EQ || tac->op > TAC_NOT) return false;
+
+    struct LitValue x, y = {0}, v;
+    bool            unary = tac->op == TAC_NOT;
+    if (!_parse_lit(tac->x, tac->type, &x)) return false;
+    if (!unary && !_parse_lit(tac->y, tac->type, &y)) return false;
+    // untyped operands spelled in different types
+    if (!unary && x.type != y.type) return false;
+
+    bool ok;
+    v.type = tac_res_type(tac->op, x.type);
+    if (tac->op <= TAC_GE) ok = _fold_cmp(tac->op, &x, &y, &v);
+    else if (x.type == TAC_TYPE_INT) ok = _fold_int(tac->op, x.i, y.i, &v);
+    else if (x.type == TAC_TYPE_FLOAT) ok = _fold_float(tac->op, x.f, y.f, &v);
+    else if (x.type == TAC_TYPE_BOOL) ok = _fold_bool(tac->op, x.b, y.b, &v);
+    // char arithmetic may give non-printable chars, which literals could not spell
+    else ok = false;
+
+    char lit[256];
+    if (!ok || !_print_lit(&v, lit)) return false;
+
+    tac->type = x.type;
+    return _to_mov(tac, lit);
+}
+
+bool fold_cond_jump(struct TAC *tac, bool *taken) {
+    if (!is_cond_jump(tac->op)) return false;
+
+    struct LitValue x, y, v;
+    if (!_parse_lit(tac->x, tac->type, &x) || !_parse_lit(tac->y, tac->type, &y) || x.type != y.type) return false;
+    if (!_fold_cmp(tac->op - TAC_JE + TAC_EQ, &x, &y, &v)) return false;
+
+    *taken = v.b;
+    return true;
+}
+
+// true if operand is the literal k of type
+static bool _is_lit_of(char *operand, enum TacType type, int k) {
+    struct LitValue v;
+    if (!_parse_lit(operand, type, &v) || v.type != type) return false;
+    switch (type) {
+        case TAC_TYPE_INT: return v.i == k;
+        case TAC_TYPE_FLOAT: return v.f == (float)k;
+        case TAC_TYPE_BOOL: return v.b == k;
+        default: return false;
+    }
+}
+
+static bool _to_mov_lit(struct TAC *tac, enum TacType type, int k) {
+    struct LitValue v = {.type = type};
+    char            lit[256];
+    if (type == TAC_TYPE_BOOL) v.b = k;
+    else v.i = k;
+    _print_lit(&v, lit);
+    return _to_mov(tac, lit);
+}
+
+// log2 of int literal operand if it is a power of two greater than 1, else -1
+static int _log2_lit(char *operand) {
+    struct LitValue v;
+    if (!_parse_lit(operand, TAC_TYPE_INT, &v) || v.i <= 1 || v.i & (v.i - 1)) return -1;
+    return __builtin_ctz(v.i);
+}
+
+static void _swap_operands(struct TAC *tac) {
+    char t[256];
+    strcpy(t, tac->x);
+    strcpy(tac->x, tac->y);
+    strcpy(tac->y, t);
+}
+
+static bool _simplify_cmp(struct TAC *tac) {
+    // x == x, not for float for nan
+    if (tac->type == TAC_TYPE_FLOAT || !_is_same_var(tac->x, tac->y)) return false;
+
+    bool v = tac->op == TAC_EQ || tac->op == TAC_LE || tac->op == TAC_GE;
+    return _to_mov_lit(tac, TAC_TYPE_BOOL, v);
+}
+
+static bool _simplify_int(struct TAC *tac) {
+    enum TacType t = TAC_TYPE_INT;
+    char        *x = tac->x, *y = tac->y;
+    int          k;
+    switch (tac->op) {
+        case TAC_ADD:
+        case TAC_OR:
+        case TAC_XOR: {
+            if (_is_lit_of(y, t, 0)) return _to_mov(tac, x);
+            if (_is_lit_of(x, t, 0)) return _to_mov(tac, y);
+            if (tac->op == TAC_XOR && _is_same_var(x, y)) return _to_mov_lit(tac, t, 0);
+            if (tac->op == TAC_OR && _is_same_var(x, y)) return _to_mov(tac, x);
+            if (tac->op == TAC_OR && (_is_lit_of(x, t, -1) || _is_lit_of(y, t, -1))) return _to_mov_lit(tac, t, -1);
+            return false;
+        }
+        case TAC_SUB: {
+            if (_is_lit_of(y, t, 0)) return _to_mov(tac, x);
+            if (_is_same_var(x, y)) return _to_mov_lit(tac, t, 0);
+            return false;
+        }
+        case TAC_MUL: {
+            if (_is_lit_of(x, t, 0) || _is_lit_of(y, t, 0)) return _to_mov_lit(tac, t, 0);
+            if (_is_lit_of(y, t, 1)) return _to_mov(tac, x);
+            if (_is_lit_of(x, t, 1)) return _to_mov(tac, y);
+            // x * 2^k => x << k
+            if (_log2_lit(x) > 0) _swap_operands(tac);
+            if ((k = _log2_lit(tac->y)) > 0) {
+                tac->op = TAC_SHL;
+                sprintf(tac->y, "%c#%d", LIT_PREFIX, k);
+                return true;
+            }
+            return false;
+        }
+        case TAC_QUO: {
+            // signed division by 2^k rounds to zero, it is not a plain shift
+            if (_is_lit_of(y, t, 1)) return _to_mov(tac, x);
+            return false;
+        }
+        case TAC_REM: {
+            if (_is_lit_of(y, t, 1) || _is_lit_of(y, t, -1)) return _to_mov_lit(tac, t, 0);
+            return false;
+        }
+        case TAC_AND: {
+            if (_is_lit_of(x, t, 0) || _is_lit_of(y, t, 0)) return _to_mov_lit(tac, t, 0);
+            if (_is_lit_of(y, t, -1) || _is_same_var(x, y)) return _to_mov(tac, x);
+            if (_is_lit_of(x, t, -1)) return _to_mov(tac, y);
+            return false;
+        }
+        case TAC_SHL:
+        case TAC_SHR: {
+            if (_is_lit_of(y, t, 0)) return _to_mov(tac, x);
+            if (_is_lit_of(x, t, 0)) return _to_mov_lit(tac, t, 0);
+            return false;
+        }
+        default: return false;
+    }
+}
+
+static bool _simplify_float(struct TAC *tac) {
+    enum TacType t = TAC_TYPE_FLOAT;
+    char        *x = tac->x, *y = tac->y;
+    switch (tac->op) {
+        // x + 0.0 is not x for x = -0.0, x * 0.0 is not 0.0 for inf & nan
+        case TAC_SUB: {
+            if (_is_lit_of(y, t, 0)) return _to_mov(tac, x);
+            return false;
+        }
+        case TAC_MUL: {
+            if (_is_lit_of(y, t, 1)) return _to_mov(tac, x);
+            if (_is_lit_of(x, t, 1)) return _to_mov(tac, y);
+            // x * 2.0 => x + x
+            if (_is_lit_of(x, t, 2)) _swap_operands(tac);
+            if (_is_lit_of(tac->y, t, 2)) {
+                tac->op = TAC_ADD;
+                strcpy(tac->y, tac->x);
+                return true;
+            }
+            return false;
+        }
+        case TAC_QUO: {
+            if (_is_lit_of(y, t, 1)) return _to_mov(tac, x);
+            return false;
+        }
+        default: return false;
+    }
+}
+
+static bool _simplify_bool(struct TAC *tac) {
+    enum TacType t = TAC_TYPE_BOOL;
+    char        *x = tac->x, *y = tac->y;
+    switch (tac->op) {
+        case TAC_AND: {
+            if (_is_lit_of(x, t, false) || _is_lit_of(y, t, false)) return _to_mov_lit(tac, t, false);
+            if (_is_lit_of(y, t, true) || _is_same_var(x, y)) return _to_mov(tac, x);
+            if (_is_lit_of(x, t, true)) return _to_mov(tac, y);
+            return false;
+        }
+        case TAC_OR: {
+            if (_is_lit_of(x, t, true) || _is_lit_of(y, t, true)) return _to_mov_lit(tac, t, true);
+            if (_is_lit_of(y, t, false) || _is_same_var(x, y)) return _to_mov(tac, x);
+            if (_is_lit_of(x, t, false)) return _to_mov(tac, y);
+            return false;
+        }
+        case TAC_XOR: {
+            if (_is_lit_of(y, t, false)) return _to_mov(tac, x);
+            if (_is_lit_of(x, t, false)) return _to_mov(tac, y);
+            if (_is_same_var(x, y)) return _to_mov_lit(tac, t, false);
+            return false;
+        }
+        // x == true, x != false => x
+        case TAC_EQ:
+        case TAC_NE: {
+            bool v = tac->op == TAC_EQ;
+            if (_is_lit_of(y, t, v)) return _to_mov(tac, x);
+            if (_is_lit_of(x, t, v)) return _to_mov(tac, y);
+            return false;
+        }
+        default: return false;
+    }
+}
+
+bool simplify_tac(struct TAC *tac) {
+    if (tac->op < TAC_EQ || tac->op >= TAC_NOT) return false;
+
+    switch (tac->type) {
+        case TAC_TYPE_INT: return _simplify_int(tac) || (tac->op <= TAC_GE && _simplify_cmp(tac));
+        case TAC_TYPE_FLOAT: return _simplify_float(tac);
+        case TAC_TYPE_BOOL: return _simplify_bool(tac) || (tac->op <= TAC_GE && _simplify_cmp(tac));
+        case TAC_TYPE_CHAR: return tac->op <= TAC_GE && _simplify_cmp(tac);
+        default: return false;
+    }
+}
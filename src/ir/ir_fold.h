@@ -0,0 +1,29 @@
+#ifndef IR_FOLD_H
+#define IR_FOLD_H
+
+#include "ir.h"
+
+// type of a literal guessed from its spelling, for tac generated without type
+enum TacType lit_type(char *lit);
+// type of the result of op on operands of type, comparisons give bool
+enum TacType tac_res_type(enum TacOpCode op, enum TacType type);
+
+/*
+ * Fold an operation on literal operands by the operand type:
+ * ADD L#1.5, L#2, V#$t0 => MOV V#$t0, L#3.5
+ * Returns false if it can not be folded, like division by zero or overflowing float.
+ */
+bool fold_tac(struct TAC *tac);
+
+// fold a cond jump on literal operands, taken is set to whether it always jumps, false if it can not be folded
+bool fold_cond_jump(struct TAC *tac, bool *taken);
+
+/*
+ * Algebraic simplification & strength reduction of an operation with a var operand:
+ * x+0, x*1, x|0, x<<0 => x; x*0, x-x, x^x => 0; x*8 => x<<3; x==x => true
+ * Float operands are only simplified where IEEE results stay the same.
+ * Returns true if tac is changed.
+ */
+bool simplify_tac(struct TAC *tac);
+
+#endif
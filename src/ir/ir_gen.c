@@ -1,11 +1,21 @@
 #include "ir_gen.h"
 #include "scope.h"
+#include "trace.h"
 #include "type.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-static int var_id = 0;
+static _Thread_local int var_id = 0;
+
+// ids of the enclosing for loops, break & continue jump to labels of the innermost one
+static _Thread_local int loop_ids[MAX_LOOP_DEPTH];
+static _Thread_local int loop_depth = 0;
+
+void reset_tac_var_id() {
+    var_id = 0;
+}
 
 char *pack_str_arg(char *name, char prefix, bool need_free) {
     char *packed_name = calloc(256, sizeof(char));
@@ -50,6 +60,11 @@ char *unpack_name(char *name) {
     return name + 2;
 }
 
+// temp vars are named V#$t<id> by _gen_temp_var_name()
+bool is_temp_var(char *name) {
+    return name && name[0] == VAR_PREFIX && name[1] == '#' && name[2] == TEMP_PREFIX;
+}
+
 void *_gen_temp_var_name() {
     char *name = calloc(254, sizeof(char));
     if (!name) {
@@ -57,10 +72,159 @@ void *_gen_temp_var_name() {
         exit(EXIT_FAILURE);
         return NULL;
     }
-    sprintf(name, "t%d", var_id++);
+    sprintf(name, "%ct%d", TEMP_PREFIX, var_id++);
     return pack_str_arg(name, VAR_PREFIX, true);
 }
 
+static enum TacType _basic_tac_type(enum BasicTypeCode code) {
+    switch (code) {
+        case _int_type: return TAC_TYPE_INT;
+        case _float_type: return TAC_TYPE_FLOAT;
+        case _bool_type: return TAC_TYPE_BOOL;
+        case _char_type: return TAC_TYPE_CHAR;
+        case _string_type: return TAC_TYPE_STRING;
+        default: return TAC_TYPE_NONE;
+    }
+}
+
+// type of expr node given by the semantic pass
+static enum TacType _tac_type(struct AstNode *node) {
+    if (!node || !node->type || node->type->type_code != _basic_type) return TAC_TYPE_NONE;
+    return _basic_tac_type(node->type->data.basic_type->code);
+}
+
+static struct TAC *_create_typed_tac(struct TAC *prev_tac, enum TacOpCode op, enum TacType type, char *x, char *y, char *res) {
+    struct TAC *t = create_tac(prev_tac, op, x, y, res);
+    t->type = type;
+    return t;
+}
+
+// scope names end with #<id of the node>, unique in a file
+static char *_scope_id(struct Scope *s) {
+    char *id = strrchr(s->name, '#');
+    return id ? id + 1 : s->name;
+}
+
+/*
+ * Funcs declared in the top level block keep their names, nested ones are named name.<id of the declaring scope>,
+ * so nested funcs of the same name in different funcs never share a label.
+ */
+static int _func_name(char *buf, int len, char *name, struct Scope *decl_scope) {
+    if (!decl_scope || !decl_scope->parent || decl_scope->parent == decl_scope) return snprintf(buf, len, "%s", name);
+    return snprintf(buf, len, "%s%c%s", name, SCOPE_SEP, _scope_id(decl_scope));
+}
+
+// S#func or E#func of the func declared in decl_scope
+static char *_gen_func_label(char prefix, char *name, struct Scope *decl_scope) {
+    char *label = calloc(256, sizeof(char));
+    if (!label) {
+        fprintf(stderr, "_gen_func_label(), no enough memory");
+        exit(EXIT_FAILURE);
+        return NULL;
+    }
+    sprintf(label, "%c#", prefix);
+    _func_name(label + 2, 254, name, decl_scope);
+    return label;
+}
+
+/*
+ * Vars declared in a func are named V#name@func, so that vars of different funcs never share a name,
+ * vars declared in a nested block get the id of the block too, V#name.<scope id>@func, so they never share the slot of a var they shadow.
+ */
+static char *_gen_var_name(struct AstNode *name_expr) {
+    char          *name = name_expr->data.name_expr->value;
+    struct Symbol *sym = scope_lookup_symbol_from_all(name_expr->scope, name);
+    struct Scope  *s = sym ? sym->scope : NULL;
+    if (!s) return pack_str_arg(name, VAR_PREFIX, false);
+
+    char *packed_name = calloc(256, sizeof(char));
+    if (!packed_name) {
+        fprintf(stderr, "_gen_var_name(), no enough memory");
+        exit(EXIT_FAILURE);
+        return NULL;
+    }
+    int len = snprintf(packed_name, 256, "%c#%s", VAR_PREFIX, name);
+    // the top level block & the body of a func are not nested
+    if (!s->is_func && s->parent && s->parent != s) len += snprintf(packed_name + len, 256 - len, "%c%s", SCOPE_SEP, _scope_id(s));
+    while (s && !s->is_func && s->parent != s) s = s->parent;
+    if (s && s->is_func) {
+        packed_name[len++] = LOCAL_VAR_SEP;
+        _func_name(packed_name + len, 256 - len, s->func_name, s->parent);
+    }
+    return packed_name;
+}
+
+// JMP label, skipped if control never reaches here
+static void _gen_jmp(char *label, struct TAC **tac) {
+    if ((*tac)->op == TAC_JMP || (*tac)->op == TAC_RET) return;
+    *tac = create_tac(*tac, TAC_JMP, label, NULL, NULL);
+}
+
+/*
+ * Jump to true_label if x op y, else to false_label, NULL label means falling through.
+ * Float compares are never negated, x < y & x >= y are both false if one is NaN,
+ * so one falling through to true jumps over a JMP false_label to fall_label instead.
+ */
+static void _gen_cond_jump(enum TacOpCode op, enum TacType type, char *x, char *y, char *true_label, char *false_label, char *fall_label, struct TAC **tac) {
+    if (!true_label && false_label && type == TAC_TYPE_FLOAT) {
+        *tac = _create_typed_tac(*tac, op, type, x, y, fall_label);
+        *tac = create_tac(*tac, TAC_JMP, false_label, NULL, NULL);
+        *tac = create_tac(*tac, TAC_LABEL, fall_label, NULL, NULL);
+    } else if (true_label) {
+        *tac = _create_typed_tac(*tac, op, type, x, y, true_label);
+        if (false_label) *tac = create_tac(*tac, TAC_JMP, false_label, NULL, NULL);
+    } else if (false_label) *tac = _create_typed_tac(*tac, negate_cond_jump(op), type, x, y, false_label);
+}
+
+/*
+ * Branch on cond without materializing it, at most one of the labels could be NULL, which means falling through.
+ * Comparisons become fused cond jumps, && and || jump to the targets as soon as the result is known.
+ */
+static void _gen_branch(struct AstNode *cond, char *true_label, char *false_label, struct TAC **tac, char *func_name) {
+    if (cond->class == OPERATION) {
+        struct Operation *op = cond->data.operation;
+        char              cond_end[256];
+        sprintf(cond_end, "%s#%d", COND_END, cond->id);
+        switch (op->op) {
+            case EQ:
+            case NE:
+            case LT:
+            case LE:
+            case GT:
+            case GE: {
+                char *x_name = gen_tac_from_ast(op->x, tac, func_name);
+                char *y_name = gen_tac_from_ast(op->y, tac, func_name);
+                _gen_cond_jump(cond_jump_of_cmp((enum TacOpCode)(op->op - EQ)), _tac_type(op->x), x_name, y_name, true_label, false_label, cond_end, tac);
+                return;
+            }
+            case LAND: {
+                // x false, the whole is false
+                _gen_branch(op->x, NULL, false_label ? false_label : cond_end, tac, func_name);
+                _gen_branch(op->y, true_label, false_label, tac, func_name);
+                if (!false_label) *tac = create_tac(*tac, TAC_LABEL, cond_end, NULL, NULL);
+                return;
+            }
+            case LOR: {
+                // x true, the whole is true
+                _gen_branch(op->x, true_label ? true_label : cond_end, NULL, tac, func_name);
+                _gen_branch(op->y, true_label, false_label, tac, func_name);
+                if (!true_label) *tac = create_tac(*tac, TAC_LABEL, cond_end, NULL, NULL);
+                return;
+            }
+            case LNOT: {
+                _gen_branch(op->x, false_label, true_label, tac, func_name);
+                return;
+            }
+            default: break;
+        }
+    }
+
+    char        *cond_res = gen_tac_from_ast(cond, tac, func_name);
+    enum TacType type = _tac_type(cond);
+    char        *true_lit = type == TAC_TYPE_BOOL ? pack_str_arg("true", LIT_PREFIX, false) : pack_int_arg(1);
+    _gen_cond_jump(TAC_JE, type, cond_res, true_lit, true_label, false_label, NULL, tac);
+}
+
 char *_gen_tac_from_operation(struct AstNode *node, struct TAC **tac) {
     struct Operation *op = node->data.operation;
 
@@ -81,88 +245,42 @@ char *_gen_tac_from_operation(struct AstNode *node, struct TAC **tac) {
         case XOR:
         case SHL:
         case SHR: {
-            char *res_name = _gen_temp_var_name();
-            *tac = create_tac(*tac, ((enum TacOpCode)(op->op - EQ)), gen_tac_from_ast(op->x, tac, NULL), gen_tac_from_ast(op->y, tac, NULL), res_name);
-            return res_name;
-        }
-        case LAND: {
             char *x_name = gen_tac_from_ast(op->x, tac, NULL);
             char *y_name = gen_tac_from_ast(op->y, tac, NULL);
             char *res_name = _gen_temp_var_name();
-            char  if_true[256];
-            char  if_end[256];
-            sprintf(if_true, "%s#%d", IF_TRUE, node->id);
-            sprintf(if_end, "%s#%d", IF_END, node->id);
-            // JE x, 0, IF_TRUE
-            *tac = create_tac(*tac, TAC_JE, x_name, pack_int_arg(0), if_true);
-            // JE y, 0, IF_TRUE
-            *tac = create_tac(*tac, TAC_JE, y_name, pack_int_arg(0), if_true);
-            // MOV res, 1
-            *tac = create_tac(*tac, TAC_MOV, res_name, pack_int_arg(1), NULL);
-            // JMP IF_END
-            *tac = create_tac(*tac, TAC_JMP, if_end, NULL, NULL);
-            // LABEL IF_TRUE
-            *tac = create_tac(*tac, TAC_LABEL, if_true, NULL, NULL);
-            // MOV res, 0
-            *tac = create_tac(*tac, TAC_MOV, res_name, pack_int_arg(0), NULL);
-            // LABEL IF_END
-            *tac = create_tac(*tac, TAC_LABEL, if_end, NULL, NULL);
+            *tac = _create_typed_tac(*tac, ((enum TacOpCode)(op->op - EQ)), _tac_type(op->x), x_name, y_name, res_name);
             return res_name;
         }
-        case LOR: {
+        case NOT: {
             char *x_name = gen_tac_from_ast(op->x, tac, NULL);
-            char *y_name = gen_tac_from_ast(op->y, tac, NULL);
             char *res_name = _gen_temp_var_name();
-            char  if_true[256];
-            char  if_end[256];
-            sprintf(if_true, "%s#%d", IF_TRUE, node->id);
-            sprintf(if_end, "%s#%d", IF_END, node->id);
-            // JE x, 1, IF_TRUE
-            *tac = create_tac(*tac, TAC_JE, x_name, pack_int_arg(1), if_true);
-            // JE y, 1, IF_TRUE
-            *tac = create_tac(*tac, TAC_JE, y_name, pack_int_arg(1), if_true);
-            // MOV res, 0
-            *tac = create_tac(*tac, TAC_MOV, res_name, pack_int_arg(0), NULL);
-            // JMP IF_END
-            *tac = create_tac(*tac, TAC_JMP, if_end, NULL, NULL);
-            // LABEL IF_TRUE
-            *tac = create_tac(*tac, TAC_LABEL, if_true, NULL, NULL);
-            // MOV res, 1
-            *tac = create_tac(*tac, TAC_MOV, res_name, pack_int_arg(1), NULL);
-            // LABEL IF_END
-            *tac = create_tac(*tac, TAC_LABEL, if_end, NULL, NULL);
+            *tac = _create_typed_tac(*tac, TAC_NOT, _tac_type(op->x), x_name, NULL, res_name);
             return res_name;
         }
-        case NOT: {
-            char *x_name = gen_tac_from_ast(op->x, tac, NULL);
-            char *var_name = _gen_temp_var_name();
-            *tac = create_tac(*tac, TAC_NOT, x_name, NULL, var_name);
-            return var_name;
-        }
+        case LAND:
+        case LOR:
         case LNOT: {
-            char *cond_name = gen_tac_from_ast(op->x, tac, NULL);
             char *res_name = _gen_temp_var_name();
-            char  if_false[256];
-            char  if_end[256];
-            sprintf(if_false, "%s#%d", IF_FALSE, node->id);
-            sprintf(if_end, "%s#%d", IF_END, node->id);
-            // JE a, 1, IF_FALSE
-            *tac = create_tac(*tac, TAC_JE, cond_name, pack_int_arg(1), if_false);
-            // MOV res, 1
-            *tac = create_tac(*tac, TAC_MOV, res_name, pack_int_arg(1), NULL);
-            // JMP IF_END
-            *tac = create_tac(*tac, TAC_JMP, if_end, NULL, NULL);
-            // LABEL IF_FALSE
-            *tac = create_tac(*tac, TAC_LABEL, if_false, NULL, NULL);
-            // MOV res, 0
-            *tac = create_tac(*tac, TAC_MOV, res_name, pack_int_arg(0), NULL);
-            // LABEL IF_END
-            *tac = create_tac(*tac, TAC_LABEL, if_end, NULL, NULL);
+            char  bool_false[256];
+            char  bool_end[256];
+            sprintf(bool_false, "%s#%d", BOOL_FALSE, node->id);
+            sprintf(bool_end, "%s#%d", BOOL_END, node->id);
+            _gen_branch(node, NULL, bool_false, tac, NULL);
+            // MOV res, true
+            *tac = _create_typed_tac(*tac, TAC_MOV, TAC_TYPE_BOOL, res_name, pack_str_arg("true", LIT_PREFIX, false), NULL);
+            // JMP BOOL_END
+            *tac = create_tac(*tac, TAC_JMP, bool_end, NULL, NULL);
+            // LABEL BOOL_FALSE
+            *tac = create_tac(*tac, TAC_LABEL, bool_false, NULL, NULL);
+            // MOV res, false
+            *tac = _create_typed_tac(*tac, TAC_MOV, TAC_TYPE_BOOL, res_name, pack_str_arg("false", LIT_PREFIX, false), NULL);
+            // LABEL BOOL_END
+            *tac = create_tac(*tac, TAC_LABEL, bool_end, NULL, NULL);
             return res_name;
         }
         case ASSIGN: {
             char *res_name = gen_tac_from_ast(op->x, tac, NULL);
-            *tac = create_tac(*tac, TAC_MOV, res_name, gen_tac_from_ast(op->y, tac, NULL), NULL);
+            *tac = _create_typed_tac(*tac, TAC_MOV, _tac_type(op->x), res_name, gen_tac_from_ast(op->y, tac, NULL), NULL);
             return res_name;
         }
     }
@@ -170,6 +288,20 @@ char *_gen_tac_from_operation(struct AstNode *node, struct TAC **tac) {
     return NULL;
 }
 
+// elseif of an if, jumps to if_end of the whole if after its body
+static void _gen_else_if(struct AstNode *node, char *if_end, struct TAC **tac, char *func_name) {
+    struct ElseIfCtrl *else_if_ctrl = node->data.else_if_ctrl;
+    char               if_false[256];
+    sprintf(if_false, "%s#%d", IF_FALSE, node->id);
+    // JLE a, b, IF_FALSE
+    _gen_branch(else_if_ctrl->cond, NULL, if_false, tac, func_name);
+    gen_tac_from_ast(else_if_ctrl->then, tac, func_name);
+    // JMP IF_END
+    _gen_jmp(if_end, tac);
+    // LABEL IF_FALSE
+    *tac = create_tac(*tac, TAC_LABEL, if_false, NULL, NULL);
+}
+
 char *gen_tac_from_ast(struct AstNode *node, struct TAC **tac, char *func_name) {
     if (!node) return NULL;
 
@@ -191,7 +323,10 @@ char *gen_tac_from_ast(struct AstNode *node, struct TAC **tac, char *func_name)
             char            *func_name = call_expr->func_expr->data.name_expr->value;
 
             // prepare params
-            for (int i = 0; i < call_expr->param_size; i++) *tac = create_tac(*tac, TAC_PARAM, gen_tac_from_ast(call_expr->params[i], tac, func_name), NULL, NULL);
+            for (int i = 0; i < call_expr->param_size; i++) {
+                char *param_name = gen_tac_from_ast(call_expr->params[i], tac, func_name);
+                *tac = _create_typed_tac(*tac, TAC_PARAM, _tac_type(call_expr->params[i]), param_name, NULL, NULL);
+            }
 
             char *param_size = pack_int_arg(call_expr->param_size);
 
@@ -202,67 +337,79 @@ char *gen_tac_from_ast(struct AstNode *node, struct TAC **tac, char *func_name)
             if (ret_type->type_code != _basic_type || ret_type->data.basic_type->code != _void_type) ret = _gen_temp_var_name();
 
             // res = call x, y
-            *tac = create_tac(*tac, TAC_CALL, pack_str_arg(func_name, FUNC_S_PREFIX, false), param_size, ret);
+            *tac = _create_typed_tac(*tac, TAC_CALL, _tac_type(node), _gen_func_label(FUNC_S_PREFIX, func_name, sym->scope), param_size, ret);
             return ret;
         }
         case INC_EXPR: {
             struct IncExpr *inc_expr = node->data.inc_expr;
             char           *x_name = gen_tac_from_ast(inc_expr->x, tac, func_name);
             enum TacOpCode  op = inc_expr->is_inc ? TAC_ADD : TAC_SUB;
+            enum TacType    type = _tac_type(inc_expr->x);
             // ++x
             // x = x + 1
             if (inc_expr->is_pre) {
-                *tac = create_tac(*tac, op, x_name, pack_int_arg(1), x_name);
+                *tac = _create_typed_tac(*tac, op, type, x_name, pack_int_arg(1), x_name);
                 return x_name;
             }
             // x++
             // t1 = x
             // x = x + 1
             char *res_name = _gen_temp_var_name();
-            *tac = create_tac(*tac, TAC_MOV, x_name, res_name, NULL);
-            *tac = create_tac(*tac, op, x_name, pack_int_arg(1), x_name);
+            *tac = _create_typed_tac(*tac, TAC_MOV, type, res_name, x_name, NULL);
+            *tac = _create_typed_tac(*tac, op, type, x_name, pack_int_arg(1), x_name);
             return res_name;
         }
-        case NAME_EXPR: return pack_str_arg(node->data.name_expr->value, VAR_PREFIX, false);
+        case NAME_EXPR: return _gen_var_name(node);
         case OPERATION: return _gen_tac_from_operation(node, tac);
         case FIELD_DECL: {
             struct FieldDecl *field_decl = node->data.field_decl;
-            char             *default_var = pack_str_arg(basic_type_default_val[field_decl->type_decl->data.basic_type_decl->tk], LIT_PREFIX, false);
-            char             *var_name = pack_str_arg(field_decl->name_expr->data.name_expr->value, VAR_PREFIX, false);
-            *tac = create_tac(*tac, TAC_MOV, var_name, default_var, NULL);
+            enum Token        tk = field_decl->type_decl->data.basic_type_decl->tk;
+            char             *default_var = pack_str_arg(basic_type_default_val[tk], LIT_PREFIX, false);
+            char             *var_name = _gen_var_name(field_decl->name_expr);
+            *tac = _create_typed_tac(*tac, TAC_MOV, _basic_tac_type(basic_types[tk].code), var_name, default_var, NULL);
             gen_tac_from_ast(field_decl->assign_expr, tac, func_name);
             return var_name;
         }
         case FUNC_DECL: {
             struct FuncDecl *func_decl = node->data.func_decl;
-            *tac = create_tac(*tac, TAC_LABEL, pack_str_arg(func_decl->name_expr->data.name_expr->value, FUNC_S_PREFIX, false), NULL, NULL);
-            gen_tac_from_ast(func_decl->body, tac, (*tac)->x);
-            *tac = create_tac(*tac, TAC_LABEL, pack_str_arg(func_decl->name_expr->data.name_expr->value, FUNC_E_PREFIX, false), NULL, NULL);
+            *tac = create_tac(*tac, TAC_LABEL, _gen_func_label(FUNC_S_PREFIX, func_decl->name_expr->data.name_expr->value, node->scope), NULL, NULL);
+            char *func_label = (*tac)->x;
+            trace_begin(func_label, "ir_gen");
+            // MOV param, A#i
+            for (int i = 0; i < func_decl->param_size; i++) {
+                struct FieldDecl *param_decl = func_decl->param_decls[i]->data.field_decl;
+                char              arg[256];
+                sprintf(arg, "%c#%d", ARG_PREFIX, i);
+                *tac = _create_typed_tac(*tac,
+                                         TAC_MOV,
+                                         _basic_tac_type(basic_types[param_decl->type_decl->data.basic_type_decl->tk].code),
+                                         _gen_var_name(param_decl->name_expr),
+                                         arg,
+                                         NULL);
+            }
+            gen_tac_from_ast(func_decl->body, tac, func_label);
+            *tac = create_tac(*tac, TAC_LABEL, _gen_func_label(FUNC_E_PREFIX, func_decl->name_expr->data.name_expr->value, node->scope), NULL, NULL);
+            trace_end();
             break;
         }
         case IF_CTRL: {
             struct IfCtrl *if_ctrl = node->data.if_ctrl;
-            char           if_true[256];
             char           if_false[256];
             char           if_end[256];
-            sprintf(if_true, "%s#%d", IF_TRUE, node->id);
             sprintf(if_false, "%s#%d", IF_FALSE, node->id);
             sprintf(if_end, "%s#%d", IF_END, node->id);
-            // t1 = a < b
-            char *cond_res = gen_tac_from_ast(if_ctrl->cond, tac, func_name);
-            // JE t1, 1 IF_TRUE
-            *tac = create_tac(*tac, TAC_JE, cond_res, pack_int_arg(1), if_true);
-            // JMP IF_FALSE
-            *tac = create_tac(*tac, TAC_JMP, if_false, NULL, NULL);
-            // LABEL IF_TRUE
-            *tac = create_tac(*tac, TAC_LABEL, if_true, NULL, NULL);
+            bool has_else = if_ctrl->else_if_size || if_ctrl->_else;
+            // JLE a, b, IF_FALSE
+            _gen_branch(if_ctrl->cond, NULL, has_else ? if_false : if_end, tac, func_name);
             gen_tac_from_ast(if_ctrl->then, tac, func_name);
-            // JMP IF_END
-            *tac = create_tac(*tac, TAC_JMP, if_end, NULL, NULL);
-            // LABEL IF_FALSE
-            *tac = create_tac(*tac, TAC_LABEL, if_false, NULL, NULL);
-            for (int i = 0; i < if_ctrl->else_if_size; i++) gen_tac_from_ast(if_ctrl->else_ifs[i], tac, func_name);
-            gen_tac_from_ast(if_ctrl->_else, tac, func_name);
+            if (has_else) {
+                // JMP IF_END
+                _gen_jmp(if_end, tac);
+                // LABEL IF_FALSE
+                *tac = create_tac(*tac, TAC_LABEL, if_false, NULL, NULL);
+                for (int i = 0; i < if_ctrl->else_if_size; i++) _gen_else_if(if_ctrl->else_ifs[i], if_end, tac, func_name);
+                gen_tac_from_ast(if_ctrl->_else, tac, func_name);
+            }
             // LABEL IF_END
             *tac = create_tac(*tac, TAC_LABEL, if_end, NULL, NULL);
             break;
@@ -270,30 +417,13 @@ char *gen_tac_from_ast(struct AstNode *node, struct TAC **tac, char *func_name)
         case RETURN_CTRL: {
             struct ReturnCtrl *return_ctrl = node->data.return_ctrl;
             char              *ret_var = gen_tac_from_ast(return_ctrl->ret_val, tac, func_name);
-            *tac = create_tac(*tac, TAC_RET, ret_var, NULL, func_name);
+            *tac = _create_typed_tac(*tac, TAC_RET, _tac_type(return_ctrl->ret_val), ret_var, NULL, func_name);
             break;
         }
         case ELSE_IF_CTRL: {
-            struct ElseIfCtrl *else_if_ctrl = node->data.else_if_ctrl;
-            char               if_true[256];
-            char               if_false[256];
-            char               if_end[256];
-            sprintf(if_true, "%s#%d", IF_TRUE, node->id);
-            sprintf(if_false, "%s#%d", IF_FALSE, node->id);
+            char if_end[256];
             sprintf(if_end, "%s#%d", IF_END, node->id);
-            // t1 = a < b
-            char *cond_res = gen_tac_from_ast(else_if_ctrl->cond, tac, func_name);
-            // JE t1, 1 IF_TRUE
-            *tac = create_tac(*tac, TAC_JE, cond_res, pack_int_arg(1), if_true);
-            // JMP IF_FALSE
-            *tac = create_tac(*tac, TAC_JMP, if_false, NULL, NULL);
-            // LABEL IF_TRUE
-            *tac = create_tac(*tac, TAC_LABEL, if_true, NULL, NULL);
-            gen_tac_from_ast(else_if_ctrl->then, tac, func_name);
-            // JMP IF_END
-            *tac = create_tac(*tac, TAC_JMP, if_end, NULL, NULL);
-            // LABEL IF_FALSE
-            *tac = create_tac(*tac, TAC_LABEL, if_false, NULL, NULL);
+            _gen_else_if(node, if_end, tac, func_name);
             // LABEL IF_END
             *tac = create_tac(*tac, TAC_LABEL, if_end, NULL, NULL);
             break;
@@ -301,25 +431,27 @@ char *gen_tac_from_ast(struct AstNode *node, struct TAC **tac, char *func_name)
         case FOR_CTRL: {
             struct ForCtrl *for_ctrl = node->data.for_ctrl;
             char            for_start[256];
-            char            for_body[256];
+            char            for_update[256];
             char            for_end[256];
             sprintf(for_start, "%s#%d", FOR_START, node->id);
-            sprintf(for_body, "%s#%d", FOR_BODY, node->id);
+            sprintf(for_update, "%s#%d", FOR_UPDATE, node->id);
             sprintf(for_end, "%s#%d", FOR_END, node->id);
             // for inits
             for (int i = 0; i < for_ctrl->inits_size; i++) gen_tac_from_ast(for_ctrl->inits[i], tac, func_name);
             // LABEL FOR_START
             *tac = create_tac(*tac, TAC_LABEL, for_start, NULL, NULL);
-            // cond t1 = i <= n
-            char *cond_res = gen_tac_from_ast(for_ctrl->cond, tac, func_name);
-            // JE t1, 1 FOR_BODY
-            *tac = create_tac(*tac, TAC_JE, cond_res, pack_int_arg(1), for_body);
-            // JMP FOR_END
-            *tac = create_tac(*tac, TAC_JMP, for_end, NULL, NULL);
-            // LABEL FOR_BODY
-            *tac = create_tac(*tac, TAC_LABEL, for_body, NULL, NULL);
+            // cond JGT i, n, FOR_END
+            if (for_ctrl->cond) _gen_branch(for_ctrl->cond, NULL, for_end, tac, func_name);
             // for body
+            if (loop_depth == MAX_LOOP_DEPTH) {
+                fprintf(stderr, "gen_tac_from_ast(), loops nested too deep\n");
+                exit(EXIT_FAILURE);
+            }
+            loop_ids[loop_depth++] = node->id;
             gen_tac_from_ast(for_ctrl->body, tac, func_name);
+            loop_depth--;
+            // LABEL FOR_UPDATE
+            *tac = create_tac(*tac, TAC_LABEL, for_update, NULL, NULL);
             // for updates
             for (int i = 0; i < for_ctrl->updates_size; i++) gen_tac_from_ast(for_ctrl->updates[i], tac, func_name);
             // JMP FOR_START
@@ -330,14 +462,14 @@ char *gen_tac_from_ast(struct AstNode *node, struct TAC **tac, char *func_name)
         }
         case BREAK_CTRL: {
             char for_end[256];
-            sprintf(for_end, "%s#%d", FOR_END, node->id);
+            sprintf(for_end, "%s#%d", FOR_END, loop_ids[loop_depth - 1]);
             *tac = create_tac(*tac, TAC_JMP, for_end, NULL, NULL);
             break;
         }
         case CONTINUE_CTRL: {
-            char for_start[256];
-            sprintf(for_start, "%s#%d", FOR_START, node->id);
-            *tac = create_tac(*tac, TAC_JMP, for_start, NULL, NULL);
+            char for_update[256];
+            sprintf(for_update, "%s#%d", FOR_UPDATE, loop_ids[loop_depth - 1]);
+            *tac = create_tac(*tac, TAC_JMP, for_update, NULL, NULL);
             break;
         }
         case BASIC_LIT: return pack_str_arg(node->data.basic_lit->value, LIT_PREFIX, false);
@@ -9,20 +9,34 @@
 #define IF_END "IF_END"
 
 #define FOR_START "FOR_START"
-#define FOR_BODY "FOR_BODY"
+#define FOR_UPDATE "FOR_UPDATE"
 #define FOR_END "FOR_END"
 
+#define COND_END "COND_END"
+#define BOOL_FALSE "BOOL_FALSE"
+#define BOOL_END "BOOL_END"
+
+#define MAX_LOOP_DEPTH 256
+
 #define VAR_PREFIX 'V'
 #define LIT_PREFIX 'L'
 #define FUNC_S_PREFIX 'S'
 #define FUNC_E_PREFIX 'E'
+#define ARG_PREFIX 'A' // A#<index>, argument of the current call
+
+#define LOCAL_VAR_SEP '@' // V#name@func, var declared in func
+#define SCOPE_SEP '.'     // V#name.<scope id> & S#func.<scope id>, var or func declared in a nested scope
+#define TEMP_PREFIX '$'   // V#$t<id>, temp var of the generator, no ident starts with it, so no user var looks like one
 
 char *pack_str_arg(char *name, char prefix, bool need_free);
 char *pack_int_arg(int val);
 char *pack_float_arg(float val);
 char *unpack_name(char *name);
+bool  is_temp_var(char *name);
 
 // return the result var name
 char *gen_tac_from_ast(struct AstNode *node, struct TAC **tac, char *func_name);
+// temp vars are named from $t0 again, call it before generating another file
+void  reset_tac_var_id();
 
 #endif
\ No newline at end of file
@@ -1,237 +1,306 @@
 #include "ir_optimize.h"
 #include "global.h"
 #include "ir.h"
-#include "c_hashmap.h"
+#include "swiss_map.h"
 #include "ir_gen.h"
+#include "ir_simplify.h"
+#include "ir_fold.h"
+#include "ir_peephole.h"
 
-#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-hashmap branch_block_tac_map;
-
-struct BranchBlockTacEntryValue {
-    struct TAC        *tac;
-    struct BasicBlock *block;
+// name table of a pass, hashmap for lookup & entry list for enumeration
+struct NameEntry {
+    char *name;
+    int   id; // index in the entry list
+    int   mark;
 };
 
-struct BranchBlockTacEntry {
-    char                           *name;
-    struct BranchBlockTacEntryValue value;
+SWISS_STR_MAP(NameMap, name_map, struct NameEntry *)
+
+struct NameTable {
+    struct Arena      *arena; // owns name entries & facts of a pass run on a function
+    struct NameMap     map;
+    struct NameEntry **entries;
+    int                size;
+    int                cap;
 };
 
-struct BranchBlockTacEntry *_create_branch_block_tac_naming_entry(char *name, struct TAC *tac) {
-    struct BranchBlockTacEntry *e = CREATE_STRUCT_P(BranchBlockTacEntry);
-    e->name = calloc(sizeof(char), strlen(name) + 1);
-    if (!e->name) {
-        fprintf(stderr, "_create_tac_naming_entry(), no enough memory");
-        free(e);
+static char *_arena_strdup(struct Arena *arena, char *s) {
+    char *d = arena_alloc(arena, strlen(s) + 1);
+    strcpy(d, s);
+    return d;
+}
+
+static struct NameTable *_create_name_table() {
+    struct NameTable *t = CREATE_STRUCT_P(NameTable);
+    if (!t) {
+        fprintf(stderr, "_create_name_table(), no enough memory\n");
         exit(EXIT_FAILURE);
     }
-
-    strcpy(e->name, name);
-    e->value = (struct BranchBlockTacEntryValue){.tac = tac};
-
-    return e;
+    t->arena = create_arena();
+    name_map_init(&t->map);
+    return t;
 }
 
-void *_get_tac_naming_entry_name(void *ele) {
-    return ((struct BranchBlockTacEntry *)ele)->name;
+static void _free_name_table(struct NameTable *t) {
+    name_map_free(&t->map);
+    free(t->entries);
+    free_arena(t->arena);
+    free(t);
 }
 
-void *_get_tac_naming_entry_tac(void *ele) {
-    return &((struct BranchBlockTacEntry *)ele)->value;
+static void _name_table_clear(struct NameTable *t) {
+    name_map_clear(&t->map);
+    t->size = 0;
 }
 
-void _update_tac_naming_entry(void *ele1, void *ele2) {
-    ((struct BranchBlockTacEntry *)ele1)->value = ((struct BranchBlockTacEntry *)ele2)->value;
+static struct NameEntry *_name_table_get(struct NameTable *t, char *name) {
+    struct NameEntry **e = name_map_get(&t->map, name);
+    return e ? *e : NULL;
 }
 
-bool _tac_naming_entry_eq_func(void *inner_entry1, void *inner_entry2) {
-    return ((struct BranchBlockTacEntryValue *)inner_entry1)->tac == ((struct BranchBlockTacEntryValue *)inner_entry2)->tac;
+// the name is hashed once, for both the lookup & the insertion
+static struct NameEntry *_name_table_put(struct NameTable *t, char *name) {
+    uint64_t           hash = name_map_hash(name);
+    struct NameEntry **slot = name_map_get_hashed(&t->map, name, hash);
+    if (slot) return *slot;
+
+    if (t->size == t->cap) {
+        int                new_cap = t->cap ? t->cap << 1 : 64;
+        struct NameEntry **entries = realloc(t->entries, new_cap * sizeof(struct NameEntry *));
+        if (!entries) {
+            fprintf(stderr, "_name_table_put(), no enough memory\n");
+            exit(EXIT_FAILURE);
+        }
+        t->entries = entries;
+        t->cap = new_cap;
+    }
+
+    struct NameEntry *e = arena_alloc(t->arena, sizeof(struct NameEntry));
+    e->name = _arena_strdup(t->arena, name);
+    e->id = t->size;
+    *name_map_put_hashed(&t->map, e->name, hash) = e;
+    t->entries[t->size++] = e;
+    return e;
 }
 
-void _init_branch_block_tac_map(struct TAC *tac) {
-    branch_block_tac_map = hashmap_new_default(
-        _get_tac_naming_entry_name, _get_tac_naming_entry_tac, _update_tac_naming_entry, str_hash_func, str_eq_func, _tac_naming_entry_eq_func);
+// unlink tac from the tac list, the block would never be empty
+static bool _remove_tac(struct BasicBlock *block, struct TAC *tac) {
+    if (block->head == block->tail) return false;
 
-    while (tac) {
-        switch (tac->op) {
-            case TAC_LABEL: {
-                struct BranchBlockTacEntry *e = _create_branch_block_tac_naming_entry(tac->x, tac);
-                hashmap_put(branch_block_tac_map, e);
-                break;
-            }
-            default: break;
-        }
-        tac = tac->next;
-    }
+    if (tac == block->head) block->head = tac->next;
+    if (tac == block->tail) block->tail = tac->prev;
+    tac->prev->next = tac->next;
+    if (tac->next) tac->next->prev = tac->prev;
+    return true;
 }
 
-struct BasicBlock *create_basic_block(struct TAC *tac) {
-    if (!tac) return NULL;
+static bool _is_var(char *name) {
+    return name[0] == VAR_PREFIX && name[1] == '#';
+}
 
-    // if (tac->op == TAC_HEAD) return create_basic_block(tac->next);
+static bool _is_lit(char *name) {
+    return name[0] == LIT_PREFIX && name[1] == '#';
+}
 
-    struct BasicBlock *block = CREATE_STRUCT_P(BasicBlock);
-    if (!block) {
-        fprintf(stderr, "create_basic_block(), no enough memory");
-        exit(EXIT_FAILURE);
-    }
+static bool _is_operation(enum TacOpCode op) {
+    return op >= TAC_EQ && op <= TAC_NOT;
+}
 
-    block->successors = calloc(8, sizeof(struct BasicBlock *));
-    block->successors_cap = 8;
-    block->successors_size = 0;
-    if (!block->successors) {
-        fprintf(stderr, "create_basic_block(), no enough memory");
-        free(block);
-        exit(EXIT_FAILURE);
-    }
-    block->head = tac;
-    block->visited = false;
-    block->level = INT32_MAX;
-
-    return block;
-}
-
-void _connect_basic_block(struct BasicBlock *block, int level) {
-    if (!block) return;
-
-    if (block->level > level) block->level = level;
-    struct TAC *tail = block->tail;
-    if (tail->op == TAC_CALL || tail->op == TAC_RET || tail->op == TAC_JMP || tail->op == TAC_JE || tail->op == TAC_JNE) {
-        char *name = NULL;
-        if (tail->op == TAC_CALL || tail->op == TAC_JMP) name = tail->x;
-        else name = tail->res;
-        struct BranchBlockTacEntryValue *v = hashmap_get(branch_block_tac_map, &(struct BranchBlockTacEntry){.name = name});
-        struct BasicBlock               *successor = v->block;
-        bool                             added = false;
-        for (int i = 0; i < block->successors_size; i++)
-            if (block->successors[i] == successor) {
-                added = true;
-                break;
-            }
-        if (!added) {
-            block->successors[block->successors_size++] = successor;
-            _connect_basic_block(successor, level + 1);
-        }
+static bool _is_same_tac(struct TAC *a, struct TAC *b) {
+    return a->op == b->op && a->type == b->type && !strcmp(a->x, b->x) && !strcmp(a->y, b->y) && !strcmp(a->res, b->res);
+}
 
-        if (tail->op == TAC_JE || tail->op == TAC_JNE || tail->op == TAC_CALL) goto NEXT_BLOCK;
-        return;
-    }
+// ---------------------Facts---------------------
+
+/*
+ * Facts of the forward passes, a persistent map from var id to value, NULL if the value is not known.
+ * Only the current version has its values in the dense array, any other version is a diff towards it,
+ * a version is made current by applying the diffs on the way & reversing them.
+ * Blocks keep the version they leave with, versions share all vars but those assigned in between,
+ * so facts take memory & time of the assignments, instead of blocks × vars.
+ */
+struct FactVersion {
+    struct FactVersion *next;  // towards the current version, NULL if it is the current one
+    int                 id;    // var this version differs from next in
+    char               *value; // value of the var in this version
+};
 
-NEXT_BLOCK:
-    if (!block->next) return;
+// a var once copied from another var, so copies of a var are killed without a scan
+struct Copier {
+    int            id;
+    struct Copier *next;
+};
 
-    struct BasicBlock *successor = block->next;
-    while (successor && successor->head->op == TAC_LABEL && successor->head->x[0] == 'S') {
-        // func body, ignore
-        char *func_name = calloc(strlen(successor->head->x) + 1, sizeof(char));
-        if (!func_name) {
-            fprintf(stderr, "_connect_basic_block(), no enough memory");
-            exit(EXIT_FAILURE);
-        }
-        strcpy(func_name, successor->head->x);
-        func_name[0] = 'E';
-        struct BranchBlockTacEntryValue *v = hashmap_get(branch_block_tac_map, &(struct BranchBlockTacEntry){.name = func_name});
-        // jump to func end block
-        successor = v->tac->block->next;
-    }
+struct FactTable {
+    struct NameTable   *vars;    // var name => id, owns versions & values
+    char              **values;  // values of the current version by var id
+    int                *seen;    // stamp of the last walk which met the var
+    struct Copier     **copiers; // vars once copied from the var, by var id
+    int                 cap;
+    int                 stamp;
+    struct FactVersion *entry; // version entering the function, nothing is known
+    struct FactVersion *current;
+};
 
-    // connect successor
-    if (!successor) return;
-    bool added = false;
-    for (int i = 0; i < block->successors_size; i++)
-        if (block->successors[i] == successor) {
-            added = true;
-            break;
-        }
-    if (!added) {
-        block->successors[block->successors_size++] = successor;
-        _connect_basic_block(successor, level + 1);
+static struct FactTable *_create_fact_table() {
+    struct FactTable *t = CREATE_STRUCT_P(FactTable);
+    if (!t) {
+        fprintf(stderr, "_create_fact_table(), no enough memory\n");
+        exit(EXIT_FAILURE);
     }
+    t->vars = _create_name_table();
+    t->entry = t->current = arena_alloc(t->vars->arena, sizeof(struct FactVersion));
+    return t;
+}
+
+static void _free_fact_table(struct FactTable *t) {
+    _free_name_table(t->vars);
+    free(t->values);
+    free(t->seen);
+    free(t->copiers);
+    free(t);
 }
 
-struct CFG *create_cfg(struct TAC *tac) {
-    struct CFG *cfg = CREATE_STRUCT_P(CFG);
-    if (!cfg) {
-        fprintf(stderr, "create_cfg(), no enough memory");
+// id of the var, a var met the first time is not known in any version
+static int _fact_id(struct FactTable *t, char *name) {
+    int id = _name_table_put(t->vars, name)->id;
+    if (id < t->cap) return id;
+
+    int             new_cap = t->vars->cap;
+    char          **values = realloc(t->values, new_cap * sizeof(char *));
+    int            *seen = realloc(t->seen, new_cap * sizeof(int));
+    struct Copier **copiers = realloc(t->copiers, new_cap * sizeof(struct Copier *));
+    if (!values || !seen || !copiers) {
+        fprintf(stderr, "_fact_id(), no enough memory\n");
         exit(EXIT_FAILURE);
     }
+    memset(values + t->cap, 0, (new_cap - t->cap) * sizeof(char *));
+    memset(seen + t->cap, 0, (new_cap - t->cap) * sizeof(int));
+    memset(copiers + t->cap, 0, (new_cap - t->cap) * sizeof(struct Copier *));
+    t->values = values;
+    t->seen = seen;
+    t->copiers = copiers;
+    t->cap = new_cap;
+    return id;
+}
 
-    _init_branch_block_tac_map(tac);
-
-    struct TAC        *cur_tac = tac;
-    struct BasicBlock *cur_block = NULL;
-    struct BasicBlock *last_block = NULL;
-    while (cur_tac) {
-        // start of a basic block
-        if (!cur_block || (cur_tac->op == TAC_LABEL && cur_tac->x[0] != 'E')) {
-            struct BasicBlock *new_block = create_basic_block(cur_tac);
-            new_block->head = cur_tac;
-            cur_tac->block = new_block;
-
-            if (cur_tac->op == TAC_LABEL && cur_tac->x[0] != 'E') {
-                struct BranchBlockTacEntryValue *v = hashmap_get(branch_block_tac_map, &(struct BranchBlockTacEntry){.name = cur_tac->x});
-                if (!v) {
-                    fprintf(stderr, "create_cfg(), can not find tac with name %s", cur_tac->x);
-                    exit(EXIT_FAILURE);
-                }
-                v->block = new_block;
-            }
+static char *_fact_get(struct FactTable *t, char *name) {
+    struct NameEntry *e = _name_table_get(t->vars, name);
+    return e ? t->values[e->id] : NULL;
+}
 
-            if (!cfg->entry) cfg->entry = new_block;
-            else last_block->next = new_block;
+static bool _is_same_value(char *a, char *b) {
+    return a == b || (a && b && !strcmp(a, b));
+}
 
-            last_block = new_block;
-            cur_block = new_block;
-        } else cur_tac->block = cur_block;
+// the current version is left as a diff towards the new one
+static void _fact_set(struct FactTable *t, int id, char *value) {
+    if (_is_same_value(t->values[id], value)) return;
 
-        // end of basic block
-        cur_block->tail = cur_tac;
+    struct FactVersion *v = arena_alloc(t->vars->arena, sizeof(struct FactVersion));
+    t->current->next = v;
+    t->current->id = id;
+    t->current->value = t->values[id];
+    t->values[id] = value;
+    t->current = v;
+}
 
-        if ((cur_tac->op == TAC_LABEL && cur_tac->x[0] == 'E') || cur_tac->op == TAC_CALL || cur_tac->op == TAC_RET || cur_tac->op == TAC_JMP ||
-            cur_tac->op == TAC_JE || cur_tac->op == TAC_JNE)
-            cur_block = NULL;
+static void _fact_reroot(struct FactTable *t, struct FactVersion *version) {
+    // reverse the way from the version to the current one, each version then points towards the version
+    struct FactVersion *prev = NULL;
+    for (struct FactVersion *v = version, *next; v; v = next) {
+        next = v->next;
+        v->next = prev;
+        prev = v;
+    }
+    // apply the diff of each version on the way, the version left holds the old value instead
+    for (struct FactVersion *v = t->current; v != version; v = v->next) {
+        struct FactVersion *diff = v->next;
+        v->id = diff->id;
+        v->value = t->values[diff->id];
+        t->values[diff->id] = diff->value;
+    }
+    t->current = version;
+}
 
-        cur_tac = cur_tac->next;
+// only vars on the way from the version to the current one could differ, they are forgotten if kill, or the walk stops at the first
+static bool _fact_differ(struct FactTable *t, struct FactVersion *version, bool kill) {
+    bool differ = false;
+    t->stamp++;
+    for (struct FactVersion *v = version; v->next; v = v->next) {
+        if (t->seen[v->id] == t->stamp) continue;
+
+        t->seen[v->id] = t->stamp;
+        if (_is_same_value(v->value, t->values[v->id])) continue;
+        if (!kill) return true;
+        _fact_set(t, v->id, NULL);
+        differ = true;
     }
+    return differ;
+}
 
-    _connect_basic_block(cfg->entry, 0);
+// facts entering the block are those agreed by all reachable predecessors, predecessors not visited yet agree with anything
+static void _fact_meet(struct FactTable *t, struct BasicBlock *block) {
+    bool met = false;
+    for (int i = 0; i < block->predecessors_size; i++) {
+        struct BasicBlock *pred = block->predecessors[i];
+        if (pred->rpo < 0 || !pred->data) continue;
 
-    // do not need
-    hashmap_free(branch_block_tac_map);
-    return cfg;
+        if (met) _fact_differ(t, pred->data, true);
+        else _fact_reroot(t, pred->data);
+        met = true;
+    }
+    if (!met) _fact_reroot(t, t->entry);
 }
 
-hashmap pre_tac_map;
+// the block keeps the current version, no copy is made
+static int _fact_leave(struct FactTable *t, struct BasicBlock *block) {
+    struct FactVersion *old = block->data;
+    block->data = t->current;
+    return !old || _fact_differ(t, old, false) ? PASS_FACTS_CHANGED : 0;
+}
 
-struct PreTacEntry {
-    char *name;
-    char *value;
-};
+static void _fact_kill(struct FactTable *t, char *name) {
+    if (!*name) return;
 
-void *_get_pre_tac_entry_name(void *ele) {
-    return ((struct PreTacEntry *)ele)->name;
+    struct NameEntry *e = _name_table_get(t->vars, name);
+    if (e) _fact_set(t, e->id, NULL);
 }
 
-void *_get_pre_tac_entry_value(void *ele) {
-    return ((struct PreTacEntry *)ele)->value;
+// ---------------------Pre Optimization---------------------
+
+// literal value of the operand if known, or the operand itself
+static char *_pre_value(struct FactTable *pre_facts, char *operand) {
+    if (!_is_var(operand)) return operand;
+
+    char *value = _fact_get(pre_facts, operand);
+    return value ? value : operand;
 }
 
-void _update_pre_tac_entry(void *ele1, void *ele2) {
-    ((struct PreTacEntry *)ele1)->value = ((struct PreTacEntry *)ele2)->value;
+static void _pre_replace(struct FactTable *pre_facts, char *operand, bool transform, int *res) {
+    char *value = _pre_value(pre_facts, operand);
+    if (!transform || value == operand) return;
+
+    strcpy(operand, value);
+    *res |= PASS_CODE_CHANGED;
 }
 
-void _init_pre_tac_map() {
-    pre_tac_map = hashmap_new_default(_get_pre_tac_entry_name, _get_pre_tac_entry_value, _update_pre_tac_entry, str_hash_func, str_eq_func, str_eq_func);
+static void _pre_set(struct FactTable *pre_facts, char *name, char *value) {
+    int id = _fact_id(pre_facts, name);
+    if (!_is_same_value(pre_facts->values[id], value)) _fact_set(pre_facts, id, _arena_strdup(pre_facts->vars->arena, value));
 }
 
-void pre_optimization(struct BasicBlock *block) {
-    struct TAC *tac = block->head;
+// constant propagation, typed folding & algebraic simplification
+int pre_optimization(struct BasicBlock *block, void *ctx, bool transform) {
+    struct FactTable *pre_facts = ctx;
+    int               res = 0;
+    _fact_meet(pre_facts, block);
 
-    while (tac) {
+    for (struct TAC *tac = block->head;; tac = tac->next) {
         switch (tac->op) {
             case TAC_HEAD: break;
             case TAC_EQ:
@@ -251,361 +320,380 @@ void pre_optimization(struct BasicBlock *block) {
             case TAC_SHL:
             case TAC_SHR:
             case TAC_NOT: {
-                if (tac->x[0] == 'V') {
-                    char *v = hashmap_get(pre_tac_map, &(struct PreTacEntry){.name = tac->x});
-                    if (v) strcpy(tac->x, v);
-                }
-
-                if (tac->y[0] == 'V') {
-                    char *v = hashmap_get(pre_tac_map, &(struct PreTacEntry){.name = tac->y});
-                    if (v) strcpy(tac->y, v);
-                }
-
-                if (tac->x[0] == 'L' && tac->y[0] == 'L') {
-                    // compute literal
-                    int v_x = atoi(unpack_name(tac->x));
-                    int v_y = atoi(unpack_name(tac->y));
-
-                    char *res = calloc(256, sizeof(char));
-                    if (!res) {
-                        fprintf(stderr, "pre_optimization(), no enough memory");
-                        exit(EXIT_FAILURE);
-                    }
-                    if (tac->op == TAC_EQ) strcpy(res, pack_str_arg(v_x == v_y ? "true" : "false", LIT_PREFIX, false));
-                    else if (tac->op == TAC_NE) strcpy(res, pack_str_arg(v_x != v_y ? "true" : "false", LIT_PREFIX, false));
-                    else if (tac->op == TAC_LT) strcpy(res, pack_str_arg(v_x < v_y ? "true" : "false", LIT_PREFIX, false));
-                    else if (tac->op == TAC_LE) strcpy(res, pack_str_arg(v_x <= v_y ? "true" : "false", LIT_PREFIX, false));
-                    else if (tac->op == TAC_GT) strcpy(res, pack_str_arg(v_x > v_y ? "true" : "false", LIT_PREFIX, false));
-                    else if (tac->op == TAC_GE) strcpy(res, pack_str_arg(v_x >= v_y ? "true" : "false", LIT_PREFIX, false));
-                    else if (tac->op == TAC_ADD) strcpy(res, pack_int_arg(v_x + v_y));
-                    else if (tac->op == TAC_SUB) strcpy(res, pack_int_arg(v_x - v_y));
-                    else if (tac->op == TAC_MUL) strcpy(res, pack_int_arg(v_x * v_y));
-                    else if (tac->op == TAC_QUO) strcpy(res, pack_int_arg(v_x / v_y));
-                    else if (tac->op == TAC_REM) strcpy(res, pack_int_arg(v_x % v_y));
-                    else if (tac->op == TAC_AND) strcpy(res, pack_int_arg(v_x & v_y));
-                    else if (tac->op == TAC_OR) strcpy(res, pack_int_arg(v_x | v_y));
-                    else if (tac->op == TAC_XOR) strcpy(res, pack_int_arg(v_x ^ v_y));
-                    else if (tac->op == TAC_SHL) strcpy(res, pack_int_arg(v_x << v_y));
-                    else if (tac->op == TAC_SHR) strcpy(res, pack_int_arg(v_x >> v_y));
-                    else if (tac->op == TAC_NOT) strcpy(res, pack_int_arg(!v_x));
-
-                    tac->op = TAC_MOV;
-                    strcpy(tac->x, tac->res);
-                    strcpy(tac->y, res);
-                    tac->res[0] = '\0';
-
-                    struct PreTacEntry *e = CREATE_STRUCT_P(PreTacEntry);
-                    e->name = tac->x;
-                    e->value = res;
-                    hashmap_put(pre_tac_map, e);
-                } else hashmap_remove(pre_tac_map, &(struct PreTacEntry){.name = tac->res});
-
+                // fold or simplify a copy with operands propagated, keep it if transforming
+                struct TAC op_tac = *tac;
+                strcpy(op_tac.x, _pre_value(pre_facts, tac->x));
+                strcpy(op_tac.y, _pre_value(pre_facts, tac->y));
+                if (!fold_tac(&op_tac)) simplify_tac(&op_tac);
+
+                if (op_tac.op == TAC_MOV && _is_lit(op_tac.y)) _pre_set(pre_facts, tac->res, op_tac.y);
+                else _fact_kill(pre_facts, tac->res);
+                if (!transform || _is_same_tac(tac, &op_tac)) break;
+
+                tac->op = op_tac.op;
+                tac->type = op_tac.type;
+                strcpy(tac->x, op_tac.x);
+                strcpy(tac->y, op_tac.y);
+                strcpy(tac->res, op_tac.res);
+                res |= PASS_CODE_CHANGED;
                 break;
             }
             case TAC_MOV: {
-                if (tac->y[0] == 'L') {
-                    struct PreTacEntry *e = CREATE_STRUCT_P(PreTacEntry);
-                    e->name = tac->x;
-                    e->value = calloc(strlen(tac->y) + 1, sizeof(char));
-                    if (!e->value) {
-                        fprintf(stderr, "pre_optimization(), no enough memory");
-                        exit(EXIT_FAILURE);
-                    }
-                    strcpy(e->value, tac->y);
-                    hashmap_put(pre_tac_map, e);
-                    break;
-                }
-                char *v = hashmap_get(pre_tac_map, &(struct PreTacEntry){.name = tac->y});
-                if (v) {
-                    strcpy(tac->y, v);
-
-                    // put new entry
-                    struct PreTacEntry *e = CREATE_STRUCT_P(PreTacEntry);
-                    e->name = tac->x;
-                    e->value = v;
-                    hashmap_put(pre_tac_map, e);
-                } else hashmap_remove(pre_tac_map, &(struct PreTacEntry){.name = tac->x});
-
+                char *y = _pre_value(pre_facts, tac->y);
+                if (_is_lit(y)) _pre_set(pre_facts, tac->x, y);
+                else _fact_kill(pre_facts, tac->x);
+                _pre_replace(pre_facts, tac->y, transform, &res);
+                break;
+            }
+            case TAC_JE:
+            case TAC_JNE:
+            case TAC_JLT:
+            case TAC_JLE:
+            case TAC_JGT:
+            case TAC_JGE: {
+                _pre_replace(pre_facts, tac->x, transform, &res);
+                _pre_replace(pre_facts, tac->y, transform, &res);
                 break;
             }
             case TAC_RET:
             case TAC_PARAM: {
-                if (tac->x[0] == 'V') {
-                    char *v = hashmap_get(pre_tac_map, &(struct PreTacEntry){.name = tac->x});
-                    if (v) strcpy(tac->x, v);
-                }
+                _pre_replace(pre_facts, tac->x, transform, &res);
+                break;
+            }
+            case TAC_CALL: {
+                // callee may assign any named var
+                for (int id = 0; id < pre_facts->vars->size; id++)
+                    if (pre_facts->values[id] && !is_temp_var(pre_facts->vars->entries[id]->name)) _fact_set(pre_facts, id, NULL);
+                _fact_kill(pre_facts, tac->res);
                 break;
             }
             case TAC_JMP:
-            case TAC_JE:
-            case TAC_JNE:
-            case TAC_LABEL:
-            case TAC_CALL: break;
+            case TAC_LABEL: break;
         }
 
         if (tac == block->tail) break;
-        tac = tac->next;
     }
+
+    // rewriting keeps the facts, which are fixed already
+    return transform ? res : _fact_leave(pre_facts, block);
 }
 
-hashmap post_tac_map;
+// ---------------------Post Optimization---------------------
 
-#define MW_USE_OFFSET 8
-#define MW_ASSIGN_OFFSET 24
-#define MW_OP_USE 0
-#define MW_OP_ASSIGN 1
+#define POST_LIVE 1       // temp var would be used later
+#define POST_DEAD_STORE 2 // named var would be assigned later before any use
 
-struct PostTacEntry {
-    char *name;
-    int   mark_word;
+// temp vars live into a block
+struct LiveTemps {
+    char **names;
+    int    size;
 };
 
-void _set_last_op(int *mark_word, int last_op) {
-    if (last_op == MW_OP_USE) *mark_word &= 0xfffffff0;
-    else if (last_op == MW_OP_ASSIGN) *mark_word |= 0x00000001;
-}
+// temp vars live out of the block are those live into any successor, successors not visited yet have nothing live
+static void _post_meet(struct NameTable *post_tac_map, struct BasicBlock *block) {
+    _name_table_clear(post_tac_map);
 
-int _get_last_op(int *mark_word) {
-    return *mark_word & 0x0000000f;
-}
+    for (int i = 0; i < block->successors_size; i++) {
+        struct LiveTemps *live = block->successors[i]->data;
+        if (!live) continue;
 
-void _inc_use(int *mark_word) {
-    *mark_word += 1 << MW_USE_OFFSET;
+        for (int j = 0; j < live->size; j++) _name_table_put(post_tac_map, live->names[j])->mark = POST_LIVE;
+    }
 }
 
-void _set_assigned(int *mark_word) {
-    *mark_word |= 1 << MW_ASSIGN_OFFSET;
-}
+static bool _post_is_dead(struct NameTable *post_tac_map, char *def) {
+    if (!*def) return false;
 
-int _get_use(int *mark_word) {
-    return (*mark_word & 0x00ffff00) >> MW_USE_OFFSET;
+    struct NameEntry *e = _name_table_get(post_tac_map, def);
+    if (is_temp_var(def)) return !e || !(e->mark & POST_LIVE);
+    return e && e->mark & POST_DEAD_STORE;
 }
 
-bool _is_assigned(int *mark_word) {
-    return *mark_word & 1 << MW_ASSIGN_OFFSET;
-}
+static void _post_def(struct NameTable *post_tac_map, char *def) {
+    if (!*def) return;
 
-void *_get_post_tac_entry_name(void *ele) {
-    return ((struct PostTacEntry *)ele)->name;
+    struct NameEntry *e = _name_table_put(post_tac_map, def);
+    if (is_temp_var(def)) e->mark &= ~POST_LIVE;
+    else e->mark |= POST_DEAD_STORE;
 }
 
-void *_get_post_tac_entry_value(void *ele) {
-    return &((struct PostTacEntry *)ele)->mark_word;
-}
+static void _post_use(struct NameTable *post_tac_map, char *use) {
+    if (!_is_var(use)) return;
 
-void _update_post_tac_entry(void *ele1, void *ele2) {
-    ((struct PostTacEntry *)ele1)->mark_word = ((struct PostTacEntry *)ele2)->mark_word;
+    if (is_temp_var(use)) {
+        _name_table_put(post_tac_map, use)->mark |= POST_LIVE;
+        return;
+    }
+    struct NameEntry *e = _name_table_get(post_tac_map, use);
+    if (e) e->mark &= ~POST_DEAD_STORE;
 }
 
-bool _post_tac_value_eq_func(void *value1, void *value2) {
-    return *((int *)value1) == *((int *)value1);
-}
+static bool _post_is_same_live(struct NameTable *post_tac_map, struct LiveTemps *live, int size) {
+    if (!live || live->size != size) return false;
 
-void _init_post_tac_map() {
-    post_tac_map =
-        hashmap_new_default(_get_post_tac_entry_name, _get_post_tac_entry_value, _update_post_tac_entry, str_hash_func, str_eq_func, _post_tac_value_eq_func);
+    for (int i = 0; i < live->size; i++) {
+        struct NameEntry *e = _name_table_get(post_tac_map, live->names[i]);
+        if (!e || !(e->mark & POST_LIVE)) return false;
+    }
+    return true;
 }
 
-void post_optimization(struct BasicBlock *block) {
-    struct TAC *tac = block->tail;
+// live temps are copied out of the name table only when they changed
+static int _post_leave(struct NameTable *post_tac_map, struct BasicBlock *block) {
+    int size = 0;
+    for (int i = 0; i < post_tac_map->size; i++)
+        if (post_tac_map->entries[i]->mark & POST_LIVE) size++;
+    if (_post_is_same_live(post_tac_map, block->data, size)) return 0;
+
+    struct LiveTemps *live = arena_alloc(post_tac_map->arena, sizeof(struct LiveTemps));
+    live->names = arena_alloc(post_tac_map->arena, (size ? size : 1) * sizeof(char *));
+    for (int i = 0; i < post_tac_map->size; i++) {
+        struct NameEntry *e = post_tac_map->entries[i];
+        if (e->mark & POST_LIVE) live->names[live->size++] = e->name;
+    }
+    block->data = live;
+    return PASS_FACTS_CHANGED;
+}
 
-    while (tac) {
+/*
+ * Redundancy removal.
+ * Temp vars are tracked through the whole function, while named vars may be read by callees,
+ * so they are only removed when assigned again in the same block before any use or call.
+ */
+int post_optimization(struct BasicBlock *block, void *ctx, bool transform) {
+    struct NameTable *post_tac_map = ctx;
+    int               res = 0;
+    struct TAC       *head = block->head;
+    _post_meet(post_tac_map, block);
+
+    for (struct TAC *tac = block->tail;;) {
+        bool is_head = tac == head;
+        // the tac before the head could be of an enclosing func, optimized on another thread, it is not read
+        struct TAC *prev = is_head ? NULL : tac->prev;
+        char       *def = NULL;
         switch (tac->op) {
-            case TAC_HEAD: break;
-            case TAC_EQ:
-            case TAC_NE:
-            case TAC_LT:
-            case TAC_LE:
-            case TAC_GT:
-            case TAC_GE:
-            case TAC_ADD:
-            case TAC_SUB:
-            case TAC_MUL:
-            case TAC_QUO:
-            case TAC_REM:
-            case TAC_AND:
-            case TAC_OR:
-            case TAC_XOR:
-            case TAC_SHL:
-            case TAC_SHR:
-            case TAC_NOT: {
-                int *mark_word_x = hashmap_get(post_tac_map, &(struct PostTacEntry){.name = tac->x});
-                if (mark_word_x) {
-                    _inc_use(mark_word_x);
-                    _set_last_op(mark_word_x, MW_OP_USE);
-                } else {
-                    struct PostTacEntry *e_x = CREATE_STRUCT_P(PostTacEntry);
-                    e_x->name = tac->x;
-                    _inc_use(&e_x->mark_word);
-                    _set_last_op(&e_x->mark_word, MW_OP_USE);
-                    hashmap_put(post_tac_map, e_x);
-                }
-
-                if (*tac->y) {
-                    int *mark_word_y = hashmap_get(post_tac_map, &(struct PostTacEntry){.name = tac->y});
-                    if (mark_word_y) {
-                        _inc_use(mark_word_y);
-                        _set_last_op(mark_word_y, MW_OP_USE);
-                    } else {
-                        struct PostTacEntry *e_y = CREATE_STRUCT_P(PostTacEntry);
-                        e_y->name = tac->y;
-                        _inc_use(&e_y->mark_word);
-                        _set_last_op(&e_y->mark_word, MW_OP_USE);
-                        hashmap_put(post_tac_map, e_y);
-                    }
-                }
+            case TAC_MOV: def = tac->x; break;
+            case TAC_CALL: def = tac->res; break;
+            default:
+                if (_is_operation(tac->op)) def = tac->res;
+        }
 
-                int *mark_word_res = hashmap_get(post_tac_map, &(struct PostTacEntry){.name = tac->res});
-                if (mark_word_res && _get_use(mark_word_res)) {
-                    _set_assigned(mark_word_res);
-                    _set_last_op(mark_word_res, MW_OP_ASSIGN);
-                } else {
-                    // not used, remove MOV
-                    if (tac->next) {
-                        tac->prev->next = tac->next;
-                        tac->next->prev = tac->prev;
-                    } else tac->prev->next = NULL;
-                    if (tac == block->head) return;
-                }
+        if (transform && def && _post_is_dead(post_tac_map, def)) {
+            if (tac->op == TAC_CALL) {
+                tac->res[0] = '\0';
+                res |= PASS_CODE_CHANGED;
+            } else if (_remove_tac(block, tac)) {
+                res |= PASS_CODE_CHANGED;
+                goto NEXT;
+            }
+        }
+        if (def) _post_def(post_tac_map, def);
 
+        switch (tac->op) {
+            case TAC_MOV: _post_use(post_tac_map, tac->y); break;
+            case TAC_JE:
+            case TAC_JNE:
+            case TAC_JLT:
+            case TAC_JLE:
+            case TAC_JGT:
+            case TAC_JGE: {
+                _post_use(post_tac_map, tac->x);
+                _post_use(post_tac_map, tac->y);
                 break;
             }
-            case TAC_MOV: {
-                int *mark_word_x = hashmap_get(post_tac_map, &(struct PostTacEntry){.name = tac->x});
-                if (mark_word_x && _get_use(mark_word_x) && _get_last_op(mark_word_x) != MW_OP_ASSIGN) {
-                    _set_assigned(mark_word_x);
-                    _set_last_op(mark_word_x, MW_OP_ASSIGN);
-                } else {
-                    // not used, remove MOV
-                    if (tac->next) {
-                        tac->prev->next = tac->next;
-                        tac->next->prev = tac->prev;
-                    } else tac->prev->next = NULL;
-                    if (tac == block->head) return;
+            case TAC_RET:
+            case TAC_PARAM: _post_use(post_tac_map, tac->x); break;
+            case TAC_CALL: {
+                // callee may read any named var
+                for (int i = 0; i < post_tac_map->size; i++) post_tac_map->entries[i]->mark &= ~POST_DEAD_STORE;
+                break;
+            }
+            default:
+                if (_is_operation(tac->op)) {
+                    _post_use(post_tac_map, tac->x);
+                    _post_use(post_tac_map, tac->y);
                 }
+        }
 
-                if (tac->y[0] == 'V') {
-                    int *mark_word_y = hashmap_get(post_tac_map, &(struct PostTacEntry){.name = tac->y});
-
-                    if (mark_word_y) {
-                        _inc_use(mark_word_y);
-                        _set_last_op(mark_word_y, MW_OP_USE);
-                    } else {
-                        struct PostTacEntry *e_y = CREATE_STRUCT_P(PostTacEntry);
-                        e_y->name = tac->y;
-                        _inc_use(&e_y->mark_word);
-                        _set_last_op(&e_y->mark_word, MW_OP_USE);
-                        hashmap_put(post_tac_map, e_y);
-                    }
-                }
+    NEXT:
+        if (is_head) break;
+        tac = prev;
+    }
 
+    return transform ? res : _post_leave(post_tac_map, block);
+}
+
+// ---------------------Copy Propagation---------------------
+
+// drop copies into or out of var
+static void _copy_kill(struct FactTable *copy_facts, char *var) {
+    if (!*var) return;
+
+    struct NameEntry *e = _name_table_get(copy_facts->vars, var);
+    if (!e) return;
+
+    _fact_set(copy_facts, e->id, NULL);
+    for (struct Copier *c = copy_facts->copiers[e->id]; c; c = c->next)
+        if (_is_same_value(copy_facts->values[c->id], e->name)) _fact_set(copy_facts, c->id, NULL);
+}
+
+// the copy holds the name interned by the table, the var is remembered as a copier of it
+static void _copy_set(struct FactTable *copy_facts, char *var, char *copied) {
+    int id = _fact_id(copy_facts, var);
+    int copied_id = _fact_id(copy_facts, copied);
+
+    struct Copier *head = copy_facts->copiers[copied_id];
+    if (!head || head->id != id) {
+        struct Copier *c = arena_alloc(copy_facts->vars->arena, sizeof(struct Copier));
+        c->id = id;
+        c->next = head;
+        copy_facts->copiers[copied_id] = c;
+    }
+    _fact_set(copy_facts, id, copy_facts->vars->entries[copied_id]->name);
+}
+
+/*
+ * Global copy propagation, uses of x after MOV x, y are replaced by y till either one is assigned again.
+ * Facts are copies available at the end of the block, met the same way as constants.
+ */
+int copy_propagation(struct BasicBlock *block, void *ctx, bool transform) {
+    struct FactTable *copy_facts = ctx;
+    int               res = 0;
+    _fact_meet(copy_facts, block);
+
+    for (struct TAC *tac = block->head;; tac = tac->next) {
+        switch (tac->op) {
+            case TAC_MOV: {
+                _pre_replace(copy_facts, tac->y, transform, &res);
+                char *y = _pre_value(copy_facts, tac->y);
+                _copy_kill(copy_facts, tac->x);
+                if (_is_var(y) && strcmp(y, tac->x)) _copy_set(copy_facts, tac->x, y);
                 break;
             }
             case TAC_JE:
             case TAC_JNE:
-            case TAC_PARAM:
-            case TAC_RET: {
-                int *mark_word_x = hashmap_get(post_tac_map, &(struct PostTacEntry){.name = tac->x});
-
-                if (mark_word_x) {
-                    _inc_use(mark_word_x);
-                    _set_last_op(mark_word_x, MW_OP_USE);
-                } else {
-                    struct PostTacEntry *e_x = CREATE_STRUCT_P(PostTacEntry);
-                    e_x->name = tac->x;
-                    _inc_use(&e_x->mark_word);
-                    _set_last_op(&e_x->mark_word, MW_OP_USE);
-                    hashmap_put(post_tac_map, e_x);
-                    int *m_test = hashmap_get(post_tac_map, &(struct PostTacEntry){.name = tac->x});
-                    int  i = 0;
-                }
+            case TAC_JLT:
+            case TAC_JLE:
+            case TAC_JGT:
+            case TAC_JGE: {
+                _pre_replace(copy_facts, tac->x, transform, &res);
+                _pre_replace(copy_facts, tac->y, transform, &res);
+                break;
+            }
+            case TAC_RET:
+            case TAC_PARAM: {
+                _pre_replace(copy_facts, tac->x, transform, &res);
                 break;
             }
             case TAC_CALL: {
-                if (!*tac->res) break;
-
-                int *mark_word_res = hashmap_get(post_tac_map, &(struct PostTacEntry){.name = tac->res});
-                if (mark_word_res && _get_use(mark_word_res)) {
-                    _set_assigned(mark_word_res);
-                    _set_last_op(mark_word_res, MW_OP_ASSIGN);
-                } else tac->res[0] = '\0';
-
+                // callee may assign any named var, only copies between temp vars survive
+                for (int id = 0; id < copy_facts->vars->size; id++) {
+                    char *value = copy_facts->values[id];
+                    if (value && !(is_temp_var(copy_facts->vars->entries[id]->name) && is_temp_var(value))) _fact_set(copy_facts, id, NULL);
+                }
+                _copy_kill(copy_facts, tac->res);
                 break;
             }
-            case TAC_JMP:
-            case TAC_LABEL: break;
+            default:
+                if (_is_operation(tac->op)) {
+                    _pre_replace(copy_facts, tac->x, transform, &res);
+                    _pre_replace(copy_facts, tac->y, transform, &res);
+                    _copy_kill(copy_facts, tac->res);
+                }
         }
 
-        if (tac == block->head) return;
-        tac = tac->prev;
+        if (tac == block->tail) break;
     }
+
+    return transform ? res : _fact_leave(copy_facts, block);
 }
 
-#define BLOCK_Q_SIZE 100000
-struct BasicBlock *block_q[BLOCK_Q_SIZE] = {};
-int                q_h = 0, q_t = 0;
+// ---------------------Coalescing---------------------
 
-void _block_q_push(struct BasicBlock *block) {
-    int next_q_t = (q_t + 1) % BLOCK_Q_SIZE;
-    if (next_q_t != q_h) block_q[q_t++] = block;
-    else fprintf(stderr, "_block_q_push(), block_q is full\n");
+static void _count_temp_use(struct NameTable *uses, char *operand) {
+    if (is_temp_var(operand)) _name_table_put(uses, operand)->mark++;
 }
 
-struct BasicBlock *_block_q_pop() {
-    if (q_t == q_h) return NULL;
-    struct BasicBlock *b = block_q[q_h];
-    q_h = (q_h + 1) % BLOCK_Q_SIZE;
-    return b;
+static char *_temp_def(struct TAC *tac) {
+    char *def = NULL;
+    if (tac->op == TAC_MOV) def = tac->x;
+    else if (tac->op == TAC_CALL || _is_operation(tac->op)) def = tac->res;
+    return def && is_temp_var(def) ? def : NULL;
 }
 
-void _do_optimize_tac(struct BasicBlock *block) {
-    if (!block) return;
-
-    // computation & propagation optimization
-    pre_optimization(block);
-    block->visited = true;
-
-    // choose one not-visited successor of block
-    if (!block->successors_size) return;
-    struct BasicBlock *next_block = NULL;
-    int                i = 0;
-    for (; i < block->successors_size; i++) {
-        if (block->successors[i]->visited) continue;
-        next_block = block->successors[i];
-        _do_optimize_tac(next_block);
+/*
+ * Write results into the var they are copied to, if the temp var has no other use:
+ * ADD V#a, V#b, V#$t0; MOV V#c, V#$t0 => ADD V#a, V#b, V#c
+ * Returns the number of MOV removed.
+ */
+int coalesce_temps(struct CFGFunc *func) {
+    struct NameTable *uses = _create_name_table();
+    for (struct TAC *tac = func->start; tac; tac = cfg_func_next_tac(func, tac)) {
+        switch (tac->op) {
+            case TAC_MOV: _count_temp_use(uses, tac->y); break;
+            case TAC_RET:
+            case TAC_PARAM: _count_temp_use(uses, tac->x); break;
+            default:
+                if (_is_operation(tac->op) || is_cond_jump(tac->op)) {
+                    _count_temp_use(uses, tac->x);
+                    _count_temp_use(uses, tac->y);
+                }
+        }
     }
 
-    // redundancy optimization
-    for (i = 0; i < block->successors_size; i++) {
-        if (block->successors[i]->level < block->level) continue;
-        post_optimization(block->successors[i]);
+    int changed = 0;
+    for (struct TAC *tac = func->start; tac; tac = cfg_func_next_tac(func, tac)) {
+        char       *def = _temp_def(tac);
+        struct TAC *mov = tac->next;
+        if (!def || !mov || mov->op != TAC_MOV || mov->block != tac->block || strcmp(mov->y, def) || !strcmp(mov->x, def)) continue;
+        if (_name_table_get(uses, def)->mark != 1) continue;
+
+        strcpy(def, mov->x);
+        mov->prev->next = mov->next;
+        if (mov->next) mov->next->prev = mov->prev;
+        changed++;
     }
+
+    _free_name_table(uses);
+    if (changed) rebuild_cfg_func(func);
+    return changed;
 }
 
-void optimize_tac(struct BasicBlock *block) {
-    if (!block) return;
+// ---------------------Pass Registry---------------------
 
-    _init_pre_tac_map();
-    _init_post_tac_map();
+// each pass run on a function owns its name or fact table, so functions could be optimized concurrently
+static void *_create_pass_ctx(struct CFGFunc *func) {
+    return _create_name_table();
+}
 
-    _do_optimize_tac(block);
-    post_optimization(block);
+static void _free_pass_ctx(struct CFGFunc *func, void *ctx) {
+    _free_name_table(ctx);
+}
 
-    hashmap_free(pre_tac_map);
-    hashmap_free(post_tac_map);
+static void *_create_fact_ctx(struct CFGFunc *func) {
+    return _create_fact_table();
 }
 
-void print_cfg(struct CFG *cfg, bool only_reachable, bool split) {
-    if (!cfg) return;
+static void _free_fact_ctx(struct CFGFunc *func, void *ctx) {
+    _free_fact_table(ctx);
+}
 
-    struct BasicBlock *block = cfg->entry;
-    while (block) {
-        if (only_reachable && !block->visited) {
-            block = block->next;
-            continue;
-        }
-        print_tac_list(block->head, block->tail);
-        if (split) printf("\n");
-        block = block->next;
-    }
-}
\ No newline at end of file
+void register_optimization_passes() {
+    register_opt_pass("constprop", false, _create_fact_ctx, pre_optimization, _free_fact_ctx);
+    register_opt_pass("copyprop", false, _create_fact_ctx, copy_propagation, _free_fact_ctx);
+    register_opt_pass("dce", true, _create_pass_ctx, post_optimization, _free_pass_ctx);
+    register_func_pass("coalesce", coalesce_temps);
+    register_func_pass("simplifycfg", simplify_cfg);
+    register_func_pass("peephole", peephole_optimize);
+}
+
+struct PassPipeline *create_opt_level_pipeline(int opt_level) {
+    if (opt_level <= 0) return NULL;
+    return create_pass_pipeline(opt_level == 1 ? O1_PIPELINE : DEFAULT_PIPELINE);
+}
+
+void optimize_tac(struct CFG *cfg, struct ThreadPool *pool) {
+    struct PassPipeline *pipeline = create_pass_pipeline(DEFAULT_PIPELINE);
+    run_pass_pipeline(pipeline, cfg, pool);
+    free_pass_pipeline(pipeline);
+}
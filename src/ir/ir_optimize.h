@@ -1,34 +1,21 @@
 #ifndef IR_OPTIMIZE_H
 #define IR_OPTIMIZE_H
 
+#include "ir_cfg.h"
+#include "ir_pass.h"
 #include <stdbool.h>
 
-struct BasicBlock {
-    struct BasicBlock **successors;
-    int                 successors_size;
-    int                 successors_cap;
+#define O1_PIPELINE "simplifycfg,constprop,dce"
+#define DEFAULT_PIPELINE "simplifycfg,constprop,coalesce,copyprop,dce,peephole"
 
-    struct BasicBlock *next;
+int                  pre_optimization(struct BasicBlock *block, void *ctx, bool transform);
+int                  post_optimization(struct BasicBlock *block, void *ctx, bool transform);
+int                  copy_propagation(struct BasicBlock *block, void *ctx, bool transform);
+int                  coalesce_temps(struct CFGFunc *func);
+void                 register_optimization_passes();
+// pipeline of -O<opt_level>, NULL for -O0
+struct PassPipeline *create_opt_level_pipeline(int opt_level);
+// the default pipeline, functions are optimized concurrently on pool, or serially if pool is NULL
+void                 optimize_tac(struct CFG *cfg, struct ThreadPool *pool);
 
-    bool        is_func;
-    struct TAC *head;
-    struct TAC *tail;
-
-    bool visited;
-    int  level;
-};
-
-struct CFG {
-    struct BasicBlock *entry;
-    struct BasicBlock *exit;
-};
-
-struct BasicBlock *create_basic_block(struct TAC *tac);
-struct CFG        *create_cfg(struct TAC *tac);
-void               print_cfg(struct CFG *cfg, bool only_reachable, bool split);
-
-void pre_optimization(struct BasicBlock *block);
-void post_optimization(struct BasicBlock *block);
-void optimize_tac(struct BasicBlock *block);
-
-#endif
\ No newline at end of file
+#endif
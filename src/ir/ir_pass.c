@@ -0,0 +1,348 @@
+#include "ir_pass.h"
+#include "global.h"
+#include "ir.h"
+#include "ir_optimize.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// registered passes, the builtin ones are registered once on first use, by whichever thread comes first
+static struct OptPass **opt_passes;
+static int              opt_pass_size;
+static int              opt_pass_cap;
+static pthread_once_t   opt_passes_once = PTHREAD_ONCE_INIT;
+static _Thread_local bool registering_builtin; // builtin passes register themselves inside pthread_once
+
+static void _register_builtin_passes() {
+    registering_builtin = true;
+    register_optimization_passes();
+    registering_builtin = false;
+}
+
+static void _init_opt_passes() {
+    if (!registering_builtin) pthread_once(&opt_passes_once, _register_builtin_passes);
+}
+
+static struct OptPass *_register_pass(char *name) {
+    _init_opt_passes();
+    if (strlen(name) >= MAX_OPT_PASS_NAME_LEN) {
+        fprintf(stderr, "register_opt_pass(), pass name too long: %s\n", name);
+        exit(EXIT_FAILURE);
+    }
+    if (find_opt_pass(name)) {
+        fprintf(stderr, "register_opt_pass(), pass already registered: %s\n", name);
+        exit(EXIT_FAILURE);
+    }
+
+    if (opt_pass_size == opt_pass_cap) {
+        int              new_cap = opt_pass_cap ? opt_pass_cap << 1 : 8;
+        struct OptPass **passes = realloc(opt_passes, new_cap * sizeof(struct OptPass *));
+        if (!passes) {
+            fprintf(stderr, "register_opt_pass(), no enough memory\n");
+            exit(EXIT_FAILURE);
+        }
+        opt_passes = passes;
+        opt_pass_cap = new_cap;
+    }
+
+    struct OptPass *pass = CREATE_STRUCT_P(OptPass);
+    if (!pass) {
+        fprintf(stderr, "register_opt_pass(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    pass->name = name;
+    pass->enabled = true;
+    opt_passes[opt_pass_size++] = pass;
+    return pass;
+}
+
+void register_opt_pass(char *name, bool backward, void *(*begin)(struct CFGFunc *), int (*run)(struct BasicBlock *, void *, bool), void (*end)(struct CFGFunc *, void *)) {
+    struct OptPass *pass = _register_pass(name);
+    pass->backward = backward;
+    pass->begin = begin;
+    pass->run = run;
+    pass->end = end;
+}
+
+void register_func_pass(char *name, int (*run_func)(struct CFGFunc *)) {
+    _register_pass(name)->run_func = run_func;
+}
+
+struct OptPass *find_opt_pass(char *name) {
+    _init_opt_passes();
+    for (int i = 0; i < opt_pass_size; i++)
+        if (!strcmp(opt_passes[i]->name, name)) return opt_passes[i];
+    return NULL;
+}
+
+bool set_opt_pass_enabled(char *name, bool enabled) {
+    struct OptPass *pass = find_opt_pass(name);
+    if (!pass) return false;
+
+    pass->enabled = enabled;
+    return true;
+}
+
+void enable_all_opt_passes() {
+    _init_opt_passes();
+    for (int i = 0; i < opt_pass_size; i++) opt_passes[i]->enabled = true;
+}
+
+void print_opt_passes() {
+    _init_opt_passes();
+    for (int i = 0; i < opt_pass_size; i++)
+        printf("%-*s %s%s\n",
+               MAX_OPT_PASS_NAME_LEN,
+               opt_passes[i]->name,
+               opt_passes[i]->run_func ? "func" : opt_passes[i]->backward ? "backward" : "forward",
+               opt_passes[i]->enabled ? "" : ", disabled");
+}
+
+struct PassPipeline *create_pass_pipeline(char *pipeline) {
+    struct PassPipeline *p = CREATE_STRUCT_P(PassPipeline);
+    if (!p) {
+        fprintf(stderr, "create_pass_pipeline(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_init(&p->lock, NULL);
+
+    if (!strncmp(pipeline, "-passes=", 8)) pipeline += 8;
+    while (*pipeline) {
+        size_t len = strcspn(pipeline, ",");
+        char   name[MAX_OPT_PASS_NAME_LEN];
+        if (len && len < MAX_OPT_PASS_NAME_LEN) {
+            memcpy(name, pipeline, len);
+            name[len] = '\0';
+        }
+
+        struct OptPass *pass = len && len < MAX_OPT_PASS_NAME_LEN ? find_opt_pass(name) : NULL;
+        if (!pass) {
+            fprintf(stderr, "create_pass_pipeline(), unknown pass: %.*s\n", (int)len, pipeline);
+            free_pass_pipeline(p);
+            return NULL;
+        }
+
+        if (p->size == p->cap) {
+            int               new_cap = p->cap ? p->cap << 1 : 8;
+            struct PassStats *passes = realloc(p->passes, new_cap * sizeof(struct PassStats));
+            if (!passes) {
+                fprintf(stderr, "create_pass_pipeline(), no enough memory\n");
+                exit(EXIT_FAILURE);
+            }
+            p->passes = passes;
+            p->cap = new_cap;
+        }
+        p->passes[p->size++] = (struct PassStats){.pass = pass};
+
+        pipeline += len;
+        if (*pipeline == ',') pipeline++;
+    }
+    return p;
+}
+
+void free_pass_pipeline(struct PassPipeline *pipeline) {
+    if (!pipeline) return;
+
+    pthread_mutex_destroy(&pipeline->lock);
+    free(pipeline->passes);
+    free(pipeline);
+}
+
+static double _wall_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int _count_tac(struct CFGFunc *func) {
+    int size = 0;
+    for (struct TAC *tac = func->start; tac; tac = cfg_func_next_tac(func, tac)) size++;
+    return size;
+}
+
+struct Worklist {
+    struct BasicBlock **blocks;
+    int                 head;
+    int                 size;
+    int                 cap;
+};
+
+static void _worklist_push(struct Worklist *w, struct BasicBlock *block) {
+    if (block->queued || block->rpo < 0) return;
+
+    if (w->size == w->cap) {
+        // reuse the consumed part before growing
+        if (w->head > w->cap >> 1) {
+            memmove(w->blocks, w->blocks + w->head, (w->size - w->head) * sizeof(struct BasicBlock *));
+            w->size -= w->head;
+            w->head = 0;
+        } else {
+            int                 new_cap = w->cap ? w->cap << 1 : 64;
+            struct BasicBlock **blocks = realloc(w->blocks, new_cap * sizeof(struct BasicBlock *));
+            if (!blocks) {
+                fprintf(stderr, "_worklist_push(), no enough memory\n");
+                exit(EXIT_FAILURE);
+            }
+            w->blocks = blocks;
+            w->cap = new_cap;
+        }
+    }
+    w->blocks[w->size++] = block;
+    block->queued = true;
+}
+
+static struct BasicBlock *_worklist_pop(struct Worklist *w) {
+    if (w->head == w->size) return NULL;
+
+    struct BasicBlock *block = w->blocks[w->head++];
+    block->queued = false;
+    if (w->head == w->size) w->head = w->size = 0;
+    return block;
+}
+
+static bool _run_func_pass(struct CFGFunc *func, struct PassStats *stats, bool count_tac) {
+    double start = _wall_time();
+    int    tac_size = count_tac ? _count_tac(func) : 0;
+    trace_begin(stats->pass->name, "pass");
+    int changed = stats->pass->run_func(func);
+    trace_end();
+
+    stats->runs++;
+    stats->blocks_changed += changed;
+    if (count_tac) stats->tac_removed += tac_size - _count_tac(func);
+    stats->time += _wall_time() - start;
+    return changed;
+}
+
+// run pass on blocks of func till its facts reach a fixed point, then transform them, returns true if code changed
+static bool _run_pass(struct CFGFunc *func, struct PassStats *stats, bool count_tac) {
+    struct OptPass *pass = stats->pass;
+    if (pass->run_func) return _run_func_pass(func, stats, count_tac);
+
+    double          start = _wall_time();
+    int             tac_size = count_tac ? _count_tac(func) : 0;
+    trace_begin(pass->name, "pass");
+    void *ctx = pass->begin ? pass->begin(func) : NULL;
+
+    struct Worklist w = {0};
+    for (int i = 0; i < func->rpo_size; i++) {
+        struct BasicBlock *block = func->rpo[pass->backward ? func->rpo_size - 1 - i : i];
+        block->data = NULL;
+        _worklist_push(&w, block);
+    }
+
+    struct BasicBlock *block;
+    while ((block = _worklist_pop(&w))) {
+        if (!(pass->run(block, ctx, false) & PASS_FACTS_CHANGED)) continue;
+
+        if (pass->backward)
+            for (int i = 0; i < block->predecessors_size; i++) _worklist_push(&w, block->predecessors[i]);
+        else
+            for (int i = 0; i < block->successors_size; i++) _worklist_push(&w, block->successors[i]);
+    }
+
+    bool changed = false;
+    for (int i = 0; i < func->rpo_size; i++) {
+        if (!(pass->run(func->rpo[i], ctx, true) & PASS_CODE_CHANGED)) continue;
+
+        stats->blocks_changed++;
+        changed = true;
+    }
+
+    if (pass->end) pass->end(func, ctx);
+    for (int i = 0; i < func->rpo_size; i++) func->rpo[i]->data = NULL;
+    free(w.blocks);
+    trace_end();
+
+    stats->runs++;
+    if (count_tac) stats->tac_removed += tac_size - _count_tac(func);
+    stats->time += _wall_time() - start;
+    return changed;
+}
+
+struct FuncTask {
+    struct PassPipeline *pipeline;
+    struct CFGFunc      *func;
+};
+
+// run the pipeline again on the function while it changes, stats are merged into the pipeline at the end
+static void _optimize_func(void *arg) {
+    struct FuncTask     *task = arg;
+    struct PassPipeline *pipeline = task->pipeline;
+    struct CFGFunc      *func = task->func;
+
+    struct PassStats *stats = malloc(pipeline->size * sizeof(struct PassStats));
+    if (!stats) {
+        fprintf(stderr, "_optimize_func(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < pipeline->size; i++) stats[i] = (struct PassStats){.pass = pipeline->passes[i].pass};
+
+    trace_begin(func->name ? func->name : "top level", "optimize");
+    func->dirty = true;
+    for (int round = 0; round < MAX_OPTIMIZE_ROUNDS && func->dirty; round++) {
+        func->dirty = false;
+        for (int i = 0; i < pipeline->size; i++)
+            if (stats[i].pass->enabled) func->dirty |= _run_pass(func, &stats[i], pipeline->count_tac);
+    }
+    trace_end();
+
+    pthread_mutex_lock(&pipeline->lock);
+    for (int i = 0; i < pipeline->size; i++) {
+        pipeline->passes[i].runs += stats[i].runs;
+        pipeline->passes[i].time += stats[i].time;
+        pipeline->passes[i].tac_removed += stats[i].tac_removed;
+        pipeline->passes[i].blocks_changed += stats[i].blocks_changed;
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    free(stats);
+}
+
+void run_pass_pipeline(struct PassPipeline *pipeline, struct CFG *cfg, struct ThreadPool *pool) {
+    if (!pipeline || !cfg) return;
+
+    struct FuncTask *tasks = malloc(cfg->func_size * sizeof(struct FuncTask));
+    if (!tasks) {
+        fprintf(stderr, "run_pass_pipeline(), no enough memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < cfg->func_size; i++) {
+        tasks[i] = (struct FuncTask){pipeline, cfg->funcs[i]};
+        if (!cfg->funcs[i]->reachable) continue;
+
+        if (pool) thread_pool_submit(pool, _optimize_func, &tasks[i]);
+        else _optimize_func(&tasks[i]);
+    }
+    if (pool) thread_pool_wait(pool);
+    free(tasks);
+}
+
+int sprint_pass_pipeline(char *buf, size_t len, struct PassPipeline *pipeline) {
+    int size = snprintf(buf, len, "%s", "");
+    for (int i = 0; pipeline && i < pipeline->size && size < len; i++)
+        if (pipeline->passes[i].pass->enabled) size += snprintf(buf + size, len - size, "%s%s", size ? "," : "", pipeline->passes[i].pass->name);
+    return size < len ? size : len - 1;
+}
+
+void print_pass_stats(struct PassPipeline *pipeline) {
+    if (!pipeline) return;
+
+    double total = 0;
+    printf("%-*s %8s %12s %12s %14s\n", MAX_OPT_PASS_NAME_LEN, "pass", "runs", "time(ms)", "tac removed", "blocks changed");
+    for (int i = 0; i < pipeline->size; i++) {
+        struct PassStats *s = &pipeline->passes[i];
+        printf("%-*s %8d %12.3f %12d %14d%s\n",
+               MAX_OPT_PASS_NAME_LEN,
+               s->pass->name,
+               s->runs,
+               s->time * 1000,
+               s->tac_removed,
+               s->blocks_changed,
+               s->pass->enabled ? "" : " (disabled)");
+        total += s->time;
+    }
+    printf("%-*s %8s %12.3f\n", MAX_OPT_PASS_NAME_LEN, "total", "", total * 1000);
+}
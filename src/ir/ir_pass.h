@@ -0,0 +1,67 @@
+#ifndef IR_PASS_H
+#define IR_PASS_H
+
+#include "ir_cfg.h"
+#include "thread_pool.h"
+#include <pthread.h>
+#include <stdbool.h>
+
+// returned by passes on a block
+#define PASS_FACTS_CHANGED 1 // facts flowing out of the block changed, neighbours need a revisit
+#define PASS_CODE_CHANGED 2  // tac of the block changed
+
+#define MAX_OPT_PASS_NAME_LEN 32
+#define MAX_OPTIMIZE_ROUNDS 16
+
+/*
+ * A block pass visits reachable blocks of a function in reverse post-order (post-order if backward),
+ * blocks are revisited until facts of the pass reach a fixed point, then visited once more to transform with the final facts.
+ * Neighbours not visited yet should be taken as the most optimistic facts, they are settled at the fixed point.
+ * A func pass runs on the whole function at once, it may change the shape of the cfg and rebuilds it itself.
+ * Passes keep their state in the ctx created per function, never in globals, so functions could be optimized concurrently.
+ */
+struct OptPass {
+    char *name;
+    bool  backward; // facts flow from successors to predecessors
+    bool  enabled;
+
+    void *(*begin)(struct CFGFunc *func); // returns ctx of the pass run on func, could be NULL
+    int (*run)(struct BasicBlock *block, void *ctx, bool transform); // only computes facts if !transform
+    void (*end)(struct CFGFunc *func, void *ctx); // called after facts of func reach a fixed point, could be NULL
+
+    int (*run_func)(struct CFGFunc *func); // returns the number of blocks changed, set for func passes only
+};
+
+struct PassStats {
+    struct OptPass *pass;
+    int             runs;           // runs on a function
+    double          time;           // wall time in seconds, summed over functions
+    int             tac_removed;    // could be negative if the pass adds tac
+    int             blocks_changed; // blocks with code changed, counted once per run
+};
+
+struct PassPipeline {
+    struct PassStats *passes; // passes run in order, with stats of each
+    int               size;
+    int               cap;
+    pthread_mutex_t   lock;      // guards stats merged by concurrent functions
+    bool              count_tac; // tac_removed is counted, by walking the tac of a func before & after each pass run
+};
+
+void            register_opt_pass(char *name, bool backward, void *(*begin)(struct CFGFunc *), int (*run)(struct BasicBlock *, void *, bool), void (*end)(struct CFGFunc *, void *));
+void            register_func_pass(char *name, int (*run_func)(struct CFGFunc *));
+struct OptPass *find_opt_pass(char *name);
+bool            set_opt_pass_enabled(char *name, bool enabled);
+void            enable_all_opt_passes();
+void            print_opt_passes();
+
+// pipeline is a comma separated pass list, like "constprop,dce", optionally prefixed by "-passes="
+struct PassPipeline *create_pass_pipeline(char *pipeline);
+void                 free_pass_pipeline(struct PassPipeline *pipeline);
+// functions are optimized concurrently on pool, or serially if pool is NULL
+void                 run_pass_pipeline(struct PassPipeline *pipeline, struct CFG *cfg, struct ThreadPool *pool);
+// names of the enabled passes, like "constprop,dce", empty if pipeline is NULL, returns the length written, truncated to len - 1
+int                  sprint_pass_pipeline(char *buf, size_t len, struct PassPipeline *pipeline);
+void                 print_pass_stats(struct PassPipeline *pipeline);
+
+#endif
@@ -0,0 +1,210 @@
+#include "ir_peephole.h"
+#include "ir.h"
+#include "ir_gen.h"
+#include "arena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct PeepholeCtx {
+    struct CFGFunc *func;
+    struct Arena   *arena;   // owns targets
+    char          **targets; // copies of labels jumped to, sorted, may outlive jumps removed in this round
+    int             target_size;
+};
+
+/*
+ * Unlinked tac is not freed, LABEL tac may still be referred by the label map of the cfg.
+ * Blocks are not fixed up, the cfg is rebuilt after all rounds.
+ */
+static void _unlink_tac(struct TAC *tac) {
+    tac->prev->next = tac->next;
+    if (tac->next) tac->next->prev = tac->prev;
+}
+
+static bool _is_plain_label(struct TAC *tac) {
+    return tac->op == TAC_LABEL && !is_func_label(tac, FUNC_S_PREFIX) && !is_func_label(tac, FUNC_E_PREFIX);
+}
+
+static int _cmp_str(const void *a, const void *b) {
+    return strcmp(*(char **)a, *(char **)b);
+}
+
+static bool _is_target(struct PeepholeCtx *ctx, char *label) {
+    return ctx->target_size && bsearch(&label, ctx->targets, ctx->target_size, sizeof(char *), _cmp_str);
+}
+
+// ---------------------Patterns---------------------
+
+// MOV x, x
+static bool _rewrite_mov_self(struct PeepholeCtx *ctx, struct TAC **w) {
+    if (strcmp(w[0]->x, w[0]->y)) return false;
+
+    _unlink_tac(w[0]);
+    return true;
+}
+
+// MOV a, b; MOV c, a => MOV a, b; MOV c, b
+static bool _rewrite_mov_forward(struct PeepholeCtx *ctx, struct TAC **w) {
+    if (strcmp(w[1]->y, w[0]->x) || !strcmp(w[0]->x, w[0]->y)) return false;
+
+    strcpy(w[1]->y, w[0]->y);
+    return true;
+}
+
+// JMP L; LABEL L => LABEL L
+static bool _rewrite_jmp_next(struct PeepholeCtx *ctx, struct TAC **w) {
+    if (strcmp(w[0]->x, w[1]->x)) return false;
+
+    _unlink_tac(w[0]);
+    return true;
+}
+
+// JLT x, y, L; LABEL L => LABEL L
+static bool _rewrite_jcc_next(struct PeepholeCtx *ctx, struct TAC **w) {
+    if (strcmp(w[0]->res, w[1]->x)) return false;
+
+    _unlink_tac(w[0]);
+    return true;
+}
+
+// JLT x, y, L; JMP L => JMP L
+static bool _rewrite_jcc_same_jmp(struct PeepholeCtx *ctx, struct TAC **w) {
+    if (strcmp(w[0]->res, w[1]->x)) return false;
+
+    _unlink_tac(w[0]);
+    return true;
+}
+
+// JLT x, y, L; JMP M; LABEL L => JGE x, y, M; LABEL L
+static bool _rewrite_jcc_over_jmp(struct PeepholeCtx *ctx, struct TAC **w) {
+    if (w[0]->type == TAC_TYPE_FLOAT || strcmp(w[0]->res, w[2]->x)) return false;
+
+    w[0]->op = negate_cond_jump(w[0]->op);
+    strcpy(w[0]->res, w[1]->x);
+    _unlink_tac(w[1]);
+    return true;
+}
+
+// JMP L; MOV a, b => JMP L
+static bool _rewrite_dead_code(struct PeepholeCtx *ctx, struct TAC **w) {
+    if (w[1]->op == TAC_LABEL) return false;
+
+    _unlink_tac(w[1]);
+    return true;
+}
+
+// LABEL L never jumped to
+static bool _rewrite_dead_label(struct PeepholeCtx *ctx, struct TAC **w) {
+    if (!_is_plain_label(w[0]) || _is_target(ctx, w[0]->x)) return false;
+
+    _unlink_tac(w[0]);
+    return true;
+}
+
+// tried in order at each tac, a window is matched again after a rewrite
+static struct PeepholePattern patterns[] = {
+    {"mov_self",      1, {TAC_MOV},                      _rewrite_mov_self     },
+    {"mov_forward",   2, {TAC_MOV, TAC_MOV},             _rewrite_mov_forward  },
+    {"jmp_next",      2, {TAC_JMP, TAC_LABEL},           _rewrite_jmp_next     },
+    {"jcc_next",      2, {PEEP_JCC, TAC_LABEL},          _rewrite_jcc_next     },
+    {"jcc_same_jmp",  2, {PEEP_JCC, TAC_JMP},            _rewrite_jcc_same_jmp },
+    {"jcc_over_jmp",  3, {PEEP_JCC, TAC_JMP, TAC_LABEL}, _rewrite_jcc_over_jmp },
+    {"dead_code",     2, {PEEP_EXIT, PEEP_ANY},          _rewrite_dead_code    },
+    {"dead_label",    1, {TAC_LABEL},                    _rewrite_dead_label   },
+};
+
+#define PATTERN_SIZE (int)(sizeof(patterns) / sizeof(patterns[0]))
+
+// ---------------------Driver---------------------
+
+static bool _match_op(int op, struct TAC *tac) {
+    switch (op) {
+        case PEEP_ANY: return true;
+        case PEEP_JCC: return is_cond_jump(tac->op);
+        case PEEP_EXIT: return tac->op == TAC_JMP || tac->op == TAC_RET;
+        default: return tac->op == (enum TacOpCode)op;
+    }
+}
+
+// contiguous tac from tac on, returns the window size
+static int _fill_window(struct TAC *tac, struct TAC **w) {
+    int size = 0;
+    for (; tac && size < MAX_PEEPHOLE_WINDOW; tac = tac->next) {
+        if (tac->op == TAC_HEAD || is_func_label(tac, FUNC_S_PREFIX) || is_func_label(tac, FUNC_E_PREFIX)) break;
+        w[size++] = tac;
+    }
+    return size;
+}
+
+static void _collect_targets(struct PeepholeCtx *ctx) {
+    int cap = 0;
+    ctx->targets = NULL;
+    ctx->target_size = 0;
+    for (struct TAC *tac = ctx->func->start; tac; tac = cfg_func_next_tac(ctx->func, tac)) {
+        char *target = tac->op == TAC_JMP ? tac->x : is_cond_jump(tac->op) ? tac->res : NULL;
+        if (!target) continue;
+
+        if (ctx->target_size == cap) {
+            ctx->targets = arena_realloc(ctx->arena, ctx->targets, cap * sizeof(char *), (cap ? cap << 1 : 16) * sizeof(char *));
+            cap = cap ? cap << 1 : 16;
+        }
+        // rewrites may change the label in place
+        char *copy = arena_alloc(ctx->arena, strlen(target) + 1);
+        strcpy(copy, target);
+        ctx->targets[ctx->target_size++] = copy;
+    }
+    if (ctx->target_size) qsort(ctx->targets, ctx->target_size, sizeof(char *), _cmp_str);
+}
+
+// first pattern fired on the window at tac, NULL if none
+static struct PeepholePattern *_fire(struct PeepholeCtx *ctx, struct TAC *tac) {
+    struct TAC *w[MAX_PEEPHOLE_WINDOW];
+    int         size = _fill_window(tac, w);
+    for (int i = 0; i < PATTERN_SIZE; i++) {
+        struct PeepholePattern *p = &patterns[i];
+        if (p->size > size) continue;
+
+        int k = 0;
+        while (k < p->size && _match_op(p->ops[k], w[k])) k++;
+        if (k == p->size && p->rewrite(ctx, w)) return p;
+    }
+    return NULL;
+}
+
+int peephole_optimize(struct CFGFunc *func) {
+    struct PeepholeCtx ctx = {.func = func, .arena = create_arena()};
+    int                changed = 0;
+    for (int round = 0; round < MAX_PEEPHOLE_ROUNDS; round++) {
+        int round_changed = 0;
+        _collect_targets(&ctx);
+
+        // func->start is never rewritten, it is the S# label or the first tac of the top level code
+        for (struct TAC *tac = func->start, *next; tac; tac = next) {
+            next = cfg_func_next_tac(func, tac);
+            if (!next) break;
+
+            struct PeepholePattern *p = _fire(&ctx, next);
+            if (!p) continue;
+
+            __atomic_add_fetch(&p->fired, 1, __ATOMIC_RELAXED);
+            round_changed++;
+            // match again at the same place
+            next = tac;
+        }
+
+        changed += round_changed;
+        if (!round_changed) break;
+    }
+
+    free_arena(ctx.arena);
+    if (changed) rebuild_cfg_func(func);
+    return changed;
+}
+
+void print_peephole_stats() {
+    printf("%-16s %6s %8s\n", "pattern", "window", "fired");
+    for (int i = 0; i < PATTERN_SIZE; i++)
+        printf("%-16s %6d %8d\n", patterns[i].name, patterns[i].size, __atomic_load_n(&patterns[i].fired, __ATOMIC_RELAXED));
+}
@@ -0,0 +1,33 @@
+#ifndef IR_PEEPHOLE_H
+#define IR_PEEPHOLE_H
+
+#include "ir_cfg.h"
+
+#define MAX_PEEPHOLE_WINDOW 4
+#define MAX_PEEPHOLE_ROUNDS 8
+
+// op classes of a window slot, besides TAC op codes
+#define PEEP_ANY -2  // any tac
+#define PEEP_JCC -3  // JE/JNE/JLT/JLE/JGT/JGE
+#define PEEP_EXIT -4 // JMP or RET, control never falls through
+
+struct PeepholeCtx;
+
+/*
+ * A pattern matches a window of contiguous tac by the op of each slot,
+ * then rewrite checks the operands and rewrites the window, returns false if the operands do not match.
+ * Windows never cover LABEL S#/E# or cross a nested func body.
+ */
+struct PeepholePattern {
+    char *name;
+    int   size;
+    int   ops[MAX_PEEPHOLE_WINDOW];
+    bool (*rewrite)(struct PeepholeCtx *ctx, struct TAC **w);
+    int   fired; // rewrites done since start, updated atomically as functions may be optimized concurrently
+};
+
+// run patterns over the tac of func till nothing fires, rebuilds the cfg of func if changed, returns the number of rewrites
+int  peephole_optimize(struct CFGFunc *func);
+void print_peephole_stats();
+
+#endif
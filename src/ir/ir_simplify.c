@@ -0,0 +1,189 @@
+#include "ir_simplify.h"
+#include "ir.h"
+#include "ir_gen.h"
+#include "ir_fold.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_SIMPLIFY_ROUNDS 16
+
+/*
+ * Unlinked tac is not freed, LABEL tac may still be referred by the label map of the cfg.
+ * Blocks are not fixed up, the cfg must be rebuilt before use.
+ */
+static void _unlink_tac(struct TAC *tac) {
+    tac->prev->next = tac->next;
+    if (tac->next) tac->next->prev = tac->prev;
+}
+
+static bool _is_plain_label(struct TAC *tac) {
+    return tac && tac->op == TAC_LABEL && !is_func_label(tac, FUNC_S_PREFIX) && !is_func_label(tac, FUNC_E_PREFIX);
+}
+
+static char *_jump_target(struct TAC *tac) {
+    switch (tac->op) {
+        case TAC_JMP: return tac->x;
+        case TAC_JE:
+        case TAC_JNE:
+        case TAC_JLT:
+        case TAC_JLE:
+        case TAC_JGT:
+        case TAC_JGE: return tac->res;
+        default: return NULL;
+    }
+}
+
+// true if control reaches LABEL label right after tac, through labels only
+static bool _falls_to_label(struct TAC *tac, char *label) {
+    for (struct TAC *next = tac->next; _is_plain_label(next); next = next->next)
+        if (!strcmp(next->x, label)) return true;
+    return false;
+}
+
+// remove blocks not reachable from the entry, LABEL E# is kept to close the function
+static int _remove_unreachable_blocks(struct CFGFunc *func) {
+    int changed = 0;
+    for (struct BasicBlock *block = func->entry; block; block = block->next) {
+        if (block->rpo >= 0) continue;
+
+        // the tac after the tail could be of an enclosing func, optimized on another thread, it is not read
+        for (struct TAC *tac = block->head, *next;; tac = next) {
+            bool is_tail = tac == block->tail;
+            next = is_tail ? NULL : tac->next;
+            if (!is_func_label(tac, FUNC_E_PREFIX)) {
+                _unlink_tac(tac);
+                changed++;
+            }
+            if (is_tail) break;
+        }
+    }
+    return changed;
+}
+
+// the label the block of LABEL label passes control to at once, NULL if it does anything else
+static char *_thread_label(struct CFGFunc *func, char *label) {
+    struct TAC *tac = cfg_lookup_label(func->cfg, label);
+    struct TAC *next = tac->next;
+    if (!next) return NULL;
+
+    // LABEL L; JMP M
+    if (next->op == TAC_JMP && next->block == tac->block) return next->x;
+    // LABEL L; LABEL M
+    if (_is_plain_label(next) && next->block->func == func) return next->x;
+    return NULL;
+}
+
+// retarget jumps to blocks which only jump or fall through to another label
+static int _thread_jumps(struct CFGFunc *func) {
+    int changed = 0;
+    for (int i = 0; i < func->rpo_size; i++) {
+        struct TAC *tail = func->rpo[i]->tail;
+        char       *target = _jump_target(tail);
+        if (!target) continue;
+
+        char *label = target;
+        char *next;
+        // bounded, jumps may form a cycle
+        for (int hops = 0; hops < func->block_size && (next = _thread_label(func, label)) && strcmp(next, label); hops++) label = next;
+        if (label == target) continue;
+
+        strcpy(target, label);
+        changed++;
+    }
+    return changed;
+}
+
+/*
+ * Remove jumps to the label right after them, cond jumps on literals become JMP or nothing:
+ * JLT L#1, L#2, L => JMP L
+ * JMP L; LABEL L => LABEL L
+ * JE x, y, L; LABEL L => LABEL L
+ * JLT x, y, L; JMP M; LABEL L => JGE x, y, M; LABEL L
+ */
+static int _fold_jumps(struct CFGFunc *func) {
+    int changed = 0;
+    for (int i = 0; i < func->rpo_size; i++) {
+        struct TAC *tail = func->rpo[i]->tail;
+        char       *target = _jump_target(tail);
+        bool        taken;
+        if (!target) continue;
+
+        if (fold_cond_jump(tail, &taken)) {
+            if (taken) {
+                tail->op = TAC_JMP;
+                strcpy(tail->x, tail->res);
+                tail->y[0] = tail->res[0] = '\0';
+                target = tail->x;
+            } else {
+                _unlink_tac(tail);
+                changed++;
+                continue;
+            }
+            changed++;
+        }
+
+        if (_falls_to_label(tail, target)) {
+            _unlink_tac(tail);
+            changed++;
+            continue;
+        }
+
+        // a float compare is not negated, both JLT & JGE fall through if one side is NaN
+        struct TAC *next = tail->next;
+        if (tail->op != TAC_JMP && tail->type != TAC_TYPE_FLOAT && next && next->op == TAC_JMP && _falls_to_label(next, target)) {
+            tail->op = negate_cond_jump(tail->op);
+            strcpy(tail->res, next->x);
+            _unlink_tac(next);
+            changed++;
+        }
+    }
+    return changed;
+}
+
+static bool _falls_through(struct TAC *tac) {
+    return tac->op != TAC_JMP && tac->op != TAC_RET && !is_func_label(tac, FUNC_E_PREFIX);
+}
+
+/*
+ * Drop the label of a block entered only by falling through from the block before it,
+ * the block is merged into that one if it does not end with a branch.
+ */
+static int _merge_blocks(struct CFGFunc *func) {
+    int changed = 0;
+    for (struct BasicBlock *block = func->entry; block; block = block->next) {
+        struct BasicBlock *next = block->next;
+        if (block->rpo < 0 || !next || !_falls_through(block->tail)) continue;
+        if (next->predecessors_size != 1 || next->predecessors[0] != block) continue;
+        // a nested func body lies between them
+        if (block->tail->next != next->head || !_is_plain_label(next->head)) continue;
+        char *target = _jump_target(block->tail);
+        if (target && !strcmp(target, next->head->x)) continue;
+
+        _unlink_tac(next->head);
+        changed++;
+    }
+    return changed;
+}
+
+int simplify_cfg(struct CFGFunc *func) {
+    int changed = 0;
+    for (int round = 0; round < MAX_SIMPLIFY_ROUNDS; round++) {
+        int round_changed = 0;
+
+        int n = _remove_unreachable_blocks(func);
+        n += _thread_jumps(func);
+        if (n) rebuild_cfg_func(func);
+        round_changed += n;
+
+        if ((n = _fold_jumps(func))) rebuild_cfg_func(func);
+        round_changed += n;
+
+        if ((n = _merge_blocks(func))) rebuild_cfg_func(func);
+        round_changed += n;
+
+        changed += round_changed;
+        if (!round_changed) break;
+    }
+    return changed;
+}
@@ -0,0 +1,9 @@
+#ifndef IR_SIMPLIFY_H
+#define IR_SIMPLIFY_H
+
+#include "ir_cfg.h"
+
+// simplify the cfg of func and rebuild it, returns the number of changes
+int simplify_cfg(struct CFGFunc *func);
+
+#endif
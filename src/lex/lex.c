@@ -1,30 +1,33 @@
 #include "lex.h"
 #include "global.h"
+#include "time_report.h"
 #include <string.h>
 
-char                *filename;             // current parsing file name
-static char         *buffer;               // buffer of read file
-static unsigned long buffer_len;           // length of buffer
-char                 ch;                   // current parsing char, inits & ends with EOF
-int                  off;                  // current offset of buffer, starts from 0
-int                  row;                  // current row of file, starts from 1
-int                  col;                  // current col of file, starts from 0
-enum Token           tk;                   // current parsed token
-enum LitKind         lk;                   // lit kind, available only when tk is _lit
-char                 lexeme[MAX_LINE_LEN]; // lexeme string, available only when tk is _lit or _ident
-char                *lex_bad_msg;          // error message
+// lexer state is per thread, so files could be compiled concurrently
+_Thread_local char                *filename;             // current parsing file name
+static _Thread_local char         *buffer;               // buffer of read file
+static _Thread_local unsigned long buffer_len;           // length of buffer
+_Thread_local char                 ch;                   // current parsing char, inits & ends with EOF
+_Thread_local int                  off;                  // current offset of buffer, starts from 0
+_Thread_local int                  row;                  // current row of file, starts from 1
+_Thread_local int                  col;                  // current col of file, starts from 0
+_Thread_local enum Token           tk;                   // current parsed token
+_Thread_local enum LitKind         lk;                   // lit kind, available only when tk is _lit
+_Thread_local char                 lexeme[MAX_LINE_LEN]; // lexeme string, available only when tk is _lit or _ident
+_Thread_local char                *lex_bad_msg;          // error message
 
 bool lex_init(char *filepath, bool _debug) {
     if (filepath == NULL) perror("lexer: can not find source file");
 
     FILE *f = fopen(filepath, "r");
-    if (f == NULL) perror("Lexer: can not find source file");
-
-    char *full_name = strrchr(filepath, '/') + 1;
-    if (full_name == NULL) {
-        printf("Lexer: file suffix is illegal\n");
-        fclose(f);
+    if (f == NULL) {
+        perror("Lexer: can not find source file");
+        return false;
     }
+
+    // file name without dirs
+    char *full_name = strrchr(filepath, '/');
+    full_name = full_name ? full_name + 1 : filepath;
     char *suffix = strrchr(full_name, '.') + 1;
     if (suffix != NULL && strcmp(suffix, "sl")) {
         printf("Lexer: file suffix is illegal\n");
@@ -74,7 +77,15 @@ bool lex_init(char *filepath, bool _debug) {
     return true;
 }
 
+// timed once per token, _lex_next calls itself on newlines
 enum Token lex_next() {
+    time_phase_begin(PHASE_LEX);
+    enum Token _tk = _lex_next();
+    time_phase_end();
+    return _tk;
+}
+
+static enum Token _lex_next() {
     _next_skip_white_space();
 
     // reserved words/identifier
@@ -190,7 +201,7 @@ enum Token lex_next() {
     if (ch == EOF) return tk = _eof;
     if (ch == '\n') {
         _newline();
-        return lex_next();
+        return _lex_next();
     }
 
     // prefixed char symbols
@@ -201,7 +212,7 @@ enum Token lex_next() {
     if (pch == '\r') {
         if (ch == '\n') {
             _newline();
-            return lex_next();
+            return _lex_next();
         }
 
         lex_bad_msg = "illegal token";
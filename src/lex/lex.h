@@ -8,25 +8,26 @@
 #define MAX_WORD_LEN 256
 #define MAX_NUMBER_LEN 32
 
-extern bool         debug;
-extern char        *filename;
-extern char         ch;
-extern int          off;
-extern int          row;
-extern int          col;
-extern enum Token   tk;
-extern enum LitKind lk;
-extern char         lexeme[MAX_LINE_LEN];
-extern char        *lex_bad_msg;
+extern _Thread_local bool         debug;
+extern _Thread_local char        *filename;
+extern _Thread_local char         ch;
+extern _Thread_local int          off;
+extern _Thread_local int          row;
+extern _Thread_local int          col;
+extern _Thread_local enum Token   tk;
+extern _Thread_local enum LitKind lk;
+extern _Thread_local char         lexeme[MAX_LINE_LEN];
+extern _Thread_local char        *lex_bad_msg;
 
 bool       lex_init(char *filepath, bool debug);
 enum Token lex_next();
 
-static void _next_skip_white_space();
-static void _next_ch();
-static void _contract();
-static void _newline();
-static bool _scan_word();
-static bool _scan_number(bool float_part);
+static enum Token _lex_next();
+static void       _next_skip_white_space();
+static void       _next_ch();
+static void       _contract();
+static void       _newline();
+static bool       _scan_word();
+static bool       _scan_number(bool float_part);
 
 #endif
\ No newline at end of file
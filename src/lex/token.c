@@ -94,4 +94,4 @@ enum Token expr_start_tokens[EXPR_START_TOKEN_NUMBER] = {_lparen, _ident, _inc,
 
 enum Token basic_lit_tokens[BASIC_LIT_TOKEN_NUMBER] = {_lit, _true, _false};
 
-hashmap reserved_tk_map = NULL;
\ No newline at end of file
+_Thread_local struct TokenMap reserved_tk_map;
\ No newline at end of file
@@ -1,7 +1,7 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
-#include "c_hashmap.h"
+#include "swiss_map.h"
 #include <stdlib.h>
 #include <stdio.h>
 
@@ -101,41 +101,18 @@ struct TokenSymbol {
 
 extern struct TokenSymbol tk_symbols[];
 
-struct TokenMapping {
-    char      *name;
-    enum Token token;
-};
-
-static struct TokenMapping *tk_mapping_new(char *name, enum Token token) {
-    struct TokenMapping *t = calloc(1, sizeof(struct TokenMapping));
-    t->name = name;
-    t->token = token;
-    return t;
-}
-
-static void *get_tk_mapping_name(void *ele) {
-    return ((struct TokenMapping *)ele)->name;
-}
-
-static void *get_tk_mapping_token(void *ele) {
-    return &((struct TokenMapping *)ele)->token;
-}
-
-static void update_tk_mapping_token(void *ele1, void *ele2) {
-    ((struct TokenMapping *)ele1)->token = ((struct TokenMapping *)ele2)->token;
-}
+SWISS_STR_MAP(TokenMap, token_map, enum Token)
 
-extern hashmap reserved_tk_map;
+// built lazily by each thread
+extern _Thread_local struct TokenMap reserved_tk_map;
 
 // clang-format off
-#define TK_MAPPING(name_str) (struct TokenMapping){(name_str)}
-#define ADD_TK_MAPPING(T) hashmap_put(reserved_tk_map, tk_mapping_new((#T), (_##T)))
-#define GET_TK_MAPPING(name_str) (enum Token *)hashmap_get(reserved_tk_map, &TK_MAPPING(name_str))
+#define ADD_TK_MAPPING(T) (*token_map_put(&reserved_tk_map, (#T)) = (_##T))
+#define GET_TK_MAPPING(name_str) token_map_get(&reserved_tk_map, (name_str))
 // clang-format on
 
 static void reserved_tk_map_init() {
-    reserved_tk_map =
-        hashmap_new((_return + 1) << 1, &get_tk_mapping_name, &get_tk_mapping_token, &update_tk_mapping_token, &str_hash_func, &str_eq_func, &int_eq_func);
+    token_map_free(&reserved_tk_map);
 
     ADD_TK_MAPPING(int);
     ADD_TK_MAPPING(float);
@@ -156,8 +133,7 @@ static void reserved_tk_map_init() {
 };
 
 static enum Token lookup_reserved_tk(char *s) {
-    if (reserved_tk_map == NULL) reserved_tk_map_init();
-    if (reserved_tk_map == NULL) printf("Lexer: could not init reserved token map");
+    if (!reserved_tk_map.size) reserved_tk_map_init();
     enum Token *t = GET_TK_MAPPING(s);
     return t == NULL ? _not_exist : *t;
 }
@@ -1,6 +1,8 @@
 #include "semantic.h"
 #include "type.h"
 
+static struct Type bool_type = {_basic_type, {.basic_type = &basic_types[bool_lk]}};
+
 void manage_scope(struct AstNode *node, struct Scope *parent_scope, bool anonymous) {
     if (!node) return;
 
@@ -42,6 +44,7 @@ void manage_scope(struct AstNode *node, struct Scope *parent_scope, bool anonymo
 
             struct Scope *s = create_scope(parent_scope, name);
             s->is_func = true;
+            s->func_name = func_decl->name_expr->data.name_expr->value;
             // func params
             for (int i = 0; i < func_decl->param_size; i++) manage_scope(func_decl->param_decls[i], s, false);
             // body
@@ -101,7 +104,7 @@ void manage_scope(struct AstNode *node, struct Scope *parent_scope, bool anonymo
             // inits
             for (int i = 0; i < for_ctrl->inits_size; i++) manage_scope(for_ctrl->inits[i], s, false);
             // cond
-            manage_scope(for_ctrl->cond, parent_scope, false);
+            manage_scope(for_ctrl->cond, s, false);
             // updates
             for (int i = 0; i < for_ctrl->updates_size; i++) manage_scope(for_ctrl->updates[i], s, false);
             // body
@@ -275,20 +278,21 @@ struct Type *check_node_type(struct AstNode *node, struct Scope *parent_scope, s
 
             // lookup func symbol in scope
             struct Symbol *sym = scope_lookup_symbol_from_all(cur_scope, call_expr->func_expr->data.name_expr->value);
-            return sym->type->data.signature_type->ret_type;
+            for (int i = 0; i < call_expr->param_size; i++) check_node_type(call_expr->params[i], cur_scope, NULL, false);
+            return node->type = sym->type->data.signature_type->ret_type;
         }
         case INC_EXPR: {
             struct IncExpr *inc_expr = node->data.inc_expr;
 
             // return operand's type
-            return check_node_type(inc_expr->x, cur_scope, NULL, false);
+            return node->type = check_node_type(inc_expr->x, cur_scope, NULL, false);
         }
         case NAME_EXPR: {
             struct NameExpr *name_expr = node->data.name_expr;
 
             // lookup symbol in scope
             struct Symbol *sym = scope_lookup_symbol_from_all(cur_scope, name_expr->value);
-            if (sym) return sym->type;
+            if (sym) return node->type = sym->type;
 
             fprintf(stderr, "at %s:%d:%d:%d, can not find symbol: %s\n", node->pos->filename, node->pos->off, node->pos->row, node->pos->col, name_expr->value);
             exit(EXIT_FAILURE);
@@ -322,7 +326,7 @@ struct Type *check_node_type(struct AstNode *node, struct Scope *parent_scope, s
                 break;
             }
 
-            if (!type_y) return type_x;
+            if (!type_y) return node->type = operation->op == LNOT ? &bool_type : type_x;
 
             if (type_x->type_code != type_y->type_code ||
                 (type_x->type_code == _basic_type && type_x->data.basic_type->code != type_y->data.basic_type->code)) {
@@ -336,7 +340,9 @@ struct Type *check_node_type(struct AstNode *node, struct Scope *parent_scope, s
                 break;
             }
 
-            return type_x;
+            // comparisons & logical operations give bool
+            if (operation->op <= GE || operation->op == LAND || operation->op == LOR) return node->type = &bool_type;
+            return node->type = type_x;
         }
         case RETURN_CTRL: {
             struct ReturnCtrl *return_ctrl = node->data.return_ctrl;
@@ -380,7 +386,7 @@ struct Type *check_node_type(struct AstNode *node, struct Scope *parent_scope, s
             struct Type *t = CREATE_STRUCT_P(Type);
             t->type_code = _basic_type;
             t->data.basic_type = &basic_types[basic_lit->lk];
-            return t;
+            return node->type = t;
         }
         case BASIC_TYPE_DECL: return create_basic_type(node->data.basic_type_decl);
         case EMPTY_STMT:
@@ -5,23 +5,20 @@
 #include <string.h>
 
 // use to store previous token info when doing token preview
-static enum Token   prev_tk;                   // previous token
-static enum LitKind prev_lk;                   // previous lit kind
-static char         prev_lexeme[MAX_LINE_LEN]; // previous lexeme
+static _Thread_local enum Token   prev_tk;                   // previous token
+static _Thread_local enum LitKind prev_lk;                   // previous lit kind
+static _Thread_local char         prev_lexeme[MAX_LINE_LEN]; // previous lexeme
 
 #define MAX_BAD_MSG_LEN 1024
-char syntax_bad_msg[MAX_BAD_MSG_LEN] = {};
+_Thread_local char syntax_bad_msg[MAX_BAD_MSG_LEN] = {};
 
 static void _debug(char *msg) {
     if (debug) printf("%s\n", msg);
 }
 
-static void _excp() {
-    fprintf(stderr, "Syntaxer: %s\n", syntax_bad_msg);
-}
-
+// the message is printed before exiting, atexit handlers would run on another thread
 static void _error_exit() {
-    atexit(_excp);
+    fprintf(stderr, "Syntaxer: %s\n", syntax_bad_msg);
     exit(EXIT_FAILURE);
 }
 
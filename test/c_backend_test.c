@@ -0,0 +1,51 @@
+#include "syntax.h"
+#include "lex.h"
+#include "semantic.h"
+#include "ir_gen.h"
+#include "ir_optimize.h"
+#include "c_source.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define C_BACKEND_TEST_EXE "/tmp/squirrel_c_test"
+
+// compile the program through C & run it, globals printed should be the same as the interpreter
+void c_backend_test() {
+    if (!lex_init(TEST_DIR "/interp_test.sl", false)) {
+        printf("lexer init failed\n");
+        return;
+    }
+    struct AstNode *x = parse();
+    manage_scope(x, NULL, false);
+    check_node_type(x, NULL, NULL, false);
+    check_stmt(x, false, false);
+
+    struct TAC *tac = CREATE_STRUCT_P(TAC);
+    tac->op = TAC_HEAD;
+    struct TAC *root_tac = tac;
+    gen_tac_from_ast(x, &tac, NULL);
+
+    struct CFG *cfg = create_cfg(root_tac);
+    optimize_tac(cfg, NULL);
+    struct Interp *interp = create_interp(cfg->tac);
+
+    FILE *out = fopen(C_BACKEND_TEST_EXE ".c", "w");
+    if (!out) {
+        printf("can not open " C_BACKEND_TEST_EXE ".c\n");
+        return;
+    }
+    emit_c(interp, out);
+    fclose(out);
+
+    if (!compile_c(C_BACKEND_TEST_EXE ".c", C_BACKEND_TEST_EXE)) printf("c backend test: compile failed\n");
+    else {
+        printf("c backend:\n");
+        fflush(stdout);
+        int status = system(C_BACKEND_TEST_EXE);
+        printf("c backend test: exit status %d\n", status);
+    }
+
+    free_interp(interp);
+    free_cfg(cfg);
+}
@@ -0,0 +1,54 @@
+#include "ir.h"
+#include "ir_cfg.h"
+#include "global.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define CFG_TEST_TAC_SIZE 200000
+
+/*
+ * A long chain of blocks, each block jumps to the next one and back to the first one:
+ * LABEL L0; ADD; JE x, y, L1; JMP L0; LABEL L1; ...
+ * Recursive construction would overflow the stack on it.
+ */
+void cfg_test() {
+    struct TAC *root_tac = CREATE_STRUCT_P(TAC);
+    root_tac->op = TAC_HEAD;
+    struct TAC *tac = root_tac;
+
+    char label[32];
+    char next_label[32];
+    int  size = 0;
+    for (int i = 0; size < CFG_TEST_TAC_SIZE; i++) {
+        sprintf(label, "L%d", i);
+        sprintf(next_label, "L%d", i + 1);
+        tac = create_tac(tac, TAC_LABEL, label, NULL, NULL);
+        tac = create_tac(tac, TAC_ADD, "V#x", "L#1", "V#x");
+        tac = create_tac(tac, TAC_JE, "V#x", "V#y", next_label);
+        tac = create_tac(tac, TAC_JMP, "L0", NULL, NULL);
+        size += 4;
+    }
+    sprintf(label, "L%d", size / 4);
+    tac = create_tac(tac, TAC_LABEL, label, NULL, NULL);
+
+    clock_t     start = clock();
+    struct CFG *cfg = create_cfg(root_tac);
+    double      cost = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    struct CFGFunc *func = cfg->funcs[0];
+    printf("cfg test: %d tac, %d blocks, %d reachable, entry rpo: %d, last block rpo: %d, cost %.3fs\n",
+           size,
+           func->block_size,
+           func->rpo_size,
+           cfg->entry->rpo,
+           tac->block->rpo,
+           cost);
+
+    free_cfg(cfg);
+    while (root_tac) {
+        struct TAC *next = root_tac->next;
+        free(root_tac);
+        root_tac = next;
+    }
+}
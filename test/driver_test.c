@@ -0,0 +1,102 @@
+#include "driver.h"
+#include "ir_optimize.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define DRIVER_TEST_DIR "/tmp/squirrel_driver_test"
+
+static bool _same_file(char *path1, char *path2) {
+    FILE *f1 = fopen(path1, "r"), *f2 = fopen(path2, "r");
+    bool  same = f1 && f2;
+    while (same) {
+        int c1 = fgetc(f1), c2 = fgetc(f2);
+        same = c1 == c2;
+        if (c1 == EOF) break;
+    }
+    if (f1) fclose(f1);
+    if (f2) fclose(f2);
+    return same;
+}
+
+// the test programs compiled serially, in parallel & with funcs of each file optimized in parallel, outputs of each file should be the same
+void driver_test() {
+    char *files[] = {
+        TEST_DIR "/decl_test.sl",
+        TEST_DIR "/interp_test.sl",
+        TEST_DIR "/test_optimize.sl",
+        TEST_DIR "/vm_bench.sl",
+    };
+    char *names[] = {"decl_test", "interp_test", "test_optimize", "vm_bench"};
+    int   size = sizeof(files) / sizeof(files[0]);
+    mkdir(DRIVER_TEST_DIR, 0755);
+    mkdir(DRIVER_TEST_DIR "/serial", 0755);
+    mkdir(DRIVER_TEST_DIR "/parallel", 0755);
+    mkdir(DRIVER_TEST_DIR "/funcs", 0755);
+
+    char *suffixes[] = {"ast", "tac", "cfg", "s"};
+    for (enum EmitKind emit = EMIT_AST; emit <= EMIT_ASM; emit++) {
+        struct DriverOptions serial = {.opt_level = 2, .emit = emit, .out_dir = DRIVER_TEST_DIR "/serial", .jobs = 1};
+        struct DriverOptions parallel = {.opt_level = 2, .emit = emit, .out_dir = DRIVER_TEST_DIR "/parallel", .jobs = size};
+        struct DriverOptions funcs = {.opt_level = 2, .emit = emit, .out_dir = DRIVER_TEST_DIR "/funcs", .jobs = size * 4};
+        int                  failed = compile_files(files, size, &serial) + compile_files(files, size, &parallel) + compile_files(files, size, &funcs);
+
+        bool same = true;
+        for (int i = 0; i < size; i++) {
+            char path1[256], path2[256], path3[256];
+            sprintf(path1, DRIVER_TEST_DIR "/serial/%s.%s", names[i], suffixes[emit]);
+            sprintf(path2, DRIVER_TEST_DIR "/parallel/%s.%s", names[i], suffixes[emit]);
+            sprintf(path3, DRIVER_TEST_DIR "/funcs/%s.%s", names[i], suffixes[emit]);
+            same &= _same_file(path1, path2) && _same_file(path1, path3);
+        }
+        printf("driver test, emit %-3s: %d failed, same output: %s\n", suffixes[emit], failed, same ? "true" : "false");
+    }
+
+    // filled by the first run, the second one reads tac from the cache, outputs should not change
+    mkdir(DRIVER_TEST_DIR "/cached", 0755);
+    system("rm -rf " DRIVER_TEST_DIR "/cache");
+    struct DriverOptions cached = {.opt_level = 2, .emit = EMIT_ASM, .out_dir = DRIVER_TEST_DIR "/cached", .cache_dir = DRIVER_TEST_DIR "/cache"};
+    int                  failed = compile_files(files, size, &cached) + compile_files(files, size, &cached);
+    bool                 same = true;
+    for (int i = 0; i < size; i++) {
+        char path1[256], path2[256];
+        sprintf(path1, DRIVER_TEST_DIR "/serial/%s.s", names[i]);
+        sprintf(path2, DRIVER_TEST_DIR "/cached/%s.s", names[i]);
+        same &= _same_file(path1, path2);
+    }
+    printf("driver test, cache: %d failed, same output: %s\n", failed, same ? "true" : "false");
+
+    // the passes of -O2 given by --passes should give the same output, an unknown pass is illegal
+    char                *args[] = {"--passes=" DEFAULT_PIPELINE, "-o", DRIVER_TEST_DIR "/passes", "--pass-stats", "x.sl"};
+    char                *unknown[] = {"--passes=constprop,nope", "x.sl"};
+    char                *parsed[1];
+    struct DriverOptions passes;
+    int                  parsed_size;
+    bool                 illegal = !parse_driver_args(sizeof(unknown) / sizeof(unknown[0]), unknown, &passes, parsed, &parsed_size);
+    bool                 legal = parse_driver_args(sizeof(args) / sizeof(args[0]), args, &passes, parsed, &parsed_size);
+    mkdir(DRIVER_TEST_DIR "/passes", 0755);
+    failed = compile_files(files, size, &passes);
+    same = legal && illegal && passes.pass_stats;
+    for (int i = 0; i < size; i++) {
+        char path1[256], path2[256];
+        sprintf(path1, DRIVER_TEST_DIR "/serial/%s.s", names[i]);
+        sprintf(path2, DRIVER_TEST_DIR "/passes/%s.s", names[i]);
+        same &= _same_file(path1, path2);
+    }
+    printf("driver test, passes: %d failed, same output: %s\n", failed, same ? "true" : "false");
+
+    // a disabled pass is skipped by -O2 & left out of its names, till args are parsed again
+    char *disable[] = {"--disable-pass=peephole", "--pass-stats", "x.sl"};
+    char *disable_unknown[] = {"--disable-pass=nope", "x.sl"};
+    char  pass_names[256];
+    illegal = !parse_driver_args(sizeof(disable_unknown) / sizeof(disable_unknown[0]), disable_unknown, &passes, parsed, &parsed_size);
+    legal = parse_driver_args(sizeof(disable) / sizeof(disable[0]), disable, &passes, parsed, &parsed_size);
+    struct PassPipeline *pipeline = create_driver_pipeline(&passes);
+    sprint_pass_pipeline(pass_names, sizeof(pass_names), pipeline);
+    bool skipped = legal && illegal && !find_opt_pass("peephole")->enabled && !strstr(pass_names, "peephole") && pipeline->count_tac;
+    free_pass_pipeline(pipeline);
+    parse_driver_args(sizeof(args) / sizeof(args[0]), args, &passes, parsed, &parsed_size);
+    printf("driver test, disable pass: skipped: %s, enabled again: %s\n", skipped ? "true" : "false", find_opt_pass("peephole")->enabled ? "true" : "false");
+}
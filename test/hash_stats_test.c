@@ -0,0 +1,146 @@
+#include "syntax.h"
+#include "lex.h"
+#include "semantic.h"
+#include "ir_gen.h"
+#include "ir_optimize.h"
+#include "swiss_map.h"
+#include "c_hashmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HASH_STATS_DUMP "/tmp/squirrel_operand_names.txt"
+#define HASH_STATS_MAX_NAMES 65536
+
+SWISS_STR_MAP(NameSet, name_set, bool)
+
+struct NameDump {
+    struct NameSet set;
+    char          *names[HASH_STATS_MAX_NAMES];
+    int            size;
+};
+
+static void _add_name(struct NameDump *dump, char *name) {
+    if (!*name || dump->size == HASH_STATS_MAX_NAMES || name_set_get(&dump->set, name)) return;
+
+    char *copy = strdup(name);
+    *name_set_put(&dump->set, copy) = true;
+    dump->names[dump->size++] = copy;
+}
+
+static void _add_tac_names(struct NameDump *dump, struct TAC *tac) {
+    for (; tac; tac = tac->next) {
+        _add_name(dump, tac->x);
+        _add_name(dump, tac->y);
+        _add_name(dump, tac->res);
+    }
+}
+
+// operand & label names of the tac generated from the file, then of the optimized tac
+static void _dump_file(struct NameDump *dump, char *filepath) {
+    if (!lex_init(filepath, false)) {
+        printf("lexer init failed\n");
+        return;
+    }
+    struct AstNode *x = parse();
+    manage_scope(x, NULL, false);
+    check_node_type(x, NULL, NULL, false);
+    check_stmt(x, false, false);
+
+    struct TAC *tac = CREATE_STRUCT_P(TAC);
+    tac->op = TAC_HEAD;
+    struct TAC *root_tac = tac;
+    gen_tac_from_ast(x, &tac, NULL);
+    _add_tac_names(dump, root_tac);
+
+    struct CFG *cfg = create_cfg(root_tac);
+    optimize_tac(cfg, NULL);
+    _add_tac_names(dump, cfg->tac);
+    free_cfg(cfg);
+}
+
+// str_hash_func & int_hash of c_hashmap.h before they were replaced, without signed overflow
+static uint _old_str_hash(char *s) {
+    uint h = 0;
+    for (; *s; s++) h += h * 7 + *s;
+    return h;
+}
+
+static uint _old_int_hash(uint h) {
+    int i = (int)h;
+    return (uint)(i ^ (i >> 16));
+}
+
+static uint _new_str_hash(char *s) {
+    return (uint)str_hash_func(s);
+}
+
+static uint _new_int_hash(uint h) {
+    return (uint)int_hash((int)h);
+}
+
+static int _cmp_uint(const void *a, const void *b) {
+    uint x = *(uint *)a, y = *(uint *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Collisions of the 32-bit hash, and buckets of a chained map at load factor 0.75, the same as libc_hashmap.
+ * Probes of a hit are the entries walked in its chain, averaged over all names.
+ */
+static void _hash_stats(char *name, struct NameDump *dump, uint (*str_hash)(char *), uint (*mix)(uint)) {
+    int   n = dump->size;
+    uint  cap = round_up_power_of_2(n * 4 / 3 + 1);
+    uint *hashes = malloc(n * sizeof(uint));
+    int  *chains = calloc(cap, sizeof(int));
+    for (int i = 0; i < n; i++) {
+        hashes[i] = str_hash(dump->names[i]);
+        chains[mix(hashes[i]) & (cap - 1)]++;
+    }
+
+    qsort(hashes, n, sizeof(uint), _cmp_uint);
+    int collisions = 0;
+    for (int i = 1; i < n; i++) collisions += hashes[i] == hashes[i - 1];
+
+    int  used = 0, max_chain = 0;
+    long probes = 0;
+    for (uint b = 0; b < cap; b++) {
+        used += chains[b] > 0;
+        if (chains[b] > max_chain) max_chain = chains[b];
+        probes += (long)chains[b] * (chains[b] + 1) / 2;
+    }
+    printf("%-10s %10d %10u %10d %10d %10.3f\n", name, collisions, cap, used, max_chain, (double)probes / n);
+
+    free(hashes);
+    free(chains);
+}
+
+// old & new string hashes on the operand names of the test programs
+void hash_stats_test() {
+    struct NameDump *dump = calloc(1, sizeof(struct NameDump));
+    name_set_init(&dump->set);
+    char *files[] = {
+        TEST_DIR "/decl_test.sl",
+        TEST_DIR "/interp_test.sl",
+        TEST_DIR "/test_lex.sl",
+        TEST_DIR "/test_optimize.sl",
+        TEST_DIR "/vm_bench.sl",
+    };
+    for (int i = 0; i < sizeof(files) / sizeof(files[0]); i++) _dump_file(dump, files[i]);
+
+    FILE *out = fopen(HASH_STATS_DUMP, "w");
+    if (out) {
+        for (int i = 0; i < dump->size; i++) fprintf(out, "%s\n", dump->names[i]);
+        fclose(out);
+    }
+
+    printf("hash stats, %d operand names, dumped to " HASH_STATS_DUMP "\n", dump->size);
+    printf("%-10s %10s %10s %10s %10s %10s\n", "hash", "collisions", "buckets", "used", "max chain", "avg probes");
+    _hash_stats("h*7+c", dump, _old_str_hash, _old_int_hash);
+    _hash_stats("wyhash", dump, _new_str_hash, _new_int_hash);
+
+    for (int i = 0; i < dump->size; i++) free(dump->names[i]);
+    name_set_free(&dump->set);
+    free(dump);
+}
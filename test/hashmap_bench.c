@@ -0,0 +1,150 @@
+#include "c_hashmap.h"
+#include "swiss_map.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define HASHMAP_BENCH_KEYS 50000
+#define HASHMAP_BENCH_ROUNDS 3
+#define HASHMAP_BENCH_LOOKUPS 8 // lookups of each key per round
+
+SWISS_STR_MAP(BenchMap, bench_map, int)
+
+struct BenchEntry {
+    char *name;
+    int   value;
+};
+
+static void *_get_bench_entry_name(void *ele) {
+    return ((struct BenchEntry *)ele)->name;
+}
+
+static void *_get_bench_entry_value(void *ele) {
+    return &((struct BenchEntry *)ele)->value;
+}
+
+static void _update_bench_entry(void *ele1, void *ele2) {
+    ((struct BenchEntry *)ele1)->value = ((struct BenchEntry *)ele2)->value;
+}
+
+static double _now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// operand & label names the way ir_gen names them, sharing long prefixes
+static char **_gen_names(int size, char *prefix) {
+    char **names = malloc(size * sizeof(char *));
+    char   buf[64];
+    for (int i = 0; i < size; i++) {
+        switch (i % 3) {
+            case 0: sprintf(buf, "%sV#$t%d", prefix, i); break;
+            case 1: sprintf(buf, "%sV#x%d@f%d", prefix, i, i % 97); break;
+            default: sprintf(buf, "%sIF_TRUE#%d", prefix, i);
+        }
+        names[i] = strdup(buf);
+    }
+    return names;
+}
+
+struct BenchCost {
+    double insert, hit, miss, remove;
+    long   checksum;
+};
+
+static void _bench_c_hashmap(char **names, char **misses, struct BenchCost *cost) {
+    struct BenchEntry *entries = calloc(HASHMAP_BENCH_KEYS, sizeof(struct BenchEntry));
+    double             start = _now();
+    hashmap map = hashmap_new_default(_get_bench_entry_name, _get_bench_entry_value, _update_bench_entry, str_hash_func, str_eq_func, int_eq_func);
+    for (int i = 0; i < HASHMAP_BENCH_KEYS; i++) {
+        entries[i] = (struct BenchEntry){names[i], i};
+        hashmap_put(map, &entries[i]);
+    }
+    cost->insert = _now() - start;
+
+    start = _now();
+    for (int r = 0; r < HASHMAP_BENCH_LOOKUPS; r++)
+        for (int i = 0; i < HASHMAP_BENCH_KEYS; i++) cost->checksum += *(int *)hashmap_get(map, &(struct BenchEntry){.name = names[i]});
+    cost->hit = _now() - start;
+
+    start = _now();
+    for (int r = 0; r < HASHMAP_BENCH_LOOKUPS; r++)
+        for (int i = 0; i < HASHMAP_BENCH_KEYS; i++) cost->checksum += hashmap_get(map, &(struct BenchEntry){.name = misses[i]}) != NULL;
+    cost->miss = _now() - start;
+
+    start = _now();
+    for (int i = 0; i < HASHMAP_BENCH_KEYS; i++) hashmap_remove(map, &entries[i]);
+    cost->remove = _now() - start;
+
+    hashmap_free(map);
+    free(entries);
+}
+
+static void _bench_swiss_map(char **names, char **misses, struct BenchCost *cost) {
+    struct BenchMap map;
+    double          start = _now();
+    bench_map_init(&map);
+    for (int i = 0; i < HASHMAP_BENCH_KEYS; i++) *bench_map_put(&map, names[i]) = i;
+    cost->insert = _now() - start;
+
+    start = _now();
+    for (int r = 0; r < HASHMAP_BENCH_LOOKUPS; r++)
+        for (int i = 0; i < HASHMAP_BENCH_KEYS; i++) cost->checksum += *bench_map_get(&map, names[i]);
+    cost->hit = _now() - start;
+
+    start = _now();
+    for (int r = 0; r < HASHMAP_BENCH_LOOKUPS; r++)
+        for (int i = 0; i < HASHMAP_BENCH_KEYS; i++) cost->checksum += bench_map_get(&map, misses[i]) != NULL;
+    cost->miss = _now() - start;
+
+    start = _now();
+    for (int i = 0; i < HASHMAP_BENCH_KEYS; i++) bench_map_remove(&map, names[i]);
+    cost->remove = _now() - start;
+
+    bench_map_free(&map);
+}
+
+static void _best(struct BenchCost *best, struct BenchCost *cost, int round) {
+    if (!round || cost->insert < best->insert) best->insert = cost->insert;
+    if (!round || cost->hit < best->hit) best->hit = cost->hit;
+    if (!round || cost->miss < best->miss) best->miss = cost->miss;
+    if (!round || cost->remove < best->remove) best->remove = cost->remove;
+    best->checksum = cost->checksum;
+}
+
+static void _report(char *op, double c_cost, double swiss_cost, int ops) {
+    printf("%-8s %12.1f %12.1f %8.2fx\n", op, c_cost * 1e9 / ops, swiss_cost * 1e9 / ops, c_cost / swiss_cost);
+}
+
+// libc_hashmap vs the swiss table on names like the operands of the optimizer, best of rounds in ns per op
+void hashmap_bench() {
+    char **names = _gen_names(HASHMAP_BENCH_KEYS, "");
+    char **misses = _gen_names(HASHMAP_BENCH_KEYS, "M#");
+
+    struct BenchCost c_best = {0}, swiss_best = {0};
+    for (int r = 0; r < HASHMAP_BENCH_ROUNDS; r++) {
+        struct BenchCost c_cost = {0}, swiss_cost = {0};
+        _bench_c_hashmap(names, misses, &c_cost);
+        _bench_swiss_map(names, misses, &swiss_cost);
+        _best(&c_best, &c_cost, r);
+        _best(&swiss_best, &swiss_cost, r);
+    }
+
+    printf("hashmap bench, %d keys\n", HASHMAP_BENCH_KEYS);
+    printf("%-8s %12s %12s %9s\n", "op", "c_hashmap", "swiss_map", "speedup");
+    _report("insert", c_best.insert, swiss_best.insert, HASHMAP_BENCH_KEYS);
+    _report("hit", c_best.hit, swiss_best.hit, HASHMAP_BENCH_KEYS * HASHMAP_BENCH_LOOKUPS);
+    _report("miss", c_best.miss, swiss_best.miss, HASHMAP_BENCH_KEYS * HASHMAP_BENCH_LOOKUPS);
+    _report("remove", c_best.remove, swiss_best.remove, HASHMAP_BENCH_KEYS);
+    printf("same result: %s\n", c_best.checksum == swiss_best.checksum ? "true" : "false");
+
+    for (int i = 0; i < HASHMAP_BENCH_KEYS; i++) {
+        free(names[i]);
+        free(misses[i]);
+    }
+    free(names);
+    free(misses);
+}
@@ -0,0 +1,50 @@
+#include "syntax.h"
+#include "lex.h"
+#include "semantic.h"
+#include "ir_gen.h"
+#include "ir_optimize.h"
+#include "vm.h"
+
+#include <stdio.h>
+
+// runs the program unoptimized & optimized, on the interpreter & the vm, globals printed should be the same
+static void _interp(char *filepath, bool optimize) {
+    if (!lex_init(filepath, false)) {
+        printf("lexer init failed\n");
+        return;
+    }
+    struct AstNode *x = parse();
+    manage_scope(x, NULL, false);
+    check_node_type(x, NULL, NULL, false);
+    check_stmt(x, false, false);
+
+    struct TAC *tac = CREATE_STRUCT_P(TAC);
+    tac->op = TAC_HEAD;
+    struct TAC *root_tac = tac;
+    gen_tac_from_ast(x, &tac, NULL);
+
+    struct CFG *cfg = create_cfg(root_tac);
+    if (optimize) optimize_tac(cfg, NULL);
+
+    struct Interp *interp = create_interp(cfg->tac);
+    interp_run(interp);
+    printf("%s, %ld instrs executed:\n", optimize ? "optimized" : "unoptimized", interp->executed);
+    print_interp_globals(interp);
+
+    struct Bytecode *bc = create_bytecode(interp);
+    struct VM       *vm = create_vm(bc);
+    vm_run(vm);
+    printf("%s vm, %d words, %ld words executed:\n", optimize ? "optimized" : "unoptimized", bc->size, vm->executed);
+    print_vm_globals(vm);
+    if (optimize) print_bytecode(bc);
+    free_vm(vm);
+    free_bytecode(bc);
+    free_interp(interp);
+    free_cfg(cfg);
+}
+
+void interp_test() {
+    _interp(TEST_DIR "/interp_test.sl", false);
+    printf("\n");
+    _interp(TEST_DIR "/interp_test.sl", true);
+}
@@ -0,0 +1,119 @@
+#include "driver.h"
+#include "ir_file.h"
+#include "ir_optimize.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IR_FILE_TEST_PATH "/tmp/squirrel_ir_file_test.sqir"
+
+// successors of each block read in place are the blocks of the cfg written, in the same order
+static bool _same_edges(struct IrFile *file, struct CFG *cfg) {
+    struct IrFileFunc  *funcs = ir_file_funcs(file);
+    struct IrFileBlock *blocks = ir_file_blocks(file);
+    uint32_t           *edges = ir_file_edges(file);
+    if (ir_file_header(file)->funcs.size != cfg->func_size) return false;
+
+    for (int i = 0; i < cfg->func_size; i++) {
+        uint32_t b = funcs[i].first_block;
+        for (struct BasicBlock *block = cfg->funcs[i]->entry; block; block = block->next, b++) {
+            if (blocks[b].succ_size != block->successors_size || blocks[b].rpo != block->rpo) return false;
+            for (int k = 0; k < block->successors_size; k++)
+                if (edges[blocks[b].first_succ + k] != funcs[i].first_block + block->successors[k]->id) return false;
+        }
+    }
+    return true;
+}
+
+static bool _same_text(struct IrFile *file, struct CFG *cfg) {
+    char  *text1 = NULL, *text2 = NULL;
+    size_t size1, size2;
+    FILE  *out1 = open_memstream(&text1, &size1), *out2 = open_memstream(&text2, &size2);
+    fprint_cfg(out1, cfg, false, true);
+    fprint_ir_file(out2, file);
+    fclose(out1);
+    fclose(out2);
+
+    bool same = size1 == size2 && !memcmp(text1, text2, size1);
+    free(text1);
+    free(text2);
+    return same;
+}
+
+// a flipped byte in the tables is caught when opened, or leaves them in range
+static int _corrupt_opened(char *image, size_t size) {
+    int   opened = 0;
+    FILE *null_out = fopen("/dev/null", "w");
+    srand(1);
+    for (int round = 0; round < 200; round++) {
+        size_t at = sizeof(struct IrFileHeader) + rand() % (size - sizeof(struct IrFileHeader));
+        char   old = image[at];
+        image[at] ^= 1 << (rand() % 8);
+
+        FILE *out = fopen(IR_FILE_TEST_PATH, "wb");
+        fwrite(image, 1, size, out);
+        fclose(out);
+        struct IrFile *file = open_ir_file(IR_FILE_TEST_PATH);
+        if (file) {
+            opened++;
+            fprint_ir_file(null_out, file);
+            close_ir_file(file);
+        }
+        image[at] = old;
+    }
+    fclose(null_out);
+    return opened;
+}
+
+// write the optimized cfg, map it & read it in place
+void ir_file_test() {
+    struct PassPipeline *pipeline = create_opt_level_pipeline(2);
+    struct CFG          *cfg = compile_to_cfg(TEST_DIR "/interp_test.sl", pipeline, NULL, NULL, NULL);
+    FILE                *out = fopen(IR_FILE_TEST_PATH, "wb");
+    free_pass_pipeline(pipeline);
+    write_ir_file(out, cfg);
+    fclose(out);
+
+    struct IrFile *file = open_ir_file(IR_FILE_TEST_PATH);
+    if (!file) {
+        printf("ir file test: can not open " IR_FILE_TEST_PATH "\n");
+        return;
+    }
+    struct IrFileHeader *h = ir_file_header(file);
+    printf("ir file: %u bytes, %u funcs, %u blocks, %u edges, %u instrs, %u consts, %u bytes of strings\n",
+           h->size,
+           h->funcs.size,
+           h->blocks.size,
+           h->edges.size,
+           h->instrs.size,
+           h->consts.size,
+           h->strings.size);
+
+    struct IrFileConst *consts = ir_file_consts(file);
+    for (uint32_t i = 0; i < h->consts.size && i < 8; i++) {
+        char *type_names[] = {"none", "int", "float", "bool", "char", "string"};
+        printf("const %-12s %-6s ", ir_file_string(file, consts[i].name), type_names[consts[i].type]);
+        switch (consts[i].type) {
+            case TAC_TYPE_FLOAT: printf("%g\n", consts[i].f); break;
+            case TAC_TYPE_STRING: printf("\"%s\"\n", ir_file_string(file, consts[i].s)); break;
+            default: printf("%d\n", consts[i].i);
+        }
+    }
+    printf("same text: %s, same edges: %s\n", _same_text(file, cfg) ? "true" : "false", _same_edges(file, cfg) ? "true" : "false");
+
+    size_t size = file->size;
+    char  *image = malloc(size);
+    memcpy(image, file->base, size);
+    close_ir_file(file);
+    free_cfg(cfg);
+
+    image[0] = 'X';
+    out = fopen(IR_FILE_TEST_PATH, "wb");
+    fwrite(image, 1, size, out);
+    fclose(out);
+    printf("bad magic rejected: %s\n", open_ir_file(IR_FILE_TEST_PATH) ? "false" : "true");
+    image[0] = IR_FILE_MAGIC[0];
+    printf("corrupt images opened: %d of 200\n", _corrupt_opened(image, size));
+    free(image);
+}
@@ -0,0 +1,74 @@
+#include "syntax.h"
+#include "lex.h"
+#include "semantic.h"
+#include "ir_gen.h"
+#include "ir_optimize.h"
+#include "jit.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static struct Interp *_load(char *filepath) {
+    if (!lex_init(filepath, false)) {
+        printf("lexer init failed\n");
+        return NULL;
+    }
+    struct AstNode *x = parse();
+    manage_scope(x, NULL, false);
+    check_node_type(x, NULL, NULL, false);
+    check_stmt(x, false, false);
+
+    struct TAC *tac = CREATE_STRUCT_P(TAC);
+    tac->op = TAC_HEAD;
+    struct TAC *root_tac = tac;
+    gen_tac_from_ast(x, &tac, NULL);
+
+    struct CFG *cfg = create_cfg(root_tac);
+    optimize_tac(cfg, NULL);
+    struct Interp *interp = create_interp(cfg->tac);
+    free_cfg(cfg);
+    return interp;
+}
+
+static double _timed_run(struct Interp *interp) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    interp_run(interp);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return end.tv_sec - start.tv_sec + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// top level slots of two runs
+static bool _same_globals(struct Interp *interp, struct Value *expected) {
+    for (int i = 0; i < interp->funcs[0].slot_size; i++)
+        if (interp->stack[i].type != expected[i].type || interp->stack[i].i != expected[i].i) return false;
+    return true;
+}
+
+static void _jit_test(char *filepath, int threshold) {
+    struct Interp *interp = _load(filepath);
+    if (!interp) return;
+
+    double       interp_cost = _timed_run(interp);
+    int          size = interp->funcs[0].slot_size;
+    struct Value expected[size + 1];
+    memcpy(expected, interp->stack, size * sizeof(struct Value));
+
+    interp->jit = create_jit(interp, threshold);
+    double jit_cost = _timed_run(interp);
+    print_interp_globals(interp);
+    printf("\n");
+    print_jit_stats(interp->jit);
+    printf("interp %.3fs, jit %.3fs, %.2fx, same result: %s\n", interp_cost, jit_cost, interp_cost / jit_cost, _same_globals(interp, expected) ? "true" : "false");
+
+    free_jit(interp->jit);
+    free_interp(interp);
+}
+
+// interpreter alone vs funcs promoted to machine code once hot
+void jit_test() {
+    _jit_test(TEST_DIR "/interp_test.sl", 1);
+    printf("\n");
+    _jit_test(TEST_DIR "/vm_bench.sl", JIT_HOT_CALLS);
+}
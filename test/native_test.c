@@ -0,0 +1,53 @@
+#include "syntax.h"
+#include "lex.h"
+#include "semantic.h"
+#include "ir_gen.h"
+#include "ir_optimize.h"
+#include "x86_64.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NATIVE_TEST_EXE "/tmp/squirrel_native_test"
+
+// compile the program to a native executable & run it, globals printed should be the same as the interpreter
+void native_test() {
+    if (!lex_init(TEST_DIR "/interp_test.sl", false)) {
+        printf("lexer init failed\n");
+        return;
+    }
+    struct AstNode *x = parse();
+    manage_scope(x, NULL, false);
+    check_node_type(x, NULL, NULL, false);
+    check_stmt(x, false, false);
+
+    struct TAC *tac = CREATE_STRUCT_P(TAC);
+    tac->op = TAC_HEAD;
+    struct TAC *root_tac = tac;
+    gen_tac_from_ast(x, &tac, NULL);
+
+    struct CFG *cfg = create_cfg(root_tac);
+    optimize_tac(cfg, NULL);
+    struct Interp *interp = create_interp(cfg->tac);
+
+    FILE *out = fopen(NATIVE_TEST_EXE ".s", "w");
+    if (!out) {
+        printf("can not open " NATIVE_TEST_EXE ".s\n");
+        return;
+    }
+    struct RegAlloc *ra = emit_x86_64(interp, cfg, out);
+    fclose(out);
+    print_reg_alloc_stats(ra);
+    free_reg_alloc(ra);
+
+    if (!link_native(NATIVE_TEST_EXE ".s", NATIVE_TEST_EXE)) printf("native test: link failed\n");
+    else {
+        printf("native:\n");
+        fflush(stdout);
+        int status = system(NATIVE_TEST_EXE);
+        printf("native test: exit status %d\n", status);
+    }
+
+    free_interp(interp);
+    free_cfg(cfg);
+}
@@ -0,0 +1,100 @@
+#include "ir.h"
+#include "ir_optimize.h"
+#include "thread_pool.h"
+#include "global.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define OPTIMIZE_TEST_FUNC_SIZE 2000
+#define OPTIMIZE_TEST_BODY_SIZE 50
+#define OPTIMIZE_TEST_THREADS 4
+
+/*
+ * Lots of functions, each one computes a constant chain through temp vars:
+ * LABEL S#f; MOV V#a, L#1; ADD V#a, L#1, V#$t0; MOV V#a, V#$t0; ...; JE V#a, L#0, F_END; RET V#a S#f; LABEL F_END; RET L#0 S#f; LABEL E#f
+ */
+static struct TAC *_gen_funcs() {
+    struct TAC *root_tac = CREATE_STRUCT_P(TAC);
+    root_tac->op = TAC_HEAD;
+    struct TAC *tac = root_tac;
+
+    char name[32], label[32], temp[32];
+    int  temp_id = 0;
+    for (int i = 0; i < OPTIMIZE_TEST_FUNC_SIZE; i++) {
+        sprintf(name, "S#f%d", i);
+        sprintf(label, "F_END#%d", i);
+        tac = create_tac(tac, TAC_LABEL, name, NULL, NULL);
+        tac = create_tac(tac, TAC_MOV, "V#a", "L#1", NULL);
+        for (int j = 0; j < OPTIMIZE_TEST_BODY_SIZE; j++) {
+            sprintf(temp, "V#$t%d", temp_id++);
+            tac = create_tac(tac, TAC_ADD, "V#a", "L#1", temp);
+            tac = create_tac(tac, TAC_MOV, "V#a", temp, NULL);
+        }
+        tac = create_tac(tac, TAC_JE, "V#a", "L#0", label);
+        tac = create_tac(tac, TAC_RET, "V#a", name, NULL);
+        tac = create_tac(tac, TAC_LABEL, label, NULL, NULL);
+        tac = create_tac(tac, TAC_RET, "L#0", name, NULL);
+        name[0] = 'E';
+        tac = create_tac(tac, TAC_LABEL, name, NULL, NULL);
+    }
+    for (int i = 0; i < OPTIMIZE_TEST_FUNC_SIZE; i++) {
+        sprintf(name, "S#f%d", i);
+        tac = create_tac(tac, TAC_CALL, name, "L#0", NULL);
+    }
+    return root_tac;
+}
+
+static double _optimize(struct TAC *tac, struct ThreadPool *pool) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    struct CFG          *cfg = create_cfg(tac);
+    struct PassPipeline *pipeline = create_pass_pipeline("simplifycfg,constprop,dce");
+    run_pass_pipeline(pipeline, cfg, pool);
+    free_pass_pipeline(pipeline);
+    free_cfg(cfg);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return end.tv_sec - start.tv_sec + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static void _free_tac_list(struct TAC *tac) {
+    while (tac) {
+        struct TAC *next = tac->next;
+        free(tac);
+        tac = next;
+    }
+}
+
+// functions optimized concurrently should get the same tac as optimized serially
+void optimize_test() {
+    struct TAC        *serial = _gen_funcs();
+    struct TAC        *parallel = _gen_funcs();
+    struct ThreadPool *pool = create_thread_pool(OPTIMIZE_TEST_THREADS);
+
+    double serial_cost = _optimize(serial, NULL);
+    double parallel_cost = _optimize(parallel, pool);
+
+    int  size = 0;
+    bool same = true;
+    for (struct TAC *x = serial, *y = parallel; x || y; x = x->next, y = y->next, size++) {
+        if (!x || !y || x->op != y->op || strcmp(x->x, y->x) || strcmp(x->y, y->y) || strcmp(x->res, y->res)) {
+            same = false;
+            break;
+        }
+    }
+
+    printf("optimize test: %d funcs, %d tac left, serial cost %.3fs, %d threads cost %.3fs, same result: %s\n",
+           OPTIMIZE_TEST_FUNC_SIZE,
+           size,
+           serial_cost,
+           OPTIMIZE_TEST_THREADS,
+           parallel_cost,
+           same ? "true" : "false");
+
+    free_thread_pool(pool);
+    _free_tac_list(serial);
+    _free_tac_list(parallel);
+}
@@ -3,11 +3,12 @@
 #include "semantic.h"
 #include "ir_gen.h"
 #include "ir_optimize.h"
+#include "ir_peephole.h"
 
 #include <stdio.h>
 
 void syntax_test() {
-    if (!lex_init("/home/riicarus/proj/c_proj/squirrel/test/test_optimize.sl", true)) printf("lexer init failed\n");
+    if (!lex_init(TEST_DIR "/test_optimize.sl", true)) printf("lexer init failed\n");
     printf("\n");
     struct AstNode *x = parse();
 
@@ -49,7 +50,16 @@ void syntax_test() {
 
     printf("\n\n\n---------------------------------------------------------\n\n\nOptimized TAC:\n");
 
-    optimize_tac(cfg->entry);
+    struct PassPipeline *pipeline = create_pass_pipeline("-passes=simplifycfg,constprop,coalesce,copyprop,dce,peephole");
+    pipeline->count_tac = true;
+    run_pass_pipeline(pipeline, cfg, NULL);
     print_cfg(cfg, true, false);
+
+    printf("\n\n\n---------------------------------------------------------\n\n\nPass Stats:\n");
+    print_pass_stats(pipeline);
+    free_pass_pipeline(pipeline);
+
+    printf("\n\n\n---------------------------------------------------------\n\n\nPeephole Stats:\n");
+    print_peephole_stats();
     // print_tac_list(root_tac, NULL);
 }
\ No newline at end of file
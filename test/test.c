@@ -4,6 +4,19 @@ extern void token_test();
 extern void lexer_test();
 
 extern void syntax_test();
+extern void cfg_test();
+extern void optimize_test();
+extern void interp_test();
+extern void vm_bench();
+extern void native_test();
+extern void c_backend_test();
+extern void jit_test();
+extern void hashmap_bench();
+extern void hash_stats_test();
+extern void driver_test();
+extern void ir_file_test();
+extern void time_report_test();
+extern void trace_test();
 
 int main() {
     // token_test();
@@ -11,4 +24,43 @@ int main() {
 
     printf("\n\n\n---------------------------------------------------------\n\n\n");
     syntax_test();
-}
\ No newline at end of file
+
+    printf("\n\n\n---------------------------------------------------------\n\n\n");
+    cfg_test();
+
+    printf("\n\n\n---------------------------------------------------------\n\n\n");
+    optimize_test();
+
+    printf("\n\n\n---------------------------------------------------------\n\n\n");
+    interp_test();
+
+    printf("\n\n\n---------------------------------------------------------\n\n\n");
+    vm_bench();
+
+    printf("\n\n\n---------------------------------------------------------\n\n\n");
+    native_test();
+
+    printf("\n\n\n---------------------------------------------------------\n\n\n");
+    c_backend_test();
+
+    printf("\n\n\n---------------------------------------------------------\n\n\n");
+    jit_test();
+
+    printf("\n\n\n---------------------------------------------------------\n\n\n");
+    hashmap_bench();
+
+    printf("\n\n\n---------------------------------------------------------\n\n\n");
+    hash_stats_test();
+
+    printf("\n\n\n---------------------------------------------------------\n\n\n");
+    driver_test();
+
+    printf("\n\n\n---------------------------------------------------------\n\n\n");
+    ir_file_test();
+
+    printf("\n\n\n---------------------------------------------------------\n\n\n");
+    time_report_test();
+
+    printf("\n\n\n---------------------------------------------------------\n\n\n");
+    trace_test();
+}
@@ -0,0 +1,54 @@
+#include "driver.h"
+#include "ir_optimize.h"
+#include "time_report.h"
+
+#include <stdio.h>
+
+// phases of the test programs compiled one after another
+void time_report_test() {
+    char *files[] = {
+        TEST_DIR "/interp_test.sl",
+        TEST_DIR "/test_optimize.sl",
+        TEST_DIR "/vm_bench.sl",
+    };
+    struct PassPipeline *pipeline = create_opt_level_pipeline(2);
+    struct TimeReport    report = {0};
+    for (int i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        time_report_start();
+        struct CFG *cfg = compile_to_cfg(files[i], pipeline, NULL, NULL, NULL);
+        time_report_stop(&report);
+        free_cfg(cfg);
+    }
+    free_pass_pipeline(pipeline);
+
+    // nothing is recorded once stopped
+    time_phase_begin(PHASE_LEX);
+    time_phase_end();
+
+    double wall = 0;
+    bool   allocs_counted = true;
+    for (int i = 0; i < PHASE_SIZE; i++) {
+        wall += report.phases[i].wall;
+        if (i == PHASE_PARSE || i == PHASE_IR_GEN) allocs_counted = allocs_counted && report.phases[i].allocs;
+    }
+    printf("compiles: %d\n", report.compiles);
+    printf("phases within total: %s\n", wall <= report.total.wall ? "true" : "false");
+    printf("allocs counted: %s\n", allocs_counted ? "true" : "false");
+    fprint_time_report(stdout, &report, TIME_REPORT_TABLE);
+
+    // funcs optimized by pool workers are counted in the phase of the file, as if optimized by the thread itself
+    struct TimeReport   alone = {0}, pooled = {0};
+    struct ThreadPool  *pool = create_thread_pool(4);
+    pipeline = create_opt_level_pipeline(2);
+    for (int i = 0; i < 2; i++) {
+        time_report_start();
+        struct CFG *cfg = compile_to_cfg(files[0], pipeline, NULL, i ? pool : NULL, NULL);
+        time_report_stop(i ? &pooled : &alone);
+        free_cfg(cfg);
+    }
+    free_pass_pipeline(pipeline);
+    free_thread_pool(pool);
+    uint64_t alone_allocs = alone.phases[PHASE_OPTIMIZE].allocs, pooled_allocs = pooled.phases[PHASE_OPTIMIZE].allocs;
+    printf("pool allocs merged: %s\n", pooled_allocs >= alone_allocs ? "true" : "false");
+    printf("pool cpu merged: %s\n", pooled.phases[PHASE_OPTIMIZE].cpu > 0 && pooled.total.cpu >= pooled.phases[PHASE_OPTIMIZE].cpu ? "true" : "false");
+}
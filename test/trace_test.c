@@ -0,0 +1,49 @@
+#include "driver.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_TEST_PATH "/tmp/squirrel_trace_test.json"
+
+// occurrences of s in the file
+static int _count(char *text, char *s) {
+    int count = 0;
+    for (char *p = text; (p = strstr(p, s)); p += strlen(s)) count++;
+    return count;
+}
+
+// spans of a parallel compile, each begin should be ended
+void trace_test() {
+    char *files[] = {
+        TEST_DIR "/interp_test.sl",
+        TEST_DIR "/test_optimize.sl",
+        TEST_DIR "/vm_bench.sl",
+    };
+    struct DriverOptions options = {.opt_level = 2, .emit = EMIT_TAC, .out_dir = "/tmp", .jobs = 2, .trace_file = TRACE_TEST_PATH};
+    compile_files(files, sizeof(files) / sizeof(files[0]), &options);
+
+    FILE *f = fopen(TRACE_TEST_PATH, "r");
+    if (!f) {
+        printf("trace test: can not open " TRACE_TEST_PATH "\n");
+        return;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *text = calloc(size + 1, 1);
+    fread(text, 1, size, f);
+    fclose(f);
+
+    int begins = _count(text, "\"ph\": \"B\"");
+    printf("trace: %ld bytes, %d spans\n", size, begins);
+    printf("files: %d, phases: %d, funcs: %d, passes: %d\n",
+           _count(text, "\"cat\": \"file\""),
+           _count(text, "\"cat\": \"phase\""),
+           _count(text, "\"cat\": \"optimize\""),
+           _count(text, "\"cat\": \"pass\""));
+    printf("spans ended: %s\n", begins == _count(text, "\"ph\": \"E\"") ? "true" : "false");
+    printf("json closed: %s\n", size > 3 && !strcmp(text + size - 3, "]}\n") ? "true" : "false");
+    free(text);
+}
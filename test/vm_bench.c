@@ -0,0 +1,98 @@
+#include "syntax.h"
+#include "lex.h"
+#include "semantic.h"
+#include "ir_gen.h"
+#include "ir_optimize.h"
+#include "vm.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define VM_BENCH_ROUNDS 3
+
+static struct Interp *_load(char *filepath) {
+    if (!lex_init(filepath, false)) {
+        printf("lexer init failed\n");
+        return NULL;
+    }
+    struct AstNode *x = parse();
+    manage_scope(x, NULL, false);
+    check_node_type(x, NULL, NULL, false);
+    check_stmt(x, false, false);
+
+    struct TAC *tac = CREATE_STRUCT_P(TAC);
+    tac->op = TAC_HEAD;
+    struct TAC *root_tac = tac;
+    gen_tac_from_ast(x, &tac, NULL);
+
+    struct CFG *cfg = create_cfg(root_tac);
+    optimize_tac(cfg, NULL);
+    struct Interp *interp = create_interp(cfg->tac);
+    free_cfg(cfg);
+    return interp;
+}
+
+// best of rounds, in seconds
+static double _bench(struct VM *vm, enum VMDispatch dispatch) {
+    double best = 0;
+    vm->dispatch = dispatch;
+    for (int r = 0; r < VM_BENCH_ROUNDS; r++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        vm_run(vm);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double cost = end.tv_sec - start.tv_sec + (end.tv_nsec - start.tv_nsec) / 1e9;
+        if (!r || cost < best) best = cost;
+    }
+    return best;
+}
+
+// top level registers of the last run
+static bool _same_globals(struct VM *vm, struct Value *expected) {
+    int size = vm->bc->funcs[0].frame_size;
+    for (int i = 0; i < size; i++)
+        if (vm->stack[i].type != expected[i].type || vm->stack[i].i != expected[i].i) return false;
+    return true;
+}
+
+static void _report(char *name, struct VM *vm, double cost, double base_cost, struct Value *expected) {
+    printf("%-20s %8.3fs %6.2fx %12ld words, same result: %s\n",
+           name,
+           cost,
+           base_cost / cost,
+           vm->executed,
+           _same_globals(vm, expected) ? "true" : "false");
+}
+
+// switch vs threaded dispatch, before & after fusing profile-selected superinstructions
+void vm_bench() {
+    struct Interp *interp = _load(TEST_DIR "/vm_bench.sl");
+    if (!interp) return;
+
+    struct Bytecode *bc = create_bytecode(interp);
+    struct VM       *vm = create_vm(bc);
+
+    double switch_cost = _bench(vm, VM_DISPATCH_SWITCH);
+    int    size = bc->funcs[0].frame_size;
+    struct Value expected[size + 1];
+    memcpy(expected, vm->stack, size * sizeof(struct Value));
+    print_vm_globals(vm);
+    printf("\n");
+
+    _report("switch", vm, switch_cost, switch_cost, expected);
+    _report("threaded", vm, _bench(vm, VM_DISPATCH_THREADED), switch_cost, expected);
+
+    vm_profile(vm);
+    int fused = fuse_superinstructions(bc, vm->pair_counts, BC_MAX_SUPERS);
+    _report("switch + super", vm, _bench(vm, VM_DISPATCH_SWITCH), switch_cost, expected);
+    _report("threaded + super", vm, _bench(vm, VM_DISPATCH_THREADED), switch_cost, expected);
+
+    printf("\n%d pairs fused:\n", fused);
+    print_superinstructions();
+
+    free_vm(vm);
+    free_bytecode(bc);
+    free_interp(interp);
+}